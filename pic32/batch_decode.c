@@ -0,0 +1,203 @@
+/*
+ * Host-side batch decoder for recorded or generated sample files.
+ *
+ * Usage: batch_decode [-p] [-t telemetry.txt] [signals.txt]
+ *
+ * Decoded times are written to stdout in the same format as
+ * time_decoder_test.c, so the output can be diffed against time.txt.
+ * A throughput report is written to stderr. Reads stdin if no file is given.
+ * With -p, each block is bit-packed first and decoded a run at a time.
+ * With -t, the telemetry of the decoder is dumped to a file at the end, in
+ * a build with -DDECODER_TELEMETRY and decoder_telemetry.c.
+ *
+ * Build: gcc -std=c99 -O2 -march=native time_decoder.c frame_layout.c \
+ *            civil_time.c packed_samples.c batch_decoder.c test_support.c \
+ *            batch_decode.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch_decoder.h"
+#include "civil_time.h"
+#include "test_support.h"
+
+#ifdef DECODER_TELEMETRY
+#include "decoder_telemetry.h"
+#endif
+
+#define CHUNKSIZE (1 << 20)    /* bytes read per block when streaming */
+
+static int usePacked = 0;       /* decode through the bit-packed path */
+
+
+static void printSync(int err, time_t unixTime, int dst, void* context)
+{
+    FILE* out = context;
+    (void) dst;
+
+    if (err) {
+        fputs("Err: valid bits but encoding is invalid.\n", out);
+        return;
+    }
+
+    struct tm currentTime;
+    civilFromTime(unixTime, &currentTime);
+
+    fprintf(out, "%d-%02d-%02d %02d:%02d\n",
+            1900 + currentTime.tm_year, currentTime.tm_mon + 1,
+            currentTime.tm_mday, currentTime.tm_hour, currentTime.tm_min);
+}
+
+
+/* decode one block of ASCII samples */
+static void decodeChunk(timeDecoder* decoder, const char* samples, size_t count,
+                        batchStats* stats)
+{
+    static uint64_t words[CHUNKSIZE / PACKEDBITS];
+
+    if (!usePacked) {
+        decodeBatch(decoder, samples, count, stats, printSync, stdout);
+        return;
+    }
+
+    size_t packed = packSamples(samples, count, words);
+    decodePackedBatch(decoder, words, packed, stats, printSync, stdout);
+}
+
+
+/* decode the whole file through a read-only mapping */
+static int decodeMapped(int fd, timeDecoder* decoder, batchStats* stats)
+{
+    struct stat info;
+
+    if (fstat(fd, &info) || !S_ISREG(info.st_mode))
+        return 1;
+
+    /* nothing to decode, but not an error either */
+    if (info.st_size == 0)
+        return 0;
+
+    size_t size = info.st_size;
+    char* samples = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (samples == MAP_FAILED)
+        return 1;
+
+    posix_madvise(samples, size, POSIX_MADV_SEQUENTIAL);
+
+    /* hand the mapping over in blocks so the page cache can keep up */
+    for (size_t offset = 0; offset < size; offset += CHUNKSIZE) {
+        size_t count = size - offset < CHUNKSIZE ? size - offset : CHUNKSIZE;
+        decodeChunk(decoder, samples + offset, count, stats);
+    }
+
+    munmap(samples, size);
+    return 0;
+}
+
+
+/* decode a pipe or other stream in large blocks */
+static int decodeStream(int fd, timeDecoder* decoder, batchStats* stats)
+{
+    static char buffer[CHUNKSIZE];
+    ssize_t count;
+
+    while ((count = read(fd, buffer, CHUNKSIZE)) > 0)
+        decodeChunk(decoder, buffer, count, stats);
+
+    return count < 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    int fd = STDIN_FILENO;
+    int arg = 1;
+    const char* telemetryPath = NULL;
+
+    if (arg < argc && strcmp(argv[arg], "-p") == 0) {
+        usePacked = 1;
+        arg++;
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-t") == 0) {
+        telemetryPath = argv[arg + 1];
+        arg += 2;
+    }
+
+    if (argc - arg > 1) {
+        fprintf(stderr, "usage: %s [-p] [-t telemetry.txt] [signals.txt]\n",
+                argv[0]);
+        return 2;
+    }
+
+#ifndef DECODER_TELEMETRY
+    if (telemetryPath) {
+        fprintf(stderr, "%s: -t needs a build with -DDECODER_TELEMETRY\n",
+                argv[0]);
+        return 2;
+    }
+#endif
+
+    if (arg < argc && strcmp(argv[arg], "-") != 0) {
+        fd = open(argv[arg], O_RDONLY);
+
+        if (fd < 0) {
+            perror(argv[arg]);
+            return 1;
+        }
+    }
+
+    static char outBuffer[CHUNKSIZE];
+    setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    clearDecoderTelemetry(&decoder);
+
+    batchStats stats;
+    initBatchStats(&stats);
+
+    double start = now();
+
+    if (decodeMapped(fd, &decoder, &stats) && decodeStream(fd, &decoder, &stats)) {
+        perror("read");
+        return 1;
+    }
+
+    double elapsed = now() - start;
+    fflush(stdout);
+
+    /* guard against a zero interval on tiny inputs */
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "samples: %llu (%.3g samples/s)\n",
+            stats.samples, stats.samples / elapsed);
+    fprintf(stderr, "frames:  %llu (%.3g frames/s)\n",
+            stats.frames, stats.frames / elapsed);
+    fprintf(stderr, "syncs:   %llu, errors: %llu, elapsed: %.3f s\n",
+            stats.syncs, stats.errors, elapsed);
+
+#ifdef DECODER_TELEMETRY
+    if (telemetryPath) {
+        FILE* out = fopen(telemetryPath, "w");
+        int err = !out || writeDecoderTelemetry(out, &decoder.telemetry);
+
+        if ((out && fclose(out)) || err) {
+            perror(telemetryPath);
+            return 1;
+        }
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "batch_decoder.h"
+
+/* decode a full bit buffer and restart from the last marker on success */
+static int finishFrames(timeDecoder* decoder, syncCallback onSync,
+                        void* context)
+{
+    time_t unixTime = 0;
+    int dst = 0;
+    int err = updateTimeAndDate(decoder, &unixTime, &dst);
+
+    if (err)
+        initDecoder(decoder);
+    else
+        keepLastMarker(decoder);
+
+    if (onSync)
+        onSync(err, unixTime, dst, context);
+
+    return err;
+}
+
+
+static void updateStats(batchStats* stats, unsigned long long samples,
+                        unsigned long long syncs, unsigned long long fails)
+{
+    if (!stats)
+        return;
+
+    stats->samples += samples;
+    stats->frames  += 2 * (syncs + fails);
+    stats->syncs   += syncs;
+    stats->errors  += fails;
+}
+
+
+void initBatchStats(batchStats* stats)
+{
+    stats->samples = 0;
+    stats->frames  = 0;
+    stats->syncs   = 0;
+    stats->errors  = 0;
+}
+
+
+void decodeBatch(timeDecoder* decoder, const char* samples, size_t count,
+                 batchStats* stats, syncCallback onSync, void* context)
+{
+    unsigned long long used  = 0;
+    unsigned long long syncs = 0;
+    unsigned long long fails = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        int input = samples[i] - '0';
+
+        /* skip line breaks and anything else that is not a sample */
+        if (input != 0 && input != 1)
+            continue;
+
+        used++;
+
+        /* keep feeding samples until both frames are in the bit buffer */
+        if (updateDecoder(decoder, input) != 3)
+            continue;
+
+        if (finishFrames(decoder, onSync, context))
+            fails++;
+        else
+            syncs++;
+    }
+
+    updateStats(stats, used, syncs, fails);
+}
+
+
+void decodePackedBatch(timeDecoder* decoder, const uint64_t* words,
+                       size_t count, batchStats* stats, syncCallback onSync,
+                       void* context)
+{
+    unsigned long long syncs = 0;
+    unsigned long long fails = 0;
+
+    size_t pos = 0;
+
+    while (pos < count) {
+        int status;
+        pos = updateDecoderPacked(decoder, words, pos, count, &status);
+
+        /* keep feeding samples until both frames are in the bit buffer */
+        if (status != 3)
+            continue;
+
+        if (finishFrames(decoder, onSync, context))
+            fails++;
+        else
+            syncs++;
+    }
+
+    updateStats(stats, count, syncs, fails);
+}
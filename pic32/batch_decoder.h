@@ -0,0 +1,77 @@
+#ifndef BATCH_DECODER_H_
+#define BATCH_DECODER_H_
+
+#include <stddef.h>
+#include <time.h>
+
+#include "packed_samples.h"
+#include "time_decoder.h"
+
+/* Running totals for a batch decoding session */
+typedef struct {
+    unsigned long long samples;   /* raw samples fed to the decoder */
+    unsigned long long frames;    /* transmission frames handed to the decoder */
+    unsigned long long syncs;     /* frame pairs decoded successfully */
+    unsigned long long errors;    /* frame pairs with an invalid encoding */
+} batchStats;
+
+
+/*
+ * \brief Called once for every full bit buffer the decoder produces.
+ *
+ * \param err 0 if the time and date was decoded, 1 otherwise.
+ * \param time Decoded time, only valid if err is 0.
+ * \param dst Decoded DST status, only valid if err is 0.
+ * \param context Pointer passed through from decodeBatch.
+ */
+typedef void (*syncCallback)(int err, time_t time, int dst, void* context);
+
+
+/*
+ * \brief Reset the counters of a batchStats.
+ *
+ * \param stats Pointer to batchStats to reset.
+ */
+void initBatchStats(batchStats* stats);
+
+
+/*
+ * \brief Run a block of ASCII samples through the timeDecoder state machine.
+ *
+ * Samples are the characters '0' and '1', one per 100 ms as in signals.txt.
+ * Any other character is skipped. The decoder keeps its state between calls,
+ * so a large file can be decoded in consecutive blocks. After every decoded
+ * frame pair the decoder restarts from the last marker, the same way
+ * radio_clock.c does after a sync.
+ *
+ * \param decoder Pointer to an initialized timeDecoder.
+ * \param samples Pointer to the block of samples.
+ * \param count Number of characters in the block.
+ * \param stats Counters to update, may be NULL.
+ * \param onSync Callback for every decoded frame pair, may be NULL.
+ * \param context Pointer passed through to onSync.
+ */
+void decodeBatch(timeDecoder* decoder, const char* samples, size_t count,
+                 batchStats* stats, syncCallback onSync, void* context);
+
+
+/*
+ * \brief Run a block of packed samples through the timeDecoder state machine.
+ *
+ * Same as decodeBatch(), but for samples packed with packSamples(). Produces
+ * exactly the same decoder states and callbacks as decodeBatch() on the
+ * unpacked samples.
+ *
+ * \param decoder Pointer to an initialized timeDecoder.
+ * \param words Pointer to the packed samples.
+ * \param count Number of samples in the block.
+ * \param stats Counters to update, may be NULL.
+ * \param onSync Callback for every decoded frame pair, may be NULL.
+ * \param context Pointer passed through to onSync.
+ */
+void decodePackedBatch(timeDecoder* decoder, const uint64_t* words,
+                       size_t count, batchStats* stats, syncCallback onSync,
+                       void* context);
+
+
+#endif /* BATCH_DECODER_H_ */
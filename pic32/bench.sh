@@ -0,0 +1,4 @@
+# time the decoder and time keeping hot paths against this machine's baseline, written on the first run
+gcc -std=c99 -O2 -DRADIO_CLOCK_NO_MAIN time_decoder.c frame_layout.c civil_time.c wwvb_signal.c time_keeping.c sample_queue.c bit_ring.c frame_voter.c capture_recorder.c hal_linux.c spi_protocol.c radio_clock.c edge_filter.c micro_bench.c micro_bench_run.c -o micro_bench
+[ -f micro_bench.txt ] || ./micro_bench -w micro_bench.txt > /dev/null
+./micro_bench -b micro_bench.txt -t 50
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+
+#include "bit_ring.h"
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* bit received age bits before the last one */
+static char bitAge(const bitRing* ring, int age)
+{
+    return ring->bits[(ring->head - 1 - age + RINGSIZE) % RINGSIZE];
+}
+
+
+/* a marker, or an erased bit that could have been one */
+static int couldBeMarker(char bit)
+{
+    return bit == 'm' || bit == ERASURE;
+}
+
+
+/* check that the last bits could end count frames, before copying them */
+static int endsFrames(const bitRing* ring, int count)
+{
+    if (ring->count < count * FRAMESIZE)
+        return 0;
+
+    /* every frame starts and ends with a marker */
+    for (int age = 0; age < count * FRAMESIZE; age += FRAMESIZE)
+        if (!couldBeMarker(bitAge(ring, age)) ||
+            !couldBeMarker(bitAge(ring, age + FRAMESIZE - 1)))
+            return 0;
+
+    return 1;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initBitRing(bitRing* ring)
+{
+    ring->head  = 0;
+    ring->count = 0;
+}
+
+
+void pushBit(bitRing* ring, char bit)
+{
+    ring->bits[ring->head] = bit;
+    ring->head = (ring->head + 1) % RINGSIZE;
+
+    if (ring->count < RINGSIZE)
+        ring->count++;
+}
+
+
+int bridgeGap(bitRing* ring, long samples)
+{
+    long seconds = (samples + NSAMPLES / 2) / NSAMPLES;
+    long offset  = samples - seconds * NSAMPLES;
+
+    if (seconds < 1 || seconds > RINGSIZE ||
+        offset > GAPTOLERANCE || offset < -GAPTOLERANCE) {
+        initBitRing(ring);
+        return 1;
+    }
+
+    /* the new bit ends the last of the seconds */
+    for (long s = 1; s < seconds; s++)
+        pushBit(ring, ERASURE);
+
+    return 0;
+}
+
+
+void copyLastBits(const bitRing* ring, int count, char* bits)
+{
+    for (int i = 0; i < count; i++)
+        bits[i] = bitAge(ring, count - 1 - i);
+}
+
+
+int decodeRingFrames(const bitRing* ring, time_t* currentTime, int* dst)
+{
+    char frames[2 * FRAMESIZE];
+
+    if (!endsFrames(ring, 2))
+        return 1;
+
+    copyLastBits(ring, 2 * FRAMESIZE, frames);
+
+    return decodeFrames(frames, currentTime, dst);
+}
+
+
+int trackRingFrame(const bitRing* ring, time_t predicted, time_t* currentTime,
+                   int* dst)
+{
+    char   frame[FRAMESIZE];
+    time_t times[1 << MAXERASURES];
+    int    dsts[1 << MAXERASURES];
+
+    if (!endsFrames(ring, 1))
+        return 1;
+
+    copyLastBits(ring, FRAMESIZE, frame);
+
+    int count = decodeErasedFrame(frame, times, dsts);
+    int found = 0;
+
+    for (int i = 0; i < count; i++) {
+        /* 60 seconds has passed since the start of the frame */
+        time_t frameEnd = times[i] + 60;
+
+        /* a single frame has no second frame to confirm it, the clock does */
+        if (labs((long) (frameEnd - predicted)) > TRACKTOLERANCE)
+            continue;
+
+        /* erasures leave two different times close to the clock */
+        if (found && frameEnd != *currentTime)
+            return 1;
+
+        found = 1;
+        *currentTime = frameEnd;
+        *dst = dsts[i];
+    }
+
+    /* follow convention of returning 0 for success */
+    return !found;
+}
+
+
+int voteRingFrames(const bitRing* ring, time_t* currentTime, int* dst)
+{
+    char frames[RINGSIZE];
+    int  count = ring->count / FRAMESIZE;
+
+    /* the markers of the other frames are left to the vote */
+    if (count < MINVOTEFRAMES || !couldBeMarker(bitAge(ring, 0)))
+        return 1;
+
+    copyLastBits(ring, count * FRAMESIZE, frames);
+
+    return voteFrames(frames, count, currentTime, dst);
+}
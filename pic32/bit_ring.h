@@ -0,0 +1,129 @@
+#ifndef BIT_RING_H_
+#define BIT_RING_H_
+
+#include <time.h>
+
+#include "frame_layout.h"
+#include "frame_voter.h"
+#include "time_decoder.h"
+
+#define RINGSIZE (VOTEFRAMES * FRAMESIZE)    /* Number of received bits kept */
+#define TRACKTOLERANCE 2    /* Seconds a tracked frame may be off by */
+#define GAPTOLERANCE (NSAMPLES / 10)    /* Samples a bridged gap may be off whole seconds, 0.1 s */
+
+
+/*
+ * Sliding window over the last RINGSIZE received bits. Unlike the bit
+ * buffer of the timeDecoder it never has to be restarted: every new bit
+ * pushes out the oldest one, and a frame can be decoded whenever the last
+ * bits line up with its markers. Erased bits stay in the ring, so a bad
+ * pulse only costs the frames it is in, and only if it hides a field bit
+ * that can't be recovered.
+ */
+typedef struct {
+    char bits[RINGSIZE];    /* received bits, 0, 1, 'm' or ERASURE */
+    int  head;              /* slot for the next bit */
+    int  count;             /* number of bits in the ring */
+} bitRing;
+
+
+/*
+ * \brief Initialize an empty bitRing.
+ *
+ * \param ring Pointer to bitRing to initialize.
+ */
+void initBitRing(bitRing* ring);
+
+
+/*
+ * \brief Append a received bit, dropping the oldest if the ring is full.
+ *
+ * \param ring Pointer to bitRing to update.
+ * \param bit Received bit, 0, 1, 'm' or ERASURE.
+ */
+void pushBit(bitRing* ring, char bit);
+
+
+/*
+ * \brief Fill the seconds between the last bit and a new one with erasures.
+ *
+ * When the decoder loses the seconds on a bad pulse, the ring can keep its
+ * bits as long as the next pulse ends a whole number of seconds after the
+ * last one: every second in between gets an ERASURE bit. Otherwise, or if
+ * the gap is longer than the ring, the ring is emptied.
+ *
+ * \param ring Pointer to bitRing to update.
+ * \param samples Samples from the end of the last bit to the end of the
+ *        new one.
+ *
+ * \returns
+ *     0: The gap is whole seconds, and the new bit can be pushed after it.
+ *     1: The seconds no longer line up, and the ring was emptied.
+ */
+int bridgeGap(bitRing* ring, long samples);
+
+
+/*
+ * \brief Copy the last bits out of the ring.
+ *
+ * \param ring Pointer to bitRing.
+ * \param count Number of bits to copy, at most the number in the ring.
+ * \param bits Stores the bits, oldest first.
+ */
+void copyLastBits(const bitRing* ring, int count, char* bits);
+
+
+/*
+ * \brief Decode the last two frames, if the last bit ends the second one.
+ *
+ * \param ring Pointer to bitRing.
+ * \param currentTime Stores the time at the end of the last bit.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Error(s) in time signal, or the bits don't line up with two frames.
+ */
+int decodeRingFrames(const bitRing* ring, time_t* currentTime, int* dst);
+
+
+/*
+ * \brief Decode only the last frame and check it against a trusted time.
+ *
+ * Once the time is known, one frame is enough: instead of a second frame
+ * 60 seconds earlier, the predicted time confirms the decoded one.
+ *
+ * \param ring Pointer to bitRing.
+ * \param predicted Trusted time at the end of the last bit.
+ * \param currentTime Stores the time at the end of the last bit.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Error(s) in time signal, the bits don't line up with a frame,
+ *        or the frame is more than TRACKTOLERANCE seconds off.
+ */
+int trackRingFrame(const bitRing* ring, time_t predicted, time_t* currentTime,
+                   int* dst);
+
+
+/*
+ * \brief Decode the last frame by a vote over the frames in the ring.
+ *
+ * Takes as many whole frames as the ring holds, at least MINVOTEFRAMES,
+ * for voteFrames(). Meant for weak signals, where two error-free frames in
+ * a row are rare but most bits of most frames are right.
+ *
+ * \param ring Pointer to bitRing.
+ * \param currentTime Stores the time at the end of the last bit.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Too few frames in the ring, the last bit can't end a frame, or
+ *        the vote failed.
+ */
+int voteRingFrames(const bitRing* ring, time_t* currentTime, int* dst);
+
+
+#endif /* BIT_RING_H_ */
@@ -0,0 +1,186 @@
+/*
+ * Checks the sliding bit ring the way radio_clock.c uses it, and measures
+ * how long it takes to get back in sync after a dropout.
+ *
+ * A long capture of consecutive frames is broken up by bursts of noise.
+ * It is decoded once with two-frame decoding only, and once with single
+ * frames tracked against a clock that runs on from the last sync. Every
+ * decoded time must be right, and tracking must resync sooner. Then one
+ * sample of every minute is flipped, which must only erase single bits
+ * instead of costing whole frames.
+ *
+ * Build: gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c bit_ring.c frame_voter.c bit_ring_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bit_ring.h"
+#include "wwvb_signal.h"
+
+#define NMINUTES 2000
+#define NSAMPLESTOTAL ((long) NMINUTES * FRAMESAMPLES)
+#define DROPOUTGAP (10 * FRAMESAMPLES)    /* samples between dropouts */
+
+
+/* resyncs after dropouts and decoded times that were wrong */
+typedef struct {
+    int    syncs;
+    int    resyncs;
+    double latency;    /* total seconds from dropout end to the next sync */
+    int    wrong;
+} clockStats;
+
+
+/* consecutive frames from a random minute */
+time_t generateCapture(char* samples)
+{
+    time_t start = (time_t) (rand() % 1000000) * 60 + 946684800;
+
+    for (int m = 0; m < NMINUTES; m++) {
+        char frame[FRAMESIZE];
+        encodeFrame(start + 60 * m, 0, frame);
+        frameToSamples(frame, samples + (long) m * FRAMESAMPLES);
+    }
+
+    return start;
+}
+
+
+/* bursts of noise every DROPOUTGAP samples */
+void addDropouts(char* samples, long* dropoutEnds, int* dropouts)
+{
+    *dropouts = 0;
+
+    for (long s = DROPOUTGAP; s + DROPOUTGAP < NSAMPLESTOTAL; s += DROPOUTGAP) {
+        long begin = s + rand() % FRAMESAMPLES;
+        long end   = begin + (50 + rand() % 400) * (NSAMPLES / 10);
+
+        for (long i = begin; i < end; i++)
+            samples[i] = rand() % 2;
+
+        dropoutEnds[(*dropouts)++] = end;
+    }
+}
+
+
+/* decode like radio_clock.c, with or without single-frame tracking */
+void runClock(const char* samples, time_t start, const long* dropoutEnds,
+              int dropouts, int tracking, clockStats* stats)
+{
+    timeDecoder decoder;
+    bitRing ring;
+    initDecoder(&decoder);
+    initBitRing(&ring);
+
+    /* stands in for the time_keeper, running on from the last sync */
+    int    synced    = 0;
+    time_t syncTime  = 0;
+    long   syncIndex = 0;
+
+    int next = 0;
+    stats->syncs   = 0;
+    stats->resyncs = 0;
+    stats->latency = 0;
+    stats->wrong   = 0;
+
+    for (long i = 0; i < NSAMPLESTOTAL; i++) {
+        int status = updateDecoder(&decoder, samples[i]);
+
+        if (status == 3)
+            keepLastMarker(&decoder);
+
+        if (status == 1) {
+            initBitRing(&ring);
+            continue;
+        }
+
+        if (decoder.lastPulse == NOPULSE)
+            continue;
+
+        pushBit(&ring, decoder.lastPulse);
+
+        time_t predicted = syncTime + (i - syncIndex) / NSAMPLES;
+        time_t currentTime;
+        int dst;
+        int err = decodeRingFrames(&ring, &currentTime, &dst);
+
+        if (err && tracking && synced)
+            err = trackRingFrame(&ring, predicted, &currentTime, &dst);
+
+        if (err)
+            continue;
+
+        /* the falling edge at sample i starts the decoded second, or a
+         * glitch ended the pulse up to NSPADDING samples early */
+        if (currentTime != start + i / NSAMPLES &&
+            currentTime != start + (i + NSPADDING) / NSAMPLES)
+            stats->wrong++;
+
+        stats->syncs++;
+        synced    = 1;
+        syncTime  = currentTime;
+        syncIndex = i;
+
+        /* first sync after the last dropout */
+        if (next < dropouts && i >= dropoutEnds[next]) {
+            stats->latency += (double) (i - dropoutEnds[next]) / NSAMPLES;
+            stats->resyncs++;
+
+            while (next < dropouts && i >= dropoutEnds[next])
+                next++;
+        }
+    }
+}
+
+
+/* flip one random sample in every minute */
+void addGlitches(char* samples)
+{
+    for (long m = 0; m < NMINUTES; m++)
+        samples[m * FRAMESAMPLES + rand() % FRAMESAMPLES] ^= 1;
+}
+
+
+int main()
+{
+    static char samples[NSAMPLESTOTAL];
+    static long dropoutEnds[NSAMPLESTOTAL / DROPOUTGAP];
+    int dropouts;
+
+    srand(1);
+
+    time_t start = generateCapture(samples);
+    addDropouts(samples, dropoutEnds, &dropouts);
+
+    clockStats pairs, tracked;
+    runClock(samples, start, dropoutEnds, dropouts, 0, &pairs);
+    runClock(samples, start, dropoutEnds, dropouts, 1, &tracked);
+
+    printf("dropouts: %d\n", dropouts);
+    printf("two frames: %d resyncs, %.1f s mean latency, %d wrong\n",
+           pairs.resyncs, pairs.latency / pairs.resyncs, pairs.wrong);
+    printf("tracking:   %d resyncs, %.1f s mean latency, %d wrong\n",
+           tracked.resyncs, tracked.latency / tracked.resyncs, tracked.wrong);
+
+    int failed = pairs.wrong || tracked.wrong ||
+                 pairs.resyncs != dropouts || tracked.resyncs != dropouts ||
+                 tracked.latency >= pairs.latency;
+
+    /* no dropouts, but every frame has a bad pulse */
+    start = generateCapture(samples);
+    addGlitches(samples);
+
+    clockStats glitched;
+    runClock(samples, start, dropoutEnds, 0, 1, &glitched);
+
+    printf("glitches: %d syncs in %d minutes, %d wrong\n",
+           glitched.syncs, NMINUTES, glitched.wrong);
+
+    /* every frame with only an erased unused bit decodes on its own */
+    failed |= glitched.wrong || glitched.syncs < NMINUTES / 2;
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
@@ -0,0 +1,312 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "capture_file.h"
+#include "packed_samples.h"
+
+/* the last truth record at or before a sample, found going forward */
+typedef struct {
+    const captureFile*   file;
+    const captureChunk*  chunk;    /* index chunk of the next record */
+    uint32_t             next;     /* next record in it */
+    const captureRecord* last;     /* last truth record so far, or NULL */
+} truthCursor;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+static void initTruthCursor(truthCursor* cursor, const captureFile* file)
+{
+    cursor->file  = file;
+    cursor->chunk = nextChunk(file, NULL);
+    cursor->next  = 0;
+    cursor->last  = NULL;
+}
+
+
+/* the next truth record, or NULL, leaving the cursor on it */
+static const captureRecord* peekTruth(truthCursor* cursor)
+{
+    for (; cursor->chunk; cursor->chunk = nextChunk(cursor->file,
+                                                    cursor->chunk),
+                          cursor->next = 0) {
+        if (cursor->chunk->type != CHUNKINDEX)
+            continue;
+
+        const captureRecord* records = chunkRecords(cursor->chunk);
+
+        for (; cursor->next < cursor->chunk->count; cursor->next++)
+            if (records[cursor->next].kind == kindTruth)
+                return &records[cursor->next];
+    }
+
+    return NULL;
+}
+
+
+/* the last truth record at or before a sample, and within reach of it */
+static const captureRecord* truthBefore(truthCursor* cursor, uint32_t sample)
+{
+    const captureRecord* record;
+
+    while ((record = peekTruth(cursor)) && record->sample <= sample) {
+        cursor->last = record;
+        cursor->next++;
+    }
+
+    if (!cursor->last || sample - cursor->last->sample > REPLAYREACH)
+        return NULL;
+
+    return cursor->last;
+}
+
+
+/* decode a full bit buffer, check it and restart from the last marker */
+static void finishReplayPair(timeDecoder* decoder, truthCursor* cursor,
+                             uint32_t sample, replayStats* stats,
+                             replayCallback onSync, void* context)
+{
+    replaySync sync;
+    sync.sample   = sample;
+    sync.time     = 0;
+    sync.dst      = 0;
+    sync.err      = updateTimeAndDate(decoder, &sync.time, &sync.dst);
+    sync.checked  = 0;
+    sync.expected = 0;
+
+    if (sync.err)
+        initDecoder(decoder);
+    else
+        keepLastMarker(decoder);
+
+    const captureRecord* truth = sync.err ? NULL : truthBefore(cursor, sample);
+
+    if (truth) {
+        sync.checked  = 1;
+        sync.expected = truth->time + (sample - truth->sample) / NSAMPLES;
+    }
+
+    if (stats) {
+        stats->syncs   += !sync.err;
+        stats->errors  += sync.err != 0;
+        stats->checked += sync.checked;
+        stats->wrong   += sync.checked && (sync.time > sync.expected + 1 ||
+                                           sync.time < sync.expected - 1);
+    }
+
+    if (onSync)
+        onSync(&sync, context);
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+int mapCapture(const void* data, size_t size, captureFile* file)
+{
+    const captureHeader* header = data;
+
+    file->data   = data;
+    file->size   = size;
+    file->mapped = 0;
+    file->header = header;
+
+    /* payloads are read in place as 64 bit words */
+    if ((uintptr_t) data % 8 || size < sizeof(captureHeader) ||
+        header->magic != CAPTUREMAGIC || header->version != CAPTUREVERSION)
+        return 1;
+
+    size_t offset = sizeof(captureHeader);
+
+    while (offset < size) {
+        if (size - offset < sizeof(captureChunk))
+            return 1;
+
+        const captureChunk* chunk = (const captureChunk*) (file->data + offset);
+        size_t room = size - offset - sizeof(captureChunk);
+
+        if (chunk->size % 8 || chunk->size > room)
+            return 1;
+
+        if (chunk->type == CHUNKSAMPLES &&
+            chunk->size < (uint64_t) (chunk->count + 63) / 64 * 8)
+            return 1;
+
+        if (chunk->type == CHUNKINDEX &&
+            chunk->size < (uint64_t) chunk->count * sizeof(captureRecord))
+            return 1;
+
+        offset += sizeof(captureChunk) + chunk->size;
+    }
+
+    return 0;
+}
+
+
+int openCapture(const char* path, captureFile* file)
+{
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return 1;
+
+    if (fstat(fd, &info) || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+
+    size_t size = info.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return 1;
+
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    if (mapCapture(data, size, file)) {
+        munmap(data, size);
+        return 1;
+    }
+
+    file->mapped = 1;
+    return 0;
+}
+
+
+void closeCapture(captureFile* file)
+{
+    if (file->mapped)
+        munmap((void*) file->data, file->size);
+
+    file->mapped = 0;
+}
+
+
+const captureChunk* nextChunk(const captureFile* file,
+                              const captureChunk* chunk)
+{
+    size_t offset = chunk ? (size_t) ((const unsigned char*) chunk - file->data)
+                            + sizeof(captureChunk) + chunk->size
+                          : sizeof(captureHeader);
+
+    if (offset >= file->size)
+        return NULL;
+
+    return (const captureChunk*) (file->data + offset);
+}
+
+
+int writeCaptureHeader(FILE* out, uint32_t startTime)
+{
+    captureHeader header;
+    header.magic      = CAPTUREMAGIC;
+    header.version    = CAPTUREVERSION;
+    header.sampleRate = NSAMPLES;
+    header.startTime  = startTime;
+    header.flags      = 0;
+
+    return fwrite(&header, sizeof(header), 1, out) != 1;
+}
+
+
+int writeSampleChunk(FILE* out, uint32_t firstSample, uint32_t time,
+                     const uint64_t* words, uint32_t count)
+{
+    captureChunk chunk;
+    chunk.type        = CHUNKSAMPLES;
+    chunk.size        = sampleChunkSize(count);
+    chunk.firstSample = firstSample;
+    chunk.count       = count;
+    chunk.time        = time;
+    chunk.reserved    = 0;
+
+    return fwrite(&chunk, sizeof(chunk), 1, out) != 1 ||
+           fwrite(words, 1, chunk.size, out) != chunk.size;
+}
+
+
+int writeIndexChunk(FILE* out, const captureRecord* records, uint32_t count)
+{
+    static const char padding[8];
+
+    captureChunk chunk;
+    chunk.type        = CHUNKINDEX;
+    chunk.size        = indexChunkSize(count);
+    chunk.firstSample = 0;
+    chunk.count       = count;
+    chunk.time        = NOTIME;
+    chunk.reserved    = 0;
+
+    size_t bytes = count * sizeof(captureRecord);
+
+    return fwrite(&chunk, sizeof(chunk), 1, out) != 1 ||
+           fwrite(records, 1, bytes, out) != bytes ||
+           fwrite(padding, 1, chunk.size - bytes, out) != chunk.size - bytes;
+}
+
+
+void replayCapture(const captureFile* file, replayStats* stats,
+                   replayCallback onSync, void* context)
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    clearDecoderTelemetry(&decoder);
+
+    truthCursor cursor;
+    initTruthCursor(&cursor, file);
+
+    if (stats) {
+        stats->samples = 0;
+        stats->gaps    = 0;
+        stats->syncs   = 0;
+        stats->errors  = 0;
+        stats->checked = 0;
+        stats->wrong   = 0;
+    }
+
+    const captureChunk* chunk = NULL;
+    uint32_t next = 0;
+    int started = 0;
+
+    while ((chunk = nextChunk(file, chunk))) {
+        if (chunk->type != CHUNKSAMPLES)
+            continue;
+
+        /* samples are missing, earlier pulses no longer line up */
+        if (started && chunk->firstSample != next) {
+            initDecoder(&decoder);
+
+            if (stats)
+                stats->gaps++;
+        }
+
+        const uint64_t* words = chunkWords(chunk);
+        size_t pos = 0;
+
+        while (pos < chunk->count) {
+            int status;
+            pos = updateDecoderPacked(&decoder, words, pos, chunk->count,
+                                      &status);
+
+            if (status == 3)
+                finishReplayPair(&decoder, &cursor,
+                                 chunk->firstSample + (uint32_t) pos - 1,
+                                 stats, onSync, context);
+        }
+
+        if (stats)
+            stats->samples += chunk->count;
+
+        next    = chunk->firstSample + chunk->count;
+        started = 1;
+    }
+}
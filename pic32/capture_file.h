@@ -0,0 +1,177 @@
+#ifndef CAPTURE_FILE_H_
+#define CAPTURE_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "capture_format.h"
+#include "time_decoder.h"
+
+#define REPLAYREACH (3 * 60 * NSAMPLES)    /* samples a truth record reaches */
+
+
+/* a capture checked by mapCapture() or openCapture() */
+typedef struct {
+    const unsigned char* data;
+    size_t               size;
+    int                  mapped;    /* data is a mapping of the file */
+    const captureHeader* header;
+} captureFile;
+
+
+/* one frame pair decoded by replayCapture() */
+typedef struct {
+    uint32_t sample;      /* sample the bit buffer filled up at */
+    int      err;         /* 0 if the pair decoded */
+    time_t   time;        /* decoded time at the start of that sample */
+    int      dst;
+    int      checked;     /* a truth record was in reach */
+    time_t   expected;    /* time of the sample from that record */
+} replaySync;
+
+
+/* totals of replayCapture() */
+typedef struct {
+    unsigned long long samples;
+    unsigned long      gaps;       /* missing samples, the decoder restarted */
+    unsigned long      syncs;      /* frame pairs decoded */
+    unsigned long      errors;     /* frame pairs with an invalid encoding */
+    unsigned long      checked;    /* decoded pairs checked against the truth */
+    unsigned long      wrong;      /* more than a second off the truth */
+} replayStats;
+
+
+/*
+ * \brief Called for every full bit buffer of replayCapture().
+ *
+ * \param sync The sample, what was decoded and what was expected.
+ * \param context Pointer passed through from replayCapture().
+ */
+typedef void (*replayCallback)(const replaySync* sync, void* context);
+
+
+/*
+ * \brief Check a capture in memory and set up a captureFile for it.
+ *
+ * The data must be 8 byte aligned and stay valid while the captureFile is
+ * used. Every chunk must lie within the data, with a payload large enough
+ * for its count.
+ *
+ * \param data Pointer to the capture.
+ * \param size Bytes of the capture.
+ * \param file Set up to read the capture.
+ *
+ * \returns 0 if the capture is valid, 1 otherwise.
+ */
+int mapCapture(const void* data, size_t size, captureFile* file);
+
+
+/*
+ * \brief Map a capture file read-only and check it with mapCapture().
+ *
+ * \param path Path of the capture.
+ * \param file Set up to read the capture, close with closeCapture().
+ *
+ * \returns 0 if the capture is valid, 1 otherwise, with errno set if the
+ *          file could not be mapped.
+ */
+int openCapture(const char* path, captureFile* file);
+
+
+/*
+ * \brief Unmap a capture opened with openCapture().
+ *
+ * \param file Capture to close.
+ */
+void closeCapture(captureFile* file);
+
+
+/*
+ * \brief First chunk of a capture, or the one after a chunk.
+ *
+ * \param file Capture to read.
+ * \param chunk Chunk to go on from, NULL for the first.
+ *
+ * \returns Pointer to the chunk in the capture, NULL after the last.
+ */
+const captureChunk* nextChunk(const captureFile* file,
+                              const captureChunk* chunk);
+
+
+/*
+ * \brief Packed samples of a CHUNKSAMPLES chunk, without copying them.
+ */
+static inline const uint64_t* chunkWords(const captureChunk* chunk)
+{
+    return (const uint64_t*) (chunk + 1);
+}
+
+
+/*
+ * \brief Records of a CHUNKINDEX chunk, without copying them.
+ */
+static inline const captureRecord* chunkRecords(const captureChunk* chunk)
+{
+    return (const captureRecord*) (chunk + 1);
+}
+
+
+/*
+ * \brief Write the header of a capture.
+ *
+ * \param out Stream to write to.
+ * \param startTime UTC of sample 0, or NOTIME.
+ *
+ * \returns 0 on success, 1 if the stream failed.
+ */
+int writeCaptureHeader(FILE* out, uint32_t startTime);
+
+
+/*
+ * \brief Write a chunk of packed samples.
+ *
+ * \param out Stream to write to.
+ * \param firstSample Index of the first sample.
+ * \param time UTC of the first sample, or NOTIME.
+ * \param words Samples packed by packSamples(), unused bits cleared.
+ * \param count Number of samples.
+ *
+ * \returns 0 on success, 1 if the stream failed.
+ */
+int writeSampleChunk(FILE* out, uint32_t firstSample, uint32_t time,
+                     const uint64_t* words, uint32_t count);
+
+
+/*
+ * \brief Write a chunk of index records.
+ *
+ * \param out Stream to write to.
+ * \param records Records sorted by sample.
+ * \param count Number of records.
+ *
+ * \returns 0 on success, 1 if the stream failed.
+ */
+int writeIndexChunk(FILE* out, const captureRecord* records, uint32_t count);
+
+
+/*
+ * \brief Replay a capture through the timeDecoder state machine.
+ *
+ * The sample chunks are decoded in place with updateDecoderPacked(), and
+ * the decoder restarts from the last marker after every frame pair, the same
+ * way decodeBatch() does, or from scratch at a gap in the samples. Every
+ * decoded pair is checked against the last truth record within REPLAYREACH
+ * samples before it.
+ *
+ * \param file Capture to replay.
+ * \param stats Totals, may be NULL.
+ * \param onSync Called for every full bit buffer, may be NULL.
+ * \param context Pointer passed through to onSync.
+ */
+void replayCapture(const captureFile* file, replayStats* stats,
+                   replayCallback onSync, void* context);
+
+
+#endif /* CAPTURE_FILE_H_ */
@@ -0,0 +1,95 @@
+#ifndef CAPTURE_FORMAT_H_
+#define CAPTURE_FORMAT_H_
+
+#include <stdint.h>
+
+/*
+ * Binary capture of receiver samples, one bit per sample instead of the one
+ * character of signals.txt.
+ *
+ * A capture is a captureHeader followed by chunks. Every chunk is a
+ * captureChunk and a payload of size bytes, a multiple of 8, so every
+ * payload starts 8 byte aligned in the file and in a mapping of it.
+ *
+ *   chunkSamples  count samples from firstSample on, packed 64 to a
+ *                 little-endian word the same way as packSamples(), sample
+ *                 firstSample + i in bit i % 64 of word i / 64.
+ *   chunkIndex    count captureRecords, sorted by sample.
+ *
+ * Everything is little-endian, the byte order of the PIC32 and of x86, so
+ * both write and map captures as they are in memory. Sample chunks follow
+ * each other without gaps unless the recording was interrupted, and the
+ * decoder is restarted at a gap. Readers skip chunks of unknown types.
+ */
+
+#define CAPTUREMAGIC   0x50414357UL    /* "WCAP" */
+#define CAPTUREVERSION 1
+#define CHUNKSAMPLES   0x534D5053UL    /* "SPMS" */
+#define CHUNKINDEX     0x58444E49UL    /* "INDX" */
+#define NOTIME         0               /* time of a sample is unknown */
+
+
+/* start of a capture file, 16 bytes */
+typedef struct {
+    uint32_t magic;         /* CAPTUREMAGIC */
+    uint16_t version;       /* CAPTUREVERSION */
+    uint16_t sampleRate;    /* samples per second, NSAMPLES */
+    uint32_t startTime;     /* UTC of sample 0, or NOTIME */
+    uint32_t flags;         /* none defined yet, 0 */
+} captureHeader;
+
+
+/* start of every chunk, 24 bytes */
+typedef struct {
+    uint32_t type;          /* CHUNKSAMPLES or CHUNKINDEX */
+    uint32_t size;          /* payload bytes after this, a multiple of 8 */
+    uint32_t firstSample;   /* index of the first sample, 0 for an index */
+    uint32_t count;         /* samples or records in the payload */
+    uint32_t time;          /* UTC of the first sample, or NOTIME */
+    uint32_t reserved;
+} captureChunk;
+
+
+/* kinds of index records */
+enum RECORDKIND {
+    kindTruth,      /* the minute starting at sample, known to be right */
+    kindSync        /* what the clock synced to at sample */
+};
+
+
+/* one index record, 12 bytes */
+typedef struct {
+    uint32_t sample;    /* index of the sample */
+    uint32_t time;      /* UTC at the start of that sample */
+    uint16_t kind;      /* kindTruth or kindSync */
+    uint16_t dst;       /* 1 if DST was in effect */
+} captureRecord;
+
+
+/*
+ * \brief Payload bytes of a sample chunk.
+ *
+ * \param count Samples in the chunk.
+ *
+ * \returns Bytes, rounded up to whole 64 bit words.
+ */
+static inline uint32_t sampleChunkSize(uint32_t count)
+{
+    return (count + 63) / 64 * 8;
+}
+
+
+/*
+ * \brief Payload bytes of an index chunk.
+ *
+ * \param count Records in the chunk.
+ *
+ * \returns Bytes, rounded up to a multiple of 8.
+ */
+static inline uint32_t indexChunkSize(uint32_t count)
+{
+    return (count * (uint32_t) sizeof(captureRecord) + 7) / 8 * 8;
+}
+
+
+#endif /* CAPTURE_FORMAT_H_ */
@@ -0,0 +1,162 @@
+#include <stddef.h>
+
+#include "capture_recorder.h"
+#include "time_decoder.h"
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* UTC of a sample from a sync, rounded down to the second */
+static uint32_t timeOfSample(const captureRecord* sync, uint32_t sample)
+{
+    int32_t offset = (int32_t) (sample - sync->sample);
+
+    /* round towards earlier times for samples before the sync too */
+    int32_t seconds = offset >= 0 ? offset / NSAMPLES
+                                  : -((NSAMPLES - 1 - offset) / NSAMPLES);
+
+    return sync->time + seconds;
+}
+
+
+/* a kept sync, oldest first */
+static const captureRecord* keptSync(const captureRecorder* recorder, int i)
+{
+    uint32_t kept  = recorder->nsyncs < RECORDERSYNCS ? recorder->nsyncs
+                                                      : RECORDERSYNCS;
+    uint32_t index = recorder->nsyncs - kept + i;
+
+    return &recorder->syncs[index % RECORDERSYNCS];
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initRecorder(captureRecorder* recorder)
+{
+    recorder->samples = 0;
+    recorder->stopAt  = 0;
+    recorder->held    = 0;
+    recorder->nsyncs  = 0;
+}
+
+
+void recordSample(captureRecorder* recorder, int sample)
+{
+    uint32_t index = recorder->samples;
+
+    if (recorderStopped(recorder))
+        return;
+
+    uint32_t* word = &recorder->words[index / 32 % RECORDERWORDS];
+    uint32_t  bit  = (uint32_t) 1 << (index % 32);
+
+    *word = sample ? *word | bit : *word & ~bit;
+    recorder->samples = index + 1;
+}
+
+
+void recordSync(captureRecorder* recorder, time_t time, int dst)
+{
+    /* syncs happen at a sample, and not after the recorder stopped */
+    if (!recorder->samples || recorderStopped(recorder))
+        return;
+
+    captureRecord* sync = &recorder->syncs[recorder->nsyncs % RECORDERSYNCS];
+
+    sync->sample = recorder->samples - 1;
+    sync->time   = (uint32_t) time;
+    sync->kind   = kindSync;
+    sync->dst    = dst != 0;
+
+    recorder->nsyncs++;
+}
+
+
+void holdRecorder(captureRecorder* recorder, uint32_t after)
+{
+    if (recorder->held)
+        return;
+
+    recorder->held   = 1;
+    recorder->stopAt = recorder->samples + after;
+}
+
+
+uint32_t exportCapture(const captureRecorder* recorder, captureWriter write,
+                       void* context)
+{
+    uint32_t last  = recorder->samples;
+    uint32_t first = 0;
+
+    /* the word holding the oldest sample has newer ones in it, skip it */
+    if (last > RECORDERSAMPLES)
+        first = (last - RECORDERSAMPLES + 31) & ~(uint32_t) 31;
+
+    int kept = recorder->nsyncs < RECORDERSYNCS ? recorder->nsyncs
+                                                : RECORDERSYNCS;
+    int syncs = 0;
+
+    /* the syncs among the kept samples */
+    while (syncs < kept &&
+           keptSync(recorder, kept - 1 - syncs)->sample >= first)
+        syncs++;
+
+    const captureRecord* latest = kept ? keptSync(recorder, kept - 1) : NULL;
+
+    captureHeader header;
+    header.magic      = CAPTUREMAGIC;
+    header.version    = CAPTUREVERSION;
+    header.sampleRate = NSAMPLES;
+    header.startTime  = latest ? timeOfSample(latest, 0) : NOTIME;
+    header.flags      = 0;
+
+    captureChunk chunk;
+    chunk.type        = CHUNKSAMPLES;
+    chunk.size        = sampleChunkSize(last - first);
+    chunk.firstSample = first;
+    chunk.count       = last - first;
+    chunk.time        = latest ? timeOfSample(latest, first) : NOTIME;
+    chunk.reserved    = 0;
+
+    write(&header, sizeof(header), context);
+    write(&chunk, sizeof(chunk), context);
+
+    uint32_t bytes = sizeof(header) + sizeof(chunk) + chunk.size;
+    uint32_t words = chunk.size / 4;
+
+    for (uint32_t i = 0; i < words; i++) {
+        uint32_t index = first / 32 + i;
+        uint32_t word  = recorder->words[index % RECORDERWORDS];
+
+        /* clear what is left of older samples after the last one */
+        if (32 * index + 32 > last)
+            word = 32 * index >= last ? 0
+                 : word & (((uint32_t) 1 << (last - 32 * index)) - 1);
+
+        write(&word, sizeof(word), context);
+    }
+
+    chunk.type        = CHUNKINDEX;
+    chunk.size        = indexChunkSize(syncs);
+    chunk.firstSample = 0;
+    chunk.count       = syncs;
+    chunk.time        = NOTIME;
+
+    write(&chunk, sizeof(chunk), context);
+
+    for (int i = kept - syncs; i < kept; i++)
+        write(keptSync(recorder, i), sizeof(captureRecord), context);
+
+    /* pad the records to a multiple of 8 bytes */
+    uint32_t padding = chunk.size - syncs * sizeof(captureRecord);
+    uint64_t zero = 0;
+
+    if (padding)
+        write(&zero, padding, context);
+
+    return bytes + sizeof(chunk) + chunk.size;
+}
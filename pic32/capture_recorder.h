@@ -0,0 +1,109 @@
+#ifndef CAPTURE_RECORDER_H_
+#define CAPTURE_RECORDER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "capture_format.h"
+
+#define RECORDERSAMPLES 16384    /* Samples kept, 27 minutes in 2 KB */
+#define RECORDERWORDS (RECORDERSAMPLES / 32)
+#define RECORDERSYNCS 16         /* Syncs kept */
+
+
+/*
+ * The last RECORDERSAMPLES samples the decoder was fed and the last
+ * RECORDERSYNCS syncs, in fixed buffers small enough for the PIC32 RAM.
+ * Samples are packed a bit each, sample i in bit i % 32 of word
+ * i / 32 % RECORDERWORDS, which in little-endian memory is the layout of a
+ * capture sample chunk. A recorder can be held after something went wrong,
+ * so it keeps what led up to it, and is turned into a capture file by
+ * exportCapture().
+ */
+typedef struct {
+    uint32_t      words[RECORDERWORDS];
+    uint32_t      samples;     /* samples recorded, index of the next one */
+    uint32_t      stopAt;      /* last sample + 1 to record once held */
+    int           held;        /* holdRecorder() was called */
+    captureRecord syncs[RECORDERSYNCS];    /* ring of the last syncs */
+    uint32_t      nsyncs;      /* syncs recorded */
+} captureRecorder;
+
+
+/*
+ * \brief Called by exportCapture() with consecutive pieces of the capture.
+ *
+ * \param data Bytes of the capture.
+ * \param size Number of bytes.
+ * \param context Pointer passed through from exportCapture().
+ */
+typedef void (*captureWriter)(const void* data, uint32_t size, void* context);
+
+
+/*
+ * \brief Check if a held recorder has recorded all it will.
+ */
+static inline int recorderStopped(const captureRecorder* recorder)
+{
+    return recorder->held && recorder->samples >= recorder->stopAt;
+}
+
+
+/*
+ * \brief Initialize an empty captureRecorder.
+ *
+ * \param recorder Pointer to the captureRecorder to initialize.
+ */
+void initRecorder(captureRecorder* recorder);
+
+
+/*
+ * \brief Record the next sample, dropping the oldest if the recorder is full.
+ *
+ * \param recorder Pointer to the captureRecorder.
+ * \param sample Sample fed to the decoder, 0 or 1.
+ */
+void recordSample(captureRecorder* recorder, int sample);
+
+
+/*
+ * \brief Record a sync at the last recorded sample.
+ *
+ * \param recorder Pointer to the captureRecorder.
+ * \param time Decoded time, UTC at the start of the last sample.
+ * \param dst 1 if DST is in effect at the decoded time.
+ */
+void recordSync(captureRecorder* recorder, time_t time, int dst);
+
+
+/*
+ * \brief Stop recording a number of samples from now.
+ *
+ * Only the first call counts, so the samples before the first problem are
+ * kept.
+ *
+ * \param recorder Pointer to the captureRecorder.
+ * \param after Samples still to record.
+ */
+void holdRecorder(captureRecorder* recorder, uint32_t after);
+
+
+/*
+ * \brief Write the recorded samples and syncs as a capture file.
+ *
+ * One sample chunk with the kept samples, starting at a multiple of 32,
+ * and an index chunk with the syncs among them. The times of the header
+ * and the sample chunk are worked out from the last sync, and NOTIME
+ * without one.
+ *
+ * \param recorder Pointer to the captureRecorder.
+ * \param write Called with every piece of the capture in order.
+ * \param context Pointer passed through to write.
+ *
+ * \returns Bytes written.
+ */
+uint32_t exportCapture(const captureRecorder* recorder, captureWriter write,
+                       void* context);
+
+
+#endif /* CAPTURE_RECORDER_H_ */
@@ -0,0 +1,234 @@
+/*
+ * Writes binary captures and replays them through the decoder.
+ *
+ * Usage: capture_replay [-p] capture.cap
+ *        capture_replay -c [-t "YYYY-MM-DD HH:MM"] signals.txt capture.cap
+ *
+ * The first form maps a capture and decodes its samples in place, checking
+ * every decoded frame pair against the truth records of the capture. With
+ * -p every pair is printed with its sample and time. A report of samples/s,
+ * how much faster than real time that is and how many pairs were wrong goes
+ * to stderr, and the run fails if any were.
+ *
+ * The second form packs an ASCII sample file into a capture. With -t the
+ * first sample starts the given UTC minute, as in the output of
+ * wwvb_synthesize -r, and a truth record is written for every minute.
+ *
+ * Build: gcc -std=c99 -O2 -march=native time_decoder.c frame_layout.c \
+ *            civil_time.c packed_samples.c capture_file.c test_support.c \
+ *            capture_replay.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture_file.h"
+#include "civil_time.h"
+#include "frame_layout.h"
+#include "packed_samples.h"
+#include "test_support.h"
+
+#define CONVERTBLOCK (1 << 16)    /* characters packed into each chunk */
+
+
+/* UTC time of a "YYYY-MM-DD HH:MM" string, 0 on success */
+static int parseMinute(const char* text, time_t* time)
+{
+    int year, month, day, hour, minute;
+
+    if (sscanf(text, "%d-%d-%d%*c%d:%d", &year, &month, &day, &hour,
+               &minute) != 5)
+        return 1;
+
+    *time = (time_t) daysFromCivil(year, month, day) * SECONDSPERDAY
+          + hour * 3600L + minute * 60L;
+    return 0;
+}
+
+
+static void printTime(time_t time)
+{
+    struct tm civil;
+    civilFromTime(time, &civil);
+
+    printf("%04d-%02d-%02d %02d:%02d:%02d", civil.tm_year + 1900,
+           civil.tm_mon + 1, civil.tm_mday, civil.tm_hour, civil.tm_min,
+           civil.tm_sec);
+}
+
+
+static void printSync(const replaySync* sync, void* context)
+{
+    (void) context;
+
+    printf("%lu ", (unsigned long) sync->sample);
+
+    if (sync->err) {
+        printf("invalid\n");
+        return;
+    }
+
+    printTime(sync->time);
+
+    if (sync->checked && sync->time != sync->expected) {
+        printf(" expected ");
+        printTime(sync->expected);
+    }
+
+    printf("\n");
+}
+
+
+/* pack an ASCII sample file, with a truth record per minute from start */
+static int convert(const char* inPath, const char* outPath, time_t start,
+                   int truth)
+{
+    static char     text[CONVERTBLOCK];
+    static uint64_t words[CONVERTBLOCK / PACKEDBITS];
+
+    FILE* in  = fopen(inPath, "rb");
+    FILE* out = in ? fopen(outPath, "wb") : NULL;
+
+    if (!in || !out) {
+        perror(in ? outPath : inPath);
+
+        if (in)
+            fclose(in);
+
+        return 1;
+    }
+
+    unsigned long long chars = 0;
+    uint32_t samples = 0;
+    size_t count;
+    int err = writeCaptureHeader(out, truth ? (uint32_t) start : NOTIME);
+
+    while (!err && (count = fread(text, 1, CONVERTBLOCK, in)) > 0) {
+        uint32_t packed = packSamples(text, count, words);
+        uint32_t time = truth ? (uint32_t) (start + samples / NSAMPLES)
+                              : NOTIME;
+
+        if (packed)
+            err = writeSampleChunk(out, samples, time, words, packed);
+
+        chars   += count;
+        samples += packed;
+    }
+
+    /* the minutes that start within the samples */
+    uint32_t minutes = truth ? (samples + FRAMESIZE * NSAMPLES - 1)
+                               / (FRAMESIZE * NSAMPLES) : 0;
+    captureRecord* records = malloc((minutes + 1) * sizeof(captureRecord));
+
+    for (uint32_t m = 0; m < minutes; m++) {
+        records[m].sample = m * FRAMESIZE * NSAMPLES;
+        records[m].time   = (uint32_t) (start + 60 * m);
+        records[m].kind   = kindTruth;
+        records[m].dst    = 0;
+    }
+
+    if (!err)
+        err = writeIndexChunk(out, records, minutes);
+
+    free(records);
+    err |= ferror(in);
+    fclose(in);
+
+    if (fclose(out) || err) {
+        fprintf(stderr, "%s: write failed\n", outPath);
+        return 1;
+    }
+
+    FILE* check = fopen(outPath, "rb");
+    long bytes = 0;
+
+    if (check && !fseek(check, 0, SEEK_END))
+        bytes = ftell(check);
+
+    if (check)
+        fclose(check);
+
+    fprintf(stderr, "samples: %lu, %llu bytes as text, %ld as a capture "
+            "(%.1fx smaller)\n", (unsigned long) samples, chars, bytes,
+            bytes > 0 ? (double) chars / bytes : 0);
+
+    return 0;
+}
+
+
+static int replay(const char* path, int print)
+{
+    captureFile file;
+
+    if (openCapture(path, &file)) {
+        fprintf(stderr, "%s: not a valid capture\n", path);
+        return 1;
+    }
+
+    if (file.header->sampleRate != NSAMPLES) {
+        fprintf(stderr, "%s: %d samples/s, the decoder takes %d\n", path,
+                file.header->sampleRate, NSAMPLES);
+        closeCapture(&file);
+        return 1;
+    }
+
+    static char outBuffer[1 << 20];
+    setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    replayStats stats;
+    double begin = now();
+
+    replayCapture(&file, &stats, print ? printSync : NULL, NULL);
+
+    double elapsed = now() - begin;
+    fflush(stdout);
+    closeCapture(&file);
+
+    /* guard against a zero interval on tiny captures */
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "samples: %llu (%.3g samples/s, %.0fx real time)\n",
+            stats.samples, stats.samples / elapsed,
+            stats.samples / (double) NSAMPLES / elapsed);
+    fprintf(stderr, "syncs:   %lu, errors: %lu, gaps: %lu\n", stats.syncs,
+            stats.errors, stats.gaps);
+    fprintf(stderr, "checked: %lu, wrong: %lu, elapsed: %.3f s\n",
+            stats.checked, stats.wrong, elapsed);
+
+    return stats.wrong != 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    int converting = 0, print = 0, truth = 0;
+    time_t start = 0;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-c") == 0)
+            converting = 1;
+        else if (strcmp(argv[arg], "-p") == 0)
+            print = 1;
+        else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc &&
+                 !parseMinute(argv[arg + 1], &start))
+            truth = 1, arg++;
+        else
+            break;
+    }
+
+    if (argc - arg != (converting ? 2 : 1) || (!converting && truth)) {
+        fprintf(stderr, "usage: %s [-p] capture.cap\n"
+                "       %s -c [-t \"YYYY-MM-DD HH:MM\"] signals.txt "
+                "capture.cap\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    if (converting)
+        return convert(argv[arg], argv[arg + 1], start, truth);
+
+    return replay(argv[arg], print);
+}
@@ -0,0 +1,308 @@
+/*
+ * Checks the capture recorder and the capture file reader.
+ *
+ * Samples recorded by captureRecorder, before and after it wraps around and
+ * after it was held, must come back bit for bit from the exported capture,
+ * with their syncs and times. A capture of consecutive minutes with truth
+ * records must replay to the same syncs as decodeBatch() on the ASCII
+ * samples, all of them right, and a wrong truth record, a gap and damaged
+ * captures must be caught. The capture must be about 8 times smaller than
+ * the ASCII samples.
+ *
+ * Build: gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c packed_samples.c batch_decoder.c \
+ *            capture_recorder.c capture_file.c test_support.c capture_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch_decoder.h"
+#include "capture_file.h"
+#include "capture_recorder.h"
+#include "test_support.h"
+#include "wwvb_signal.h"
+
+#define NMINUTES 30
+#define TESTSTART 1399997400     /* 2014-05-13 16:10 UTC */
+#define MAXCAPTURE (1 << 20)     /* bytes of a capture in memory */
+
+
+/* a capture written to memory, aligned for mapCapture() */
+typedef struct {
+    uint64_t words[MAXCAPTURE / 8];
+    uint32_t size;
+} memoryCapture;
+
+
+static memoryCapture capture;
+
+
+static void writeMemory(const void* data, uint32_t size, void* context)
+{
+    memoryCapture* out = context;
+
+    if (out->size + size <= MAXCAPTURE)
+        memcpy((char*) out->words + out->size, data, size);
+
+    out->size += size;
+}
+
+
+/* read a capture written to a stream back into memory */
+static void readBack(FILE* file, memoryCapture* out)
+{
+    rewind(file);
+    out->size = fread(out->words, 1, MAXCAPTURE, file);
+    fclose(file);
+}
+
+
+/* the first chunk of a type, or NULL */
+static const captureChunk* findChunk(const captureFile* file, uint32_t type)
+{
+    const captureChunk* chunk = NULL;
+
+    while ((chunk = nextChunk(file, chunk)) && chunk->type != type);
+
+    return chunk;
+}
+
+
+/* consecutive minutes of clean samples, 0 or 1 */
+static void minuteSamples(char* samples, int minutes)
+{
+    for (int m = 0; m < minutes; m++) {
+        char frame[FRAMESIZE];
+        encodeFrame(TESTSTART + 60 * m, 0, frame);
+        frameToSamples(frame, samples + m * FRAMESAMPLES);
+    }
+}
+
+
+/*
+ * Record random samples and a sync every 1000, optionally holding the
+ * recorder halfway, and check the export against what was recorded.
+ */
+static void checkRecorder(uint32_t count, int hold, const char* what)
+{
+    static char samples[4 * RECORDERSAMPLES];
+    static captureRecorder recorder;
+    initRecorder(&recorder);
+
+    uint32_t last = count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        samples[i] = rand() & 1;
+        recordSample(&recorder, samples[i]);
+
+        /* syncs are at whole seconds, like those of the decoder */
+        if (i % 1000 == 0 && i)
+            recordSync(&recorder, TESTSTART + i / NSAMPLES, i % 2000 == 0);
+
+        if (hold && i == count / 2) {
+            holdRecorder(&recorder, 100);
+            last = i + 101;
+        }
+    }
+
+    expect(recorder.samples == last, what);
+
+    capture.size = 0;
+    uint32_t bytes = exportCapture(&recorder, writeMemory, &capture);
+
+    captureFile file;
+    expect(bytes == capture.size && !mapCapture(capture.words, bytes, &file),
+           what);
+
+    const captureChunk* chunk = findChunk(&file, CHUNKSAMPLES);
+    const captureChunk* index = findChunk(&file, CHUNKINDEX);
+
+    if (!chunk || !index) {
+        expect(0, what);
+        return;
+    }
+
+    /* all kept samples but the ones sharing a word with newer ones */
+    uint32_t first = chunk->firstSample;
+
+    expect(first % 32 == 0 && chunk->firstSample + chunk->count == last &&
+           (last <= RECORDERSAMPLES ? first == 0
+                                    : chunk->count > RECORDERSAMPLES - 32),
+           what);
+
+    for (uint32_t i = 0; i < chunk->count; i++)
+        if (getPackedSample(chunkWords(chunk), i) != samples[first + i]) {
+            expect(0, what);
+            break;
+        }
+
+    /* bits after the last sample are cleared */
+    for (uint32_t i = chunk->count; i < chunk->size * 8; i++)
+        if (getPackedSample(chunkWords(chunk), i)) {
+            expect(0, what);
+            break;
+        }
+
+    /* the syncs among the kept samples, with the time of every sample */
+    const captureRecord* records = chunkRecords(index);
+    uint32_t syncs = 0;
+
+    for (uint32_t i = 1000; i < last; i += 1000)
+        syncs += i >= first && last - i <= RECORDERSYNCS * 1000;
+
+    expect(index->count == syncs, what);
+
+    for (uint32_t i = 0; i < index->count; i++)
+        expect(records[i].kind == kindSync &&
+               records[i].sample >= first && records[i].sample % 1000 == 0 &&
+               records[i].time == TESTSTART + records[i].sample / NSAMPLES &&
+               records[i].dst == (records[i].sample % 2000 == 0), what);
+
+    expect(file.header->startTime == (syncs ? TESTSTART : NOTIME) &&
+           chunk->time == (syncs ? TESTSTART + first / NSAMPLES : NOTIME),
+           what);
+}
+
+
+static void countSync(int err, time_t time, int dst, void* context)
+{
+    (void) time;
+    (void) dst;
+
+    if (!err)
+        (*(int*) context)++;
+}
+
+
+/* write minutes of samples with a truth record per minute, in two chunks */
+static void writeMinutes(const char* samples, uint32_t count, uint32_t gap,
+                         uint32_t wrongMinute)
+{
+    static char     text[NMINUTES * FRAMESAMPLES];
+    static uint64_t words[NMINUTES * FRAMESAMPLES / PACKEDBITS + 1];
+    captureRecord   records[NMINUTES];
+
+    for (uint32_t i = 0; i < count; i++)
+        text[i] = '0' + samples[i];
+
+    FILE* file = tmpfile();
+    uint32_t half = count / 2 / 64 * 64;
+
+    writeCaptureHeader(file, TESTSTART);
+    packSamples(text, half, words);
+    writeSampleChunk(file, 0, TESTSTART, words, half);
+    packSamples(text + half + gap, count - half - gap, words);
+    writeSampleChunk(file, half + gap, TESTSTART + (half + gap) / NSAMPLES,
+                     words, count - half - gap);
+
+    for (int m = 0; m < NMINUTES; m++) {
+        records[m].sample = m * FRAMESAMPLES;
+        records[m].time   = TESTSTART + 60 * m + 60 * (m == (int) wrongMinute);
+        records[m].kind   = kindTruth;
+        records[m].dst    = 0;
+    }
+
+    writeIndexChunk(file, records, NMINUTES);
+    readBack(file, &capture);
+}
+
+
+static void checkReplay()
+{
+    static char samples[NMINUTES * FRAMESAMPLES];
+    static char text[NMINUTES * FRAMESAMPLES];
+    uint32_t count = NMINUTES * FRAMESAMPLES;
+
+    minuteSamples(samples, NMINUTES);
+
+    for (uint32_t i = 0; i < count; i++)
+        text[i] = '0' + samples[i];
+
+    /* the syncs of the ASCII samples */
+    int batchSyncs = 0;
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    decodeBatch(&decoder, text, count, NULL, countSync, &batchSyncs);
+
+    captureFile file;
+    replayStats stats;
+
+    writeMinutes(samples, count, 0, NMINUTES);
+    expect(!mapCapture(capture.words, capture.size, &file), "capture valid");
+    replayCapture(&file, &stats, NULL, NULL);
+
+    expect(stats.samples == count && !stats.gaps && !stats.errors,
+           "replay of every sample");
+    expect(stats.syncs == (unsigned long) batchSyncs && stats.syncs > 0,
+           "same syncs as decodeBatch()");
+    expect(stats.checked == stats.syncs && !stats.wrong,
+           "syncs match the truth");
+
+    /* text without line breaks is a byte per sample, truth records extra */
+    const captureChunk* index = findChunk(&file, CHUNKINDEX);
+    double ratio = (double) count / (capture.size - sizeof(captureChunk) -
+                                     (index ? index->size : 0));
+    expect(ratio > 7.5, "8 times smaller than ASCII");
+
+    /* pairs are decoded at the start of every other minute */
+    writeMinutes(samples, count, 0, 11);
+    mapCapture(capture.words, capture.size, &file);
+    replayCapture(&file, &stats, NULL, NULL);
+    expect(stats.wrong > 0, "wrong truth record caught");
+
+    writeMinutes(samples, count, 1000, NMINUTES);
+    mapCapture(capture.words, capture.size, &file);
+    replayCapture(&file, &stats, NULL, NULL);
+    expect(stats.gaps == 1 && stats.samples == count - 1000 &&
+           stats.syncs > 0 && !stats.wrong, "restart at a gap");
+}
+
+
+static void checkDamaged()
+{
+    static char samples[2 * FRAMESAMPLES];
+    captureFile file;
+
+    minuteSamples(samples, 2);
+    writeMinutes(samples, 2 * FRAMESAMPLES, 0, NMINUTES);
+
+    expect(!mapCapture(capture.words, capture.size, &file), "capture valid");
+    expect(mapCapture(capture.words, capture.size - 8, &file),
+           "truncated capture");
+    expect(mapCapture(capture.words, capture.size + 4, &file),
+           "trailing bytes");
+    expect(mapCapture((char*) capture.words + 4, capture.size - 4, &file),
+           "unaligned capture");
+
+    capture.words[0] ^= 1;
+    expect(mapCapture(capture.words, capture.size, &file), "bad magic");
+    capture.words[0] ^= 1;
+
+    /* more samples than the chunk holds */
+    captureChunk* chunk = (captureChunk*) ((char*) capture.words +
+                                           sizeof(captureHeader));
+    chunk->count += 64;
+    expect(mapCapture(capture.words, capture.size, &file), "short chunk");
+}
+
+
+int main()
+{
+    srand(1);
+
+    checkRecorder(3000, 0, "recorder before wrapping");
+    checkRecorder(2 * RECORDERSAMPLES + 17, 0, "recorder after wrapping");
+    checkRecorder(3 * RECORDERSAMPLES, 1, "held recorder");
+    checkReplay();
+    checkDamaged();
+
+    if (failures) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
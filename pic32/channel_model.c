@@ -0,0 +1,137 @@
+#include <math.h>
+
+#include "channel_model.h"
+#include "test_support.h"
+
+/* independent random streams of a channel */
+#define NOISESTREAM 0x9E3779B97F4A7C15ULL
+#define FALLSTREAM  0x3C6EF372FE94F82AULL
+#define RISESTREAM  0xDAA66D2C7DDF743FULL
+#define FADESTREAM  0x78DDE6E5FD29F054ULL
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* random number in [0, 1) fixed by the seed, the stream and the index */
+static double uniform(const channel* ch, uint64_t stream, long index)
+{
+    uint64_t random = mix(ch->seed ^ stream ^ mix((uint64_t) index));
+
+    return (random >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/* chance the receiver reads a 1 at a carrier amplitude */
+static double readsOne(double amplitude, double sigma)
+{
+    if (sigma == 0)
+        return amplitude > RECEIVERTHRESHOLD;
+
+    return 0.5 * erfc((RECEIVERTHRESHOLD - amplitude) / (sigma * sqrt(2)));
+}
+
+
+/* offset of a pulse edge of a second, Box-Muller from two streams */
+static double edgeJitter(const channel* ch, uint64_t stream, long second)
+{
+    if (ch->config.jitter <= 0)
+        return 0;
+
+    double u1 = uniform(ch, stream, 2 * second);
+    double u2 = uniform(ch, stream, 2 * second + 1);
+    double offset = ch->config.jitter * sqrt(-2 * log(1 - u1))
+                  * cos(6.283185307179586 * u2);
+
+    /* keep the edges of neighboring pulses in order */
+    return offset < -MAXJITTER ? -MAXJITTER
+         : offset > MAXJITTER ? MAXJITTER : offset;
+}
+
+
+/* move the transmitter on to a second, which is at most one later */
+static void enterSecond(channel* ch, long second)
+{
+    long minute = second / 60;
+
+    if (minute != ch->minute) {
+        encodeFrame(ch->start + minute * 60, 0, ch->frame);
+        ch->minute = minute;
+    }
+
+    ch->fall = second == ch->second + 1 ? ch->nextFall
+             : edgeJitter(ch, FALLSTREAM, second);
+    ch->nextFall = edgeJitter(ch, FALLSTREAM, second + 1);
+    ch->rise = (double) pulseLows(ch->frame[second % 60]) / NSAMPLES
+             + edgeJitter(ch, RISESTREAM, second);
+
+    /* a fade may start in any second outside of one */
+    const channelConfig* config = &ch->config;
+
+    if (second >= ch->fadeEnd && config->fadesPerHour > 0 &&
+        uniform(ch, FADESTREAM, 2 * second) < config->fadesPerHour / 3600) {
+        double u = uniform(ch, FADESTREAM, 2 * second + 1);
+        ch->fadeEnd = second + (long) ceil(-log(1 - u) * config->fadeLength);
+    }
+
+    ch->second = second;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+double flipProbability(double snr)
+{
+    return 1 - readsOne(1, pow(10, -snr / 20));
+}
+
+
+void initChannel(channel* ch, const channelConfig* config, time_t start,
+                 double phase, uint64_t seed)
+{
+    ch->config = *config;
+    ch->seed   = seed;
+    ch->start  = start;
+    ch->phase  = phase;
+    ch->period = 1.0 / NSAMPLES / (1 + config->skew * 1e-6);
+
+    double sigma = pow(10, -config->snr / 20);
+    double fade  = pow(10, -config->fadeDepth / 20);
+
+    ch->one[0][0] = readsOne(LOWCARRIER, sigma);
+    ch->one[0][1] = readsOne(1, sigma);
+    ch->one[1][0] = readsOne(LOWCARRIER * fade, sigma);
+    ch->one[1][1] = readsOne(fade, sigma);
+
+    ch->sample  = 0;
+    ch->second  = -2;
+    ch->minute  = -1;
+    ch->fadeEnd = 0;
+}
+
+
+int channelSample(channel* ch)
+{
+    double t = ch->phase + ch->sample * ch->period;
+    long second = (long) t;
+
+    if (second != ch->second)
+        enterSecond(ch, second);
+
+    /* the pulse of this second, or the next one starting early */
+    double into = t - second;
+    int full = (into < ch->fall || into >= ch->rise) &&
+               into < 1 + ch->nextFall;
+    int faded = second < ch->fadeEnd;
+
+    return uniform(ch, NOISESTREAM, ch->sample++) < ch->one[faded][full];
+}
+
+
+time_t channelTime(const channel* ch)
+{
+    return ch->start + ch->second;
+}
@@ -0,0 +1,102 @@
+#ifndef CHANNEL_MODEL_H_
+#define CHANNEL_MODEL_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "wwvb_signal.h"
+
+#define LOWCARRIER 0.1413     /* carrier amplitude during a pulse, -17 dB */
+#define RECEIVERTHRESHOLD ((1 + LOWCARRIER) / 2)   /* sample is 1 above this */
+#define MAXJITTER 0.09        /* edges move less than a sample, in seconds */
+
+
+/*
+ * Impairments between the transmitter and the sampled receiver output. The
+ * receiver compares the carrier amplitude plus Gaussian noise against a
+ * fixed threshold halfway between full amplitude and the -17 dB of a pulse,
+ * so noise flips samples, and a fade drops the carrier toward or below the
+ * threshold for seconds at a time.
+ */
+typedef struct {
+    double snr;            /* full carrier to noise power of a sample, dB */
+    double jitter;         /* standard deviation of every pulse edge, seconds */
+    double skew;           /* sampler clock fast against the transmitter, ppm */
+    double fadesPerHour;   /* average rate of burst fades */
+    double fadeLength;     /* average length of a fade, seconds */
+    double fadeDepth;      /* carrier loss during a fade, dB */
+} channelConfig;
+
+
+/*
+ * A transmitter from a UTC minute on, seen through a channelConfig. All the
+ * randomness is a function of the seed and the sample or second it applies
+ * to, so a channel replays the same way from the same seed, and the noise
+ * of two channels with the same seed only differs in its strength.
+ */
+typedef struct {
+    channelConfig config;
+    uint64_t seed;
+    time_t   start;        /* UTC of the minute the transmitter starts in */
+    double   phase;        /* seconds into the minute of the first sample */
+    double   period;       /* transmitter seconds between samples */
+    double   one[2][2];    /* chance of a 1, [in a fade][carrier full] */
+
+    /* transmitter state of the current second */
+    long     sample;       /* index of the next sample */
+    long     second;       /* seconds since start */
+    long     minute;       /* minute of the encoded frame */
+    char     frame[FRAMESIZE];
+    double   fall;         /* pulse edges in seconds into the second */
+    double   rise;
+    double   nextFall;     /* falling edge of the next second */
+    long     fadeEnd;      /* first second after the current fade */
+} channel;
+
+
+/*
+ * \brief Chance that noise flips a sample outside of fades.
+ *
+ * \param snr Full carrier to noise power of a sample, dB, or INFINITY.
+ *
+ * \returns Probability from 0 to 0.5.
+ */
+double flipProbability(double snr);
+
+
+/*
+ * \brief Start a channel.
+ *
+ * Frames are encoded without DST.
+ *
+ * \param ch Pointer to channel to initialize.
+ * \param config Pointer to the impairments, copied.
+ * \param start UTC time of the minute the transmitter starts in.
+ * \param phase Seconds into that minute of the first sample, 0 to 60.
+ * \param seed Seed of all the random impairments.
+ */
+void initChannel(channel* ch, const channelConfig* config, time_t start,
+                 double phase, uint64_t seed);
+
+
+/*
+ * \brief Take the next sample of the receiver output.
+ *
+ * \param ch Pointer to channel to sample.
+ *
+ * \returns 1 for full carrier, 0 for a pulse.
+ */
+int channelSample(channel* ch);
+
+
+/*
+ * \brief UTC second the transmitter was in at the last sample.
+ *
+ * \param ch Pointer to channel sampled at least once.
+ *
+ * \returns UTC time in whole seconds.
+ */
+time_t channelTime(const channel* ch);
+
+
+#endif /* CHANNEL_MODEL_H_ */
@@ -0,0 +1,197 @@
+/*
+ * Checks the impairments of the channel model one at a time.
+ *
+ * Without impairments a channel must give exactly the samples of
+ * frameToSamples(). Noise alone must flip samples at the rate of
+ * flipProbability(), a skewed sampler must take one extra sample per
+ * 1e6 / (NSAMPLES * ppm) seconds, edge jitter must only move edges by a
+ * sample each, and deep fades must cover about the time configured.
+ *
+ * Build: gcc -std=c99 -O2 frame_layout.c civil_time.c wwvb_signal.c \
+ *            channel_model.c channel_model_test.c -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "channel_model.h"
+
+#define NMINUTES 600
+#define START 1420070400    /* 2015-01-01 */
+
+
+/* frameToSamples() of consecutive minutes, from a sample into the first */
+static char expectedSample(long sample, char* frame, char* samples,
+                           long* minute)
+{
+    if (sample / FRAMESAMPLES != *minute) {
+        *minute = sample / FRAMESAMPLES;
+        encodeFrame(START + *minute * 60, 0, frame);
+        frameToSamples(frame, samples);
+    }
+
+    return samples[sample % FRAMESAMPLES];
+}
+
+
+/* compare a channel against the clean samples, returns the mismatches */
+static long countFlips(const channelConfig* config, long offset,
+                       long* longest)
+{
+    char frame[FRAMESIZE], samples[FRAMESAMPLES];
+    long minute = -1, flips = 0, run = 0;
+
+    channel ch;
+    initChannel(&ch, config, START, (offset + 0.5) / NSAMPLES, 7);
+    *longest = 0;
+
+    for (long i = 0; i < NMINUTES * (long) FRAMESAMPLES - offset; i++) {
+        int flipped = channelSample(&ch) !=
+                      expectedSample(offset + i, frame, samples, &minute);
+
+        flips += flipped;
+        run = flipped ? run + 1 : 0;
+
+        if (run > *longest)
+            *longest = run;
+    }
+
+    return flips;
+}
+
+
+static int checkClean(void)
+{
+    channelConfig clean = {INFINITY, 0, 0, 0, 0, 0};
+    long longest;
+
+    for (long offset = 0; offset < FRAMESAMPLES; offset += 37)
+        if (countFlips(&clean, offset, &longest)) {
+            printf("clean channel differs from frameToSamples() at offset "
+                   "%ld\n", offset);
+            return 1;
+        }
+
+    return 0;
+}
+
+
+static int checkNoise(void)
+{
+    for (double snr = 12; snr <= 20; snr += 2) {
+        channelConfig config = {snr, 0, 0, 0, 0, 0};
+        long longest;
+        double expected = flipProbability(snr) * NMINUTES * FRAMESAMPLES;
+        long flips = countFlips(&config, 0, &longest);
+
+        /* five standard deviations of the binomial count */
+        if (fabs(flips - expected) > 5 * sqrt(expected) + 1) {
+            printf("%.0f dB: %ld flips, %.0f expected\n", snr, flips,
+                   expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int checkSkew(void)
+{
+    for (double ppm = -200; ppm <= 200; ppm += 100) {
+        channelConfig config = {INFINITY, 0, ppm, 0, 0, 0};
+        channel ch;
+        initChannel(&ch, &config, START, 0.05, 1);
+
+        /* samples until the transmitter has sent every minute */
+        long samples = 0;
+
+        do {
+            channelSample(&ch);
+            samples++;
+        } while (channelTime(&ch) < START + NMINUTES * 60L);
+
+        long expected = lround(NMINUTES * (double) FRAMESAMPLES
+                               * (1 + ppm * 1e-6));
+
+        if (labs(samples - 1 - expected) > 1) {
+            printf("%.0f ppm: %ld samples, %ld expected\n", ppm,
+                   samples - 1, expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int checkJitter(void)
+{
+    channelConfig config = {INFINITY, 0.03, 0, 0, 0, 0};
+    long longest;
+    long flips = countFlips(&config, 0, &longest);
+
+    /*
+     * Edges at the middle of samples move out of them 10% of the time, and
+     * only a 0 pulse can lose both of its samples.
+     */
+    double rate = (double) flips / (2 * NMINUTES * 60);
+
+    if (longest > 2 || rate < 0.05 || rate > 0.15) {
+        printf("jitter: %.3f flips per edge, runs of up to %ld\n", rate,
+               longest);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static int checkFades(void)
+{
+    /* a full carrier fades below the threshold, a pulse stays low */
+    channelConfig config = {INFINITY, 0, 0, 6, 20, 20};
+    char frame[FRAMESIZE], samples[FRAMESAMPLES];
+    long minute = -1, faded = 0, run = 0, longest = 0;
+
+    channel ch;
+    initChannel(&ch, &config, START, 0.05, 7);
+
+    /* seconds in which every sample of the full carrier read low */
+    for (long second = 0; second < NMINUTES * 60L; second++) {
+        int carrier = 0;
+
+        for (long i = second * NSAMPLES; i < (second + 1) * NSAMPLES; i++)
+            carrier |= channelSample(&ch) &&
+                       expectedSample(i, frame, samples, &minute);
+
+        faded += !carrier;
+        run = carrier ? 0 : run + 1;
+
+        if (run > longest)
+            longest = run;
+    }
+
+    double expected = NMINUTES / 60.0 * config.fadesPerHour
+                    * (config.fadeLength + 0.5);
+
+    if (faded < expected / 2 || faded > expected * 2 ||
+        longest < config.fadeLength) {
+        printf("fades: %ld s, about %.0f s expected, longest %ld s\n",
+               faded, expected, longest);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int main()
+{
+    int failed = checkClean() || checkNoise() || checkSkew() ||
+                 checkJitter() || checkFades();
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
@@ -0,0 +1,110 @@
+#include "civil_time.h"
+
+/* days before the start of each month, for normal and leap years */
+static const short monthStart[2][13] = {
+    {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365},
+    {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366}
+};
+
+
+/*
+ * The conversions count years from March, so the leap day is the last day
+ * of the year and every 400 year era has the same number of days.
+ */
+
+long daysFromCivil(int year, int month, int day)
+{
+    /* January and February belong to the previous year */
+    year -= month <= 2;
+
+    long     era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yoe = (unsigned) (year - era * 400);            /* [0, 399] */
+    unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5
+                 + day - 1;                                 /* [0, 365] */
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;   /* [0, 146096] */
+
+    /* 719468 days from 0000-03-01 to 1970-01-01 */
+    return era * 146097 + (long) doe - 719468;
+}
+
+
+void civilFromDays(long days, int* year, int* month, int* day)
+{
+    days += 719468;
+
+    long     era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned) (days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp  = (5 * doy + 2) / 153;                     /* March is 0 */
+
+    *day   = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year  = yoe + era * 400 + (*month <= 2);
+}
+
+
+int monthFromDayOfYear(int dayOfYear, int leapYear, int* month,
+                       int* dayOfMonth)
+{
+    const short* start = monthStart[leapYear != 0];
+
+    if (dayOfYear < 1 || dayOfYear > start[12])
+        return 1;
+
+    /* months have 28 to 31 days, so this is the month or the one before */
+    int guess = (dayOfYear - 1) / 31;
+    if (dayOfYear > start[guess + 1])
+        guess++;
+
+    *month      = guess;
+    *dayOfMonth = dayOfYear - start[guess];
+
+    return 0;
+}
+
+
+int daysInMonth(int year, int month)
+{
+    const short* start = monthStart[isLeapYear(year)];
+
+    return start[month + 1] - start[month];
+}
+
+
+time_t timeFromCivil(const struct tm* utcTime)
+{
+    long days = daysFromCivil(utcTime->tm_year + 1900, utcTime->tm_mon + 1,
+                              utcTime->tm_mday);
+
+    return (time_t) days * SECONDSPERDAY + utcTime->tm_hour * 3600L
+         + utcTime->tm_min * 60 + utcTime->tm_sec;
+}
+
+
+void civilFromTime(time_t unixTime, struct tm* utcTime)
+{
+    long days    = unixTime / SECONDSPERDAY;
+    long seconds = unixTime % SECONDSPERDAY;
+
+    /* round towards negative infinity for times before 1970 */
+    if (seconds < 0) {
+        seconds += SECONDSPERDAY;
+        days--;
+    }
+
+    int year, month, day;
+    civilFromDays(days, &year, &month, &day);
+
+    utcTime->tm_year  = year - 1900;
+    utcTime->tm_mon   = month - 1;
+    utcTime->tm_mday  = day;
+    utcTime->tm_hour  = seconds / 3600;
+    utcTime->tm_min   = seconds / 60 % 60;
+    utcTime->tm_sec   = seconds % 60;
+    utcTime->tm_yday  = monthStart[isLeapYear(year)][month - 1] + day - 1;
+    utcTime->tm_isdst = 0;
+
+    /* 1970-01-01 was a Thursday */
+    utcTime->tm_wday  = (days % 7 + 11) % 7;
+}
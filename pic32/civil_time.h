@@ -0,0 +1,96 @@
+#ifndef CIVIL_TIME_H_
+#define CIVIL_TIME_H_
+
+#include <time.h>
+
+#define SECONDSPERDAY 86400L
+
+
+/*
+ * \brief Check if a year is a leap year in the Gregorian calendar.
+ *
+ * \param year Full year, e.g. 2014.
+ *
+ * \returns 1 for a leap year, 0 otherwise.
+ */
+static inline int isLeapYear(int year)
+{
+    return year % 400 == 0 || (year % 4 == 0 && year % 100 != 0);
+}
+
+
+/*
+ * \brief Number of days from 1970-01-01 to a date in the Gregorian calendar.
+ *
+ * \param year Full year, e.g. 2014.
+ * \param month Month from 1 to 12.
+ * \param day Day of the month from 1 to 31.
+ *
+ * \returns Days since 1970-01-01, negative for earlier dates.
+ */
+long daysFromCivil(int year, int month, int day);
+
+
+/*
+ * \brief Date of a day counted from 1970-01-01, inverse of daysFromCivil().
+ *
+ * \param days Days since 1970-01-01.
+ * \param year Stores the full year.
+ * \param month Stores the month from 1 to 12.
+ * \param day Stores the day of the month from 1 to 31.
+ */
+void civilFromDays(long days, int* year, int* month, int* day);
+
+
+/*
+ * \brief Month and day of the month for a day of the year, using a table.
+ *
+ * \param dayOfYear Day of the year from 1 to 365, or 366 in leap years.
+ * \param leapYear 1 in leap years, 0 otherwise.
+ * \param month Stores the month from 0 to 11, convention of tm struct.
+ * \param dayOfMonth Stores the day of the month from 1 to 31.
+ *
+ * \returns
+ *     0: Month and day are valid.
+ *     1: dayOfYear is out of range.
+ */
+int monthFromDayOfYear(int dayOfYear, int leapYear, int* month,
+                       int* dayOfMonth);
+
+
+/*
+ * \brief Number of days in a month.
+ *
+ * \param year Full year, e.g. 2014.
+ * \param month Month from 0 to 11, convention of tm struct.
+ *
+ * \returns 28 to 31.
+ */
+int daysInMonth(int year, int month);
+
+
+/*
+ * \brief Convert a UTC date and time to unix time, like timegm().
+ *
+ * Only tm_year, tm_mon, tm_mday, tm_hour, tm_min and tm_sec are used, and
+ * they must be in their normal ranges. Does not depend on the TZ setting.
+ *
+ * \param utcTime UTC date and time to convert.
+ *
+ * \returns Seconds since 1970-01-01 00:00:00 UTC.
+ */
+time_t timeFromCivil(const struct tm* utcTime);
+
+
+/*
+ * \brief Convert unix time to a UTC date and time, like gmtime_r().
+ *
+ * Fills every field of the tm struct, tm_isdst is set to 0.
+ *
+ * \param unixTime Seconds since 1970-01-01 00:00:00 UTC.
+ * \param utcTime Stores the UTC date and time.
+ */
+void civilFromTime(time_t unixTime, struct tm* utcTime);
+
+
+#endif /* CIVIL_TIME_H_ */
@@ -0,0 +1,111 @@
+/*
+ * Checks the civil time conversions against the C library in UTC.
+ *
+ * Every day from 1900 to 2200 is converted both ways and compared with
+ * gmtime(), and every day of the year table entry is checked against the
+ * dates it produces. Also times frame conversions per second.
+ *
+ * Build: gcc -std=c99 -O2 civil_time.c civil_time_test.c
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "civil_time.h"
+
+#define FIRSTYEAR 1900
+#define LASTYEAR 2200
+
+
+int sameTime(struct tm* a, struct tm* b)
+{
+    return a->tm_year == b->tm_year && a->tm_mon  == b->tm_mon  &&
+           a->tm_mday == b->tm_mday && a->tm_hour == b->tm_hour &&
+           a->tm_min  == b->tm_min  && a->tm_sec  == b->tm_sec  &&
+           a->tm_wday == b->tm_wday && a->tm_yday == b->tm_yday;
+}
+
+
+int checkDays()
+{
+    long first = daysFromCivil(FIRSTYEAR, 1, 1);
+    long last  = daysFromCivil(LASTYEAR, 12, 31);
+
+    for (long days = first; days <= last; days++) {
+        /* a few seconds into the day to check the time of day too */
+        time_t unixTime = (time_t) days * SECONDSPERDAY + days % 86399;
+
+        struct tm expected, actual;
+        expected = *gmtime(&unixTime);
+        civilFromTime(unixTime, &actual);
+
+        if (!sameTime(&expected, &actual) || timeFromCivil(&actual) != unixTime) {
+            printf("mismatch on day %ld\n", days);
+            return 1;
+        }
+
+        /* the day of the year table must give the same date */
+        int month, dayOfMonth;
+        int leapYear = isLeapYear(actual.tm_year + 1900);
+
+        if (monthFromDayOfYear(actual.tm_yday + 1, leapYear, &month, &dayOfMonth)
+                || month != actual.tm_mon || dayOfMonth != actual.tm_mday) {
+            printf("day of year mismatch on day %ld\n", days);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+int checkDayOfYearRange()
+{
+    int month, dayOfMonth;
+
+    return !monthFromDayOfYear(0, 0, &month, &dayOfMonth)
+        || !monthFromDayOfYear(366, 0, &month, &dayOfMonth)
+        ||  monthFromDayOfYear(366, 1, &month, &dayOfMonth)
+        || !monthFromDayOfYear(367, 1, &month, &dayOfMonth);
+}
+
+
+void timeConversions()
+{
+    struct tm frameTime = {0};
+    frameTime.tm_year = 114;
+
+    long conversions = 0;
+    time_t sum = 0;
+    clock_t start = clock();
+
+    for (int day = 1; day <= 365; day++) {
+        monthFromDayOfYear(day, 0, &frameTime.tm_mon, &frameTime.tm_mday);
+
+        for (int minute = 0; minute < 24 * 60; minute++) {
+            frameTime.tm_hour = minute / 60;
+            frameTime.tm_min  = minute % 60;
+            sum += timeFromCivil(&frameTime);
+            conversions++;
+        }
+    }
+
+    double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    /* print the sum so the loop is not optimized away */
+    printf("%.3g frame conversions/s (checksum %ld)\n",
+           conversions / (elapsed > 0 ? elapsed : 1e-9), (long) sum);
+}
+
+
+int main()
+{
+    if (checkDays() || checkDayOfYearRange()) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    timeConversions();
+    printf("PASS\n");
+    return 0;
+}
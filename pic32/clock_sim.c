@@ -0,0 +1,523 @@
+/*
+ * Simulates the whole radio clock, faster than real time.
+ *
+ * Usage: clock_sim [-j threads] [-h hours] [-n runs]
+ *
+ * Every run executes the radio_clock.c main loop with its time_keeper and
+ * decoder on the virtual clock of hal_linux.c, fed by a virtual WWVB
+ * transmitter. The transmitter starts at a random time, and each scenario
+ * adds sample noise, an error of the local oscillator and periodic
+ * dropouts. Runs are spread over a pool of threads, each with its own
+ * virtual board. For every scenario the time to the first sync, the
+ * latency of resyncs after dropouts and the error of the time sent over
+ * SPI, to the second and to the millisecond, are reported. No tick may be
+ * longer than MAXPERIOD, however far the seconds are moved, or the sampling
+ * interrupt would miss its end before the 16 bit Timer4 wraps.
+ *
+ * Build: gcc -std=c99 -O2 -pthread -DRADIO_CLOCK_NO_MAIN radio_clock.c \
+ *            time_keeping.c sample_queue.c bit_ring.c frame_voter.c \
+ *            capture_recorder.c time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c edge_filter.c spi_protocol.c hal_linux.c \
+ *            clock_sim.c -lm
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "civil_time.h"
+#include "hal.h"
+#include "radio_clock.h"
+#include "spi_protocol.h"
+#include "test_support.h"
+#include "time_keeping.h"
+#include "wwvb_signal.h"
+
+#define ERRORBINS 7        /* time errors from -3 s or less to 3 s or more */
+#define MAXLATENCIES 4096  /* resyncs kept per run */
+#define PHASEBINS 1000     /* packet time errors in 0.1 ms, up to 100 ms */
+
+
+/* conditions the clock runs in */
+typedef struct {
+    const char* name;
+    double noise;          /* probability that a sample is flipped */
+    double ppm;            /* local oscillator error */
+    int    dropoutEvery;   /* minutes between dropouts, 0 for none */
+    int    dropoutLength;  /* seconds of noise at the end of each period */
+} scenario;
+
+
+/* one run of a scenario, written only by the thread simulating it */
+typedef struct {
+    const scenario* config;
+    uint64_t seed;
+    time_t   start;         /* UTC of the minute the transmitter starts in */
+    double   phase;         /* seconds into the minute at virtual time 0 */
+    double   rate;          /* transmitter seconds per timer tick */
+
+    /* transmitter state */
+    long     frameMinute;
+    char     frame[FRAMESIZE];
+    long     lastSample;
+    int      lastLevel;
+
+    /* results */
+    double   firstSync;     /* seconds to the first sync, -1 if never */
+    long     nextDropout;   /* dropout whose resync is still pending */
+    int      resyncs;
+    double   latencies[MAXLATENCIES];
+    long     errors[ERRORBINS];
+    int      maxError;
+    long     phaseBins[PHASEBINS + 1];
+    unsigned longestTick;   /* timer ticks, from halLongestTick() */
+
+    /* words of the packet being received */
+    uint32_t words[PACKETWORDS];
+    int      wordCount;
+    long     badPackets;
+} simRun;
+
+
+/* work shared by the threads */
+typedef struct {
+    simRun*         runs;
+    int             count;
+    uint64_t        ticks;
+    pthread_mutex_t lock;
+    int             next;
+} simJob;
+
+
+static const scenario scenarios[] = {
+    {"clean",       0.0,    0.0,   0,   0},
+    {"noisy",       0.003,  20.0,  0,   0},
+    {"dropouts",    0.001,  50.0,  30,  300},
+    {"night",       0.002,  100.0, 180, 7200},
+    {"marginal",    0.01,   50.0,  0,   0},
+};
+
+
+/******************************************************************************/
+/********************************* Transmitter ********************************/
+/******************************************************************************/
+
+/* random number in [0, 1) fixed by the run and the sample */
+static double uniform(simRun* run, long sample)
+{
+    return (mix(run->seed ^ mix(sample)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+static int inDropout(const scenario* config, long second)
+{
+    long period = config->dropoutEvery * 60L;
+
+    return period && second % period >= period - config->dropoutLength;
+}
+
+
+/* US DST at a UTC time, from local standard time to keep it independent */
+static int usDst(time_t utc)
+{
+    long long local = (long long) utc + TIMEZONE;
+    struct tm localTime;
+    civilFromTime(local, &localTime);
+
+    /* the second Sunday of March and the first of November */
+    int  year     = localTime.tm_year + 1900;
+    long march    = daysFromCivil(year, 3, 8);
+    long november = daysFromCivil(year, 11, 1);
+
+    march    += (7 - (march + 4) % 7) % 7;
+    november += (7 - (november + 4) % 7) % 7;
+
+    /* 2:00 standard time to 2:00 DST, which is 1:00 standard time */
+    return local >= march * SECONDSPERDAY + 7200 &&
+           local <  november * SECONDSPERDAY + 3600;
+}
+
+
+/* DST status of the frames of the UTC day of a time, from DST at its ends */
+static int usDstStatus(time_t utc)
+{
+    time_t dayStart = utc / SECONDSPERDAY * SECONDSPERDAY;
+
+    return usDst(dayStart + SECONDSPERDAY) * DSTBEGINS
+         | usDst(dayStart) * DSTENDS;
+}
+
+
+/* receiver output at a virtual time, one level per transmitted sample */
+static int transmit(uint64_t tick, void* context)
+{
+    simRun* run = context;
+    long sample = (long) ((run->phase + tick * run->rate) * NSAMPLES);
+
+    if (sample == run->lastSample)
+        return run->lastLevel;
+
+    long second = sample / NSAMPLES;
+    long minute = second / 60;
+    int  level;
+
+    if (inDropout(run->config, second)) {
+        level = uniform(run, sample) < 0.5;
+
+    } else {
+        if (minute != run->frameMinute) {
+            time_t utc = run->start + minute * 60;
+            encodeFrame(utc, usDstStatus(utc), run->frame);
+            run->frameMinute = minute;
+        }
+
+        level  = sample % NSAMPLES >= pulseLows(run->frame[second % 60]);
+        level ^= uniform(run, sample) < run->config->noise;
+    }
+
+    run->lastSample = sample;
+    run->lastLevel  = level;
+
+    return level;
+}
+
+
+/******************************************************************************/
+/********************************** Receiver **********************************/
+/******************************************************************************/
+
+/* local time in a packet from createPacket(), in whole seconds */
+static long long packetTime(const timePacket* packet)
+{
+    return daysFromCivil(packet->year, packet->month, packet->day)
+         * SECONDSPERDAY + packet->hour * 3600L + packet->minute * 60L
+         + packet->second;
+}
+
+
+static void receive(const timePacket* packet, uint64_t tick, simRun* run)
+{
+    const scenario* config = run->config;
+
+    /* seconds since the start of the transmitter's first minute */
+    double seconds = run->phase + tick * run->rate;
+    int synced = !packet->header;
+
+    if (synced && run->firstSync < 0)
+        run->firstSync = tick / (double) HALTICKRATE;
+
+    /* first sync after the end of a dropout */
+    long period = config->dropoutEvery * 60L;
+
+    if (synced && period) {
+        long ended = (long) (seconds / period);
+
+        if (run->nextDropout <= ended) {
+            if (run->nextDropout > 0 && run->resyncs < MAXLATENCIES)
+                run->latencies[run->resyncs++] =
+                    seconds - run->nextDropout * period;
+
+            run->nextDropout = ended + 1;
+        }
+    }
+
+    if (run->firstSync < 0)
+        return;
+
+    /* compare the local time on the display with the transmitted time */
+    time_t    utc   = run->start + (time_t) seconds;
+    long long truth = utc + TIMEZONE + usDst(utc) * 3600LL;
+    long long shown = packetTime(packet);
+
+    /* to the millisecond, and to the nearest second, so a packet sent right
+     * at the turn of a second is not a second off */
+    double fine  = (double) (shown - truth) + packet->millisecond * 1e-3
+                 - (run->start + seconds - utc);
+    int    error = (int) floor(fine + 0.5);
+    int    bin   = error < -3 ? -3 : error > 3 ? 3 : error;
+
+    run->errors[bin + 3]++;
+
+    if (abs(error) > run->maxError)
+        run->maxError = abs(error);
+
+    long phaseBin = (long) (fabs(fine) * 1e4);
+
+    run->phaseBins[phaseBin < PHASEBINS ? phaseBin : PHASEBINS]++;
+}
+
+
+/* collect the words of a packet from the virtual SPI link */
+static void receiveWord(uint32_t word, uint64_t tick, void* context)
+{
+    simRun* run = context;
+
+    if (word >> 16 == PACKETSYNC)
+        run->wordCount = 0;
+
+    if (run->wordCount < PACKETWORDS)
+        run->words[run->wordCount++] = word;
+
+    if (run->wordCount < PACKETWORDS)
+        return;
+
+    timePacket packet;
+    run->wordCount = PACKETWORDS + 1;
+
+    if (decodePacket(run->words, &packet))
+        run->badPackets++;
+    else
+        receive(&packet, tick, run);
+}
+
+
+/******************************************************************************/
+/******************************** Thread pool *********************************/
+/******************************************************************************/
+
+static void simulate(simRun* run, uint64_t ticks)
+{
+    halReset();
+    halSetReceiverSource(transmit, run);
+    halSetSPISink(receiveWord, run);
+    halSetRunTime(ticks);
+
+    runRadioClock();
+    run->longestTick = halLongestTick();
+}
+
+
+static void* simWorker(void* arg)
+{
+    simJob* job = arg;
+
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        int next = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (next >= job->count)
+            break;
+
+        simulate(&job->runs[next], job->ticks);
+    }
+
+    return NULL;
+}
+
+
+static void runAll(simJob* job, int threads)
+{
+    pthread_t workers[threads > 1 ? threads - 1 : 1];
+    int started = 0;
+
+    while (started < threads - 1 &&
+           !pthread_create(&workers[started], NULL, simWorker, job))
+        started++;
+
+    /* the calling thread is one of the workers */
+    simWorker(job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+}
+
+
+/******************************************************************************/
+/*********************************** Report ***********************************/
+/******************************************************************************/
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* median and 99th percentile of the packet time errors in ms */
+static void printPhase(const long* bins)
+{
+    long total = 0, count = 0;
+    int  median = -1, p99 = -1;
+
+    for (int b = 0; b <= PHASEBINS; b++)
+        total += bins[b];
+
+    for (int b = 0; b <= PHASEBINS && total; b++) {
+        count += bins[b];
+
+        if (median < 0 && 2 * count >= total)
+            median = b;
+        if (p99 < 0 && 100 * count >= 99 * total)
+            p99 = b;
+    }
+
+    if (!total)
+        printf(" %7s %7s", "-", "-");
+    else if (p99 < PHASEBINS)
+        printf(" %5.1fms %5.1fms", median * 0.1, p99 * 0.1);
+    else
+        printf(" %5.1fms %7s", median * 0.1, ">100ms");
+}
+
+
+/* median and 99th percentile, "never" for values that never happened */
+static void printPercentiles(double* values, int count, int total)
+{
+    qsort(values, count, sizeof(double), compareDoubles);
+
+    int median = total / 2, p99 = 99 * total / 100;
+
+    if (median < count)
+        printf(" %7.0fs", values[median]);
+    else
+        printf(" %8s", "never");
+
+    if (p99 < count)
+        printf(" %7.0fs", values[p99]);
+    else
+        printf(" %8s", "never");
+}
+
+
+/* print one line of the report, returns the number of runs that never synced */
+static int report(const scenario* config, simRun* runs, int count)
+{
+    double first[count];
+    double* latencies = malloc((size_t) count * MAXLATENCIES * sizeof(double));
+    long errors[ERRORBINS] = {0};
+    long phaseBins[PHASEBINS + 1] = {0};
+    long packets = 0;
+    int synced = 0, resyncs = 0, maxError = 0;
+
+    for (int r = 0; r < count; r++) {
+        if (runs[r].firstSync >= 0)
+            first[synced++] = runs[r].firstSync;
+
+        memcpy(latencies + resyncs, runs[r].latencies,
+               runs[r].resyncs * sizeof(double));
+        resyncs += runs[r].resyncs;
+
+        for (int b = 0; b < ERRORBINS; b++) {
+            errors[b] += runs[r].errors[b];
+            packets   += runs[r].errors[b];
+        }
+
+        if (runs[r].maxError > maxError)
+            maxError = runs[r].maxError;
+
+        for (int b = 0; b <= PHASEBINS; b++)
+            phaseBins[b] += runs[r].phaseBins[b];
+    }
+
+    printf("%-9s %3d/%-3d", config->name, synced, count);
+    printPercentiles(first, synced, count);
+
+    printf(" %5d", resyncs);
+    if (resyncs)
+        printPercentiles(latencies, resyncs, resyncs);
+    else
+        printf(" %8s %8s", "-", "-");
+
+    printPhase(phaseBins);
+
+    for (int b = 0; b < ERRORBINS; b++)
+        printf(" %6.2f", packets ? 100.0 * errors[b] / packets : 0.0);
+
+    printf(" %4ds\n", maxError);
+    free(latencies);
+
+    return count - synced;
+}
+
+
+int main(int argc, char** argv)
+{
+    int threads = 4, runsPer = 8;
+    double hours = 6;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-j"))
+            threads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-h"))
+            hours = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-n"))
+            runsPer = atoi(argv[i + 1]);
+    }
+
+    if (threads < 1 || runsPer < 1 || hours <= 0) {
+        fprintf(stderr, "usage: %s [-j threads] [-h hours] [-n runs]\n",
+                argv[0]);
+        return 2;
+    }
+
+    int nscenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+    int count = nscenarios * runsPer;
+    simRun* runs = calloc(count, sizeof(simRun));
+
+    srand(1);
+
+    for (int i = 0; i < count; i++) {
+        simRun* run = &runs[i];
+        run->config = &scenarios[i / runsPer];
+        run->seed   = mix(i + 1);
+
+        /* a random minute from 2015 to 2040, entered part way through */
+        run->start = 1420070400 + (time_t) (rand() % 13000000) * 60;
+        run->phase = (rand() % 60000) / 1000.0;
+        run->rate  = (1 + run->config->ppm * 1e-6) / HALTICKRATE;
+
+        run->frameMinute = -1;
+        run->lastSample  = -1;
+        run->firstSync   = -1;
+    }
+
+    simJob job = {runs, count, (uint64_t) (hours * 3600 * HALTICKRATE),
+                  PTHREAD_MUTEX_INITIALIZER, 0};
+
+    runAll(&job, threads);
+
+    printf("%.1f hours per run, time error of the SPI output in %% of "
+           "packets after the first sync\n\n", hours);
+    printf("scenario  synced  first sync (med, p99)  resyncs "
+           "latency (med, p99)  packet error (med, p99)   <=-3     -2     "
+           "-1      0     +1     +2   >=+3  max\n");
+
+    /* a clean signal must always sync */
+    int failed = report(&scenarios[0], runs, runsPer) > 0;
+
+    for (int s = 1; s < nscenarios; s++)
+        report(&scenarios[s], runs + s * runsPer, runsPer);
+
+    /* every packet must pass its CRC on a perfect link */
+    long badPackets = 0;
+
+    for (int i = 0; i < count; i++)
+        badPackets += runs[i].badPackets;
+
+    if (badPackets) {
+        printf("%ld packets failed to decode\n", badPackets);
+        failed = 1;
+    }
+
+    /* the PIC32 would hang on a tick that ends after Timer4 wraps */
+    unsigned longestTick = 0;
+
+    for (int i = 0; i < count; i++)
+        if (runs[i].longestTick > longestTick)
+            longestTick = runs[i].longestTick;
+
+    printf("longest tick %u timer ticks, at most %u\n", longestTick,
+           (unsigned) MAXPERIOD);
+
+    if (longestTick > MAXPERIOD)
+        failed = 1;
+
+    free(runs);
+    pthread_mutex_destroy(&job.lock);
+
+    return failed;
+}
@@ -0,0 +1,89 @@
+#ifndef CYCLE_COUNTER_H_
+#define CYCLE_COUNTER_H_
+
+#include <stdint.h>
+
+/*
+ * A free running counter to time short stretches of code with. On the PIC32
+ * it is the core timer, which counts every other SYSCLK cycle, on x86 the
+ * time stamp counter and on 64 bit ARM the virtual counter. Anywhere else
+ * it falls back to the monotonic clock in nanoseconds, which needs
+ * _POSIX_C_SOURCE defined before the first include. Counts are taken as
+ * differences of readCycles(), so a counter narrower than 64 bits may wrap
+ * between the two reads.
+ */
+#if defined(__PIC32MX__)
+#include <P32xxxx.h>
+
+typedef uint32_t cycleCount;
+
+#define CYCLECOUNTER "core timer"
+#define CYCLESPERCOUNT 2    /* SYSCLK cycles per count */
+
+static inline cycleCount readCycles(void)
+{
+    return _CP0_GET_COUNT();
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+typedef uint64_t cycleCount;
+
+#define CYCLECOUNTER "tsc"
+#define CYCLESPERCOUNT 1
+
+static inline cycleCount readCycles(void)
+{
+    return __rdtsc();
+}
+
+#elif defined(__aarch64__)
+
+typedef uint64_t cycleCount;
+
+#define CYCLECOUNTER "cntvct"
+#define CYCLESPERCOUNT 1
+
+static inline cycleCount readCycles(void)
+{
+    uint64_t count;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r" (count));
+
+    return count;
+}
+
+#else
+#include <time.h>
+
+typedef uint64_t cycleCount;
+
+#define CYCLECOUNTER "ns"
+#define CYCLESPERCOUNT 1
+
+static inline cycleCount readCycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif
+
+
+/*
+ * \brief Cycles between two reads of the counter.
+ *
+ * \param start Earlier value of readCycles().
+ * \param end Later value of readCycles().
+ *
+ * \returns Cycles in between, corrected for counters that wrap.
+ */
+static inline uint64_t cyclesBetween(cycleCount start, cycleCount end)
+{
+    return (uint64_t) (cycleCount) (end - start) * CYCLESPERCOUNT;
+}
+
+
+#endif /* CYCLE_COUNTER_H_ */
@@ -0,0 +1,336 @@
+/*
+ * Decodes the test corpus of wwvb_synthesize in memory and checks every
+ * case against its time as it goes.
+ *
+ * Usage: decoder_regress [-j threads] [-n cases] [-s seed]
+ *
+ * The cases are the ones of signals.txt and time.txt, split into blocks of
+ * SYNTHBLOCK cases that a pool of threads generates and runs through
+ * updateDecoderRun(), a run of equal samples at a time, and
+ * updateTimeAndDate(), restarting after every frame pair the same way
+ * time_decoder_test.c does. Each block starts like the corpus, with noise
+ * and a marker, and the frame pair of each case has to decode to its time
+ * at the first sample of the next case. The first case that does
+ * not is reported with its start time, what was decoded and the state of
+ * the decoder, and the run fails. By default all CORPUSCASES cases are
+ * checked, in less than a second on four cores, and -n checks only the
+ * first cases.
+ *
+ * Build: gcc -std=c99 -O2 -pthread time_decoder.c frame_layout.c \
+ *            civil_time.c wwvb_signal.c wwvb_synthesizer.c test_support.c \
+ *            decoder_regress.c
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "civil_time.h"
+#include "test_support.h"
+#include "wwvb_synthesizer.h"
+
+#define NOISESAMPLES 22    /* samples of noise before the first marker */
+#define NOFAILURE -1
+
+
+/* the first case that did not decode to its time */
+typedef struct {
+    long        index;     /* case, or NOFAILURE */
+    const char* problem;
+    char        truth[TRUTHSIZE];
+    time_t      decoded;   /* only if the frames decoded to a time */
+    int         valid;
+    timeDecoder decoder;   /* before the restart of a sync */
+} regressFailure;
+
+
+/* work shared by the threads */
+typedef struct {
+    uint64_t        seed;
+    long            cases;
+    pthread_mutex_t lock;
+    long            next;       /* first case of the next block */
+    regressFailure  failure;    /* of the lowest case */
+} regressJob;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* the time.txt line of a decoded time, without the line break */
+static void formatMinute(time_t time, char* text, size_t size)
+{
+    struct tm civil;
+    civilFromTime(time, &civil);
+
+    snprintf(text, size, "%04d-%02d-%02d %02d:%02d", civil.tm_year + 1900,
+             civil.tm_mon + 1, civil.tm_mday, civil.tm_hour, civil.tm_min);
+}
+
+
+static void formatSecond(time_t time, char* text, size_t size)
+{
+    struct tm civil;
+    civilFromTime(time, &civil);
+
+    snprintf(text, size, "%04d-%02d-%02d %02d:%02d:%02d",
+             civil.tm_year + 1900, civil.tm_mon + 1, civil.tm_mday,
+             civil.tm_hour, civil.tm_min, civil.tm_sec);
+}
+
+
+/* samples from pos to the next change of level, at most up to end */
+static long runLength(const char* text, long pos, long end)
+{
+    const char* next = memchr(text + pos + 1, text[pos] ^ 1, end - pos - 1);
+
+    return next ? next - (text + pos) : end - pos;
+}
+
+
+/* keep a failure if it is the first case to fail so far */
+static void recordFailure(regressJob* job, const regressFailure* failure)
+{
+    pthread_mutex_lock(&job->lock);
+
+    if (job->failure.index == NOFAILURE || failure->index < job->failure.index)
+        job->failure = *failure;
+
+    pthread_mutex_unlock(&job->lock);
+}
+
+
+/*
+ * Check the frame pair of a case decoded by a full buffer, and restart from
+ * the last marker. Returns 0 if it decoded to the time of the case.
+ */
+static int checkSync(timeDecoder* decoder, regressFailure* failure)
+{
+    char decoded[64];
+    int dst;
+
+    failure->decoder = *decoder;
+    failure->valid   = !updateTimeAndDate(decoder, &failure->decoded, &dst);
+
+    if (!failure->valid) {
+        initDecoder(decoder);
+        failure->problem = "valid bits but encoding is invalid";
+        return 1;
+    }
+
+    /* if successful, keep first marker and keep going */
+    keepLastMarker(decoder);
+
+    formatMinute(failure->decoded, decoded, sizeof(decoded));
+
+    if (memcmp(decoded, failure->truth, TRUTHSIZE - 1)) {
+        failure->problem = "decoded to the wrong time";
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* decode one block of cases, returns 0 if all of them decoded right */
+static int decodeBlock(regressJob* job, long first, long count, char* text,
+                       regressFailure* failure)
+{
+    char truth[TRUTHSIZE];
+    timeDecoder decoder;
+    initDecoder(&decoder);
+
+    /* the start of the corpus */
+    for (int i = 0; i < NOISESAMPLES + NSAMPLES; i++)
+        updateDecoder(&decoder, i < NOISESAMPLES ||
+                      i - NOISESAMPLES >= pulseLows('m'));
+
+    failure->index = NOFAILURE;
+
+    for (long k = 0; k <= count; k++) {
+        if (k < count)
+            caseToText(job->seed, first + k, text, truth);
+
+        /* the falling edge after the last marker ends the previous case */
+        long length = k < count ? CASESAMPLES : 1;
+        long j = 0;
+
+        while (j < length) {
+            int input = k < count ? text[j] - '0' : 0;
+            int status;
+            long start = j;
+
+            j += updateDecoderRun(&decoder, input,
+                                  runLength(text, j, length), &status);
+
+            /* the sample the status is for, the others returned 0 */
+            long last = j - 1;
+
+            if (status == 3 && (last || !k)) {
+                failure->index = first + k;
+                failure->valid = 0;
+                failure->decoder = decoder;
+                memcpy(failure->truth, truth, TRUTHSIZE);
+                failure->problem = "frames decoded before the end of the case";
+                return 1;
+            }
+
+            if (status == 3 && checkSync(&decoder, failure)) {
+                failure->index = first + k - 1;
+                return 1;
+            }
+
+            if (start == 0 && k && (last || status != 3)) {
+                failure->index = first + k - 1;
+                failure->valid = 0;
+                failure->decoder = decoder;
+                failure->problem = "no frames decoded at the end of the case";
+                return 1;
+            }
+
+            if (k == count)
+                return 0;
+        }
+
+        memcpy(failure->truth, truth, TRUTHSIZE);
+    }
+
+    return 0;
+}
+
+
+static void* regressWorker(void* arg)
+{
+    regressJob* job = arg;
+    char* text = malloc(CASESAMPLES);
+    regressFailure failure;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        long first = job->next;
+        job->next += SYNTHBLOCK;
+        long failed = job->failure.index;
+        pthread_mutex_unlock(&job->lock);
+
+        /* nothing left, or nothing left before the first failure */
+        if (first >= job->cases || (failed != NOFAILURE && first > failed))
+            break;
+
+        long count = job->cases - first < SYNTHBLOCK ? job->cases - first
+                                                     : SYNTHBLOCK;
+
+        if (decodeBlock(job, first, count, text, &failure))
+            recordFailure(job, &failure);
+    }
+
+    free(text);
+    return NULL;
+}
+
+
+static void printFailure(const regressJob* job, const regressFailure* failure)
+{
+    static const char* states[] = {"waitForHigh", "waitForEdge", "countLow",
+                                   "countHigh", "bufferFull"};
+    const timeDecoder* decoder = &failure->decoder;
+    char start[64], decoded[64];
+
+    formatSecond(caseTime(job->seed, failure->index), start, sizeof(start));
+    printf("case %ld from %s: %s\n", failure->index, start, failure->problem);
+    printf("  expected %.*s", TRUTHSIZE, failure->truth);
+
+    if (failure->valid) {
+        formatMinute(failure->decoded, decoded, sizeof(decoded));
+        printf("  decoded  %s\n", decoded);
+    }
+
+    printf("  decoder  %s, foundStart %d, bitCount %d, inputCount %d, "
+           "zeroCount %d, glitched %d\n  bits     ",
+           states[decoder->currentState], decoder->foundStart,
+           decoder->bitCount, decoder->inputCount, decoder->zeroCount,
+           decoder->glitched);
+
+    /* bits as in a frame listing, 0, 1, m and x for erasures */
+    for (int i = 0; i < decoder->bitCount && i < BUFFERSIZE; i++) {
+        char bit = decoder->bitBuffer[i];
+        putchar(bit == 0 ? '0' : bit == 1 ? '1' : bit);
+
+        if (i % FRAMESIZE == FRAMESIZE - 1 && i + 1 < decoder->bitCount)
+            printf("\n           ");
+    }
+
+    printf("\n");
+}
+
+
+/******************************************************************************/
+/*********************************** Main *************************************/
+/******************************************************************************/
+
+int main(int argc, char** argv)
+{
+    int threads = 4;
+    long cases = CORPUSCASES;
+    uint64_t seed = 1;
+    int usage = argc % 2 == 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-j"))
+            threads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-n"))
+            cases = atol(argv[i + 1]);
+        else if (!strcmp(argv[i], "-s"))
+            seed = strtoull(argv[i + 1], NULL, 10);
+        else
+            usage = 1;
+    }
+
+    if (usage || threads < 1 || cases < 1) {
+        fprintf(stderr, "usage: %s [-j threads] [-n cases] [-s seed]\n",
+                argv[0]);
+        return 2;
+    }
+
+    regressJob job;
+    job.seed  = seed;
+    job.cases = cases;
+    job.next  = 0;
+    job.failure.index = NOFAILURE;
+    pthread_mutex_init(&job.lock, NULL);
+
+    double begin = now();
+
+    pthread_t workers[threads > 1 ? threads - 1 : 1];
+    int started = 0;
+
+    while (started < threads - 1 &&
+           !pthread_create(&workers[started], NULL, regressWorker, &job))
+        started++;
+
+    /* the calling thread is one of the workers */
+    regressWorker(&job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    double elapsed = now() - begin;
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "cases: %ld on %d threads in %.3f s (%.0f/s)\n", cases,
+            started + 1, elapsed, cases / elapsed);
+
+    pthread_mutex_destroy(&job.lock);
+
+    if (job.failure.index != NOFAILURE) {
+        printFailure(&job, &job.failure);
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "decoder_telemetry.h"
+
+static const char* resetNames[NRESETCAUSES] = {
+    "longLow", "longHigh", "shortHigh", "noStart"
+};
+
+static const char* symbolNames[NSYMBOLS] = {
+    "zero", "one", "marker", "erasure"
+};
+
+static const char* stateNames[bufferFull + 1] = {
+    "waitForHigh", "waitForEdge", "countLow", "countHigh", "bufferFull"
+};
+
+static const char* pairNames[NFRAMEPAIRS] = {
+    "decoded", "badFirst", "badSecond", "mismatch", "ambiguous"
+};
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+static int findName(const char** names, int count, const char* name)
+{
+    for (int i = 0; i < count; i++)
+        if (!strcmp(names[i], name))
+            return i;
+
+    return -1;
+}
+
+
+/* read the values of one line into counters, returns how many there were */
+static int readValues(const char* text, uint32_t* values, int count)
+{
+    int read = 0;
+
+    for (; read < count; read++) {
+        char* end;
+        long value = strtol(text, &end, 10);
+
+        if (end == text)
+            break;
+
+        values[read] = (uint32_t) value;
+        text = end;
+    }
+
+    return read;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+int writeDecoderTelemetry(FILE* out, const decoderTelemetry* telemetry)
+{
+    /* count the stay still going on as if it ended now */
+    decoderTelemetry counts = *telemetry;
+    uint32_t length = counts.runLength;
+
+    if (length && counts.runState <= bufferFull)
+        counts.dwellRuns[counts.runState][length < DWELLBINS ? length - 1
+                                                             : DWELLBINS - 1]++;
+
+    fprintf(out, "# decoder telemetry, 100 ms samples\n");
+    fprintf(out, "samples total %lu\n", (unsigned long) counts.samples);
+
+    for (int i = 0; i < NRESETCAUSES; i++)
+        fprintf(out, "reset %s %lu\n", resetNames[i],
+                (unsigned long) counts.resets[i]);
+
+    for (int i = 0; i < NSYMBOLS; i++)
+        fprintf(out, "symbol %s %lu\n", symbolNames[i],
+                (unsigned long) counts.symbols[i]);
+
+    fprintf(out, "symbol glitched %lu\n", (unsigned long) counts.glitches);
+
+    for (int i = 0; i <= bufferFull; i++) {
+        fprintf(out, "dwell %s %lu\nruns %s", stateNames[i],
+                (unsigned long) counts.dwell[i], stateNames[i]);
+
+        for (int j = 0; j < DWELLBINS; j++)
+            fprintf(out, " %lu", (unsigned long) counts.dwellRuns[i][j]);
+
+        fprintf(out, "\n");
+    }
+
+    for (int i = 0; i < NFRAMEPAIRS; i++)
+        fprintf(out, "pair %s %lu\n", pairNames[i],
+                (unsigned long) counts.pairs[i]);
+
+    int synced = counts.pairs[pairDecoded] > 0;
+
+    fprintf(out, "sync first %ld\nsync last %ld\n",
+            synced ? (long) counts.firstSync : -1L,
+            synced ? (long) counts.lastSync  : -1L);
+
+    return ferror(out) != 0;
+}
+
+
+int readDecoderTelemetry(FILE* in, decoderTelemetry* telemetry)
+{
+    char line[256];
+    int  lines = 0;
+
+    memset(telemetry, 0, sizeof(*telemetry));
+
+    while (fgets(line, sizeof(line), in)) {
+        char group[16], name[16];
+        int  used;
+
+        if (line[0] == '#' ||
+            sscanf(line, "%15s %15s%n", group, name, &used) != 2)
+            continue;
+
+        const char* values = line + used;
+        int found = -1;
+        uint32_t value = 0;
+
+        if (!strcmp(group, "runs")) {
+            found = findName(stateNames, bufferFull + 1, name);
+
+            if (found >= 0)
+                readValues(values, telemetry->dwellRuns[found], DWELLBINS);
+
+        } else if (readValues(values, &value, 1) != 1) {
+            continue;
+
+        } else if (!strcmp(group, "samples")) {
+            telemetry->samples = value;
+            found = 0;
+
+        } else if (!strcmp(group, "reset")) {
+            found = findName(resetNames, NRESETCAUSES, name);
+
+            if (found >= 0)
+                telemetry->resets[found] = value;
+
+        } else if (!strcmp(group, "symbol") && !strcmp(name, "glitched")) {
+            telemetry->glitches = value;
+            found = 0;
+
+        } else if (!strcmp(group, "symbol")) {
+            found = findName(symbolNames, NSYMBOLS, name);
+
+            if (found >= 0)
+                telemetry->symbols[found] = value;
+
+        } else if (!strcmp(group, "dwell")) {
+            found = findName(stateNames, bufferFull + 1, name);
+
+            if (found >= 0)
+                telemetry->dwell[found] = value;
+
+        } else if (!strcmp(group, "pair")) {
+            found = findName(pairNames, NFRAMEPAIRS, name);
+
+            if (found >= 0)
+                telemetry->pairs[found] = value;
+
+        } else if (!strcmp(group, "sync")) {
+            /* -1 without a sync reads as 0, pair decoded tells them apart */
+            uint32_t* sync = !strcmp(name, "first") ? &telemetry->firstSync
+                           : !strcmp(name, "last")  ? &telemetry->lastSync
+                           : NULL;
+
+            if (sync && value != (uint32_t) -1)
+                *sync = value;
+
+            found = sync ? 0 : -1;
+        }
+
+        lines += found >= 0;
+    }
+
+    /* the stay still going on was written as if it ended */
+    telemetry->runState = waitForHigh;
+
+    return !lines;
+}
@@ -0,0 +1,54 @@
+#ifndef DECODER_TELEMETRY_H_
+#define DECODER_TELEMETRY_H_
+
+#include <stdio.h>
+
+#include "time_decoder.h"
+
+#ifndef DECODER_TELEMETRY
+#error "decoder_telemetry.h needs a build with -DDECODER_TELEMETRY"
+#endif
+
+
+/*
+ * \brief Write the telemetry of a timeDecoder as text.
+ *
+ * One "group name values" line per counter, with a leading comment, so the
+ * dumps of many runs can be compared with diff or summed with awk:
+ *
+ *     samples total 36000
+ *     reset longLow 3
+ *     symbol marker 120
+ *     dwell countLow 21000
+ *     runs countLow 0 4 300 ...
+ *     pair decoded 5
+ *     sync first 1234
+ *
+ * A dwell line has the samples spent in a state, the runs line after it the
+ * stays in that state of 1 to DWELLBINS or more samples, including the one
+ * still going on. The sync lines are in samples since the counters were
+ * cleared, and -1 without a decoded pair.
+ *
+ * \param out Stream to write to.
+ * \param telemetry Counters to write.
+ *
+ * \returns 0 on success, 1 if the stream failed.
+ */
+int writeDecoderTelemetry(FILE* out, const decoderTelemetry* telemetry);
+
+
+/*
+ * \brief Read telemetry written by writeDecoderTelemetry().
+ *
+ * Unknown lines are skipped and missing counters read as 0, so dumps of
+ * older and newer builds can still be read.
+ *
+ * \param in Stream to read from.
+ * \param telemetry Stores the counters read.
+ *
+ * \returns 0 on success, 1 if the stream held no counters.
+ */
+int readDecoderTelemetry(FILE* in, decoderTelemetry* telemetry);
+
+
+#endif /* DECODER_TELEMETRY_H_ */
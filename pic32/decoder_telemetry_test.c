@@ -0,0 +1,232 @@
+/*
+ * Checks the telemetry counters of the decoder and their text dump.
+ *
+ * A clean capture must sync with no resets but the ones before the start of
+ * frame, with every sample counted in exactly one state and every pulse as
+ * one symbol. Short sequences then provoke each reset cause and a glitched
+ * pulse, and hand-made frame pairs each reason updateTimeAndDate() rejects
+ * a pair for. The counters must come back the same from their dump.
+ *
+ * Build: gcc -std=c99 -O2 -DDECODER_TELEMETRY time_decoder.c frame_layout.c \
+ *            civil_time.c wwvb_signal.c decoder_telemetry.c \
+ *            test_support.c decoder_telemetry_test.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "decoder_telemetry.h"
+#include "test_support.h"
+#include "wwvb_signal.h"
+
+#define NMINUTES 10
+#define CAPTURESTART 1399997400    /* 16:10 UTC, minute units digit 0 */
+#define MINUTE2BIT 7               /* weight 2 of the minute field */
+
+
+static void feed(timeDecoder* decoder, const char* inputs)
+{
+    for (; *inputs; inputs++)
+        updateDecoder(decoder, *inputs - '0');
+}
+
+
+/* the counters must survive a dump and a read back */
+static void checkDump(const decoderTelemetry* telemetry)
+{
+    FILE* file = tmpfile();
+    decoderTelemetry read;
+
+    expect(file && !writeDecoderTelemetry(file, telemetry), "dump written");
+
+    if (!file)
+        return;
+
+    rewind(file);
+    expect(!readDecoderTelemetry(file, &read), "dump read back");
+    fclose(file);
+
+    expect(read.samples == telemetry->samples, "dumped samples");
+    expect(!memcmp(read.resets, telemetry->resets, sizeof(read.resets)),
+           "dumped resets");
+    expect(!memcmp(read.symbols, telemetry->symbols, sizeof(read.symbols)),
+           "dumped symbols");
+    expect(read.glitches == telemetry->glitches, "dumped glitches");
+    expect(!memcmp(read.dwell, telemetry->dwell, sizeof(read.dwell)),
+           "dumped dwell");
+    expect(!memcmp(read.pairs, telemetry->pairs, sizeof(read.pairs)),
+           "dumped pairs");
+    expect(read.firstSync == telemetry->firstSync &&
+           read.lastSync == telemetry->lastSync, "dumped syncs");
+
+    /* the stays of 2 to 9 samples in the pulse states add up to the dwell */
+    for (int state = countLow; state <= countHigh; state++) {
+        uint32_t total = 0;
+
+        for (int j = 0; j < DWELLBINS; j++)
+            total += (j + 1) * read.dwellRuns[state][j];
+
+        expect(total == read.dwell[state], "dumped stays add up to dwell");
+    }
+}
+
+
+static void checkCleanCapture()
+{
+    static char samples[NMINUTES * FRAMESAMPLES];
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    clearDecoderTelemetry(&decoder);
+
+    for (int m = 0; m < NMINUTES; m++) {
+        char frame[FRAMESIZE];
+        encodeFrame(CAPTURESTART + 60 * m, 0, frame);
+        frameToSamples(frame, samples + m * FRAMESAMPLES);
+    }
+
+    int syncs = 0, wrong = 0;
+    uint32_t firstSync = 0;
+
+    for (long i = 0; i < NMINUTES * FRAMESAMPLES; i++) {
+        if (updateDecoder(&decoder, samples[i]) != 3)
+            continue;
+
+        time_t unixTime;
+        int dst;
+
+        if (updateTimeAndDate(&decoder, &unixTime, &dst)) {
+            wrong++;
+            initDecoder(&decoder);
+            continue;
+        }
+
+        /* decoded at the falling edge that starts the next minute */
+        wrong += unixTime != CAPTURESTART + 60 * ((i + 1) / FRAMESAMPLES);
+        firstSync = syncs++ ? firstSync : (uint32_t) (i + 1);
+        keepLastMarker(&decoder);
+    }
+
+    const decoderTelemetry* telemetry = &decoder.telemetry;
+    uint32_t dwell = 0, symbols = 0;
+
+    for (int i = 0; i <= bufferFull; i++)
+        dwell += telemetry->dwell[i];
+
+    for (int i = 0; i < NSYMBOLS; i++)
+        symbols += telemetry->symbols[i];
+
+    expect(syncs > 0 && !wrong, "clean capture decodes");
+    expect(telemetry->samples == NMINUTES * FRAMESAMPLES, "samples counted");
+    expect(dwell == telemetry->samples, "every sample in one state");
+    expect(telemetry->pairs[pairDecoded] == (uint32_t) syncs, "syncs counted");
+    expect(telemetry->firstSync == firstSync, "time to first sync");
+    expect(!telemetry->resets[resetLongLow] &&
+           !telemetry->resets[resetLongHigh] &&
+           !telemetry->resets[resetShortHigh], "no resets on clean pulses");
+    expect(telemetry->resets[resetNoStart] > 0, "resets before frame start");
+    expect(!telemetry->symbols[symbolErasure] && !telemetry->glitches,
+           "no erasures on clean pulses");
+
+    /* every pulse ends as a symbol, but the first one is cut off at the start
+     * and the last one ends at the falling edge after the capture */
+    expect(symbols == NMINUTES * FRAMESIZE - 2, "one symbol per pulse");
+
+    checkDump(telemetry);
+}
+
+
+static void checkResets()
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    clearDecoderTelemetry(&decoder);
+
+    /* a low of 11 samples, a high of 30 and a high cut short twice */
+    feed(&decoder, "10000000000000000000");
+    feed(&decoder, "10111111111111111111111111111111");
+    feed(&decoder, "0");
+    feed(&decoder, "101000");
+
+    /* a glitched pulse is erased, and can't start a frame */
+    feed(&decoder, "100101111110");
+
+    const decoderTelemetry* telemetry = &decoder.telemetry;
+
+    expect(telemetry->resets[resetLongLow] == 1, "too many lows");
+    expect(telemetry->resets[resetLongHigh] == 1, "too many highs");
+    expect(telemetry->resets[resetShortHigh] == 1, "too few highs");
+    expect(telemetry->resets[resetNoStart] == 1, "no frame start");
+    expect(telemetry->glitches == 2, "glitches");
+    expect(telemetry->symbols[symbolErasure] == 1, "erased pulse");
+    expect(!telemetry->pairs[pairDecoded], "no sync");
+
+    checkDump(telemetry);
+}
+
+
+/* one frame pair through updateTimeAndDate(), returns 0 if it decoded */
+static int decodePair(timeDecoder* decoder, time_t first, time_t second,
+                      int erase, int corrupt)
+{
+    time_t unixTime;
+    int dst;
+
+    encodeFrame(first, 0, decoder->bitBuffer);
+    encodeFrame(second, 0, decoder->bitBuffer + FRAMESIZE);
+
+    if (erase >= 0) {
+        decoder->bitBuffer[erase] = ERASURE;
+        decoder->bitBuffer[FRAMESIZE + erase] = ERASURE;
+    }
+
+    if (corrupt >= 0)
+        decoder->bitBuffer[corrupt] = 1;
+
+    return updateTimeAndDate(decoder, &unixTime, &dst);
+}
+
+
+static void checkFramePairs()
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    clearDecoderTelemetry(&decoder);
+
+    time_t start = CAPTURESTART;
+
+    expect(!decodePair(&decoder, start, start + 60, -1, -1), "pair decodes");
+    expect(decodePair(&decoder, start, start + 60, -1, 0), "bad first frame");
+    expect(decodePair(&decoder, start, start + 60, -1, FRAMESIZE),
+           "bad second frame");
+    expect(decodePair(&decoder, start, start, -1, -1),
+           "frames not a minute apart");
+
+    /* minutes 10 or 12 then 11 or 13 */
+    expect(decodePair(&decoder, start, start + 60, MINUTE2BIT, -1),
+           "ambiguous erasures");
+
+    const uint32_t* pairs = decoder.telemetry.pairs;
+
+    for (int i = 0; i < NFRAMEPAIRS; i++)
+        expect(pairs[i] == 1, "one pair of each outcome");
+
+    expect(decoder.telemetry.firstSync == 0, "synced before any samples");
+
+    checkDump(&decoder.telemetry);
+}
+
+
+int main()
+{
+    checkCleanCapture();
+    checkResets();
+    checkFramePairs();
+
+    if (failures) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "edge_filter.h"
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initEdgeFilter(edgeFilter* filter, int window, int fallAt, int riseAt,
+                    uint32_t readTicks)
+{
+    filter->window    = window;
+    filter->fallAt    = fallAt;
+    filter->riseAt    = riseAt;
+    filter->readTicks = readTicks;
+
+    /* the decoder also starts out waiting for the carrier */
+    filter->history = window < MAXFILTERWINDOW ? ((uint32_t) 1 << window) - 1
+                                  : ~(uint32_t) 0;
+    filter->sum     = window;
+    filter->level   = 1;
+}
+
+
+int filterRead(edgeFilter* filter, int read, uint32_t time, pinEdge* edge)
+{
+    int oldest = filter->history >> (filter->window - 1) & 1;
+
+    read = read != 0;
+    filter->history = filter->history << 1 | read;
+    filter->sum += read - oldest;
+
+    int level = filter->level ? filter->sum > filter->fallAt
+                              : filter->sum >= filter->riseAt;
+
+    if (level == filter->level)
+        return 0;
+
+    filter->level = level;
+
+    /* on a clean edge every read since it is at the new level */
+    int after = level ? filter->sum : filter->window - filter->sum;
+
+    edge->time  = time - (uint32_t) (after - 1) * filter->readTicks
+                - filter->readTicks / 2;
+    edge->level = level;
+
+    return 1;
+}
+
+
+void initCaptureFilter(captureFilter* filter, uint32_t minTicks)
+{
+    filter->minTicks = minTicks;
+    filter->level    = 1;
+    filter->pending  = 0;
+}
+
+
+int filterCapture(captureFilter* filter, uint32_t time, int level,
+                  pinEdge* edge)
+{
+    int kept = pollCapture(filter, time, edge);
+    level = level != 0;
+
+    if (filter->pending) {
+        /* back to the level before it too soon, both were a glitch */
+        if (level != filter->edge.level)
+            filter->pending = 0;
+
+        return kept;
+    }
+
+    if (level != filter->level) {
+        filter->pending    = 1;
+        filter->edge.time  = time;
+        filter->edge.level = level;
+    }
+
+    return kept;
+}
+
+
+int pollCapture(captureFilter* filter, uint32_t now, pinEdge* edge)
+{
+    if (!filter->pending || now - filter->edge.time < filter->minTicks)
+        return 0;
+
+    filter->pending = 0;
+    filter->level   = filter->edge.level;
+    *edge = filter->edge;
+
+    return 1;
+}
+
+
+void initPulseMeter(pulseMeter* meter)
+{
+    meter->started = 0;
+    meter->rose    = 0;
+}
+
+
+int measurePulse(pulseMeter* meter, pinEdge edge, pinPulse* pulse)
+{
+    if (edge.level) {
+        if (meter->started && !meter->rose) {
+            meter->pulse.low = edge.time - meter->pulse.start;
+            meter->rose = 1;
+        }
+
+        return 0;
+    }
+
+    int complete = meter->started && meter->rose;
+
+    if (complete) {
+        meter->pulse.length = edge.time - meter->pulse.start;
+        *pulse = meter->pulse;
+    }
+
+    /* every falling edge starts the next pulse */
+    meter->started     = 1;
+    meter->rose        = 0;
+    meter->pulse.start = edge.time;
+
+    return complete;
+}
+
+
+void initEdgeSampler(edgeSampler* sampler, uint32_t sampleTicks,
+                     uint32_t time)
+{
+    sampler->sampleTicks = sampleTicks;
+    sampler->lastTime    = time;
+    sampler->phase       = 0;
+    sampler->level       = 1;
+}
+
+
+int edgeRun(edgeSampler* sampler, pinEdge edge, int* level)
+{
+    int32_t elapsed = (int32_t) (edge.time - sampler->lastTime);
+
+    /* an edge dated back past the last one is at the same time */
+    if (elapsed < 0)
+        elapsed = 0;
+
+    int64_t ticks = sampler->phase + elapsed;
+
+    /* the phase stays within half a sample, so ticks is never that short */
+    int64_t samples = (ticks + sampler->sampleTicks / 2)
+                    / sampler->sampleTicks;
+
+    sampler->phase    = (long) (ticks - samples * sampler->sampleTicks);
+    sampler->lastTime += (uint32_t) elapsed;
+
+    *level = sampler->level;
+    sampler->level = edge.level;
+
+    return (int) samples;
+}
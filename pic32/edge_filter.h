@@ -0,0 +1,215 @@
+#ifndef EDGE_FILTER_H_
+#define EDGE_FILTER_H_
+
+#include <stdint.h>
+
+#define MAXFILTERWINDOW 32    /* Most reads a read filter sums over */
+
+
+/* A change of the filtered receiver level */
+typedef struct {
+    uint32_t time;     /* timer ticks, wrapping */
+    int      level;    /* level after the edge, 0 for a falling edge */
+} pinEdge;
+
+
+/* A pulse of the time signal, from one falling edge to the next */
+typedef struct {
+    uint32_t start;     /* time of the falling edge that started it */
+    uint32_t low;       /* ticks to the rising edge */
+    uint32_t length;    /* ticks to the next falling edge */
+} pinPulse;
+
+
+/*
+ * Filters reads of the receiver pin taken at a fixed interval. The sum of
+ * the last window reads is a moving average of the level, and the filtered
+ * level falls once the sum drops to fallAt and rises once it reaches
+ * riseAt. Thresholds a read apart are a majority vote, 0 and window a
+ * debounce that needs every read to agree, and anything in between adds
+ * hysteresis. Each change of the level is an edge, dated back to where the
+ * reads at the new level started on a clean edge.
+ */
+typedef struct {
+    uint32_t history;      /* last reads, newest in bit 0 */
+    int      window;       /* reads in the sum, 1 to MAXFILTERWINDOW */
+    int      fallAt;       /* sum the level falls at */
+    int      riseAt;       /* sum the level rises at */
+    int      sum;          /* 1 reads in the window */
+    int      level;        /* filtered level */
+    uint32_t readTicks;    /* timer ticks between reads */
+} edgeFilter;
+
+
+/*
+ * Filters the edges of the receiver pin timed by an input capture unit. An
+ * edge only counts once the pin has stayed at its level for minTicks, so a
+ * pair of edges closer than that is a glitch and both are dropped. Kept
+ * edges have the time they were captured at.
+ */
+typedef struct {
+    uint32_t minTicks;    /* shortest level that is kept */
+    int      level;       /* filtered level */
+    int      pending;     /* an edge is waiting for minTicks to pass */
+    pinEdge  edge;        /* the edge waiting */
+} captureFilter;
+
+
+/* Measures the pulses between filtered falling edges */
+typedef struct {
+    int      started;    /* a falling edge started the pulse */
+    int      rose;       /* and a rising edge has followed it */
+    pinPulse pulse;      /* the pulse so far */
+} pulseMeter;
+
+
+/*
+ * Turns filtered edges into runs of decoder samples. Edges are rounded to a
+ * grid of samples, so rounding errors don't add up from run to run.
+ */
+typedef struct {
+    uint32_t sampleTicks;    /* timer ticks per decoder sample */
+    uint32_t lastTime;       /* time of the last edge */
+    long     phase;          /* ticks the last edge was past its sample */
+    int      level;          /* level since the last edge */
+} edgeSampler;
+
+
+/*
+ * \brief Initialize a filter of pin reads, at full carrier amplitude.
+ *
+ * \param filter Pointer to edgeFilter to initialize.
+ * \param window Number of reads summed, 1 to MAXFILTERWINDOW.
+ * \param fallAt Sum of the reads at or below which the level falls.
+ * \param riseAt Sum of the reads at or above which the level rises, more
+ *     than fallAt.
+ * \param readTicks Timer ticks between two reads.
+ */
+void initEdgeFilter(edgeFilter* filter, int window, int fallAt, int riseAt,
+                    uint32_t readTicks);
+
+
+/*
+ * \brief Initialize a filter taking the majority of an odd number of reads.
+ */
+static inline void initMajorityFilter(edgeFilter* filter, int window,
+                                      uint32_t readTicks)
+{
+    initEdgeFilter(filter, window, window / 2, window / 2 + 1, readTicks);
+}
+
+
+/*
+ * \brief Initialize a filter that only changes once all reads agree.
+ */
+static inline void initDebounceFilter(edgeFilter* filter, int window,
+                                      uint32_t readTicks)
+{
+    initEdgeFilter(filter, window, 0, window, readTicks);
+}
+
+
+/*
+ * \brief Filter one read of the receiver pin.
+ *
+ * \param filter Pointer to the edgeFilter.
+ * \param read Level read from the pin, 0 or 1.
+ * \param time Timer ticks at the read.
+ * \param edge Stores the edge, if the level changed at this read.
+ *
+ * \returns 1 if the filtered level changed, 0 otherwise.
+ */
+int filterRead(edgeFilter* filter, int read, uint32_t time, pinEdge* edge);
+
+
+/*
+ * \brief Initialize a filter of captured edges, at full carrier amplitude.
+ *
+ * \param filter Pointer to captureFilter to initialize.
+ * \param minTicks Shortest time at a level that is not a glitch.
+ */
+void initCaptureFilter(captureFilter* filter, uint32_t minTicks);
+
+
+/*
+ * \brief Filter one captured edge of the receiver pin.
+ *
+ * An edge to the level the pin is already at is ignored.
+ *
+ * \param filter Pointer to the captureFilter.
+ * \param time Timer ticks the edge was captured at.
+ * \param level Level of the pin after the edge.
+ * \param edge Stores the last edge, if it has now lasted minTicks.
+ *
+ * \returns 1 if an edge was kept, 0 otherwise.
+ */
+int filterCapture(captureFilter* filter, uint32_t time, int level,
+                  pinEdge* edge);
+
+
+/*
+ * \brief Keep the last captured edge once the pin has stayed at its level.
+ *
+ * Call when there was no capture for a while, so an edge is not held back
+ * until the next one.
+ *
+ * \param filter Pointer to the captureFilter.
+ * \param now Current timer ticks.
+ * \param edge Stores the last edge, if it has now lasted minTicks.
+ *
+ * \returns 1 if an edge was kept, 0 otherwise.
+ */
+int pollCapture(captureFilter* filter, uint32_t now, pinEdge* edge);
+
+
+/*
+ * \brief Initialize a pulseMeter, waiting for a falling edge.
+ *
+ * \param meter Pointer to pulseMeter to initialize.
+ */
+void initPulseMeter(pulseMeter* meter);
+
+
+/*
+ * \brief Measure the pulses of filtered edges.
+ *
+ * A pulse is complete at the falling edge after a rising edge. Two falling
+ * edges in a row start the pulse over.
+ *
+ * \param meter Pointer to the pulseMeter.
+ * \param edge Next filtered edge.
+ * \param pulse Stores the pulse that the edge completed.
+ *
+ * \returns 1 if a pulse was completed, 0 otherwise.
+ */
+int measurePulse(pulseMeter* meter, pinEdge edge, pinPulse* pulse);
+
+
+/*
+ * \brief Initialize an edgeSampler, at full carrier amplitude.
+ *
+ * \param sampler Pointer to edgeSampler to initialize.
+ * \param sampleTicks Timer ticks per decoder sample.
+ * \param time Timer ticks the samples start at.
+ */
+void initEdgeSampler(edgeSampler* sampler, uint32_t sampleTicks,
+                     uint32_t time);
+
+
+/*
+ * \brief Number of decoder samples at the level before an edge.
+ *
+ * Feed the run to updateDecoderRun(). Edges less than half a sample after
+ * the last one give a run of 0 samples, and edges dated before it count as
+ * at the same time.
+ *
+ * \param sampler Pointer to the edgeSampler.
+ * \param edge Next filtered edge, less than 2^31 ticks after the last.
+ * \param level Stores the level of the run.
+ *
+ * \returns Number of samples in the run.
+ */
+int edgeRun(edgeSampler* sampler, pinEdge edge, int* level);
+
+
+#endif /* EDGE_FILTER_H_ */
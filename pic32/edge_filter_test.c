@@ -0,0 +1,557 @@
+/*
+ * Checks the edge filters, and decoding from filtered edges against
+ * decoding averaged samples.
+ *
+ * Each read filter must find every edge of clean reads to within half a
+ * read, and of reads that chatter around the edges to within the chatter,
+ * without extra edges. The capture filter must drop glitches shorter than
+ * its minimum and keep the other edges at their capture times. Runs fed to
+ * updateDecoderRun() must leave the decoder exactly as updateDecoder() does
+ * sample by sample. Then minutes of the time signal are read at 1 kHz with
+ * chatter and random flips, and decoded both the way radio_clock.c does,
+ * from the average of the reads of every sample, and from the edges of a
+ * moving average with hysteresis. The edges must decode as many frames,
+ * none wrong, and time the seconds to within a quarter of the moving
+ * average, and at least 4 times closer than the edges between samples do
+ * where the samples are longer than the moving average.
+ *
+ * Build: gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c edge_filter.c test_support.c \
+ *            edge_filter_test.c -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "edge_filter.h"
+#include "hal.h"
+#include "test_support.h"
+#include "time_decoder.h"
+#include "wwvb_signal.h"
+
+#define READRATE 1000                         /* reads per second */
+#define READTICKS (HALTICKRATE / READRATE)    /* timer ticks between reads */
+#define SAMPLETICKS (HALTICKRATE / NSAMPLES)  /* timer ticks per sample */
+#define NEDGES 2000
+#define NSTREAMS 200
+#define STREAMSIZE 20000
+#define NCHANNELS 10
+#define CHANNELMINUTES 20
+#define FILTERREADS 24                        /* moving average of the channel */
+
+
+static double uniform()
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+
+/******************************************************************************/
+/******************************* Read filters *********************************/
+/******************************************************************************/
+
+/* reads of alternating levels, falling first, of 20 to 200 reads each */
+static int makeEdges(long* edges, int count)
+{
+    long read = 50;
+
+    for (int i = 0; i < count; i++) {
+        edges[i] = read;
+        read += 20 + rand() % 181;
+    }
+
+    return read;
+}
+
+
+/* level of a read, random within chatter reads of an edge */
+static int readLevel(const long* edges, int* next, long read, int chatter)
+{
+    while (*next < NEDGES && edges[*next] + chatter <= read)
+        (*next)++;
+
+    if (*next < NEDGES && edges[*next] - chatter <= read)
+        return rand() & 1;
+
+    return *next ? (*next - 1) % 2 : 1;
+}
+
+
+static void checkFilter(edgeFilter filter, const char* name, int chatter)
+{
+    static long edges[NEDGES];
+    int  reads = makeEdges(edges, NEDGES);
+    int  found = 0, ok = 1, next = 0;
+    long worst = 0;
+
+    /* reads start halfway into their interval, so an edge is between two */
+    for (long read = 0, e = 0; read < reads; read++) {
+        pinEdge edge;
+        int level = readLevel(edges, &next, read, chatter);
+
+        if (!filterRead(&filter, level, read * READTICKS + READTICKS / 2,
+                        &edge))
+            continue;
+
+        found++;
+
+        /* the edge it found, in order */
+        if (e >= NEDGES || edge.level != e % 2) {
+            ok = 0;
+            continue;
+        }
+
+        long error = labs((long) edge.time - edges[e++] * READTICKS);
+
+        if (error > worst)
+            worst = error;
+    }
+
+    printf("%-10s chatter %d: %4d/%d edges, worst %4.1f reads off\n", name,
+           chatter, found, NEDGES, (double) worst / READTICKS);
+
+    expect(ok && found == NEDGES, "one edge per edge");
+
+    /* at most half the chatter either side of the edge is on the wrong side */
+    expect(worst <= (chatter ? chatter * READTICKS : READTICKS / 2),
+           "edges on time");
+}
+
+
+static void checkReadFilters()
+{
+    edgeFilter majority, debounce, hysteresis;
+    initMajorityFilter(&majority, 15, READTICKS);
+    initDebounceFilter(&debounce, 8, READTICKS);
+    initEdgeFilter(&hysteresis, 16, 4, 12, READTICKS);
+
+    for (int chatter = 0; chatter <= 4; chatter += 4) {
+        checkFilter(majority, "majority", chatter);
+        checkFilter(debounce, "debounce", chatter);
+        checkFilter(hysteresis, "hysteresis", chatter);
+    }
+}
+
+
+/******************************************************************************/
+/****************************** Capture filter ********************************/
+/******************************************************************************/
+
+/* capture an edge, and check the edge it keeps, if any, against the next */
+static void captureEdge(captureFilter* filter, uint32_t time, int level,
+                        const long* edges, int* kept, int* ok)
+{
+    pinEdge edge;
+
+    if (!filterCapture(filter, time, level, &edge))
+        return;
+
+    *ok &= edge.level == *kept % 2 &&
+           edge.time  == (uint32_t) edges[*kept] * READTICKS;
+    (*kept)++;
+}
+
+
+static void checkCaptureFilter()
+{
+    static long edges[NEDGES + 1];
+    makeEdges(edges, NEDGES + 1);
+
+    captureFilter filter;
+    initCaptureFilter(&filter, 10 * READTICKS);
+
+    int kept = 0, ok = 1;
+
+    for (int e = 0; e < NEDGES; e++) {
+        uint32_t time  = edges[e] * READTICKS;
+        int      level = e % 2;
+
+        /* contact bounce before about half the edges */
+        if (rand() & 1) {
+            captureEdge(&filter, time - 2 * READTICKS, level, edges, &kept,
+                        &ok);
+            captureEdge(&filter, time - READTICKS, !level, edges, &kept, &ok);
+        }
+
+        captureEdge(&filter, time, level, edges, &kept, &ok);
+
+        /* a glitch in about half the levels long enough for one */
+        if (edges[e + 1] - edges[e] > 40 && rand() & 1) {
+            uint32_t glitch = time + 15 * READTICKS;
+
+            captureEdge(&filter, glitch, !level, edges, &kept, &ok);
+            captureEdge(&filter, glitch + 5 * READTICKS, level, edges, &kept,
+                        &ok);
+        }
+    }
+
+    /* the last edge is only kept once its level has lasted */
+    uint32_t last = edges[NEDGES - 1] * READTICKS;
+    pinEdge  edge;
+
+    ok &= !pollCapture(&filter, last + 9 * READTICKS, &edge);
+    ok &= pollCapture(&filter, last + 10 * READTICKS, &edge) &&
+          edge.time == last;
+    kept++;
+
+    printf("capture:   %4d/%d edges kept\n", kept, NEDGES);
+
+    expect(ok && kept == NEDGES, "captured edges without the glitches");
+}
+
+
+static void checkPulseMeter()
+{
+    static const pinEdge edges[] = {
+        {100, 1}, {200, 0}, {400, 1}, {1200, 0}, {1300, 0}, {1800, 1},
+        {2300, 0}
+    };
+
+    pulseMeter meter;
+    initPulseMeter(&meter);
+
+    pinPulse pulses[2];
+    int count = 0;
+
+    for (int i = 0; i < 7; i++)
+        count += measurePulse(&meter, edges[i], &pulses[count]);
+
+    /* a falling edge without a rising edge before it starts over */
+    expect(count == 2 &&
+           pulses[0].start == 200  && pulses[0].low == 200 &&
+           pulses[0].length == 1000 &&
+           pulses[1].start == 1300 && pulses[1].low == 500 &&
+           pulses[1].length == 1000, "pulses between falling edges");
+}
+
+
+/******************************************************************************/
+/********************************* Decoder ************************************/
+/******************************************************************************/
+
+int sameDecoder(timeDecoder* a, timeDecoder* b)
+{
+    return a->currentState == b->currentState &&
+           a->foundStart   == b->foundStart   &&
+           a->glitched     == b->glitched     &&
+           a->bitCount     == b->bitCount     &&
+           a->inputCount   == b->inputCount   &&
+           a->zeroCount    == b->zeroCount    &&
+           a->lastPulse    == b->lastPulse    &&
+           !memcmp(a->bitBuffer, b->bitBuffer, a->bitCount);
+}
+
+
+/* pulses of random width, some jittered, glitched or too long */
+static void generateStream(char* samples, int count)
+{
+    static const int lows[] = {2, 5, 8};
+    int i = 0;
+
+    while (i < count) {
+        int kind = rand() % 12;
+        int low  = lows[rand() % 3] * NSAMPLES / 10
+                 + (kind == 0) * (rand() % 5 - 2);
+        int high = NSAMPLES - low + (kind == 1) * (rand() % 7 - 3);
+
+        if (kind == 2)
+            low += rand() % (NSAMPLES + NSAMPLES / 2);
+        if (kind == 3)
+            high += rand() % (NSAMPLES + NSAMPLES / 2);
+
+        for (int j = 0; j < low && i < count; j++)
+            samples[i++] = 0;
+        for (int j = 0; j < high && i < count; j++)
+            samples[i++] = 1;
+
+        if (kind == 4 && i > 0)
+            samples[i - 1 - rand() % (i < 6 ? i : 6)] ^= 1;
+    }
+}
+
+
+static void checkRuns()
+{
+    static char samples[STREAMSIZE];
+    int ok = 1;
+
+    for (int n = 0; n < NSTREAMS && ok; n++) {
+        generateStream(samples, STREAMSIZE);
+
+        timeDecoder reference, runs;
+        initDecoder(&reference);
+        initDecoder(&runs);
+
+        int i = 0;
+
+        while (i < STREAMSIZE && ok) {
+            /* the rest of a run of equal samples, cut at random */
+            int length = 1;
+
+            while (i + length < STREAMSIZE &&
+                   samples[i + length] == samples[i] && rand() % 50)
+                length++;
+
+            int status, done = updateDecoderRun(&runs, samples[i], length,
+                                                &status);
+            int expected = 0;
+
+            for (int j = 0; j < done; j++) {
+                expected = updateDecoder(&reference, samples[i + j]);
+
+                /* nothing may happen before the last sample consumed */
+                if (j < done - 1)
+                    ok &= !expected && reference.lastPulse == NOPULSE;
+            }
+
+            ok &= done >= 1 && done <= length && status == expected &&
+                  sameDecoder(&reference, &runs);
+
+            if (status == 3) {
+                keepLastMarker(&reference);
+                keepLastMarker(&runs);
+            }
+
+            i += done;
+        }
+    }
+
+    expect(ok, "runs decode the same as samples");
+}
+
+
+/******************************************************************************/
+/********************************* Channel ************************************/
+/******************************************************************************/
+
+/* reads of the time signal, random near its edges and flipped at random */
+typedef struct {
+    time_t start;          /* UTC of the minute read 0 is in */
+    long   offset;         /* reads into that minute of read 0 */
+    long   frameMinute;
+    char   frame[FRAMESIZE];
+    int    chatter;        /* reads either side of an edge that are random */
+    double flips;          /* probability that a read is flipped */
+} readSource;
+
+
+/* totals of a way of decoding over the channels */
+typedef struct {
+    int    frames;         /* frame pairs decoded to the right time */
+    int    wrong;
+    long   edges;          /* falling edges timed, on the second or not */
+    long   offSecond;      /* falling edges more than 100 ms from it */
+    double squares;        /* sum of the squared errors of the others */
+} decodeResult;
+
+
+/* seconds since the start of the minute of read 0 */
+static long readSecond(const readSource* source, long read)
+{
+    return (read + source->offset) / READRATE;
+}
+
+
+static int sourceRead(readSource* source, long read)
+{
+    long second = readSecond(source, read);
+    long into   = (read + source->offset) % READRATE;
+
+    if (second / 60 != source->frameMinute) {
+        source->frameMinute = second / 60;
+        encodeFrame(source->start + source->frameMinute * 60, 0,
+                    source->frame);
+    }
+
+    long low   = pulseLows(source->frame[second % 60]) * (long) READRATE
+               / NSAMPLES;
+    int  level = into >= low;
+
+    if (into < source->chatter || into >= READRATE - source->chatter ||
+        labs(into - low) < source->chatter)
+        level = rand() & 1;
+
+    return level ^ (uniform() < source->flips);
+}
+
+
+/* a falling edge against the nearest start of a second */
+static void timeEdge(const readSource* source, uint32_t time,
+                     decodeResult* result)
+{
+    long ticks = ((long) time + source->offset * READTICKS) % HALTICKRATE;
+    long error = ticks < HALTICKRATE / 2 ? ticks : ticks - HALTICKRATE;
+
+    result->edges++;
+
+    if (labs(error) > HALTICKRATE / 10)
+        result->offSecond++;
+    else
+        result->squares += (double) error * error;
+}
+
+
+static double rmsEdge(const decodeResult* result)
+{
+    long timed = result->edges - result->offSecond;
+
+    return timed ? 1000 * sqrt(result->squares / timed) / HALTICKRATE : 0;
+}
+
+
+/* a full buffer, counted if it decodes, then restarted like snr_sweep.c */
+static void decodeBuffer(timeDecoder* decoder, const readSource* source,
+                         long read, decodeResult* result)
+{
+    time_t time;
+    int dst;
+    int err = updateTimeAndDate(decoder, &time, &dst);
+
+    if (err) {
+        initDecoder(decoder);
+        return;
+    }
+
+    keepLastMarker(decoder);
+
+    if (labs((long) (time - source->start - readSecond(source, read))) > 1)
+        result->wrong++;
+    else
+        result->frames++;
+}
+
+
+/* the way radio_clock.c does, the reads of each sample averaged */
+static void decodeAverages(readSource source, long reads,
+                           decodeResult* result)
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+
+    int perSample = READRATE / NSAMPLES;
+    int last = 1;
+
+    for (long read = 0; read + perSample <= reads; read += perSample) {
+        int level = 0;
+
+        for (int i = 0; i < perSample; i++)
+            level += sourceRead(&source, read + i);
+
+        int x = 2 * level >= perSample;
+
+        /* the edge is as likely in the half sample before as after */
+        if (last && !x)
+            timeEdge(&source, (uint32_t) read * READTICKS, result);
+
+        last = x;
+
+        if (updateDecoder(&decoder, x) == 3)
+            decodeBuffer(&decoder, &source, read, result);
+    }
+}
+
+
+/* the edges of a moving average with hysteresis, in runs */
+static void decodeEdges(readSource source, long reads, decodeResult* result)
+{
+    timeDecoder decoder;
+    edgeFilter  filter;
+    edgeSampler sampler;
+    initDecoder(&decoder);
+    initEdgeFilter(&filter, FILTERREADS, FILTERREADS / 4, 3 * FILTERREADS / 4,
+                   READTICKS);
+    initEdgeSampler(&sampler, SAMPLETICKS, 0);
+
+    for (long read = 0; read < reads; read++) {
+        pinEdge edge;
+
+        if (!filterRead(&filter, sourceRead(&source, read),
+                        (uint32_t) read * READTICKS, &edge))
+            continue;
+
+        if (!edge.level)
+            timeEdge(&source, edge.time, result);
+
+        int level;
+        int count = edgeRun(&sampler, edge, &level);
+
+        while (count > 0) {
+            int status;
+            count -= updateDecoderRun(&decoder, level, count, &status);
+
+            if (status == 3)
+                decodeBuffer(&decoder, &source, read, result);
+        }
+    }
+}
+
+
+static void checkChannel()
+{
+    static const double flips[] = {0, 0.05, 0.1, 0.15};
+    long reads = CHANNELMINUTES * 60L * READRATE;
+
+    printf("read flips      frames        wrong    edges off second"
+           "   rms edge error\n"
+           "            averaged  edges\n");
+
+    for (int f = 0; f < 4; f++) {
+        decodeResult averaged, edges;
+        memset(&averaged, 0, sizeof(averaged));
+        memset(&edges, 0, sizeof(edges));
+
+        for (int c = 0; c < NCHANNELS; c++) {
+            readSource source;
+            source.start       = 1420070400
+                               + (time_t) (rand() % 13000000) * 60;
+            source.offset      = rand() % (60 * READRATE);
+            source.frameMinute = -1;
+            source.chatter     = 3;
+            source.flips       = flips[f];
+
+            /* the same reads both ways */
+            unsigned seed = rand();
+            srand(seed);
+            decodeAverages(source, reads, &averaged);
+            srand(seed);
+            decodeEdges(source, reads, &edges);
+        }
+
+        printf("%9.0f%%   %5d  %5d   %3d  %3d   %4ld  %4ld   %6.2f  %5.2f ms\n",
+               100 * flips[f], averaged.frames, edges.frames, averaged.wrong,
+               edges.wrong, averaged.offSecond, edges.offSecond,
+               rmsEdge(&averaged), rmsEdge(&edges));
+
+        expect(!averaged.wrong && !edges.wrong, "no wrong frames");
+        expect(edges.frames >= averaged.frames, "edges decode as many frames");
+        expect(rmsEdge(&edges) < 1000.0 * FILTERREADS / 4 / READRATE,
+               "edges timed to within a quarter of the filter");
+
+        /* samples shorter than the filter time the seconds about as well */
+        if (SAMPLETICKS > FILTERREADS * READTICKS)
+            expect(rmsEdge(&edges) * 4 < rmsEdge(&averaged),
+                   "edges timed closer than samples");
+    }
+}
+
+
+int main()
+{
+    srand(1);
+
+    checkReadFilters();
+    checkCaptureFilter();
+    checkPulseMeter();
+    checkRuns();
+    checkChannel();
+
+    if (failures) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+/* Generated by generate_layout_header.py from wwvb_layout.py, do not edit. */
+
+#include "frame_layout.h"
+
+static const unsigned short minuteSlice0[256] = {
+      0,  40,  20,  60,  10,  50,  30,  70,   0,  40,  20,  60,
+     10,  50,  30,  70,   8,  48,  28,  68,  18,  58,  38,  78,
+      8,  48,  28,  68,  18,  58,  38,  78,   4,  44,  24,  64,
+     14,  54,  34,  74,   4,  44,  24,  64,  14,  54,  34,  74,
+     12,  52,  32,  72,  22,  62,  42,  82,  12,  52,  32,  72,
+     22,  62,  42,  82,   2,  42,  22,  62,  12,  52,  32,  72,
+      2,  42,  22,  62,  12,  52,  32,  72,  10,  50,  30,  70,
+     20,  60,  40,  80,  10,  50,  30,  70,  20,  60,  40,  80,
+      6,  46,  26,  66,  16,  56,  36,  76,   6,  46,  26,  66,
+     16,  56,  36,  76,  14,  54,  34,  74,  24,  64,  44,  84,
+     14,  54,  34,  74,  24,  64,  44,  84,   1,  41,  21,  61,
+     11,  51,  31,  71,   1,  41,  21,  61,  11,  51,  31,  71,
+      9,  49,  29,  69,  19,  59,  39,  79,   9,  49,  29,  69,
+     19,  59,  39,  79,   5,  45,  25,  65,  15,  55,  35,  75,
+      5,  45,  25,  65,  15,  55,  35,  75,  13,  53,  33,  73,
+     23,  63,  43,  83,  13,  53,  33,  73,  23,  63,  43,  83,
+      3,  43,  23,  63,  13,  53,  33,  73,   3,  43,  23,  63,
+     13,  53,  33,  73,  11,  51,  31,  71,  21,  61,  41,  81,
+     11,  51,  31,  71,  21,  61,  41,  81,   7,  47,  27,  67,
+     17,  57,  37,  77,   7,  47,  27,  67,  17,  57,  37,  77,
+     15,  55,  35,  75,  25,  65,  45,  85,  15,  55,  35,  75,
+     25,  65,  45,  85,
+};
+
+static const unsigned short hourSlice0[128] = {
+      0,  20,  10,  30,   0,  20,  10,  30,   8,  28,  18,  38,
+      8,  28,  18,  38,   4,  24,  14,  34,   4,  24,  14,  34,
+     12,  32,  22,  42,  12,  32,  22,  42,   2,  22,  12,  32,
+      2,  22,  12,  32,  10,  30,  20,  40,  10,  30,  20,  40,
+      6,  26,  16,  36,   6,  26,  16,  36,  14,  34,  24,  44,
+     14,  34,  24,  44,   1,  21,  11,  31,   1,  21,  11,  31,
+      9,  29,  19,  39,   9,  29,  19,  39,   5,  25,  15,  35,
+      5,  25,  15,  35,  13,  33,  23,  43,  13,  33,  23,  43,
+      3,  23,  13,  33,   3,  23,  13,  33,  11,  31,  21,  41,
+     11,  31,  21,  41,   7,  27,  17,  37,   7,  27,  17,  37,
+     15,  35,  25,  45,  15,  35,  25,  45,
+};
+
+static const unsigned short daySlice0[256] = {
+      0, 200, 100, 300,   0, 200, 100, 300,  80, 280, 180, 380,
+     80, 280, 180, 380,  40, 240, 140, 340,  40, 240, 140, 340,
+    120, 320, 220, 420, 120, 320, 220, 420,  20, 220, 120, 320,
+     20, 220, 120, 320, 100, 300, 200, 400, 100, 300, 200, 400,
+     60, 260, 160, 360,  60, 260, 160, 360, 140, 340, 240, 440,
+    140, 340, 240, 440,  10, 210, 110, 310,  10, 210, 110, 310,
+     90, 290, 190, 390,  90, 290, 190, 390,  50, 250, 150, 350,
+     50, 250, 150, 350, 130, 330, 230, 430, 130, 330, 230, 430,
+     30, 230, 130, 330,  30, 230, 130, 330, 110, 310, 210, 410,
+    110, 310, 210, 410,  70, 270, 170, 370,  70, 270, 170, 370,
+    150, 350, 250, 450, 150, 350, 250, 450,   0, 200, 100, 300,
+      0, 200, 100, 300,  80, 280, 180, 380,  80, 280, 180, 380,
+     40, 240, 140, 340,  40, 240, 140, 340, 120, 320, 220, 420,
+    120, 320, 220, 420,  20, 220, 120, 320,  20, 220, 120, 320,
+    100, 300, 200, 400, 100, 300, 200, 400,  60, 260, 160, 360,
+     60, 260, 160, 360, 140, 340, 240, 440, 140, 340, 240, 440,
+     10, 210, 110, 310,  10, 210, 110, 310,  90, 290, 190, 390,
+     90, 290, 190, 390,  50, 250, 150, 350,  50, 250, 150, 350,
+    130, 330, 230, 430, 130, 330, 230, 430,  30, 230, 130, 330,
+     30, 230, 130, 330, 110, 310, 210, 410, 110, 310, 210, 410,
+     70, 270, 170, 370,  70, 270, 170, 370, 150, 350, 250, 450,
+    150, 350, 250, 450,
+};
+
+static const unsigned short daySlice1[16] = {
+      0,   8,   4,  12,   2,  10,   6,  14,   1,   9,   5,  13,
+      3,  11,   7,  15,
+};
+
+static const unsigned short yearSlice0[256] = {
+      0,  80,  40, 120,  20, 100,  60, 140,  10,  90,  50, 130,
+     30, 110,  70, 150,   0,  80,  40, 120,  20, 100,  60, 140,
+     10,  90,  50, 130,  30, 110,  70, 150,   8,  88,  48, 128,
+     28, 108,  68, 148,  18,  98,  58, 138,  38, 118,  78, 158,
+      8,  88,  48, 128,  28, 108,  68, 148,  18,  98,  58, 138,
+     38, 118,  78, 158,   4,  84,  44, 124,  24, 104,  64, 144,
+     14,  94,  54, 134,  34, 114,  74, 154,   4,  84,  44, 124,
+     24, 104,  64, 144,  14,  94,  54, 134,  34, 114,  74, 154,
+     12,  92,  52, 132,  32, 112,  72, 152,  22, 102,  62, 142,
+     42, 122,  82, 162,  12,  92,  52, 132,  32, 112,  72, 152,
+     22, 102,  62, 142,  42, 122,  82, 162,   2,  82,  42, 122,
+     22, 102,  62, 142,  12,  92,  52, 132,  32, 112,  72, 152,
+      2,  82,  42, 122,  22, 102,  62, 142,  12,  92,  52, 132,
+     32, 112,  72, 152,  10,  90,  50, 130,  30, 110,  70, 150,
+     20, 100,  60, 140,  40, 120,  80, 160,  10,  90,  50, 130,
+     30, 110,  70, 150,  20, 100,  60, 140,  40, 120,  80, 160,
+      6,  86,  46, 126,  26, 106,  66, 146,  16,  96,  56, 136,
+     36, 116,  76, 156,   6,  86,  46, 126,  26, 106,  66, 146,
+     16,  96,  56, 136,  36, 116,  76, 156,  14,  94,  54, 134,
+     34, 114,  74, 154,  24, 104,  64, 144,  44, 124,  84, 164,
+     14,  94,  54, 134,  34, 114,  74, 154,  24, 104,  64, 144,
+     44, 124,  84, 164,
+};
+
+static const unsigned short yearSlice1[2] = {
+      0,   1,
+};
+
+const fieldSlice frameFields[NFIELDS][MAXSLICES] = {
+    {{1, 8, minuteSlice0}, {0, 0, 0}},
+    {{12, 7, hourSlice0}, {0, 0, 0}},
+    {{22, 8, daySlice0}, {30, 4, daySlice1}},
+    {{45, 8, yearSlice0}, {53, 1, yearSlice1}},
+};
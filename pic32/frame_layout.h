@@ -0,0 +1,72 @@
+/* Generated by generate_layout_header.py from wwvb_layout.py, do not edit. */
+
+#ifndef FRAME_LAYOUT_H_
+#define FRAME_LAYOUT_H_
+
+#include <stdint.h>
+
+#define FRAMESIZE 60    /* Number of bits in one frame */
+#define MAXSLICES 2     /* Table slices per BCD field */
+
+/* bits that are always a marker */
+#define MARKERMASK 0x0802008020080201ULL
+
+/* bits that are always 0 */
+#define ZEROMASK   0x0040100C01304C10ULL
+
+/* set in leap years */
+#define LEAPYEARBIT 55
+
+/* set while DST is in effect at the end of the UTC day of the frame */
+#define DSTATENDBIT 57
+
+/* set while DST is in effect at the start of the UTC day */
+#define DSTATSTARTBIT 58
+
+/* bits that carry a field, the leap year or the DST bits */
+#define FIELDMASK  0x06BDE003DEC7B1EEULL
+
+enum FIELD {
+    minuteField,
+    hourField,
+    dayField,
+    yearField,
+    NFIELDS
+};
+
+
+/* Maps a slice of the packed frame to its value in a BCD field */
+typedef struct {
+    unsigned char shift;           /* first frame bit of the slice */
+    unsigned char width;           /* number of bits, 0 if unused */
+    const unsigned short* table;   /* value of every slice pattern */
+} fieldSlice;
+
+
+/* slices of every BCD field, indexed by enum FIELD */
+extern const fieldSlice frameFields[NFIELDS][MAXSLICES];
+
+
+/*
+ * \brief Decode one BCD field from a packed frame.
+ *
+ * \param data Packed data bits of the frame.
+ * \param field Field to decode.
+ *
+ * \returns Value of the field.
+ */
+static inline int decodeField(uint64_t data, enum FIELD field)
+{
+    const fieldSlice* slice = frameFields[field];
+    int value = 0;
+
+    for (int i = 0; i < MAXSLICES && slice[i].width; i++) {
+        unsigned raw = (data >> slice[i].shift) & ((1u << slice[i].width) - 1);
+        value += slice[i].table[raw];
+    }
+
+    return value;
+}
+
+
+#endif /* FRAME_LAYOUT_H_ */
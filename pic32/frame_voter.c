@@ -0,0 +1,226 @@
+#include <limits.h>
+
+#include "civil_time.h"
+#include "frame_voter.h"
+
+
+/* packed frames of a vote, oldest first */
+typedef struct {
+    uint64_t data[VOTEFRAMES];
+    uint64_t markers[VOTEFRAMES];
+    uint64_t erasures[VOTEFRAMES];
+    int      count;
+} frameStack;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* bits of a field in a packed frame */
+static uint64_t fieldBits(enum FIELD field)
+{
+    uint64_t bits = 0;
+
+    for (int i = 0; i < MAXSLICES; i++) {
+        const fieldSlice* slice = &frameFields[field][i];
+        bits |= (((uint64_t) 1 << slice->width) - 1) << slice->shift;
+    }
+
+    return bits & FIELDMASK;
+}
+
+
+/* packed minute field of a minute, the bits encodeFrame() sets */
+static uint64_t minuteBits(int minute)
+{
+    uint64_t bits = 0;
+
+    /* weights decrease from the first bit of the field to the last */
+    for (int i = 0; i < MAXSLICES; i++) {
+        const fieldSlice* slice = &frameFields[minuteField][i];
+
+        for (int k = 0; k < slice->width; k++) {
+            int weight = slice->table[1 << k];
+
+            if (weight && minute >= weight) {
+                bits |= (uint64_t) 1 << (slice->shift + k);
+                minute -= weight;
+            }
+        }
+    }
+
+    return bits;
+}
+
+
+/* minutes before the last frame that frame j was sent */
+static int frameAge(const frameStack* stack, int j)
+{
+    return stack->count - 1 - j;
+}
+
+
+/* minute of the hour age minutes before minute */
+static int minuteBefore(int minute, int age)
+{
+    return (minute - age % 60 + 60) % 60;
+}
+
+
+/* agreement of the minute fields with a last minute, less disagreement */
+static int minuteScore(const frameStack* stack, int minute)
+{
+    uint64_t field = fieldBits(minuteField);
+    int score = 0;
+
+    for (int j = 0; j < stack->count; j++) {
+        int      age      = frameAge(stack, j);
+        uint64_t expected = minuteBits(minuteBefore(minute, age));
+        uint64_t known    = field & ~stack->erasures[j];
+
+        /* a marker is wrong whatever the bit should be */
+        uint64_t wrong = ((stack->data[j] ^ expected) | stack->markers[j])
+                       & known;
+
+        score += __builtin_popcountll(known) - 2 * __builtin_popcountll(wrong);
+    }
+
+    return score;
+}
+
+
+/* minute of the last frame the stack agrees with best, -1 if no clear one */
+static int voteMinute(const frameStack* stack)
+{
+    int best = -1, bestScore = INT_MIN, secondScore = INT_MIN;
+
+    for (int minute = 0; minute < 60; minute++) {
+        int score = minuteScore(stack, minute);
+
+        if (score > bestScore) {
+            secondScore = bestScore;
+            bestScore   = score;
+            best        = minute;
+        } else if (score > secondScore) {
+            secondScore = score;
+        }
+    }
+
+    return bestScore > secondScore ? best : -1;
+}
+
+
+/* bits frame j votes on, when the last frame is at a minute */
+static uint64_t votingBits(const frameStack* stack, int j, int minute)
+{
+    uint64_t bits = ~stack->erasures[j];
+
+    /* before the top of the hour the hour, day and year can differ */
+    if (frameAge(stack, j) > minute)
+        bits &= ~(FIELDMASK & ~fieldBits(minuteField));
+
+    return bits;
+}
+
+
+/* data bits of frame j with its minute field moved on to the last frame */
+static uint64_t adjustedData(const frameStack* stack, int j, int minute)
+{
+    uint64_t sent = minuteBits(minuteBefore(minute, frameAge(stack, j)));
+
+    return stack->data[j] ^ (sent ^ minuteBits(minute));
+}
+
+
+/* majority of the frames at every bit, ERASURE where there is none */
+static void voteBits(const frameStack* stack, int minute, char* frame)
+{
+    for (int i = 0; i < FRAMESIZE; i++) {
+        uint64_t bit = (uint64_t) 1 << i;
+        int votes[3] = {0, 0, 0};
+
+        for (int j = 0; j < stack->count; j++) {
+            if (!(votingBits(stack, j, minute) & bit))
+                continue;
+
+            if (stack->markers[j] & bit)
+                votes[2]++;
+            else
+                votes[(adjustedData(stack, j, minute) & bit) != 0]++;
+        }
+
+        int total = votes[0] + votes[1] + votes[2];
+        frame[i] = ERASURE;
+
+        for (int s = 0; s < 3; s++)
+            if (2 * votes[s] - total >= VOTEMARGIN)
+                frame[i] = s == 2 ? 'm' : (char) s;
+    }
+}
+
+
+/* bits of the frames that disagree with the voted frame */
+static int voteErrors(const frameStack* stack, int minute, char* frame)
+{
+    uint64_t data, markers;
+    packFrame(frame, &data, &markers);
+
+    int errors = 0;
+
+    for (int j = 0; j < stack->count; j++) {
+        uint64_t differ = (adjustedData(stack, j, minute) ^ data) |
+                          (stack->markers[j] ^ markers);
+
+        errors += __builtin_popcountll(differ & votingBits(stack, j, minute));
+    }
+
+    return errors;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+int voteFrames(char* frames, int count, time_t* currentTime, int* dst)
+{
+    if (count < MINVOTEFRAMES || count > VOTEFRAMES)
+        return 1;
+
+    frameStack stack;
+    stack.count = count;
+
+    for (int j = 0; j < count; j++) {
+        char* frame = frames + j * FRAMESIZE;
+
+        packFrame(frame, &stack.data[j], &stack.markers[j]);
+        stack.erasures[j] = packErasures(frame);
+    }
+
+    int minute = voteMinute(&stack);
+
+    /* the hour, day and year need as many frames as the rest */
+    if (minute < 0 || minute + 1 < MINVOTEFRAMES)
+        return 1;
+
+    char voted[FRAMESIZE];
+    voteBits(&stack, minute, voted);
+
+    if (packErasures(voted) ||
+        voteErrors(&stack, minute, voted) > count * MAXVOTEERRORS)
+        return 1;
+
+    struct tm frameTime;
+
+    /* the minute bits can outvote the minute they were adjusted for */
+    if (checkFrame(voted) || decodeFrame(voted, &frameTime) ||
+        frameTime.tm_min != minute)
+        return 1;
+
+    /* 60 seconds has passed since the start of the last frame */
+    *currentTime = timeFromCivil(&frameTime) + 60;
+    *dst = frameTime.tm_isdst;
+
+    return 0;
+}
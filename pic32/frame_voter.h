@@ -0,0 +1,41 @@
+#ifndef FRAME_VOTER_H_
+#define FRAME_VOTER_H_
+
+#include <time.h>
+
+#include "frame_layout.h"
+#include "time_decoder.h"
+
+#define VOTEFRAMES 5       /* Most consecutive frames stacked for a vote */
+#define MINVOTEFRAMES 3    /* Fewest frames a vote is taken over */
+#define VOTEMARGIN 2       /* Votes a bit needs over all other symbols */
+#define MAXVOTEERRORS 4    /* Bits per frame that may disagree with the vote */
+
+
+/*
+ * \brief Decode the last of several consecutive frames by a vote over all.
+ *
+ * Each bit of the frame is the symbol with VOTEMARGIN more votes than the
+ * others together, erased bits don't vote. The minute field changes from
+ * frame to frame, so it is voted on after taking out the expected
+ * increment for the age of each frame, at every minute of the hour, and
+ * the minute that agrees best with the frames wins. Frames from before the
+ * top of the hour don't vote on the other fields, so there is no vote in
+ * the first MINVOTEFRAMES - 1 minutes of an hour. The voted frame must
+ * pass checkFrame() and the range checks of decodeFrame() without any
+ * erased bit, and the frames must not disagree with it in more than
+ * MAXVOTEERRORS bits per frame.
+ *
+ * \param frames Pointer to count frames, oldest first, one minute apart.
+ * \param count Number of frames, MINVOTEFRAMES to VOTEFRAMES.
+ * \param currentTime Stores the time at the end of the last frame.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Error(s) in time signal, or no clear majority.
+ */
+int voteFrames(char* frames, int count, time_t* currentTime, int* dst);
+
+
+#endif /* FRAME_VOTER_H_ */
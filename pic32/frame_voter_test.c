@@ -0,0 +1,331 @@
+/*
+ * Checks the frame voter, and compares the time to the first sync of the
+ * bit ring with and without votes on a weak signal.
+ *
+ * Clean frames must vote to their time across the top of the hour, the
+ * day and the year, except in the first minutes of an hour, where too few
+ * frames are left to vote on the hour. Frames with random bad bits must
+ * never vote to a wrong time, and random bits must never vote to any. Then
+ * frames go through the channel model at low SNRs, given for 10 samples
+ * per second and raised at higher rates to flip as many samples a second,
+ * and are decoded the way radio_clock.c does: with two-frame decoding only
+ * and the ring emptied whenever the decoder loses the seconds, with the
+ * gaps bridged, and with votes as well. Each must sync at least as soon as
+ * the one before, votes sooner than two frames at the lowest SNR, and none
+ * to a wrong time.
+ *
+ * Build: gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c channel_model.c bit_ring.c frame_voter.c \
+ *            test_support.c frame_voter_test.c -lm
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_ring.h"
+#include "channel_model.h"
+#include "civil_time.h"
+#include "test_support.h"
+
+#define NTRIALS 2000
+#define NNOISE 100000
+#define NCHANNELS 40
+#define CHANNELMINUTES 60
+#define NEVER (CHANNELMINUTES * 60 + 1)
+
+
+/* count consecutive frames, the last one starting at minute */
+static void encodeFrames(time_t minute, int count, char* frames)
+{
+    for (int j = 0; j < count; j++)
+        encodeFrame(minute - 60 * (count - 1 - j), 0, frames + j * FRAMESIZE);
+}
+
+
+/* random minute of this century */
+static time_t randomMinute()
+{
+    return 946684800 + (time_t) (rand() % 50000000) * 60;
+}
+
+
+static void checkBoundaries()
+{
+    /* last minutes of 2015, and of the leap year 2016 */
+    static const time_t ends[] = {1451606400, 1483228800};
+    int ok = 1;
+
+    for (int e = 0; e < 2; e++) {
+        for (int m = -3; m < 5; m++) {
+            for (int count = MINVOTEFRAMES; count <= VOTEFRAMES; count++) {
+                char frames[VOTEFRAMES * FRAMESIZE];
+                time_t minute = ends[e] + 60 * m, time;
+                int dst;
+
+                encodeFrames(minute, count, frames);
+                int err = voteFrames(frames, count, &time, &dst);
+
+                /* too few frames of the hour are left to vote on it */
+                if (m == 0 || m == 1)
+                    ok &= err;
+                else
+                    ok &= !err && time == minute + 60 && !dst;
+            }
+        }
+    }
+
+    for (int n = 0; n < NTRIALS; n++) {
+        char frames[VOTEFRAMES * FRAMESIZE];
+        time_t minute = randomMinute(), time;
+        int dst;
+
+        encodeFrames(minute, VOTEFRAMES, frames);
+        int err = voteFrames(frames, VOTEFRAMES, &time, &dst);
+
+        ok &= minute % 3600 < 120 ? err : !err && time == minute + 60;
+    }
+
+    expect(ok, "clean frames vote to their time");
+}
+
+
+/* replace bits with a random other symbol or an erasure */
+static void spoilBits(char* frames, int count, double probability)
+{
+    static const char symbols[] = {0, 1, 'm', ERASURE};
+
+    for (int i = 0; i < count * FRAMESIZE; i++) {
+        if (rand() >= probability * RAND_MAX)
+            continue;
+
+        char bit;
+        do
+            bit = symbols[rand() % 4];
+        while (bit == frames[i]);
+
+        frames[i] = bit;
+    }
+}
+
+
+static void checkErrors()
+{
+    static const double rates[] = {0.02, 0.05, 0.1, 0.2};
+
+    for (int r = 0; r < 4; r++) {
+        int voted = 0, pairs = 0, wrong = 0;
+
+        for (int n = 0; n < NTRIALS; n++) {
+            char frames[VOTEFRAMES * FRAMESIZE];
+            time_t minute = randomMinute(), time;
+            int dst;
+
+            encodeFrames(minute, VOTEFRAMES, frames);
+            spoilBits(frames, VOTEFRAMES, rates[r]);
+
+            if (!voteFrames(frames, VOTEFRAMES, &time, &dst)) {
+                voted++;
+                wrong += time != minute + 60;
+            }
+
+            char* last = frames + (VOTEFRAMES - 2) * FRAMESIZE;
+            pairs += !decodeFrames(last, &time, &dst);
+        }
+
+        printf("%2.0f%% bad bits: %4d/%d voted, %4d by two frames, "
+               "%d wrong\n", 100 * rates[r], voted, NTRIALS, pairs, wrong);
+
+        expect(!wrong, "no wrong votes");
+
+        /* a few bad bits in each frame are not enough to stop a vote */
+        if (rates[r] < 0.03)
+            expect(voted > NTRIALS * 4 / 5, "votes with few bad bits");
+
+        if (rates[r] < 0.06)
+            expect(voted > 2 * pairs, "votes more often than two frames");
+    }
+}
+
+
+static void checkNoise()
+{
+    static const char symbols[] = {0, 1, 'm', ERASURE};
+    int synced = 0;
+
+    for (int n = 0; n < NNOISE; n++) {
+        char frames[VOTEFRAMES * FRAMESIZE];
+        time_t time;
+        int dst;
+
+        for (int i = 0; i < VOTEFRAMES * FRAMESIZE; i++)
+            frames[i] = symbols[rand() % 4];
+
+        synced += !voteFrames(frames, VOTEFRAMES, &time, &dst);
+    }
+
+    expect(!synced, "no votes on random bits");
+}
+
+
+/* how a channel is decoded, each adds to the one before */
+enum MODE {
+    modePairs,      /* two frames, the ring emptied when the seconds are lost */
+    modeBridged,    /* lost pulses bridged with erasures */
+    modeVotes,      /* votes when two frames don't decode */
+    NMODES
+};
+
+
+/* seconds to the first sync through a channel, like radio_clock.c */
+static int runChannel(const channelConfig* config, uint64_t seed,
+                      enum MODE mode, int* wrong)
+{
+    time_t start = 1420070400 + (time_t) (seed * 7919 % 13000000) * 60;
+
+    channel ch;
+    initChannel(&ch, config, start, (seed * 37 % 600) / 10.0, seed);
+
+    timeDecoder decoder;
+    bitRing ring;
+    initDecoder(&decoder);
+    initBitRing(&ring);
+
+    long sinceBit = 0;
+    int  lost = 0;
+
+    for (long i = 0; i < CHANNELMINUTES * 60L * NSAMPLES; i++) {
+        int status = updateDecoder(&decoder, channelSample(&ch));
+        sinceBit++;
+
+        if (status == 3)
+            keepLastMarker(&decoder);
+
+        if (status == 1) {
+            if (mode == modePairs)
+                initBitRing(&ring);
+
+            lost = 1;
+            continue;
+        }
+
+        if (decoder.lastPulse == NOPULSE)
+            continue;
+
+        if (lost && mode != modePairs)
+            bridgeGap(&ring, sinceBit);
+
+        pushBit(&ring, decoder.lastPulse);
+        sinceBit = 0;
+        lost = 0;
+
+        time_t time;
+        int dst;
+        int err = decodeRingFrames(&ring, &time, &dst);
+
+        if (err && mode == modeVotes)
+            err = voteRingFrames(&ring, &time, &dst);
+
+        if (err)
+            continue;
+
+        if (labs((long) (time - channelTime(&ch))) > 1) {
+            (*wrong)++;
+            continue;
+        }
+
+        return (int) (i / NSAMPLES);
+    }
+
+    return NEVER;
+}
+
+
+static void printTime(int seconds)
+{
+    if (seconds == NEVER)
+        printf("  %6s", "never");
+    else
+        printf("  %5ds", seconds);
+}
+
+
+/* SNR with as many flipped samples per second at NSAMPLES as snr at 10 */
+static double sameFlipsPerSecond(double snr)
+{
+    double flips = flipProbability(snr) * 10 / NSAMPLES;
+    double low = snr - 20, high = snr + 20;
+
+    for (int i = 0; i < 50; i++) {
+        double middle = (low + high) / 2;
+
+        if (flipProbability(middle) > flips)
+            low = middle;
+        else
+            high = middle;
+    }
+
+    return high;
+}
+
+
+static void checkChannel()
+{
+    static const double snrs[] = {17, 16, 15, 14};
+    channelConfig config = {0, 0.010, 30, 0, 0, 0};
+
+    printf("first sync (med, p90)   two frames        bridged     "
+           "with votes  wrong\n");
+
+    for (int s = 0; s < 4; s++) {
+        int times[NMODES][NCHANNELS], median[NMODES], p90[NMODES];
+        int wrong = 0;
+        config.snr = sameFlipsPerSecond(snrs[s]);
+
+        printf("%8.0f dB      ", snrs[s]);
+
+        for (int mode = 0; mode < NMODES; mode++) {
+            for (int t = 0; t < NCHANNELS; t++)
+                times[mode][t] = runChannel(&config, t + 1, mode, &wrong);
+
+            qsort(times[mode], NCHANNELS, sizeof(int), compareInts);
+            median[mode] = times[mode][NCHANNELS / 2];
+            p90[mode]    = times[mode][NCHANNELS * 9 / 10];
+
+            printTime(median[mode]);
+            printTime(p90[mode]);
+        }
+
+        printf("  %5d\n", wrong);
+
+        expect(!wrong, "no wrong syncs through the channel");
+
+        for (int mode = 1; mode < NMODES; mode++)
+            expect(median[mode] <= median[mode - 1] &&
+                   p90[mode] <= p90[mode - 1], "bridges and votes sync sooner");
+
+        /* two frames alone hardly ever get through the lowest SNR */
+        if (s == 3)
+            expect(median[modeVotes] < median[modePairs],
+                   "votes sync at 14 dB");
+    }
+}
+
+
+int main()
+{
+    srand(1);
+
+    checkBoundaries();
+    checkErrors();
+    checkNoise();
+    checkChannel();
+
+    if (failures) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
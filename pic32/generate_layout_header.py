@@ -0,0 +1,149 @@
+# Generate frame_layout.h and frame_layout.c from wwvb_layout.py.
+#
+# Frames are packed into 64-bit words with frame bit i at bit i. Each BCD field
+# is split into slices of at most 8 bits, and every slice gets a table mapping
+# its raw bits to the value they add to the field.
+
+import wwvb_layout as layout
+
+SLICE_BITS = 8
+
+
+def mask(bits):
+    value = 0
+    for bit in bits:
+        value |= 1 << bit
+    return value
+
+
+def fieldSlices(indAndWeight):
+    weights = dict(indAndWeight)
+    first = min(weights)
+    last = max(weights)
+
+    slices = []
+    shift = first
+    while shift <= last:
+        width = min(SLICE_BITS, last - shift + 1)
+        table = []
+
+        for raw in range(1 << width):
+            value = 0
+            for k in range(width):
+                if raw >> k & 1:
+                    value += weights.get(shift + k, 0)
+            table.append(value)
+
+        slices.append((shift, width, table))
+        shift += width
+
+    return slices
+
+
+def writeTable(out, name, table):
+    out.write('static const unsigned short %s[%d] = {\n' % (name, len(table)))
+    for i in range(0, len(table), 12):
+        row = ', '.join('%3d' % value for value in table[i:i + 12])
+        out.write('    %s,\n' % row)
+    out.write('};\n\n')
+
+
+def writeHeader(out):
+    maxSlices = max(len(fieldSlices(weights)) for (name, weights) in layout.FIELDS)
+
+    out.write('/* Generated by generate_layout_header.py from wwvb_layout.py, '
+              'do not edit. */\n\n')
+    out.write('#ifndef FRAME_LAYOUT_H_\n#define FRAME_LAYOUT_H_\n\n')
+    out.write('#include <stdint.h>\n\n')
+
+    out.write('#define FRAMESIZE %d    /* Number of bits in one frame */\n'
+              % layout.FRAME_SIZE)
+    out.write('#define MAXSLICES %d     /* Table slices per BCD field */\n\n'
+              % maxSlices)
+
+    out.write('/* bits that are always a marker */\n')
+    out.write('#define MARKERMASK 0x%016XULL\n\n' % mask(layout.MARKERS))
+    out.write('/* bits that are always 0 */\n')
+    out.write('#define ZEROMASK   0x%016XULL\n\n' % mask(layout.ZEROS))
+    out.write('/* set in leap years */\n')
+    out.write('#define LEAPYEARBIT %d\n\n' % layout.LEAP_YEAR_BIT)
+    out.write('/* set while DST is in effect at the end of the UTC day of the frame */\n')
+    out.write('#define DSTATENDBIT %d\n\n' % layout.DST_AT_END_BIT)
+    out.write('/* set while DST is in effect at the start of the UTC day */\n')
+    out.write('#define DSTATSTARTBIT %d\n\n' % layout.DST_AT_START_BIT)
+
+    fieldBits = [ind for (name, weights) in layout.FIELDS for (ind, w) in weights]
+    fieldBits += [layout.LEAP_YEAR_BIT, layout.DST_AT_END_BIT,
+                  layout.DST_AT_START_BIT]
+    out.write('/* bits that carry a field, the leap year or the DST bits */\n')
+    out.write('#define FIELDMASK  0x%016XULL\n\n' % mask(fieldBits))
+
+    out.write('enum FIELD {\n')
+    for (name, weights) in layout.FIELDS:
+        out.write('    %sField,\n' % name)
+    out.write('    NFIELDS\n};\n\n\n')
+
+    out.write('/* Maps a slice of the packed frame to its value in a BCD field */\n')
+    out.write('typedef struct {\n')
+    out.write('    unsigned char shift;           /* first frame bit of the slice */\n')
+    out.write('    unsigned char width;           /* number of bits, 0 if unused */\n')
+    out.write('    const unsigned short* table;   /* value of every slice pattern */\n')
+    out.write('} fieldSlice;\n\n\n')
+
+    out.write('/* slices of every BCD field, indexed by enum FIELD */\n')
+    out.write('extern const fieldSlice frameFields[NFIELDS][MAXSLICES];\n\n\n')
+
+    out.write('/*\n')
+    out.write(' * \\brief Decode one BCD field from a packed frame.\n')
+    out.write(' *\n')
+    out.write(' * \\param data Packed data bits of the frame.\n')
+    out.write(' * \\param field Field to decode.\n')
+    out.write(' *\n')
+    out.write(' * \\returns Value of the field.\n')
+    out.write(' */\n')
+    out.write('static inline int decodeField(uint64_t data, enum FIELD field)\n')
+    out.write('{\n')
+    out.write('    const fieldSlice* slice = frameFields[field];\n')
+    out.write('    int value = 0;\n\n')
+    out.write('    for (int i = 0; i < MAXSLICES && slice[i].width; i++) {\n')
+    out.write('        unsigned raw = (data >> slice[i].shift) '
+              '& ((1u << slice[i].width) - 1);\n')
+    out.write('        value += slice[i].table[raw];\n')
+    out.write('    }\n\n')
+    out.write('    return value;\n')
+    out.write('}\n\n\n')
+
+    out.write('#endif /* FRAME_LAYOUT_H_ */\n')
+
+
+def writeSource(out):
+    maxSlices = max(len(fieldSlices(weights)) for (name, weights) in layout.FIELDS)
+
+    out.write('/* Generated by generate_layout_header.py from wwvb_layout.py, '
+              'do not edit. */\n\n')
+    out.write('#include "frame_layout.h"\n\n')
+
+    entries = []
+    for (name, weights) in layout.FIELDS:
+        row = []
+        for (i, (shift, width, table)) in enumerate(fieldSlices(weights)):
+            tableName = '%sSlice%d' % (name, i)
+            writeTable(out, tableName, table)
+            row.append('{%d, %d, %s}' % (shift, width, tableName))
+        row += ['{0, 0, 0}'] * (maxSlices - len(row))
+        entries.append(row)
+
+    out.write('const fieldSlice frameFields[NFIELDS][MAXSLICES] = {\n')
+    for row in entries:
+        out.write('    {%s},\n' % ', '.join(row))
+    out.write('};\n')
+
+
+if __name__ == '__main__':
+    header = open('frame_layout.h', 'w')
+    writeHeader(header)
+    header.close()
+
+    source = open('frame_layout.c', 'w')
+    writeSource(source)
+    source.close()
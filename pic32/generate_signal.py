@@ -2,6 +2,14 @@ import sys
 import random
 import datetime
 
+import wwvb_layout as layout
+
+# DST status of a frame, as DSTOFF to DSTON of time_decoder.h
+DST_OFF = 0
+DST_BEGINS = 1
+DST_ENDS = 2
+DST_ON = 3
+
 def generateBit(bit):
     lows = 8
 
@@ -31,16 +39,14 @@ def fillFrame(value, indAndWeight, frame):
             value %= weight
 
 
-def generateTimeBits(year, month, day, hour, minute):
-    frame = [0 for x in xrange(60)]
+def generateTimeBits(year, month, day, hour, minute, dst=DST_OFF):
+    frame = [0 for x in xrange(layout.FRAME_SIZE)]
 
     # minute
-    indAndWeight = [(1,40), (2,20), (3,10), (5,8), (6,4), (7,2), (8,1)]
-    fillFrame(minute, indAndWeight, frame)
+    fillFrame(minute, layout.field('minute'), frame)
 
     # hour
-    indAndWeight = [(12,20), (13,10), (15,8), (16,4), (17,2), (18,1)]
-    fillFrame(hour, indAndWeight, frame)
+    fillFrame(hour, layout.field('hour'), frame)
 
     yearStart = datetime.date(2000+year, 1, 1)
     currentDate = datetime.date(2000+year, month, day)
@@ -50,30 +56,26 @@ def generateTimeBits(year, month, day, hour, minute):
 
 
     # day of year
-    indAndWeight = [(22,200), (23,100), (25,80), (26,40), (27,20),\
-                    (28,10),  (30,8),   (31,4),  (32,2),  (33,1)]
-    fillFrame(dayOfYear, indAndWeight, frame)
+    fillFrame(dayOfYear, layout.field('day'), frame)
 
 
     # last 2 digit of year
-    indAndWeight = [(45,80), (46,40), (47,20), (48,10),\
-                    (50,8),  (51,4),  (52,2),  (53,1)]
-    fillFrame(year, indAndWeight, frame)
+    fillFrame(year, layout.field('year'), frame)
 
-    dst = 0
     leapYear = 0
     if year % 400 == 0 or (year % 4 == 0 and year % 100 != 0):
         leapYear = 1
 
-    frame[55] = leapYear
-    frame[57] = frame[58] = 0;
+    frame[layout.LEAP_YEAR_BIT] = leapYear
+    frame[layout.DST_AT_END_BIT] = int(dst in (DST_BEGINS, DST_ON))
+    frame[layout.DST_AT_START_BIT] = int(dst in (DST_ENDS, DST_ON))
 
     fillPreDefinedBits(frame)
 
     return frame
 
-def generateTimeSignal(year, month, day, hour, minute):
-    frame = generateTimeBits(year, month, day, hour, minute)
+def generateTimeSignal(year, month, day, hour, minute, dst=DST_OFF):
+    frame = generateTimeBits(year, month, day, hour, minute, dst)
     signal = ''
 
     for bit in frame:
@@ -82,12 +84,10 @@ def generateTimeSignal(year, month, day, hour, minute):
 
 
 def fillPreDefinedBits(frame):
-    frame[0]  = 'm' ; frame[4]  =  0 ; frame[9]  = 'm';
-    frame[10] =  0  ; frame[11] =  0 ; frame[14] =  0 ;
-    frame[19] = 'm' ; frame[20] =  0 ; frame[21] =  0 ;
-    frame[24] =  0  ; frame[29] = 'm'; frame[34] =  0 ;
-    frame[35] =  0  ; frame[39] = 'm'; frame[44] =  0 ;
-    frame[49] = 'm' ; frame[54] =  0 ; frame[59] = 'm';
+    for ind in layout.MARKERS:
+        frame[ind] = 'm'
+    for ind in layout.ZEROS:
+        frame[ind] = 0
 
 
 def generateTests():
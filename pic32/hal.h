@@ -0,0 +1,274 @@
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+
+/*
+ * Hardware abstraction for the timers, the sampling interrupt, the receiver
+ * and signal pins, and the SPI link to the FPGA. On the PIC32 every function is an inline
+ * register access from hal_pic32.h. Everywhere else hal_linux.c runs them
+ * against a virtual clock, so the firmware main loops build and run on a
+ * desktop.
+ */
+#ifdef __PIC32MX__
+#define HALAPI static inline
+#define HALLOCAL
+#else
+#define HALAPI
+#define HALLOCAL __thread    /* one virtual board per thread */
+#endif
+
+#define HALTICKRATE 625000    /* Timer ticks per second, 20MHz / 32 */
+#define HALTIMERMAX 0xFFFF    /* Timer4 is 16 bit and wraps after this count */
+
+
+/* Runs in the sampling interrupt */
+typedef void (*halInterruptHandler)(void);
+
+
+/*
+ * \brief Start the sampling timer, Timer2, interrupting every ticks.
+ *
+ * On the PIC32 the handler has to be defined with HALSAMPLINGISR, which
+ * puts it on the Timer2 vector. On a desktop it is called on the virtual
+ * clock while the main loop waits. Either way it ends with
+ * halAckSamplingInterrupt().
+ *
+ * \param ticks Timer ticks between two interrupts, at HALTICKRATE.
+ * \param handler Function run by the interrupt.
+ */
+HALAPI void halStartSamplingInterrupt(unsigned ticks,
+                                      halInterruptHandler handler);
+
+
+/*
+ * \brief Clear the sampling interrupt, last thing in its handler.
+ */
+HALAPI void halAckSamplingInterrupt(void);
+
+
+/*
+ * \brief Sleep until the next interrupt has run.
+ */
+HALAPI void halWaitForInterrupt(void);
+
+
+/*
+ * \brief Start the time keeping timer, Timer4, at HALTICKRATE.
+ */
+HALAPI void halStartTickTimer(void);
+
+
+/*
+ * \brief Reset the time keeping timer count to 0.
+ */
+HALAPI void halResetTickTimer(void);
+
+
+/*
+ * \brief Wait until the time keeping timer has counted to ticks.
+ *
+ * \param ticks Count to wait for, since the last reset, at most HALTIMERMAX.
+ */
+HALAPI void halWaitTickTimer(unsigned ticks);
+
+
+/*
+ * \brief Read the time keeping timer.
+ *
+ * \returns Count since the last reset, wrapping to 0 after HALTIMERMAX.
+ */
+HALAPI unsigned halReadTickTimer(void);
+
+
+/*
+ * \brief Check if the time keeping timer has counted to ticks.
+ *
+ * \param ticks Count to check for, since the last reset, at most
+ *     HALTIMERMAX. A larger count is never reached.
+ *
+ * \returns 1 once the count is reached, 0 before.
+ */
+HALAPI int halTickTimerPassed(unsigned ticks);
+
+
+/*
+ * \brief Take ticks off the time keeping timer count, keeping the rest.
+ *
+ * Ends a tick that ran over without losing the time it ran over by.
+ *
+ * \param ticks Count to take off, at most the count so far.
+ */
+HALAPI void halRewindTickTimer(unsigned ticks);
+
+
+/*
+ * \brief Set up the receiver input pin and the debug LEDs.
+ */
+HALAPI void halInitReceiverPins(void);
+
+
+/*
+ * \brief Read the receiver board output.
+ *
+ * \returns 1 for full carrier amplitude, 0 for reduced amplitude.
+ */
+HALAPI int halReadReceiverPin(void);
+
+
+/*
+ * \brief Show a value on the debug LEDs.
+ *
+ * \param value Value to show, low 8 bits.
+ */
+HALAPI void halWriteLeds(int value);
+
+
+/*
+ * \brief Set up the output pin of the WWVB simulator.
+ */
+HALAPI void halInitSignalPin(void);
+
+
+/*
+ * \brief Drive the output pin of the WWVB simulator.
+ *
+ * \param value 1 for full carrier amplitude, 0 for reduced amplitude.
+ */
+HALAPI void halWriteSignalPin(int value);
+
+
+/*
+ * \brief Set up SPI2 as a 32 bit master at 5MHz.
+ */
+HALAPI void halInitSPI(void);
+
+
+/*
+ * \brief Send one 32 bit word over SPI.
+ *
+ * Waits for the previous word to leave the transmit buffer first, so the
+ * words of a packet can be sent back to back.
+ *
+ * \param word Word to send.
+ */
+HALAPI void halWriteSPI(uint32_t word);
+
+
+/*
+ * \brief Send out a piece of a capture of the receiver samples.
+ *
+ * The board has no link for it, so on the PIC32 the bytes are dropped and
+ * the recorder is read out with the debugger instead. On a desktop they are
+ * appended to the file named by the environment variable HAL_CAPTURE, if
+ * set.
+ *
+ * \param data Bytes of the capture.
+ * \param size Number of bytes.
+ */
+HALAPI void halWriteCapture(const void* data, uint32_t size);
+
+
+/*
+ * \brief Check if the main loop should keep going.
+ *
+ * \returns Always 1 on the PIC32, 0 once the virtual run time is over.
+ */
+HALAPI int halKeepRunning(void);
+
+
+#ifdef __PIC32MX__
+
+#include "hal_pic32.h"
+
+#else
+
+/* the handler is a plain function, run by halWaitForInterrupt() */
+#define HALSAMPLINGISR(name) void name(void)
+
+/* Level of a virtual pin at a virtual time */
+typedef int (*halPinSource)(uint64_t tick, void* context);
+
+/* Called for every level driven on a virtual pin */
+typedef void (*halPinSink)(int value, uint64_t tick, void* context);
+
+/* Called for every word sent over the virtual SPI link */
+typedef void (*halWordSink)(uint32_t word, uint64_t tick, void* context);
+
+
+/*
+ * \brief Start the calling thread over at virtual time 0, without sources,
+ *        sinks or run time.
+ */
+void halReset(void);
+
+
+/*
+ * \brief Virtual time since the program started, or since halReset().
+ *
+ * Every thread has its own virtual clock, pins and SPI link.
+ *
+ * \returns Timer ticks, HALTICKRATE per second.
+ */
+uint64_t halTicks(void);
+
+
+/*
+ * \brief Set what the virtual receiver pin reads.
+ *
+ * Without a source, the samples in the file named by the environment
+ * variable HAL_SAMPLES are played back, one per 100 ms.
+ *
+ * \param source Level of the receiver pin at a virtual time.
+ * \param context Pointer passed through to source.
+ */
+void halSetReceiverSource(halPinSource source, void* context);
+
+
+/*
+ * \brief Set where the levels driven on the virtual signal pin go.
+ *
+ * \param sink Called with every level, may be NULL.
+ * \param context Pointer passed through to sink.
+ */
+void halSetSignalSink(halPinSink sink, void* context);
+
+
+/*
+ * \brief Set where the words sent over virtual SPI go.
+ *
+ * Without a sink, words are printed with their virtual time if the
+ * environment variable HAL_SPI_LOG is set.
+ *
+ * \param sink Called with every word, may be NULL.
+ * \param context Pointer passed through to sink.
+ */
+void halSetSPISink(halWordSink sink, void* context);
+
+
+/*
+ * \brief Set how long halKeepRunning() keeps returning 1.
+ *
+ * Without a run time, the environment variable HAL_SECONDS sets it, or
+ * else the length of the HAL_SAMPLES file.
+ *
+ * \param ticks Virtual run time in timer ticks.
+ */
+void halSetRunTime(uint64_t ticks);
+
+
+/*
+ * \brief Longest count the time keeping timer was waited on or checked
+ *        for since halReset().
+ *
+ * Timer4 is 16 bit, so a count over HALTIMERMAX would never be reached on
+ * the PIC32 and hang the clock. The virtual timer wraps the same way.
+ *
+ * \returns Timer ticks.
+ */
+unsigned halLongestTick(void);
+
+#endif
+
+
+#endif /* HAL_H_ */
@@ -0,0 +1,358 @@
+/*
+ * Desktop implementation of hal.h against a virtual clock.
+ *
+ * Time only moves when the firmware waits on a timer or for an interrupt,
+ * so a main loop that holds for 100 ms per iteration runs as fast as the
+ * host allows. The sampling interrupt is a plain call of its handler at
+ * each virtual time it is due, made from whichever wait passes it. The
+ * receiver pin reads from a source function of the virtual time, and SPI
+ * words and signal pin levels go to sink functions. All of this state is
+ * per thread, so each thread can run its own copy of the firmware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal.h"
+
+#define SAMPLETICKS (HALTICKRATE / 10)    /* ticks per 100 ms sample */
+
+
+static HALLOCAL uint64_t now;              /* virtual time in timer ticks */
+static HALLOCAL uint64_t tickStart;        /* virtual time of Timer4 reset */
+static HALLOCAL uint64_t runTicks;         /* halKeepRunning() 0 from here */
+static HALLOCAL unsigned longestTick;      /* longest Timer4 count used */
+
+static HALLOCAL halInterruptHandler samplingHandler;
+static HALLOCAL uint64_t samplingTicks;    /* between sampling interrupts */
+static HALLOCAL uint64_t nextInterrupt;    /* virtual time of the next one */
+
+static HALLOCAL halPinSource receiverSource;
+static HALLOCAL void*        receiverContext;
+static HALLOCAL halPinSink   signalSink;
+static HALLOCAL void*        signalContext;
+static HALLOCAL halWordSink  spiSink;
+static HALLOCAL void*        spiContext;
+
+static HALLOCAL FILE* captureOut;   /* HAL_CAPTURE, opened by the first write */
+
+static HALLOCAL int configured;    /* run time and receiver source are set */
+static HALLOCAL int spiLog;        /* print SPI words without a sink */
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* samples of the HAL_SAMPLES file, one per 100 ms */
+typedef struct {
+    char*  samples;
+    size_t count;
+} sampleFile;
+
+
+static int playSample(uint64_t tick, void* context)
+{
+    sampleFile* file = context;
+    uint64_t index = tick / SAMPLETICKS;
+
+    /* full carrier once the capture is over */
+    return index < file->count ? file->samples[index] : 1;
+}
+
+
+static void loadSamples(const char* path, sampleFile* file)
+{
+    FILE* in = fopen(path, "rb");
+    int c;
+
+    if (!in) {
+        perror(path);
+        exit(1);
+    }
+
+    size_t size = 0;
+    file->count = 0;
+    file->samples = NULL;
+
+    /* keep the 0 and 1 characters, drop line breaks */
+    while ((c = fgetc(in)) != EOF) {
+        if (c != '0' && c != '1')
+            continue;
+
+        if (file->count == size) {
+            size = size ? 2 * size : 4096;
+            file->samples = realloc(file->samples, size);
+        }
+
+        file->samples[file->count++] = c - '0';
+    }
+
+    fclose(in);
+}
+
+
+/* settings from the environment for anything not set by the program */
+static void configure(void)
+{
+    static HALLOCAL sampleFile file;
+
+    if (configured)
+        return;
+
+    configured = 1;
+    spiLog = getenv("HAL_SPI_LOG") != NULL;
+
+    const char* path    = getenv("HAL_SAMPLES");
+    const char* seconds = getenv("HAL_SECONDS");
+
+    if (seconds && !runTicks)
+        runTicks = (uint64_t) (atof(seconds) * HALTICKRATE);
+
+    if (path && !receiverSource) {
+        loadSamples(path, &file);
+        receiverSource  = playSample;
+        receiverContext = &file;
+
+        if (!runTicks)
+            runTicks = file.count * SAMPLETICKS;
+    }
+
+    /* without a limit, run until the process is stopped */
+    if (!runTicks)
+        runTicks = UINT64_MAX;
+}
+
+
+/* Timer4 counts to HALTIMERMAX and wraps */
+static unsigned tickCount(void)
+{
+    return (unsigned) ((now - tickStart) & HALTIMERMAX);
+}
+
+
+static void useTickCount(unsigned ticks)
+{
+    if (ticks > longestTick)
+        longestTick = ticks;
+}
+
+
+static void waitUntil(uint64_t tick)
+{
+    /* the interrupts due on the way, each at its own time */
+    while (samplingHandler && nextInterrupt <= tick) {
+        if (now < nextInterrupt)
+            now = nextInterrupt;
+
+        nextInterrupt += samplingTicks;
+        samplingHandler();
+    }
+
+    if (now < tick)
+        now = tick;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void halStartSamplingInterrupt(unsigned ticks, halInterruptHandler handler)
+{
+    samplingHandler = handler;
+    samplingTicks   = ticks;
+    nextInterrupt   = now + ticks;
+}
+
+
+void halAckSamplingInterrupt(void)
+{
+}
+
+
+void halWaitForInterrupt(void)
+{
+    /* without interrupts there is nothing to wake up for */
+    if (samplingHandler)
+        waitUntil(nextInterrupt);
+}
+
+
+void halStartTickTimer(void)
+{
+    tickStart = now;
+}
+
+
+void halResetTickTimer(void)
+{
+    tickStart = now;
+}
+
+
+void halWaitTickTimer(unsigned ticks)
+{
+    useTickCount(ticks);
+
+    /* the count is never reached, the PIC32 would hang */
+    if (ticks > HALTIMERMAX) {
+        fprintf(stderr, "halWaitTickTimer: %u is over the 16 bit timer\n",
+                ticks);
+        exit(1);
+    }
+
+    waitUntil(tickStart + ticks);
+}
+
+
+unsigned halReadTickTimer(void)
+{
+    return tickCount();
+}
+
+
+int halTickTimerPassed(unsigned ticks)
+{
+    useTickCount(ticks);
+
+    return tickCount() >= ticks;
+}
+
+
+void halRewindTickTimer(unsigned ticks)
+{
+    tickStart += ticks;
+}
+
+
+void halInitReceiverPins(void)
+{
+    configure();
+}
+
+
+int halReadReceiverPin(void)
+{
+    configure();
+
+    /* no signal at all without a source */
+    return receiverSource ? receiverSource(now, receiverContext) != 0 : 0;
+}
+
+
+void halWriteLeds(int value)
+{
+    (void) value;
+}
+
+
+void halInitSignalPin(void)
+{
+    configure();
+}
+
+
+void halWriteSignalPin(int value)
+{
+    if (signalSink)
+        signalSink(value, now, signalContext);
+}
+
+
+void halInitSPI(void)
+{
+    configure();
+}
+
+
+void halWriteSPI(uint32_t word)
+{
+    if (spiSink)
+        spiSink(word, now, spiContext);
+    else if (spiLog)
+        printf("%.1f %08lx\n", (double) now / HALTICKRATE,
+               (unsigned long) word);
+}
+
+
+void halWriteCapture(const void* data, uint32_t size)
+{
+    const char* path = getenv("HAL_CAPTURE");
+
+    if (!path)
+        return;
+
+    if (!captureOut && !(captureOut = fopen(path, "wb"))) {
+        perror(path);
+        exit(1);
+    }
+
+    fwrite(data, 1, size, captureOut);
+    fflush(captureOut);
+}
+
+
+int halKeepRunning(void)
+{
+    configure();
+
+    return now < runTicks;
+}
+
+
+void halReset(void)
+{
+    now = tickStart = runTicks = 0;
+    longestTick = 0;
+
+    samplingHandler = NULL;
+    receiverSource  = NULL;
+    signalSink      = NULL;
+    spiSink         = NULL;
+    configured      = 0;
+
+    if (captureOut)
+        fclose(captureOut);
+
+    captureOut = NULL;
+}
+
+
+uint64_t halTicks(void)
+{
+    return now;
+}
+
+
+void halSetReceiverSource(halPinSource source, void* context)
+{
+    receiverSource  = source;
+    receiverContext = context;
+}
+
+
+void halSetSignalSink(halPinSink sink, void* context)
+{
+    signalSink    = sink;
+    signalContext = context;
+}
+
+
+void halSetSPISink(halWordSink sink, void* context)
+{
+    spiSink    = sink;
+    spiContext = context;
+}
+
+
+void halSetRunTime(uint64_t ticks)
+{
+    runTicks = ticks;
+}
+
+
+unsigned halLongestTick(void)
+{
+    return longestTick;
+}
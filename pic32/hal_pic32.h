@@ -0,0 +1,180 @@
+#ifndef HAL_PIC32_H_
+#define HAL_PIC32_H_
+
+/* PIC32 register implementation of hal.h, only included from there */
+
+#include <P32xxxx.h>
+#include <sys/attribs.h>
+
+/* the handler of halStartSamplingInterrupt(), on the Timer2 vector */
+#define HALSAMPLINGISR(name) \
+    void __ISR(_TIMER_2_VECTOR, IPL3SOFT) name(void)
+
+
+HALAPI void halStartSamplingInterrupt(unsigned ticks,
+                                      halInterruptHandler handler)
+{
+    /* HALSAMPLINGISR has put it on the vector already */
+    (void) handler;
+
+    /* stop Timer2 and count up to PR2 from 0, then interrupt at priority 3 */
+    T2CON = 0;
+    TMR2  = 0;
+    PR2   = ticks - 1;
+
+    IPC2CLR = _IPC2_T2IP_MASK | _IPC2_T2IS_MASK;
+    IPC2SET = 3 << _IPC2_T2IP_POSITION;
+    IFS0CLR = _IFS0_T2IF_MASK;
+    IEC0SET = _IEC0_T2IE_MASK;
+
+    /* each interrupt on its own vector */
+    INTCONSET = _INTCON_MVEC_MASK;
+    __builtin_enable_interrupts();
+
+    /*
+     * Assumes peripheral clock at 20MHz, use Timer2 for sampling timer
+     *     bit 15  : ON    = 1  : timer on
+     *     bit 14  : FRZ   = 0  : keep running in exception mode
+     *     bit 13  : SIDL  = 0  : keep running in idle mode
+     *     bit 12-8: unused
+     *     bit 7   : TGATE = 0  : disable gated accumulation
+     *     bit 6-4 : TCKPS = 101: 1:32 prescaler
+     *     bit 3   : T32   = 0  : 16 bit timer
+     *     bit 2   : unused
+     *     bit 1   : TCS   = 0  : use internal peripheral clock
+     *     bit 0   : unused
+     */
+    T2CON = 0x8050;
+}
+
+
+HALAPI void halAckSamplingInterrupt(void)
+{
+    IFS0CLR = _IFS0_T2IF_MASK;
+}
+
+
+HALAPI void halWaitForInterrupt(void)
+{
+    /* idle the core, any interrupt wakes it up */
+    __asm__ __volatile__ ("wait");
+}
+
+
+HALAPI void halStartTickTimer(void)
+{
+    /* same settings as Timer2 in halStartSamplingInterrupt() */
+    T4CON = 0x8050;
+}
+
+
+HALAPI void halResetTickTimer(void)
+{
+    /* reset timer counter to 0 */
+    TMR4 = 0;
+}
+
+
+HALAPI void halWaitTickTimer(unsigned ticks)
+{
+    while (TMR4 < ticks);
+}
+
+
+HALAPI unsigned halReadTickTimer(void)
+{
+    return TMR4;
+}
+
+
+HALAPI int halTickTimerPassed(unsigned ticks)
+{
+    return TMR4 >= ticks;
+}
+
+
+HALAPI void halRewindTickTimer(unsigned ticks)
+{
+    /* a timer tick is 32 peripheral clocks, none passes in between */
+    TMR4 -= ticks;
+}
+
+
+HALAPI void halInitReceiverPins(void)
+{
+    /* set up LEDs to display received signal */
+    TRISD = 0xFF00;
+
+    /* set up input for receiver board */
+    TRISF = 0xFFFF;
+}
+
+
+HALAPI int halReadReceiverPin(void)
+{
+    /* get input from RF0, output from board is negated */
+    return ~PORTF & 0x1;
+}
+
+
+HALAPI void halWriteLeds(int value)
+{
+    PORTD = value;
+}
+
+
+HALAPI void halInitSignalPin(void)
+{
+    TRISF = 0x0000;
+}
+
+
+HALAPI void halWriteSignalPin(int value)
+{
+    PORTF = value;
+}
+
+
+HALAPI void halInitSPI(void)
+{
+    /* turn off SPI */
+    SPI2CON = 0x0;
+
+    /* read BUF to clear it */
+    (void) SPI2BUF;
+
+    /* set baud rate to 5MHz for a 20MHz peripheral clk */
+    SPI2BRG = 0x0001;
+
+    /* set to Master mode (bit 5), SDO centered on rising clk edge (bit 8),
+     * 32 bit mode (bit 11 - 10) */
+    SPI2CON = SPI2CON | 0x00000920;
+
+    /* turn SPI back on */
+    SPI2CON = SPI2CON | 0x00008000;
+}
+
+
+HALAPI void halWriteSPI(uint32_t word)
+{
+    /* wait for SPITBE (bit 3), the transmit buffer is empty */
+    while (!(SPI2STAT & 0x00000008));
+
+    SPI2BUF = word;
+}
+
+
+HALAPI void halWriteCapture(const void* data, uint32_t size)
+{
+    (void) data;
+    (void) size;
+}
+
+
+HALAPI int halKeepRunning(void)
+{
+    return 1;
+}
+
+
+#endif /* HAL_PIC32_H_ */
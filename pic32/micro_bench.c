@@ -0,0 +1,568 @@
+#include <string.h>
+
+#include "edge_filter.h"
+#include "micro_bench.h"
+#include "radio_clock.h"
+#include "time_decoder.h"
+#include "time_keeping.h"
+#include "wwvb_signal.h"
+
+#define BENCHFRAMES 4                               /* frames of samples */
+#define BENCHSAMPLES (BENCHFRAMES * FRAMESAMPLES)
+#define NPAIRS 8                                    /* frame pairs to decode */
+#define NOISYFLIPS 50                               /* 1 sample in 50 flipped */
+#define BENCHSTART 1394359140    /* 2014-03-09 01:59:00 PST, DST at 2:00 */
+#define BENCHRUNS (BENCHFRAMES * FRAMESIZE * 2)     /* runs of clean samples */
+#define BENCHTICKS (HALTICKRATE / NSAMPLES)         /* timer ticks per sample */
+
+
+/* what the benchmarks run on, set up once */
+typedef struct {
+    char        samples[3][BENCHSAMPLES];    /* clean, noisy and random */
+    timeDecoder pulses[3];                   /* a 0, a 1 and a marker */
+    timeDecoder invalid;                     /* a pulse of no bit */
+    timeDecoder pairs[3][NPAIRS];            /* valid, erased and random */
+    pinEdge     edges[BENCHSAMPLES];         /* of the noisy samples */
+    int         nedges;
+    char        runLevels[BENCHRUNS];        /* runs of the clean samples */
+    short       runLengths[BENCHRUNS];
+    int         nruns;
+} benchInputs;
+
+
+static benchInputs inputs;
+static volatile int benchSink;    /* keeps results from being optimized out */
+static uint32_t randomState;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* xorshift32, cheap enough for the PIC32 */
+static uint32_t nextRandom(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return randomState;
+}
+
+
+static void setPulse(timeDecoder* decoder, int zeros, int length)
+{
+    initDecoder(decoder);
+    decoder->foundStart = 1;
+
+    for (int i = 0; i < length; i++)
+        updateInputBuffer(decoder, i >= zeros);
+}
+
+
+/* a frame bit of random type, 0, 1 or 'm' */
+static char randomBit(void)
+{
+    static const char bits[3] = {0, 1, 'm'};
+
+    return bits[nextRandom() % 3];
+}
+
+
+/* two field bits of a frame erased */
+static void eraseBits(char* frame)
+{
+    for (int erased = 0; erased < 2;) {
+        int bit = nextRandom() % FRAMESIZE;
+
+        if (FIELDMASK >> bit & 1 && frame[bit] != ERASURE) {
+            frame[bit] = ERASURE;
+            erased++;
+        }
+    }
+}
+
+
+static void setupInputs(void)
+{
+    char frame[FRAMESIZE];
+    randomState = 2463534242u;
+
+    /* consecutive frames, clean, with flipped samples, and random */
+    for (int f = 0; f < BENCHFRAMES; f++) {
+        encodeFrame(BENCHSTART + 60 * f, 0, frame);
+        frameToSamples(frame, inputs.samples[0] + f * FRAMESAMPLES);
+    }
+
+    for (int i = 0; i < BENCHSAMPLES; i++) {
+        inputs.samples[1][i] = inputs.samples[0][i]
+                             ^ (nextRandom() % NOISYFLIPS == 0);
+        inputs.samples[2][i] = nextRandom() & 1;
+    }
+
+    /* every change of the noisy samples is a captured edge */
+    inputs.nedges = 0;
+
+    for (int i = 1; i < BENCHSAMPLES; i++) {
+        if (inputs.samples[1][i] == inputs.samples[1][i - 1])
+            continue;
+
+        pinEdge* edge = &inputs.edges[inputs.nedges++];
+        edge->time  = i * BENCHTICKS;
+        edge->level = inputs.samples[1][i];
+    }
+
+    inputs.nruns = 0;
+
+    for (int i = 0; i < BENCHSAMPLES; i++) {
+        if (i && inputs.samples[0][i] == inputs.samples[0][i - 1]) {
+            inputs.runLengths[inputs.nruns - 1]++;
+            continue;
+        }
+
+        inputs.runLevels[inputs.nruns]  = inputs.samples[0][i];
+        inputs.runLengths[inputs.nruns] = 1;
+        inputs.nruns++;
+    }
+
+    setPulse(&inputs.pulses[0], pulseLows(0), NSAMPLES);
+    setPulse(&inputs.pulses[1], pulseLows(1), NSAMPLES);
+    setPulse(&inputs.pulses[2], pulseLows('m'), NSAMPLES);
+    setPulse(&inputs.invalid, 4, NSAMPLES + NSPADDING - 1);
+
+    for (int p = 0; p < NPAIRS; p++) {
+        time_t minute = BENCHSTART + (time_t) (nextRandom() % 1000000) * 60;
+
+        for (int k = 0; k < 3; k++) {
+            timeDecoder* decoder = &inputs.pairs[k][p];
+            initDecoder(decoder);
+            decoder->bitCount = BUFFERSIZE;
+        }
+
+        for (int half = 0; half < 2; half++) {
+            char* valid  = inputs.pairs[0][p].bitBuffer + half * FRAMESIZE;
+            char* erased = inputs.pairs[1][p].bitBuffer + half * FRAMESIZE;
+            char* random = inputs.pairs[2][p].bitBuffer + half * FRAMESIZE;
+
+            encodeFrame(minute + 60 * half, 0, valid);
+            memcpy(erased, valid, FRAMESIZE);
+            eraseBits(erased);
+
+            for (int i = 0; i < FRAMESIZE; i++)
+                random[i] = randomBit();
+        }
+    }
+}
+
+
+/* keep the fastest repeat of a benchmark */
+static void keepFastest(benchResult* result, const char* name, uint32_t ops,
+                        uint64_t cycles)
+{
+    if (result->name[0] && cycles >= result->cycles)
+        return;
+
+    int i = 0;
+
+    for (; name[i] && i < BENCHNAMESIZE - 1; i++)
+        result->name[i] = name[i];
+
+    result->name[i] = '\0';
+    result->ops    = ops;
+    result->cycles = cycles;
+}
+
+
+/******************************************************************************/
+/******************************** Benchmarks **********************************/
+/******************************************************************************/
+
+/* samples in a loop, restarting after every full buffer */
+static uint64_t benchDecoder(const char* samples, uint32_t ops)
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+    clearDecoderTelemetry(&decoder);
+
+    int sink = 0, i = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        int status = updateDecoder(&decoder, samples[i]);
+
+        if (status == 3)
+            keepLastMarker(&decoder);
+
+        sink += status;
+
+        if (++i == BENCHSAMPLES)
+            i = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink;
+
+    return cyclesBetween(start, end);
+}
+
+
+/*
+ * One call in a state per operation. The state and the pulse counted so far
+ * are set before every call, so the decoder never leaves it.
+ */
+static uint64_t benchState(int state, int input, uint32_t ops)
+{
+    timeDecoder decoder = inputs.pulses[0];
+
+    decoder.currentState = state;
+    decoder.bitCount = 2;
+
+    /* inside a pulse, at its falling edge for a countHigh with a 0 */
+    int first = state == countLow ? 1 : state == countHigh && input ? 3
+              : NSAMPLES - 1;
+
+    /* all of a countLow so far is 0's, the rest of the pulse of a 0 bit */
+    int zeros = state == countLow ? 0 : inputs.pulses[0].zeroCount;
+
+    int sink = 0, count = first;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        decoder.currentState = state;
+        decoder.inputCount = count;
+        decoder.zeroCount = zeros ? zeros : count;
+        decoder.bitCount = 2;
+        sink += updateDecoder(&decoder, input);
+
+        if (++count == first + 4)
+            count = first;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink;
+
+    return cyclesBetween(start, end);
+}
+
+
+/* runs of clean samples, the same signal as a clean benchDecoder() */
+static uint64_t benchRuns(uint32_t ops)
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+
+    int sink = 0, r = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        int level = inputs.runLevels[r];
+        int count = inputs.runLengths[r];
+
+        while (count > 0) {
+            int status;
+            count -= updateDecoderRun(&decoder, level, count, &status);
+
+            if (status == 3)
+                keepLastMarker(&decoder);
+
+            sink += status;
+        }
+
+        if (++r == inputs.nruns)
+            r = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink;
+
+    return cyclesBetween(start, end);
+}
+
+
+/* one read per operation, of clean or noisy samples */
+static uint64_t benchFilterRead(const char* samples, uint32_t ops)
+{
+    edgeFilter filter;
+    initEdgeFilter(&filter, 24, 6, 18, BENCHTICKS);
+
+    pinEdge edge;
+    int sink = 0, i = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        sink += filterRead(&filter, samples[i], op * BENCHTICKS, &edge);
+
+        if (++i == BENCHSAMPLES)
+            i = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink + edge.level;
+
+    return cyclesBetween(start, end);
+}
+
+
+/* one captured edge per operation, most of them glitches */
+static uint64_t benchFilterCapture(uint32_t ops)
+{
+    captureFilter filter;
+    initCaptureFilter(&filter, 2 * BENCHTICKS);
+
+    pinEdge edge;
+    int sink = 0, e = 0;
+    uint32_t offset = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        pinEdge* captured = &inputs.edges[e];
+        sink += filterCapture(&filter, captured->time + offset,
+                              captured->level, &edge);
+
+        /* the time keeps going when the edges start over */
+        if (++e == inputs.nedges) {
+            e = 0;
+            offset += BENCHSAMPLES * BENCHTICKS;
+        }
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink + edge.level;
+
+    return cyclesBetween(start, end);
+}
+
+
+static uint64_t benchBitBuffer(timeDecoder* pulses, int count, uint32_t ops)
+{
+    int sink = 0, p = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        pulses[p].bitCount = 0;
+        sink += updateBitBuffer(&pulses[p]);
+
+        if (++p == count)
+            p = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink;
+
+    return cyclesBetween(start, end);
+}
+
+
+static uint64_t benchCheckFrame(timeDecoder* pairs, uint32_t ops)
+{
+    int sink = 0, p = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        sink += checkFrame(pairs[p].bitBuffer);
+
+        if (++p == NPAIRS)
+            p = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink;
+
+    return cyclesBetween(start, end);
+}
+
+
+static uint64_t benchDecodeFrame(timeDecoder* pairs, uint32_t ops)
+{
+    struct tm frameTime;
+    int sink = 0, p = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        sink += decodeFrame(pairs[p].bitBuffer, &frameTime);
+
+        if (++p == NPAIRS)
+            p = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink + frameTime.tm_min;
+
+    return cyclesBetween(start, end);
+}
+
+
+static uint64_t benchTimeAndDate(timeDecoder* pairs, uint32_t ops)
+{
+    time_t time = 0;
+    int dst, sink = 0, p = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        sink += updateTimeAndDate(&pairs[p], &time, &dst);
+
+        if (++p == NPAIRS)
+            p = 0;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink + (int) time;
+
+    return cyclesBetween(start, end);
+}
+
+
+/* every tick, or only ticks that end a second, through a DST change */
+static uint64_t benchTick(int endSecond, uint32_t ops)
+{
+    time_keeper timeKeeper;
+    initTimeKeeper(&timeKeeper, TIMEZONE, BENCHSTART);
+
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        if (endSecond)
+            timeKeeper.subSecondCount = NTICKS - 1;
+
+        tick(&timeKeeper);
+    }
+
+    cycleCount end = readCycles();
+    benchSink = timeKeeper.localTime.tm_sec;
+
+    return cyclesBetween(start, end);
+}
+
+
+static uint64_t benchPacket(uint32_t ops)
+{
+    time_keeper timeKeeper;
+    initTimeKeeper(&timeKeeper, TIMEZONE, BENCHSTART);
+    syncTime(&timeKeeper, BENCHSTART, 0);
+
+    timePacket packet;
+    int sink = 0;
+    cycleCount start = readCycles();
+
+    for (uint32_t op = 0; op < ops; op++) {
+        createPacket(&timeKeeper, op & 1, &packet);
+        sink += packet.second;
+    }
+
+    cycleCount end = readCycles();
+    benchSink = sink;
+
+    return cyclesBetween(start, end);
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+int runMicroBenches(benchResult* results, int repeats, uint32_t scale)
+{
+    static const char* sampleNames[3] = {"clean", "noisy", "random"};
+    static const char* pairNames[3]   = {"valid", "erased", "random"};
+    char name[BENCHNAMESIZE];
+    int count = 0;
+
+    setupInputs();
+    memset(results, 0, MAXBENCHES * sizeof(benchResult));
+
+    for (int r = 0; r < repeats; r++) {
+        int n = 0;
+        uint32_t ops = 4000 * scale;
+
+        for (int k = 0; k < 3; k++) {
+            strcpy(name, "updateDecoder.");
+            strcat(name, sampleNames[k]);
+            keepFastest(&results[n++], name, ops,
+                        benchDecoder(inputs.samples[k], ops));
+        }
+
+        /* the edge before a pulse, inside one, and after the last */
+        keepFastest(&results[n++], "updateDecoder.waitForHigh", ops,
+                    benchState(waitForHigh, 1, ops));
+        keepFastest(&results[n++], "updateDecoder.waitForEdge", ops,
+                    benchState(waitForEdge, 0, ops));
+        keepFastest(&results[n++], "updateDecoder.countLow", ops,
+                    benchState(countLow, 0, ops));
+        keepFastest(&results[n++], "updateDecoder.countHigh", ops,
+                    benchState(countHigh, 1, ops));
+        keepFastest(&results[n++], "updateDecoder.pulseEnd", ops,
+                    benchState(countHigh, 0, ops));
+        keepFastest(&results[n++], "updateDecoder.bufferFull", ops,
+                    benchState(bufferFull, 0, ops));
+
+        /* the same clean signal as whole runs */
+        ops = 40 * scale;
+        keepFastest(&results[n++], "updateDecoderRun.clean", ops,
+                    benchRuns(ops));
+
+        ops = 4000 * scale;
+        keepFastest(&results[n++], "filterRead.clean", ops,
+                    benchFilterRead(inputs.samples[0], ops));
+        keepFastest(&results[n++], "filterRead.noisy", ops,
+                    benchFilterRead(inputs.samples[1], ops));
+        keepFastest(&results[n++], "filterCapture.noisy", ops,
+                    benchFilterCapture(ops));
+
+        ops = 4000 * scale;
+        keepFastest(&results[n++], "updateBitBuffer.pulses", ops,
+                    benchBitBuffer(inputs.pulses, 3, ops));
+        keepFastest(&results[n++], "updateBitBuffer.invalid", ops,
+                    benchBitBuffer(&inputs.invalid, 1, ops));
+
+        ops = 400 * scale;
+        keepFastest(&results[n++], "checkFrame.valid", ops,
+                    benchCheckFrame(inputs.pairs[0], ops));
+        keepFastest(&results[n++], "checkFrame.random", ops,
+                    benchCheckFrame(inputs.pairs[2], ops));
+        keepFastest(&results[n++], "decodeFrame.valid", ops,
+                    benchDecodeFrame(inputs.pairs[0], ops));
+        keepFastest(&results[n++], "decodeFrame.erased", ops,
+                    benchDecodeFrame(inputs.pairs[1], ops));
+        keepFastest(&results[n++], "decodeFrame.random", ops,
+                    benchDecodeFrame(inputs.pairs[2], ops));
+
+        ops = 100 * scale;
+
+        for (int k = 0; k < 3; k++) {
+            strcpy(name, "updateTimeAndDate.");
+            strcat(name, pairNames[k]);
+            keepFastest(&results[n++], name, ops,
+                        benchTimeAndDate(inputs.pairs[k], ops));
+        }
+
+        ops = 8000 * scale;
+        keepFastest(&results[n++], "tick.tenth", ops, benchTick(0, ops));
+        keepFastest(&results[n++], "tick.second", ops, benchTick(1, ops));
+
+        ops = 4000 * scale;
+        keepFastest(&results[n++], "createPacket.synced", ops,
+                    benchPacket(ops));
+
+        count = n;
+    }
+
+    return count;
+}
+
+
+#ifdef MICRO_BENCH_FIRMWARE
+
+/* results for the debugger's watch window */
+benchResult microBenchResults[MAXBENCHES];
+int microBenchCount;
+
+int main()
+{
+    microBenchCount = runMicroBenches(microBenchResults, 3, 1);
+
+    while (1);
+
+    return 0;
+}
+
+#endif
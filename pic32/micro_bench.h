@@ -0,0 +1,40 @@
+#ifndef MICRO_BENCH_H_
+#define MICRO_BENCH_H_
+
+#include <stdint.h>
+
+#include "cycle_counter.h"
+
+#define MAXBENCHES 32
+#define BENCHNAMESIZE 32
+
+
+/* cycles of one benchmark, the least of its repeats */
+typedef struct {
+    char     name[BENCHNAMESIZE];    /* function.input, no spaces */
+    uint32_t ops;                    /* operations timed per repeat */
+    uint64_t cycles;                 /* cycles for all of them */
+} benchResult;
+
+
+/*
+ * \brief Time the hot paths of the decoder and the time keeper.
+ *
+ * Covers updateDecoder() on clean, noisy and random samples and in each
+ * state, updateDecoderRun() on the runs of the clean samples, filterRead()
+ * and filterCapture(), updateBitBuffer(), checkFrame(), decodeFrame(),
+ * updateTimeAndDate(), tick() and createPacket(), each on realistic and
+ * adversarial inputs. Only uses the cycle counter and fixed buffers, so it
+ * runs the same on the PIC32 as on a desktop.
+ *
+ * \param results Stores up to MAXBENCHES results.
+ * \param repeats Times each benchmark is run, the fastest counts.
+ * \param scale Multiplies the operations per benchmark, 1 for about 5 ms
+ *     each on the PIC32.
+ *
+ * \returns Number of results.
+ */
+int runMicroBenches(benchResult* results, int repeats, uint32_t scale);
+
+
+#endif /* MICRO_BENCH_H_ */
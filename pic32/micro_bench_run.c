@@ -0,0 +1,212 @@
+/*
+ * Runs the microbenchmarks of micro_bench.c and checks them against a
+ * baseline.
+ *
+ * Usage: micro_bench [-r repeats] [-s scale] [-w baseline]
+ *                    [-b baseline] [-t tolerance %]
+ *
+ * Prints the operations, ns/op and cycles/op of every benchmark. The cycle
+ * counter is calibrated against the monotonic clock for the ns. With -w the
+ * cycles/op are written to a baseline file, one "name cycles/op ns/op" line
+ * per benchmark after a comment with the counter, and with -b they are
+ * compared with one. A benchmark more than the tolerance slower than its
+ * baseline fails the run. Baselines only hold for the machine and the
+ * compiler flags they were written with.
+ *
+ * Build: gcc -std=c99 -O2 -DRADIO_CLOCK_NO_MAIN time_decoder.c \
+ *            frame_layout.c civil_time.c wwvb_signal.c time_keeping.c \
+ *            sample_queue.c bit_ring.c frame_voter.c capture_recorder.c \
+ *            hal_linux.c spi_protocol.c radio_clock.c edge_filter.c \
+ *            micro_bench.c micro_bench_run.c -o micro_bench
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "micro_bench.h"
+
+#define CALIBRATIONNS 50000000    /* time the counter is compared over */
+
+
+/* one line of a baseline file */
+typedef struct {
+    char   name[BENCHNAMESIZE];
+    double cycles;
+} baselineEntry;
+
+
+static double nowNs()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+/* counter cycles per nanosecond */
+static double calibrate()
+{
+    double begin = nowNs(), end;
+    cycleCount start = readCycles();
+
+    do {
+        end = nowNs();
+    } while (end - begin < CALIBRATIONNS);
+
+    return cyclesBetween(start, readCycles()) / (end - begin);
+}
+
+
+static int readBaseline(const char* path, baselineEntry* entries, int* count)
+{
+    FILE* in = fopen(path, "r");
+    char line[256];
+
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+
+    *count = 0;
+
+    while (fgets(line, sizeof(line), in) && *count < MAXBENCHES) {
+        baselineEntry* entry = &entries[*count];
+
+        if (line[0] == '#')
+            continue;
+
+        if (sscanf(line, "%31s %lf", entry->name, &entry->cycles) == 2)
+            (*count)++;
+    }
+
+    fclose(in);
+    return 0;
+}
+
+
+static int writeBaseline(const char* path, const benchResult* results,
+                         int count, double perNs)
+{
+    FILE* out = fopen(path, "w");
+
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(out, "# micro_bench baseline, %s counter, name cycles/op ns/op\n",
+            CYCLECOUNTER);
+
+    for (int i = 0; i < count; i++) {
+        double cycles = (double) results[i].cycles / results[i].ops;
+        fprintf(out, "%s %.2f %.2f\n", results[i].name, cycles,
+                cycles / perNs);
+    }
+
+    return fclose(out) != 0;
+}
+
+
+static const baselineEntry* findBaseline(const baselineEntry* entries,
+                                         int count, const char* name)
+{
+    for (int i = 0; i < count; i++)
+        if (!strcmp(entries[i].name, name))
+            return &entries[i];
+
+    return NULL;
+}
+
+
+int main(int argc, char** argv)
+{
+    int repeats = 10;
+    uint32_t scale = 50;
+    double tolerance = 25;
+    const char* writePath = NULL;
+    const char* comparePath = NULL;
+    int usage = argc % 2 == 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-r"))
+            repeats = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-s"))
+            scale = strtoul(argv[i + 1], NULL, 10);
+        else if (!strcmp(argv[i], "-w"))
+            writePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-b"))
+            comparePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-t"))
+            tolerance = atof(argv[i + 1]);
+        else
+            usage = 1;
+    }
+
+    if (usage || repeats < 1 || scale < 1 || tolerance < 0) {
+        fprintf(stderr, "usage: %s [-r repeats] [-s scale] [-w baseline] "
+                "[-b baseline] [-t tolerance %%]\n", argv[0]);
+        return 2;
+    }
+
+    baselineEntry baseline[MAXBENCHES];
+    int nbaseline = 0;
+
+    if (comparePath && readBaseline(comparePath, baseline, &nbaseline))
+        return 1;
+
+    benchResult results[MAXBENCHES];
+    double perNs = calibrate();
+    int count = runMicroBenches(results, repeats, scale);
+    int regressions = 0;
+
+    printf("%s counter, %.3f cycles/ns, fastest of %d\n\n", CYCLECOUNTER,
+           perNs, repeats);
+    printf("%-28s %9s %9s %10s", "benchmark", "ops", "ns/op", "cycles/op");
+    printf(comparePath ? " %10s %8s\n" : "\n", "baseline", "change");
+
+    for (int i = 0; i < count; i++) {
+        double cycles = (double) results[i].cycles / results[i].ops;
+
+        printf("%-28s %9lu %9.2f %10.2f", results[i].name,
+               (unsigned long) results[i].ops, cycles / perNs, cycles);
+
+        if (!comparePath) {
+            printf("\n");
+            continue;
+        }
+
+        const baselineEntry* entry = findBaseline(baseline, nbaseline,
+                                                  results[i].name);
+
+        if (!entry) {
+            printf(" %10s\n", "new");
+            continue;
+        }
+
+        double change = entry->cycles > 0
+                      ? 100 * (cycles - entry->cycles) / entry->cycles : 0;
+        int slower = change > tolerance;
+
+        printf(" %10.2f %+7.1f%%%s\n", entry->cycles, change,
+               slower ? "  REGRESSION" : "");
+
+        regressions += slower;
+    }
+
+    if (writePath && writeBaseline(writePath, results, count, perNs))
+        return 1;
+
+    if (regressions) {
+        printf("%d benchmarks more than %.0f%% slower than the baseline\n",
+               regressions, tolerance);
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * Decodes many sample files at once with the multi-channel decoder.
+ *
+ * Usage: multi_decode [-j threads] signals1.txt signals2.txt ...
+ *
+ * Every file is one channel. Decoded times are printed per file in the same
+ * format as time_decoder_test.c, prefixed with the file name, followed by a
+ * throughput report on stderr.
+ *
+ * Build: gcc -std=c99 -O3 -march=native -pthread time_decoder.c \
+ *            frame_layout.c civil_time.c multi_decoder.c test_support.c \
+ *            multi_decode.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civil_time.h"
+#include "multi_decoder.h"
+#include "test_support.h"
+
+
+/* decoded times of one channel, only written by the thread decoding it */
+typedef struct {
+    size_t  count;
+    size_t  size;
+    time_t* times;    /* -1 for a frame pair that failed to decode */
+} syncList;
+
+
+static void recordSync(int channel, int err, time_t time, int dst,
+                       void* context)
+{
+    syncList* list = (syncList*) context + channel;
+    (void) dst;
+
+    if (list->count == list->size) {
+        list->size  = list->size ? 2 * list->size : 64;
+        list->times = realloc(list->times, list->size * sizeof(time_t));
+    }
+
+    list->times[list->count++] = err ? -1 : time;
+}
+
+
+/* read a file of ASCII samples as raw 0/1 samples */
+static char* readSamples(const char* path, size_t* count)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char* samples = malloc(size > 0 ? size : 1);
+    size = fread(samples, 1, size, file);
+    fclose(file);
+
+    /* drop line breaks and anything else that is not a sample */
+    size_t n = 0;
+    for (long i = 0; i < size; i++)
+        if (samples[i] == '0' || samples[i] == '1')
+            samples[n++] = samples[i] - '0';
+
+    *count = n;
+    return samples;
+}
+
+
+int main(int argc, char** argv)
+{
+    int threads = 4;
+    int arg = 1;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+        threads = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+
+    int channels = argc - arg;
+
+    if (channels < 1 || threads < 1) {
+        fprintf(stderr, "usage: %s [-j threads] signals.txt...\n", argv[0]);
+        return 2;
+    }
+
+    char**    streams = calloc(channels, sizeof(char*));
+    size_t*   lengths = calloc(channels, sizeof(size_t));
+    syncList* syncs   = calloc(channels, sizeof(syncList));
+
+    unsigned long long samples = 0;
+
+    for (int c = 0; c < channels; c++) {
+        streams[c] = readSamples(argv[arg + c], &lengths[c]);
+
+        if (!streams[c]) {
+            perror(argv[arg + c]);
+            return 1;
+        }
+
+        samples += lengths[c];
+    }
+
+    double start = now();
+    int used = runMultiDecoder((const char* const*) streams, lengths, channels,
+                               threads, recordSync, syncs);
+    double elapsed = now() - start;
+
+    unsigned long long frames = 0;
+
+    for (int c = 0; c < channels; c++) {
+        for (size_t i = 0; i < syncs[c].count; i++) {
+            if (syncs[c].times[i] == -1) {
+                printf("%s: Err: valid bits but encoding is invalid.\n",
+                       argv[arg + c]);
+                continue;
+            }
+
+            struct tm currentTime;
+            civilFromTime(syncs[c].times[i], &currentTime);
+
+            printf("%s: %d-%02d-%02d %02d:%02d\n", argv[arg + c],
+                   1900 + currentTime.tm_year, currentTime.tm_mon + 1,
+                   currentTime.tm_mday, currentTime.tm_hour,
+                   currentTime.tm_min);
+        }
+
+        frames += 2 * syncs[c].count;
+        free(syncs[c].times);
+        free(streams[c]);
+    }
+
+    /* guard against a zero interval on tiny inputs */
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "channels: %d on %d threads\n", channels, used);
+    fprintf(stderr, "samples:  %llu (%.3g samples/s)\n",
+            samples, samples / elapsed);
+    fprintf(stderr, "frames:   %llu (%.3g frames/s)\n",
+            frames, frames / elapsed);
+
+    free(streams);
+    free(lengths);
+    free(syncs);
+
+    return 0;
+}
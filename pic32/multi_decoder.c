@@ -0,0 +1,297 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "multi_decoder.h"
+
+/******************************************************************************/
+/****************************** Channel helpers *******************************/
+/******************************************************************************/
+
+static void resetChannel(multiDecoder* decoder, int c)
+{
+    /* same as initDecoder() */
+    decoder->currentState[c] = waitForHigh;
+    decoder->inputCount[c]   = 0;
+    decoder->zeroCount[c]    = 0;
+    decoder->bitCount[c]     = 0;
+    decoder->foundStart[c]   = 0;
+    decoder->glitched[c]     = 0;
+}
+
+
+/* same as finishPulse() after appendPulse() for one channel */
+static int finishChannelPulse(multiDecoder* decoder, int c)
+{
+    int bit = classifyPulse(decoder->zeroCount[c]);
+
+    /* keep the second, only its bit is lost */
+    if (bit < 0 || decoder->glitched[c])
+        bit = ERASURE;
+
+    decoder->glitched[c] = 0;
+
+    int err = appendBit(decoder->bitBuffer[c], &decoder->bitCount[c],
+                        &decoder->foundStart[c], bit);
+
+    /* check for error conditions */
+    switch (err) {
+
+        case 2:    /* valid bit, but haven't found start of frame */
+            resetChannel(decoder, c);
+            break;
+
+        default:
+            /* go to bufferFull state if bitBuffer is now full */
+            if (decoder->bitCount[c] >= BUFFERSIZE) {
+                decoder->currentState[c] = bufferFull;
+                return 3;
+            }
+    }
+
+    /* start counting 0's again, the falling edge is the first sample */
+    decoder->currentState[c] = countLow;
+    decoder->inputCount[c]   = 1;
+    decoder->zeroCount[c]    = 1;
+
+    return err;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initMultiDecoder(multiDecoder* decoder, int channels)
+{
+    decoder->channels = channels;
+
+    for (int c = 0; c < channels; c++) {
+        resetChannel(decoder, c);
+        decoder->pulseDone[c] = 0;
+    }
+}
+
+
+void updateMultiDecoder(multiDecoder* decoder, const char* inputs,
+                        char* status)
+{
+    unsigned char* state = decoder->currentState;
+    unsigned char* count = decoder->inputCount;
+    unsigned char* zeros = decoder->zeroCount;
+    unsigned char* done  = decoder->pulseDone;
+    unsigned char* glitch = decoder->glitched;
+    int* bitCount   = decoder->bitCount;
+    int* foundStart = decoder->foundStart;
+
+    int channels = decoder->channels;
+    unsigned char pending = 0;
+
+    /*
+     * Every transition of the state machine as arithmetic on 0/1 flags, so
+     * the compiler can step all channels at once without branches. States
+     * only ever advance by one, waitForHigh -> waitForEdge -> countLow ->
+     * countHigh, or fall back to waitForHigh on a reset.
+     */
+    for (int c = 0; c < channels; c++) {
+        unsigned char s  = state[c];
+        unsigned char k  = count[c];
+        unsigned char x  = inputs[c] != 0;
+        unsigned char nx = x ^ 1;
+
+        unsigned char high = s == waitForHigh;
+        unsigned char edge = s == waitForEdge;
+        unsigned char low  = s == countLow;
+        unsigned char ones = s == countHigh;
+        unsigned char full = s == bufferFull;
+
+        /* a 0 too early, the first one in a pulse is only a glitch */
+        unsigned char under = ones & nx & (k < NSAMPLES - NSPADDING);
+        unsigned char first = under & (glitch[c] ^ 1);
+
+        /* too many 0's, or too many or a second time not enough 1's */
+        unsigned char resetLow  = low & (k >= NSAMPLES);
+        unsigned char resetHigh = ones & ((x & (k >= NSAMPLES + NSPADDING)) |
+                                          (under & glitch[c]));
+        unsigned char keep      = (resetLow | resetHigh) ^ 1;
+
+        /* samples counted into the pulse, a glitch counts as a 1 */
+        unsigned char append = (edge & nx) | (low & keep) |
+                               (ones & (x | first) & keep);
+
+        /* falling edge at the end of a valid length pulse */
+        unsigned char pulse = ones & nx & keep & (under ^ 1);
+
+        state[c]  = (s + ((high | low) & x) + (edge & nx)) * keep;
+        count[c]  = (k + append) * keep;
+        zeros[c]  = (zeros[c] + (append & nx & (first ^ 1))) * keep;
+        glitch[c] = (glitch[c] | first) * keep;
+        status[c] = (keep ^ 1) + 3 * full;
+        done[c]   = pulse;
+
+        /* the rest of initDecoder() on a reset */
+        bitCount[c]   *= keep;
+        foundStart[c] *= keep;
+
+        pending |= pulse;
+    }
+
+    if (!pending)
+        return;
+
+    /* decode finished pulses, about once per second per channel */
+    for (int c = 0; c < channels; c++)
+        if (done[c])
+            status[c] = finishChannelPulse(decoder, c);
+}
+
+
+void getChannel(multiDecoder* decoder, int channel, timeDecoder* single)
+{
+    single->currentState = decoder->currentState[channel];
+    single->inputCount   = decoder->inputCount[channel];
+    single->zeroCount    = decoder->zeroCount[channel];
+    single->bitCount     = decoder->bitCount[channel];
+    single->foundStart   = decoder->foundStart[channel];
+    single->glitched     = decoder->glitched[channel];
+
+    memcpy(single->bitBuffer, decoder->bitBuffer[channel], single->bitCount);
+}
+
+
+void setChannel(multiDecoder* decoder, int channel, timeDecoder* single)
+{
+    decoder->currentState[channel] = single->currentState;
+    decoder->inputCount[channel]   = single->inputCount;
+    decoder->zeroCount[channel]    = single->zeroCount;
+    decoder->bitCount[channel]     = single->bitCount;
+    decoder->foundStart[channel]   = single->foundStart;
+    decoder->glitched[channel]     = single->glitched;
+
+    memcpy(decoder->bitBuffer[channel], single->bitBuffer, single->bitCount);
+}
+
+
+/******************************************************************************/
+/******************************** Thread pool *********************************/
+/******************************************************************************/
+
+/* work shared by the threads of runMultiDecoder() */
+typedef struct {
+    const char* const* streams;
+    const size_t*      lengths;
+    int                channels;
+    channelCallback    onSync;
+    void*              context;
+
+    pthread_mutex_t    lock;
+    int                nextGroup;    /* next group of channels to decode */
+} decodeJob;
+
+
+/* decode a full bit buffer and restart from the last marker on success */
+static void syncChannel(decodeJob* job, int channel, timeDecoder* single)
+{
+    time_t unixTime = 0;
+    int dst = 0;
+    int err = updateTimeAndDate(single, &unixTime, &dst);
+
+    if (err)
+        initDecoder(single);
+    else
+        keepLastMarker(single);
+
+    if (job->onSync)
+        job->onSync(channel, err, unixTime, dst, job->context);
+}
+
+
+static void decodeGroup(decodeJob* job, int first, int channels)
+{
+    multiDecoder decoder;
+    initMultiDecoder(&decoder, channels);
+
+    char inputs[MAXCHANNELS];
+    char status[MAXCHANNELS];
+
+    /* step all channels together while every stream has samples */
+    size_t shortest = job->lengths[first];
+    for (int c = 1; c < channels; c++)
+        if (job->lengths[first + c] < shortest)
+            shortest = job->lengths[first + c];
+
+    for (size_t t = 0; t < shortest; t++) {
+        for (int c = 0; c < channels; c++)
+            inputs[c] = job->streams[first + c][t];
+
+        updateMultiDecoder(&decoder, inputs, status);
+
+        for (int c = 0; c < channels; c++) {
+            if (status[c] != 3)
+                continue;
+
+            timeDecoder single;
+            getChannel(&decoder, c, &single);
+            syncChannel(job, first + c, &single);
+            setChannel(&decoder, c, &single);
+        }
+    }
+
+    /* finish the longer streams one channel at a time */
+    for (int c = 0; c < channels; c++) {
+        timeDecoder single;
+        getChannel(&decoder, c, &single);
+
+        const char* stream = job->streams[first + c];
+
+        for (size_t t = shortest; t < job->lengths[first + c]; t++)
+            if (updateDecoder(&single, stream[t]) == 3)
+                syncChannel(job, first + c, &single);
+    }
+}
+
+
+static void* decodeWorker(void* arg)
+{
+    decodeJob* job = arg;
+
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        int group = job->nextGroup++;
+        pthread_mutex_unlock(&job->lock);
+
+        int first = group * MAXCHANNELS;
+        if (first >= job->channels)
+            break;
+
+        int channels = job->channels - first;
+        decodeGroup(job, first, channels < MAXCHANNELS ? channels : MAXCHANNELS);
+    }
+
+    return NULL;
+}
+
+
+int runMultiDecoder(const char* const* streams, const size_t* lengths,
+                    int channels, int threads, channelCallback onSync,
+                    void* context)
+{
+    decodeJob job = {streams, lengths, channels, onSync, context,
+                     PTHREAD_MUTEX_INITIALIZER, 0};
+
+    /* the calling thread is one of the workers */
+    pthread_t workers[threads > 1 ? threads - 1 : 1];
+    int started = 0;
+
+    while (started < threads - 1 &&
+           !pthread_create(&workers[started], NULL, decodeWorker, &job))
+        started++;
+
+    decodeWorker(&job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_mutex_destroy(&job.lock);
+
+    return started + 1;
+}
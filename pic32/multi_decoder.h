@@ -0,0 +1,119 @@
+#ifndef MULTI_DECODER_H_
+#define MULTI_DECODER_H_
+
+#include <stddef.h>
+#include <time.h>
+
+#include "time_decoder.h"
+
+#define MAXCHANNELS 64    /* Number of channels stepped together */
+
+#if NSAMPLES + NSPADDING > 255
+#error "multiDecoder counts the samples of a pulse in bytes"
+#endif
+
+
+/*
+ * Decodes several channels at once, one timeDecoder state machine per
+ * channel, stored as struct-of-arrays so every channel can be advanced by
+ * one sample in a single vectorizable pass. Like the timeDecoder, each
+ * channel only counts the samples and the 0 samples of its current pulse,
+ * in bytes, so the sample rate is limited to what fits.
+ */
+typedef struct {
+    int channels;    /* number of channels in use */
+
+    /* stepped every sample */
+    unsigned char currentState[MAXCHANNELS];
+    unsigned char inputCount[MAXCHANNELS];
+    unsigned char zeroCount[MAXCHANNELS];
+    unsigned char pulseDone[MAXCHANNELS];
+    unsigned char glitched[MAXCHANNELS];
+
+    /* updated once per pulse */
+    int  bitCount[MAXCHANNELS];
+    int  foundStart[MAXCHANNELS];
+    char bitBuffer[MAXCHANNELS][BUFFERSIZE];
+
+} multiDecoder;
+
+
+/*
+ * \brief Called for every full bit buffer of a channel in runMultiDecoder().
+ *
+ * Called from the worker threads, so it must be thread-safe.
+ *
+ * \param channel Index of the channel.
+ * \param err 0 if the time and date was decoded, 1 otherwise.
+ * \param time Decoded time, only valid if err is 0.
+ * \param dst Decoded DST status, only valid if err is 0.
+ * \param context Pointer passed through from runMultiDecoder.
+ */
+typedef void (*channelCallback)(int channel, int err, time_t time, int dst,
+                                void* context);
+
+
+/*
+ * \brief Initialize every channel of a multiDecoder.
+ *
+ * \param decoder Pointer to multiDecoder to initialize.
+ * \param channels Number of channels, at most MAXCHANNELS.
+ */
+void initMultiDecoder(multiDecoder* decoder, int channels);
+
+
+/*
+ * \brief Update every channel with one sample.
+ *
+ * Same as calling updateDecoder() on each channel's timeDecoder.
+ *
+ * \param decoder Pointer to multiDecoder to update.
+ * \param inputs One raw sample, 0 or 1, per channel.
+ * \param status Stores what updateDecoder() returns, per channel.
+ */
+void updateMultiDecoder(multiDecoder* decoder, const char* inputs,
+                        char* status);
+
+
+/*
+ * \brief Copy the state of one channel out to a timeDecoder.
+ *
+ * \param decoder Pointer to multiDecoder to read.
+ * \param channel Index of the channel.
+ * \param single Stores the channel as a timeDecoder.
+ */
+void getChannel(multiDecoder* decoder, int channel, timeDecoder* single);
+
+
+/*
+ * \brief Replace the state of one channel with a timeDecoder.
+ *
+ * \param decoder Pointer to multiDecoder to update.
+ * \param channel Index of the channel.
+ * \param single timeDecoder to copy in.
+ */
+void setChannel(multiDecoder* decoder, int channel, timeDecoder* single);
+
+
+/*
+ * \brief Decode many sample streams in parallel.
+ *
+ * Channels are split into groups of MAXCHANNELS, and a pool of threads
+ * takes groups until all are decoded. After every full bit buffer a channel
+ * restarts from the last marker, the same way radio_clock.c does.
+ *
+ * \param streams One array of raw samples, 0 or 1, per channel.
+ * \param lengths Number of samples in each stream.
+ * \param channels Number of streams.
+ * \param threads Number of worker threads.
+ * \param onSync Callback for every decoded frame pair, may be NULL.
+ * \param context Pointer passed through to onSync.
+ *
+ * \returns Number of threads used, including the calling thread.
+ */
+int runMultiDecoder(const char* const* streams, const size_t* lengths,
+                    int channels, int threads, channelCallback onSync,
+                    void* context);
+
+
+#endif /* MULTI_DECODER_H_ */
@@ -0,0 +1,245 @@
+/*
+ * Checks that the multi-channel decoder matches updateDecoder() exactly.
+ *
+ * Random streams of jittered pulses and glitches are stepped through one
+ * timeDecoder per channel and through a multiDecoder side by side, comparing
+ * every status and the state of every channel after every sample. Then the
+ * thread pool decodes streams of real frames and every channel's decoded
+ * times are compared with a single-channel run.
+ *
+ * Build: gcc -std=c99 -O3 -march=native -pthread time_decoder.c \
+ *            frame_layout.c civil_time.c wwvb_signal.c multi_decoder.c \
+ *            multi_decoder_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "multi_decoder.h"
+#include "wwvb_signal.h"
+
+#define NCHANNELS 150      /* not a multiple of MAXCHANNELS on purpose */
+#define STREAMSIZE (2000 * NSAMPLES)    /* samples per channel, 2000 s */
+#define MAXSYNCS (STREAMSIZE / FRAMESAMPLES + 1)
+#define NTHREADS 4
+
+
+/* decoded times of one channel */
+typedef struct {
+    int    count;
+    int    err[MAXSYNCS];
+    time_t time[MAXSYNCS];
+} syncLog;
+
+
+int sameDecoder(timeDecoder* a, timeDecoder* b)
+{
+    return a->currentState == b->currentState &&
+           a->foundStart   == b->foundStart   &&
+           a->glitched     == b->glitched     &&
+           a->bitCount     == b->bitCount     &&
+           a->inputCount   == b->inputCount   &&
+           a->zeroCount    == b->zeroCount    &&
+           !memcmp(a->bitBuffer, b->bitBuffer, a->bitCount);
+}
+
+
+/* fill samples with pulses of random width, about 5 in errorRange corrupted */
+void generateStream(char* samples, size_t count, int errorRange)
+{
+    static const int lows[] = {2, 5, 8};
+    size_t i = 0;
+
+    while (i < count) {
+        int kind = rand() % errorRange;
+        int low  = lows[rand() % 3] + (kind == 0) * (rand() % 5 - 2);
+        int high = NSAMPLES - low + (kind == 1) * (rand() % 7 - 3);
+
+        /* occasionally emit a long run to exercise the resets */
+        if (kind == 2)
+            low += rand() % 15;
+        if (kind == 3)
+            high += rand() % 15;
+
+        for (int j = 0; j < low && i < count; j++)
+            samples[i++] = 0;
+        for (int j = 0; j < high && i < count; j++)
+            samples[i++] = 1;
+
+        /* single sample glitch */
+        if (kind == 4 && i > 0)
+            samples[i - 1 - rand() % (i < 6 ? i : 6)] ^= 1;
+    }
+}
+
+
+/* fill samples with consecutive frames starting at a random minute */
+void generateFrames(char* samples, size_t count)
+{
+    static char frameSamples[FRAMESAMPLES];
+    time_t minute = (time_t) (rand() % 1000000) * 60 + 946684800;
+    size_t i = 0;
+
+    while (i < count) {
+        char frame[FRAMESIZE];
+        encodeFrame(minute, 0, frame);
+        frameToSamples(frame, frameSamples);
+
+        for (int j = 0; j < FRAMESAMPLES && i < count; j++)
+            samples[i++] = frameSamples[j];
+
+        minute += 60;
+    }
+}
+
+
+int compareLockstep(char** streams)
+{
+    static timeDecoder singles[NCHANNELS];
+    static multiDecoder multi[(NCHANNELS + MAXCHANNELS - 1) / MAXCHANNELS];
+
+    int groups = (NCHANNELS + MAXCHANNELS - 1) / MAXCHANNELS;
+
+    for (int c = 0; c < NCHANNELS; c++)
+        initDecoder(&singles[c]);
+
+    for (int g = 0; g < groups; g++)
+        initMultiDecoder(&multi[g], g < groups - 1 ? MAXCHANNELS
+                                                   : NCHANNELS - g * MAXCHANNELS);
+
+    for (size_t t = 0; t < STREAMSIZE; t++) {
+        for (int g = 0; g < groups; g++) {
+            char inputs[MAXCHANNELS], status[MAXCHANNELS];
+
+            for (int c = 0; c < multi[g].channels; c++)
+                inputs[c] = streams[g * MAXCHANNELS + c][t];
+
+            updateMultiDecoder(&multi[g], inputs, status);
+
+            for (int c = 0; c < multi[g].channels; c++) {
+                timeDecoder* single = &singles[g * MAXCHANNELS + c];
+                int expected = updateDecoder(single, inputs[c]);
+
+                timeDecoder copy;
+                getChannel(&multi[g], c, &copy);
+
+                if (expected != status[c] || !sameDecoder(single, &copy)) {
+                    printf("channel %d differs at sample %zu\n",
+                           g * MAXCHANNELS + c, t);
+                    return 1;
+                }
+
+                /* leave full channels alone half of the time */
+                if (expected == 3 && rand() % 2) {
+                    keepLastMarker(single);
+                    setChannel(&multi[g], c, single);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+void logSync(int channel, int err, time_t time, int dst, void* context)
+{
+    syncLog* log = (syncLog*) context + channel;
+    (void) dst;
+
+    if (log->count < MAXSYNCS) {
+        log->err[log->count]  = err;
+        log->time[log->count] = time;
+    }
+
+    log->count++;
+}
+
+
+int compareThreaded(char** streams)
+{
+    static syncLog expected[NCHANNELS], actual[NCHANNELS];
+    size_t lengths[NCHANNELS];
+
+    memset(expected, 0, sizeof(expected));
+    memset(actual, 0, sizeof(actual));
+
+    for (int c = 0; c < NCHANNELS; c++) {
+        /* streams of different lengths */
+        lengths[c] = STREAMSIZE - rand() % 2000;
+
+        /* single-channel reference, restarting like radio_clock.c */
+        timeDecoder single;
+        initDecoder(&single);
+
+        for (size_t t = 0; t < lengths[c]; t++) {
+            if (updateDecoder(&single, streams[c][t]) != 3)
+                continue;
+
+            time_t unixTime = 0;
+            int dst = 0;
+            int err = updateTimeAndDate(&single, &unixTime, &dst);
+
+            if (err)
+                initDecoder(&single);
+            else
+                keepLastMarker(&single);
+
+            logSync(c, err, unixTime, dst, expected);
+        }
+    }
+
+    runMultiDecoder((const char* const*) streams, lengths, NCHANNELS, NTHREADS,
+                    logSync, actual);
+
+    int syncs = 0;
+
+    for (int c = 0; c < NCHANNELS; c++) {
+        for (int i = 0; i < expected[c].count && i < MAXSYNCS; i++)
+            syncs += !expected[c].err[i];
+
+        if (memcmp(&expected[c], &actual[c], sizeof(syncLog))) {
+            printf("channel %d: decoded times differ\n", c);
+            return 1;
+        }
+    }
+
+    /* make sure the frames actually decoded */
+    if (syncs < NCHANNELS) {
+        printf("only %d successful syncs\n", syncs);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int main()
+{
+    static char samples[NCHANNELS][STREAMSIZE];
+    char* streams[NCHANNELS];
+
+    srand(1);
+
+    /* sweep from mostly garbage to mostly clean pulses */
+    for (int c = 0; c < NCHANNELS; c++) {
+        generateStream(samples[c], STREAMSIZE, 16 << (c % 9));
+        streams[c] = samples[c];
+    }
+
+    int failed = compareLockstep(streams);
+
+    /* clean frames, with a few channels of garbage mixed in */
+    for (int c = 0; c < NCHANNELS; c++) {
+        if (c % 7)
+            generateFrames(samples[c], STREAMSIZE);
+        else
+            generateStream(samples[c], STREAMSIZE, 64);
+    }
+
+    failed |= compareThreaded(streams);
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
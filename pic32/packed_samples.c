@@ -0,0 +1,145 @@
+#include <limits.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "packed_samples.h"
+
+/******************************************************************************/
+/***************************** Packing helpers ********************************/
+/******************************************************************************/
+
+/* appends bits to a packed buffer one block at a time */
+typedef struct {
+    uint64_t* words;     /* next word to write */
+    uint64_t  current;   /* bits not yet written out */
+    unsigned  fill;      /* number of bits in current */
+    size_t    count;     /* total number of bits appended */
+} bitWriter;
+
+
+static void writeBits(bitWriter* writer, uint64_t bits, unsigned n)
+{
+    /* n is at most 32, so at most one word is completed per call */
+    writer->current |= bits << writer->fill;
+    writer->count   += n;
+
+    if (writer->fill + n >= PACKEDBITS) {
+        *writer->words++ = writer->current;
+        writer->current  = bits >> (PACKEDBITS - writer->fill);
+    }
+
+    writer->fill = (writer->fill + n) % PACKEDBITS;
+}
+
+
+static void writeAscii(bitWriter* writer, const char* ascii, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        if (ascii[i] == '0' || ascii[i] == '1')
+            writeBits(writer, ascii[i] == '1', 1);
+}
+
+
+/******************************************************************************/
+/*************************** Packed decoder helpers ***************************/
+/******************************************************************************/
+
+/* index of the first sample in [pos, end) equal to value, or end */
+static size_t findSample(const uint64_t* words, size_t pos, size_t end,
+                         int value)
+{
+    uint64_t flip = value ? 0 : ~(uint64_t) 0;
+
+    while (pos < end) {
+        unsigned shift = pos % PACKEDBITS;
+        uint64_t bits  = (words[pos / PACKEDBITS] ^ flip) >> shift;
+
+        if (bits) {
+            size_t found = pos + __builtin_ctzll(bits);
+            return found < end ? found : end;
+        }
+
+        pos += PACKEDBITS - shift;
+    }
+
+    return end;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+size_t packSamples(const char* ascii, size_t count, uint64_t* words)
+{
+    bitWriter writer = {words, 0, 0, 0};
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i one  = _mm256_set1_epi8('1');
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*) (ascii + i));
+        __m256i ones  = _mm256_cmpeq_epi8(block, one);
+        __m256i valid = _mm256_or_si256(ones, _mm256_cmpeq_epi8(block, zero));
+
+        /* fall back to scalar packing if the block has line breaks */
+        if ((uint32_t) _mm256_movemask_epi8(valid) == 0xFFFFFFFF)
+            writeBits(&writer, (uint32_t) _mm256_movemask_epi8(ones), 32);
+        else
+            writeAscii(&writer, ascii + i, 32);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i one  = _mm_set1_epi8('1');
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*) (ascii + i));
+        __m128i ones  = _mm_cmpeq_epi8(block, one);
+        __m128i valid = _mm_or_si128(ones, _mm_cmpeq_epi8(block, zero));
+
+        /* fall back to scalar packing if the block has line breaks */
+        if (_mm_movemask_epi8(valid) == 0xFFFF)
+            writeBits(&writer, _mm_movemask_epi8(ones), 16);
+        else
+            writeAscii(&writer, ascii + i, 16);
+    }
+#endif
+
+    writeAscii(&writer, ascii + i, count - i);
+
+    /* flush the partially filled last word */
+    if (writer.fill)
+        *writer.words = writer.current;
+
+    return writer.count;
+}
+
+
+size_t updateDecoderPacked(timeDecoder* decoder, const uint64_t* words,
+                           size_t start, size_t end, int* status)
+{
+    size_t pos = start;
+
+    *status = 0;
+
+    while (pos < end) {
+        int    input = getPackedSample(words, pos);
+        size_t next  = findSample(words, pos + 1, end, !input);
+
+        /* the decoder can stop inside a run, at the end of a pulse */
+        while (pos < next) {
+            size_t length = next - pos < INT_MAX ? next - pos : INT_MAX;
+
+            pos += updateDecoderRun(decoder, input, (int) length, status);
+
+            if (*status)
+                return pos;
+        }
+    }
+
+    return end;
+}
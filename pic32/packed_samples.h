@@ -0,0 +1,70 @@
+#ifndef PACKED_SAMPLES_H_
+#define PACKED_SAMPLES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "time_decoder.h"
+
+#define PACKEDBITS 64    /* Number of samples stored in each packed word */
+
+
+/*
+ * \brief Number of packed words needed to hold a number of samples.
+ */
+static inline size_t packedWords(size_t samples)
+{
+    return (samples + PACKEDBITS - 1) / PACKEDBITS;
+}
+
+
+/*
+ * \brief Read one sample back from a packed buffer.
+ *
+ * \param words Pointer to the packed samples.
+ * \param index Index of the sample to read.
+ *
+ * \returns 0 or 1.
+ */
+static inline int getPackedSample(const uint64_t* words, size_t index)
+{
+    return (words[index / PACKEDBITS] >> (index % PACKEDBITS)) & 1;
+}
+
+
+/*
+ * \brief Pack ASCII samples into bits, sample i goes to bit i % 64 of word i / 64.
+ *
+ * Characters other than '0' and '1' are skipped. Uses SSE2 or AVX2 when the
+ * compiler targets them. Unused bits of the last word are cleared.
+ *
+ * \param ascii Pointer to the ASCII samples.
+ * \param count Number of characters to pack.
+ * \param words Output, must hold packedWords(count) words.
+ *
+ * \returns Number of samples packed.
+ */
+size_t packSamples(const char* ascii, size_t count, uint64_t* words);
+
+
+/*
+ * \brief Update the timeDecoder state machine from a range of packed samples.
+ *
+ * Equivalent to calling updateDecoder() on every sample of the range, but
+ * finds the end of each run of equal samples a word at a time and passes
+ * the run to updateDecoderRun(). Stops early after the first sample for
+ * which updateDecoder() would not have returned 0.
+ *
+ * \param decoder Pointer to timeDecoder to update.
+ * \param words Pointer to the packed samples.
+ * \param start Index of the first sample to decode.
+ * \param end Index one past the last sample to decode.
+ * \param status Stores what updateDecoder() returned for the last sample.
+ *
+ * \returns Index one past the last sample consumed.
+ */
+size_t updateDecoderPacked(timeDecoder* decoder, const uint64_t* words,
+                           size_t start, size_t end, int* status);
+
+
+#endif /* PACKED_SAMPLES_H_ */
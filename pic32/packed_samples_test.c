@@ -0,0 +1,227 @@
+/*
+ * Checks that the packed decoder is bit-identical to updateDecoder().
+ *
+ * Random streams of jittered pulses, glitches and long runs are decoded both
+ * sample by sample and through updateDecoderPacked() in random sized blocks.
+ * Every non-zero status and the full decoder state after every block must
+ * match, including the last pulse and, in a build with -DDECODER_TELEMETRY,
+ * the telemetry counters. A sample file such as signals.txt can be given to
+ * check it as well.
+ *
+ * Build: gcc -std=c99 -O2 -march=native time_decoder.c frame_layout.c \
+ *            civil_time.c packed_samples.c packed_samples_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packed_samples.h"
+
+#define NSTREAMS 200
+#define STREAMSIZE 20000
+
+
+/* restart the same way radio_clock.c does after a full bit buffer */
+void restartDecoder(timeDecoder* decoder)
+{
+    time_t unixTime;
+    int dst;
+    int err = updateTimeAndDate(decoder, &unixTime, &dst);
+
+    if (err)
+        initDecoder(decoder);
+    else
+        keepLastMarker(decoder);
+}
+
+
+int sameDecoder(timeDecoder* a, timeDecoder* b)
+{
+    return a->currentState == b->currentState &&
+           a->foundStart   == b->foundStart   &&
+           a->glitched     == b->glitched     &&
+           a->bitCount     == b->bitCount     &&
+           a->inputCount   == b->inputCount   &&
+           a->zeroCount    == b->zeroCount    &&
+           a->lastPulse    == b->lastPulse    &&
+#ifdef DECODER_TELEMETRY
+           !memcmp(&a->telemetry, &b->telemetry, sizeof(a->telemetry)) &&
+#endif
+           !memcmp(a->bitBuffer, b->bitBuffer, a->bitCount);
+}
+
+
+/* fill samples with pulses of random width, about 5 in errorRange corrupted */
+void generateStream(char* samples, size_t count, int errorRange)
+{
+    static const int lows[] = {2, 5, 8};
+    size_t i = 0;
+
+    while (i < count) {
+        int kind = rand() % errorRange;
+        int low  = lows[rand() % 3] + (kind == 0) * (rand() % 5 - 2);
+        int high = NSAMPLES - low + (kind == 1) * (rand() % 7 - 3);
+
+        /* occasionally emit a long run to exercise the resets */
+        if (kind == 2)
+            low += rand() % 15;
+        if (kind == 3)
+            high += rand() % 15;
+
+        for (int j = 0; j < low && i < count; j++)
+            samples[i++] = 0;
+        for (int j = 0; j < high && i < count; j++)
+            samples[i++] = 1;
+
+        /* single sample glitch */
+        if (kind == 4 && i > 0)
+            samples[i - 1 - rand() % (i < 6 ? i : 6)] ^= 1;
+    }
+}
+
+
+/* pack ASCII samples and check them against a scalar parse, -1 on mismatch */
+long checkPacking(const char* ascii, size_t size, uint64_t* words,
+                  char* samples)
+{
+    size_t count = packSamples(ascii, size, words);
+    size_t n = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        if (ascii[i] != '0' && ascii[i] != '1')
+            continue;
+
+        samples[n] = ascii[i] - '0';
+
+        if (n >= count || getPackedSample(words, n) != samples[n])
+            return -1;
+
+        n++;
+    }
+
+    return n == count ? (long) count : -1;
+}
+
+
+/* decode samples both ways, returns the number of mismatches */
+int compareStream(const char* samples, size_t count, const uint64_t* words)
+{
+    timeDecoder scalar, packed;
+    initDecoder(&scalar);
+    initDecoder(&packed);
+    clearDecoderTelemetry(&scalar);
+    clearDecoderTelemetry(&packed);
+
+    size_t pos = 0;
+    size_t checked = 0;
+
+    while (pos < count) {
+        size_t end = pos + 1 + rand() % 300;
+        if (end > count)
+            end = count;
+
+        int status;
+        size_t next = updateDecoderPacked(&packed, words, pos, end, &status);
+
+        /* every sample the packed decoder skipped must have returned 0 */
+        for (; checked < next; checked++) {
+            int expected = updateDecoder(&scalar, samples[checked]);
+
+            if (expected != (checked + 1 == next ? status : 0)) {
+                printf("status mismatch at sample %zu: %d != %d\n",
+                       checked, expected, status);
+                return 1;
+            }
+        }
+
+        if (!sameDecoder(&scalar, &packed)) {
+            printf("state mismatch after sample %zu\n", next);
+            return 1;
+        }
+
+        if (status == 3) {
+            restartDecoder(&scalar);
+            restartDecoder(&packed);
+        }
+
+        pos = next;
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    static char     ascii[STREAMSIZE + STREAMSIZE / 61];
+    static char     samples[STREAMSIZE];
+    static uint64_t words[STREAMSIZE / PACKEDBITS + 1];
+
+    int failures = 0;
+    srand(1);
+
+    for (int n = 0; n < NSTREAMS; n++) {
+        /* sweep from mostly garbage to mostly clean pulses */
+        generateStream(samples, STREAMSIZE, 16 << (n % 9));
+
+        /* write as ASCII, with line breaks in every other stream */
+        size_t size = 0;
+        for (size_t i = 0; i < STREAMSIZE; i++) {
+            if (n % 2 && i % 60 == 59)
+                ascii[size++] = '\n';
+            ascii[size++] = '0' + samples[i];
+        }
+
+        long count = checkPacking(ascii, size, words, samples);
+
+        if (count != STREAMSIZE) {
+            printf("stream %d: packed samples do not match\n", n);
+            failures++;
+            continue;
+        }
+
+        failures += compareStream(samples, count, words);
+    }
+
+    /* optionally check a sample file as well */
+    if (argc > 1) {
+        FILE* file = fopen(argv[1], "rb");
+        if (!file) {
+            perror(argv[1]);
+            return 1;
+        }
+
+        fseek(file, 0, SEEK_END);
+        size_t size = ftell(file);
+        rewind(file);
+
+        char*     fileAscii   = malloc(size);
+        char*     fileSamples = malloc(size);
+        uint64_t* fileWords   = malloc(packedWords(size) * sizeof(uint64_t));
+
+        size = fread(fileAscii, 1, size, file);
+        fclose(file);
+
+        long count = checkPacking(fileAscii, size, fileWords, fileSamples);
+
+        if (count < 0) {
+            printf("%s: packed samples do not match\n", argv[1]);
+            failures++;
+        } else {
+            failures += compareStream(fileSamples, count, fileWords);
+        }
+
+        free(fileAscii);
+        free(fileSamples);
+        free(fileWords);
+    }
+
+    if (failures) {
+        printf("FAIL: %d mismatching streams\n", failures);
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
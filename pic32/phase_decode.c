@@ -0,0 +1,180 @@
+/*
+ * Decodes the phase-modulated time code from baseband I/Q recordings.
+ *
+ * Usage: phase_decode recording.iq
+ *        phase_decode [-s snr] -g "YYYY-MM-DD HH:MM" minutes recording.iq
+ *
+ * A recording is IQSAMPLES samples per second of the downconverted carrier,
+ * each a little-endian 16 bit I and Q, interleaved. The first form prints
+ * the time and DST flag of every decoded frame, at the end of the frame,
+ * and a report of samples/s and frames to stderr. The second form writes a
+ * simulated recording of the minutes from a UTC time, starting 10 seconds
+ * into the first one at a random carrier phase, with noise at an SNR in dB
+ * of the full carrier to a sample, none by default.
+ *
+ * Build: gcc -std=c99 -O2 frame_layout.c civil_time.c wwvb_signal.c \
+ *            phase_decoder.c phase_signal.c test_support.c \
+ *            phase_decode.c -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civil_time.h"
+#include "phase_signal.h"
+#include "test_support.h"
+
+#define BLOCKSAMPLES 65536    /* samples read or written at a time */
+#define STARTOFFSET 10.0      /* seconds into the first minute recorded */
+
+
+/* UTC time of a "YYYY-MM-DD HH:MM" string, 0 on success */
+static int parseMinute(const char* text, time_t* time)
+{
+    int year, month, day, hour, minute;
+
+    if (sscanf(text, "%d-%d-%d%*c%d:%d", &year, &month, &day, &hour,
+               &minute) != 5)
+        return 1;
+
+    *time = (time_t) daysFromCivil(year, month, day) * SECONDSPERDAY
+          + hour * 3600L + minute * 60L;
+    return 0;
+}
+
+
+static int generate(time_t start, long minutes, double snr, const char* path)
+{
+    static iqSample block[BLOCKSAMPLES];
+
+    FILE* out = fopen(path, "wb");
+
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+
+    phaseSource source;
+    initPhaseSource(&source, start, STARTOFFSET, snr, 0, (uint64_t) start);
+
+    long total = minutes * 60 * IQSAMPLES;
+    int err = 0;
+
+    for (long done = 0; !err && done < total; done += BLOCKSAMPLES) {
+        long count = total - done < BLOCKSAMPLES ? total - done : BLOCKSAMPLES;
+
+        for (long i = 0; i < count; i++)
+            block[i] = phaseSourceSample(&source);
+
+        err = fwrite(block, sizeof(iqSample), count, out) != (size_t) count;
+    }
+
+    if (fclose(out) || err) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static int decode(const char* path)
+{
+    static iqSample block[BLOCKSAMPLES];
+
+    FILE* in = fopen(path, "rb");
+
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+
+    phaseDecoder decoder;
+    initPhaseDecoder(&decoder);
+
+    unsigned long long samples = 0;
+    long frames = 0, errors = 0;
+    size_t count;
+    double begin = now();
+
+    while ((count = fread(block, sizeof(iqSample), BLOCKSAMPLES, in)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (updatePhaseDecoder(&decoder, block[i]) != 3)
+                continue;
+
+            time_t time;
+            int dst;
+
+            if (decodePhaseFrame(&decoder, &time, &dst)) {
+                errors++;
+                continue;
+            }
+
+            struct tm civil;
+            civilFromTime(time, &civil);
+
+            printf("%04d-%02d-%02d %02d:%02d:%02d DST %d\n",
+                   civil.tm_year + 1900, civil.tm_mon + 1, civil.tm_mday,
+                   civil.tm_hour, civil.tm_min, civil.tm_sec, dst);
+            frames++;
+        }
+
+        samples += count;
+    }
+
+    double elapsed = now() - begin;
+    int err = ferror(in);
+    fclose(in);
+
+    if (err) {
+        fprintf(stderr, "%s: read failed\n", path);
+        return 1;
+    }
+
+    /* guard against a zero interval on tiny recordings */
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "samples: %llu (%.3g samples/s, %.0fx real time)\n",
+            samples, samples / elapsed, samples / (double) IQSAMPLES / elapsed);
+    fprintf(stderr, "frames:  %ld, rejected: %ld\n", frames, errors);
+
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    double snr = INFINITY;
+    time_t start = 0;
+    long minutes = 0;
+    int generating = 0;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc)
+            snr = atof(argv[++arg]);
+        else if (strcmp(argv[arg], "-g") == 0 && arg + 2 < argc &&
+                 !parseMinute(argv[arg + 1], &start)) {
+            minutes = atol(argv[arg + 2]);
+            generating = 1;
+            arg += 2;
+        } else
+            break;
+    }
+
+    if (argc - arg != 1 || (generating && minutes < 1)) {
+        fprintf(stderr, "usage: %s recording.iq\n"
+                "       %s [-s snr] -g \"YYYY-MM-DD HH:MM\" minutes "
+                "recording.iq\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    if (generating)
+        return generate(start, minutes, snr, argv[arg]);
+
+    return decode(argv[arg]);
+}
@@ -0,0 +1,415 @@
+#include <math.h>
+
+#include "phase_decoder.h"
+
+/* second each position of the minute code is sent in, from position 1 */
+static const uint8_t codeSeconds[CODELENGTH + 1] = {
+     0, 17, 16, 19, 15, 45, 44, 43, 14, 42, 41, 40, 38, 37, 36, 35,
+    13, 34, 33, 32, 31, 30, 28, 27, 26, 25, 24, 23, 22, 21, 20, 18
+};
+
+/* seconds of dst_ls[4] to dst_ls[0] */
+static const uint8_t dstSeconds[5] = {46, 47, 50, 51, 52};
+
+/* dst_ls of each DST status without a leap second, DSTOFF to DSTON */
+static const uint8_t dstCodes[4] = {0x08, 0x15, 0x16, 0x03};
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* xor of the positions of the set bits, 0 for a valid codeword */
+static unsigned codeSyndrome(uint32_t code)
+{
+    unsigned syndrome = 0;
+
+    for (unsigned k = 1; k <= CODELENGTH; k++)
+        if (code >> k & 1)
+            syndrome ^= k;
+
+    return syndrome;
+}
+
+
+/* minute code from the seconds it was sent in */
+static uint32_t frameCode(uint64_t frame)
+{
+    uint32_t code = 0;
+
+    for (int k = 1; k <= CODELENGTH; k++)
+        code |= (uint32_t) (frame >> codeSeconds[k] & 1) << k;
+
+    return code;
+}
+
+
+/* bits of the frame dst_ls sets for a DST status */
+static uint64_t dstFrameBits(int dst)
+{
+    uint64_t bits = 0;
+
+    for (int k = 0; k < 5; k++)
+        bits |= (uint64_t) (dstCodes[dst] >> (4 - k) & 1) << dstSeconds[k];
+
+    return bits;
+}
+
+
+/* carrier phase up to 180 degrees, kept on the side of the last one */
+static void updateReference(phaseDecoder* decoder)
+{
+    double x = (double) decoder->carrierI;
+    double y = (double) decoder->carrierQ;
+    double length = sqrt(x * x + y * y);
+
+    if (length == 0)
+        return;
+
+    /* half the angle of the squared carrier */
+    double u = 1 + x / length;
+    double v = y / length;
+    double half = sqrt(u * u + v * v);
+
+    if (half == 0) {
+        u = 0;
+        v = 1;
+    } else {
+        u /= half;
+        v /= half;
+    }
+
+    if (u * decoder->referenceI + v * decoder->referenceQ < 0) {
+        u = -u;
+        v = -v;
+    }
+
+    decoder->referenceI = u;
+    decoder->referenceQ = v;
+}
+
+
+/* drop of the average power from the slots before a slot to the ones after */
+static int64_t powerDrop(const phaseDecoder* decoder, int slot)
+{
+    int64_t drop = 0;
+
+    for (int k = 0; k < EDGESLOTS; k++)
+        drop += decoder->power[(slot + IQSAMPLES - 1 - k) % IQSAMPLES]
+              - decoder->power[(slot + k) % IQSAMPLES];
+
+    return drop;
+}
+
+
+/*
+ * move the second boundary to the largest drop in power, 0 if the second
+ * ends here, 1 if it ends a little later and 2 if the bits were dropped
+ */
+static int updateBoundary(phaseDecoder* decoder)
+{
+    const int64_t* power = decoder->power;
+    int64_t current = powerDrop(decoder, decoder->phase);
+    int64_t drop = powerDrop(decoder, 0), largest = current;
+    int best = decoder->phase;
+
+    /* slide the drop a slot at a time, a slot moves from after to before */
+    for (int p = 0; p < IQSAMPLES; p++) {
+        if (drop > largest) {
+            largest = drop;
+            best = p;
+        }
+
+        drop += 2 * power[p] - power[(p + IQSAMPLES - EDGESLOTS) % IQSAMPLES]
+              - power[(p + EDGESLOTS) % IQSAMPLES];
+    }
+
+    /* slots the boundary moves by, to the nearer side */
+    int move = (best - decoder->phase + IQSAMPLES) % IQSAMPLES;
+
+    if (move > IQSAMPLES / 2)
+        move -= IQSAMPLES;
+
+    /* the bits stay whole if the boundary only moves a little */
+    if (move >= -BOUNDARYSTEP && move <= BOUNDARYSTEP) {
+        decoder->phase = best;
+        return move > 0;
+    }
+
+    if (largest * 8 <= current * (8 + PHASEHYSTERESIS))
+        return 0;
+
+    decoder->phase = best;
+    decoder->symbolCount = 0;
+    return 2;
+}
+
+
+/* check that the second sums are stronger than noise would make them */
+static int carrierPresent(const phaseDecoder* decoder)
+{
+    int64_t noise = 0;
+
+    /* |sum|^2 of IQSAMPLES samples of noise is their total power, which
+     * the blocks count POWERBLOCK times */
+    for (int p = 0; p < IQSAMPLES; p++)
+        noise += decoder->power[p];
+
+    return decoder->symbolPower * EDGEDECAY * POWERBLOCK >=
+           SIGNALGAIN * noise * PHASEDECAY;
+}
+
+
+/* soft value of bit i of the last two frames, 0 is the oldest */
+static double frameSymbol(const phaseDecoder* decoder, int i)
+{
+    return decoder->symbols[(decoder->symbolHead + i) % PHASERING];
+}
+
+
+/* check that fewer than WEAKBITS code bits of a frame are less sure */
+static int isWeakBit(const phaseDecoder* decoder, int first, int bit)
+{
+    double confidence = fabs(frameSymbol(decoder, first + bit));
+    int surer = 0;
+
+    for (int k = 1; k <= CODELENGTH; k++)
+        surer += fabs(frameSymbol(decoder, first + codeSeconds[k])) <
+                 confidence;
+
+    return surer < WEAKBITS;
+}
+
+
+/* hard bits of the frame from a soft bit on, as received */
+static uint64_t hardBits(const phaseDecoder* decoder, int first)
+{
+    uint64_t bits = 0;
+
+    for (int i = 0; i < FRAMESIZE; i++)
+        bits |= (uint64_t) (frameSymbol(decoder, first + i) < 0) << i;
+
+    return bits;
+}
+
+
+/* hard bits of the last frame the way up the sync word says, 1 if no sync */
+static int frameBits(const phaseDecoder* decoder, uint64_t* frame,
+                     uint64_t* flip)
+{
+    if (decoder->symbolCount < FRAMESIZE || !carrierPresent(decoder))
+        return 1;
+
+    uint64_t bits = hardBits(decoder, FRAMESIZE);
+    int errors = __builtin_popcountll((bits ^ SYNCBITS) & SYNCMASK);
+
+    if (errors >= SYNCLENGTH - MAXSYNCERRORS)
+        *flip = (1ULL << FRAMESIZE) - 1;
+    else if (errors <= MAXSYNCERRORS)
+        *flip = 0;
+    else
+        return 1;
+
+    *frame = bits ^ *flip;
+    return 0;
+}
+
+
+/* start and DST of a frame, 1 if it does not decode */
+static int frameMinute(const phaseDecoder* decoder, int first, uint64_t frame,
+                       time_t* minute, int* dst)
+{
+    if (decodePhaseBits(frame, minute, dst))
+        return 1;
+
+    /* the bit that was corrected, if any */
+    uint32_t minutes;
+    int fixed = decodeMinuteCode(frameCode(frame), &minutes);
+
+    return fixed && !isWeakBit(decoder, first, codeSeconds[fixed]);
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initPhaseDecoder(phaseDecoder* decoder)
+{
+    for (int i = 0; i < IQSAMPLES; i++) {
+        decoder->window[i].i = 0;
+        decoder->window[i].q = 0;
+        decoder->power[i]    = 0;
+    }
+
+    decoder->sumI        = 0;
+    decoder->sumQ        = 0;
+    decoder->blockI      = 0;
+    decoder->blockQ      = 0;
+    decoder->slot        = 0;
+    decoder->sampleCount = 0;
+    decoder->phase       = 0;
+    decoder->symbolPower = 0;
+    decoder->carrierI    = 0;
+    decoder->carrierQ    = 0;
+    decoder->referenceI  = 1;
+    decoder->referenceQ  = 0;
+    decoder->symbolHead  = 0;
+    decoder->symbolCount = 0;
+}
+
+
+int updatePhaseDecoder(phaseDecoder* decoder, iqSample sample)
+{
+    int slot = decoder->slot;
+    iqSample* oldest  = &decoder->window[slot];
+    iqSample* leaving = &decoder->window[(slot + IQSAMPLES - POWERBLOCK) %
+                                         IQSAMPLES];
+
+    decoder->blockI += sample.i - leaving->i;
+    decoder->blockQ += sample.q - leaving->q;
+    decoder->sumI += sample.i - oldest->i;
+    decoder->sumQ += sample.q - oldest->q;
+    *oldest = sample;
+
+    /* the power of a block is kept at the slot of its middle */
+    int64_t* power = &decoder->power[(slot + IQSAMPLES - POWERBLOCK / 2) %
+                                     IQSAMPLES];
+    int64_t blockI = decoder->blockI, blockQ = decoder->blockQ;
+
+    *power += blockI * blockI + blockQ * blockQ - *power / EDGEDECAY;
+
+    decoder->slot = decoder->slot + 1 == IQSAMPLES ? 0 : decoder->slot + 1;
+    decoder->sampleCount++;
+
+    if (decoder->sampleCount < IQSAMPLES)
+        return 0;
+
+    /* the window holds a whole second once the next sample starts one */
+    if (decoder->slot != decoder->phase)
+        return 0;
+
+    int moved = updateBoundary(decoder);
+
+    if (moved)
+        return moved == 2 ? 2 : 0;
+
+    int64_t sumI = decoder->sumI, sumQ = decoder->sumQ;
+
+    decoder->symbolPower += sumI * sumI + sumQ * sumQ
+                          - decoder->symbolPower / PHASEDECAY;
+
+    /* squaring takes out the 180 degree steps of the modulation */
+    decoder->carrierI += sumI * sumI - sumQ * sumQ
+                       - decoder->carrierI / PHASEDECAY;
+    decoder->carrierQ += 2 * sumI * sumQ - decoder->carrierQ / PHASEDECAY;
+    updateReference(decoder);
+
+    decoder->symbols[decoder->symbolHead] = sumI * decoder->referenceI +
+                                            sumQ * decoder->referenceQ;
+    decoder->symbolHead = (decoder->symbolHead + 1) % PHASERING;
+
+    if (decoder->symbolCount < PHASERING)
+        decoder->symbolCount++;
+
+    uint64_t frame, flip;
+    return frameBits(decoder, &frame, &flip) ? 1 : 3;
+}
+
+
+int decodePhaseFrame(const phaseDecoder* decoder, time_t* currentTime,
+                     int* dst)
+{
+    uint64_t frame, flip;
+    time_t minute, before;
+    int dstBefore;
+
+    if (frameBits(decoder, &frame, &flip) ||
+        frameMinute(decoder, FRAMESIZE, frame, &minute, dst))
+        return 1;
+
+    /* sync_T also matches some shifts of a frame, whose minute code then
+     * decodes to some minute, but not to one after the frame before */
+    if (decoder->symbolCount < PHASERING ||
+        frameMinute(decoder, 0, hardBits(decoder, 0) ^ flip, &before,
+                    &dstBefore) || before != minute - 60)
+        return 1;
+
+    /* the frame ended with the last bit */
+    *currentTime = minute + 60;
+    return 0;
+}
+
+
+uint64_t encodePhaseFrame(time_t minute, int dst)
+{
+    uint32_t code  = encodeMinuteCode((uint32_t) ((minute - PHASEEPOCH) / 60));
+    uint64_t frame = SYNCBITS;
+
+    for (int k = 1; k <= CODELENGTH; k++)
+        frame |= (uint64_t) (code >> k & 1) << codeSeconds[k];
+
+    return frame | dstFrameBits(dst);
+}
+
+
+int decodePhaseBits(uint64_t frame, time_t* minute, int* dst)
+{
+    uint32_t minutes;
+    decodeMinuteCode(frameCode(frame), &minutes);
+
+    int status = DSTOFF;
+
+    while (status <= DSTON && (frame & DSTLSMASK) != dstFrameBits(status))
+        status++;
+
+    if (minutes >= PHASEMINUTES || status > DSTON)
+        return 1;
+
+    *minute = PHASEEPOCH + (time_t) minutes * 60;
+    *dst = status;
+
+    return 0;
+}
+
+
+uint32_t encodeMinuteCode(uint32_t minutes)
+{
+    uint32_t code = 0;
+
+    /* data bits in the positions that are not a power of 2 */
+    for (unsigned k = 3, bit = 0; k <= CODELENGTH; k++) {
+        if (!(k & (k - 1)))
+            continue;
+
+        code |= (uint32_t) (minutes >> bit++ & 1) << k;
+    }
+
+    /* each parity bit clears its bit of the syndrome */
+    unsigned syndrome = codeSyndrome(code);
+
+    for (unsigned j = 0; j < 5; j++)
+        code |= (uint32_t) (syndrome >> j & 1) << (1 << j);
+
+    return code;
+}
+
+
+int decodeMinuteCode(uint32_t code, uint32_t* minutes)
+{
+    /* the syndrome of one wrong bit is its position */
+    unsigned syndrome = codeSyndrome(code);
+    code ^= (uint32_t) 1 << syndrome;
+
+    uint32_t value = 0;
+
+    for (unsigned k = 3, bit = 0; k <= CODELENGTH; k++) {
+        if (!(k & (k - 1)))
+            continue;
+
+        value |= (uint32_t) (code >> k & 1) << bit++;
+    }
+
+    *minutes = value;
+    return (int) syndrome;
+}
@@ -0,0 +1,197 @@
+#ifndef PHASE_DECODER_H_
+#define PHASE_DECODER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "frame_layout.h"
+#include "time_decoder.h"
+
+#define IQSAMPLES 1000            /* I/Q samples per second, at baseband */
+#define PHASEEPOCH 946684800      /* 2000-01-01 00:00 UTC, minute 0 */
+#define PHASEMINUTES 52596000UL   /* minutes from 2000 to 2100 */
+
+/*
+ * Layout of the phase-modulated frame of the enhanced WWVB broadcast, one
+ * bit per second, bit i of the packed frame sent in second i. A 1 inverts
+ * the carrier for the whole second. The frame starts with the 13 bit sync
+ * word sync_T, sent most significant bit first, and seconds 29, 39, 49 and
+ * 59 are always 0. The 26 bit minute of the century is spread over seconds
+ * 18 to 45, with the 5 parity bits of a (31,26) Hamming code that corrects
+ * one bit error in seconds 13 to 17. Seconds 46 and 47 and 50 to 52 are
+ * dst_ls, a 5 bit code of the DST status and of a pending leap second.
+ * Second 48, the notice of the extended frames, and seconds 53 to 58, the
+ * date of the next DST change, are not decoded.
+ */
+#define SYNCMASK    0x0802008020001FFFULL    /* bits of sync_T and the 0s */
+#define SYNCBITS    0x00000000000002DCULL    /* their values */
+#define SYNCLENGTH  17                       /* bits in SYNCMASK */
+#define DSTLSMASK   0x001CC00000000000ULL    /* bits of dst_ls */
+#define CODELENGTH  31                       /* bits of the minute code */
+#define PHASERING   (2 * FRAMESIZE)          /* soft bits kept, two frames */
+
+#define PHASEDECAY 8          /* time constant of the carrier, in seconds */
+#define EDGEDECAY 64          /* time constant of the power per slot */
+#define POWERBLOCK (IQSAMPLES / 100)    /* samples summed for power, 10 ms */
+#define EDGESLOTS (IQSAMPLES / 5)    /* slots of full and low carrier */
+#define PHASEHYSTERESIS 2     /* power drop lead in eighths to move the boundary */
+#define BOUNDARYSTEP (IQSAMPLES / 20)    /* moves that keep the bits, 50 ms */
+#define MAXSYNCERRORS 2       /* sync bits that may be wrong in a frame */
+#define SIGNALGAIN 2          /* second sums over the power noise gives them */
+#define WEAKBITS 4            /* least confident code bits a fix may be in */
+
+
+/* one baseband sample of the carrier */
+typedef struct {
+    int16_t i;
+    int16_t q;
+} iqSample;
+
+
+/*
+ * Decoder of the phase-modulated time code from baseband I/Q samples of
+ * unknown carrier phase and sample timing. The second boundary is where the
+ * average power drops the most, from the last 200 ms of a second, which
+ * always have the full carrier, to the first 200 ms, which always have the
+ * pulse of the amplitude code. The power is that of the sums of POWERBLOCK
+ * samples, over which the carrier barely turns, so the noise adds less to
+ * it than to the power of single samples. Every second of samples is
+ * summed in a sliding window, and the carrier phase comes from the
+ * average square of the sums at the boundary, which the modulation does
+ * not change. The 180 degree ambiguity left over is resolved by the sign
+ * of the sync word. Noise alone sums to SIGNALGAIN times less power than a
+ * carrier, so frames are only looked for above that.
+ */
+typedef struct {
+    iqSample window[IQSAMPLES];     /* last second of samples */
+    int32_t  sumI;                  /* sum of the window */
+    int32_t  sumQ;
+    int32_t  blockI;                /* sum of the last POWERBLOCK samples */
+    int32_t  blockQ;
+    int      slot;                  /* slot of the next sample in window */
+    long     sampleCount;           /* samples seen since initialization */
+
+    int64_t  power[IQSAMPLES];      /* decaying power of the blocks per slot */
+    int      phase;                 /* slot of the first sample of a second */
+
+    int64_t  symbolPower;           /* decaying |sum|^2 at the boundary */
+    int64_t  carrierI;              /* decaying square of the symbol sums */
+    int64_t  carrierQ;
+    double   referenceI;            /* carrier phase up to 180 degrees */
+    double   referenceQ;
+
+    double   symbols[PHASERING];    /* ring of soft bits, carrier removed */
+    int      symbolHead;            /* slot of the next soft bit */
+    int      symbolCount;           /* soft bits in the ring */
+} phaseDecoder;
+
+
+/*
+ * \brief Initialize a phaseDecoder.
+ *
+ * \param decoder Pointer to phaseDecoder to initialize.
+ */
+void initPhaseDecoder(phaseDecoder* decoder);
+
+
+/*
+ * \brief Update the phaseDecoder with one baseband sample.
+ *
+ * \param decoder Pointer to phaseDecoder to update.
+ * \param sample I/Q sample of the carrier.
+ *
+ * \returns
+ *     0: No new bit.
+ *     1: A new bit was received.
+ *     2: The second boundary moved by more than BOUNDARYSTEP and the
+ *        received bits were dropped.
+ *     3: A new bit was received and the last FRAMESIZE bits start with
+ *        the sync word, ready for decodePhaseFrame().
+ */
+int updatePhaseDecoder(phaseDecoder* decoder, iqSample sample);
+
+
+/*
+ * \brief Decode the last two frames of received bits.
+ *
+ * Both frames have to decode, to consecutive minutes, as sync_T alone
+ * also matches some shifts of the frames. The sync word is only checked
+ * in the last frame, and sets which way up both are. A wrong bit of a codeword is
+ * only corrected if it was one of the WEAKBITS bits received with the
+ * least confidence, which turns most of the wrong corrections of two or
+ * more wrong bits into a rejected frame.
+ *
+ * \param decoder Pointer to phaseDecoder.
+ * \param currentTime Stores the time at the end of the frame, as
+ *        updateTimeAndDate() does.
+ * \param dst Stores the DST status of the frame, DSTOFF to DSTON, as
+ *        updateTimeAndDate() does.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Error(s) in time signal.
+ */
+int decodePhaseFrame(const phaseDecoder* decoder, time_t* currentTime,
+                     int* dst);
+
+
+/*
+ * \brief Encode the phase-modulated frame transmitted during one minute.
+ *
+ * No leap second is announced, and the notice and the date of the next DST
+ * change are sent as 0.
+ *
+ * \param minute UTC time of the start of the minute, from 2000 to 2099.
+ * \param dst DST status of the minute, DSTOFF to DSTON.
+ *
+ * \returns Packed bits of the frame, bit i sent in second i.
+ */
+uint64_t encodePhaseFrame(time_t minute, int dst);
+
+
+/*
+ * \brief Decode a packed phase-modulated frame.
+ *
+ * Sync bits are not checked. One wrong bit of the codeword is corrected.
+ *
+ * \param frame Packed bits of the frame.
+ * \param minute Stores the UTC time of the start of the frame.
+ * \param dst Stores the DST status of the frame, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Frame is successfully decoded
+ *     1: The minute is out of range, or dst_ls is not the code of a DST
+ *        status without a leap second.
+ */
+int decodePhaseBits(uint64_t frame, time_t* minute, int* dst);
+
+
+/*
+ * \brief Hamming codeword of a minute of the century.
+ *
+ * Bit k of the codeword is position k of the code, from 1 to CODELENGTH:
+ * powers of 2 are the parity bits, time_par[0] to time_par[4], and the 26
+ * data bits fill the rest, least significant first.
+ *
+ * \param minutes Minutes since PHASEEPOCH, less than 2^26.
+ *
+ * \returns The codeword, bit 0 clear.
+ */
+uint32_t encodeMinuteCode(uint32_t minutes);
+
+
+/*
+ * \brief Correct and decode a Hamming codeword.
+ *
+ * The code is perfect, so every word is taken as a codeword with at most
+ * one wrong bit, and two or more wrong bits decode to a wrong minute.
+ *
+ * \param code The received codeword, bit 0 ignored.
+ * \param minutes Stores the minutes since PHASEEPOCH.
+ *
+ * \returns Position of the bit that was corrected, 0 if none was.
+ */
+int decodeMinuteCode(uint32_t code, uint32_t* minutes);
+
+
+#endif /* PHASE_DECODER_H_ */
@@ -0,0 +1,284 @@
+/*
+ * Compares the phase-modulated time code with the amplitude code on the
+ * same noisy baseband signal, and times both decoders.
+ *
+ * Usage: phase_decoder_bench [trials]
+ *
+ * Every trial starts at a random minute, a random time within it and a
+ * random carrier phase and frequency offset. The phaseDecoder gets the I/Q
+ * samples, and updateDecoder() the output of an envelope detector, 1 where
+ * the envelope averaged over the IQREADS I/Q samples of a receiver sample
+ * is above RECEIVERTHRESHOLD. Both run until each reports a
+ * time within a second of the truth, or MAXSECONDS have passed. Median and
+ * 99th percentile times to the first correct sync are printed per SNR,
+ * along with the number of decoded times that were wrong, and then the
+ * samples per second each decoder gets through on this machine. Fails if
+ * either decoder misses a sync or gets a time wrong on the clean signal.
+ *
+ * Build: gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c phase_decoder.c phase_signal.c \
+ *            test_support.c phase_decoder_bench.c -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "channel_model.h"
+#include "phase_signal.h"
+#include "test_support.h"
+
+#define MAXSECONDS 1200    /* give up on a trial after 20 minutes */
+#define NEVER (MAXSECONDS + 1)
+#define BENCHMINUTES 60    /* minutes of samples timed */
+#define MINTIME 0.5        /* seconds each decoder is timed for at least */
+#define MAXOFFSET 0.002    /* largest carrier offset, Hz */
+#define IQREADS (IQSAMPLES / NSAMPLES)    /* I/Q samples per receiver sample */
+
+#if IQSAMPLES % NSAMPLES
+#error "a receiver sample has to be a whole number of I/Q samples"
+#endif
+
+
+/* seconds to the first correct sync of each decoder, and wrong syncs */
+typedef struct {
+    int* amplitude;
+    int* phase;
+    int  amplitudeWrong;
+    int  phaseWrong;
+} benchResult;
+
+
+/* envelope of a sample, IQFULLSCALE for the full carrier */
+static double envelope(iqSample sample)
+{
+    return sqrt((double) sample.i * sample.i + (double) sample.q * sample.q);
+}
+
+
+/* receiver output of the amplitude code, from the envelopes of a sample */
+static int receiverOutput(double envelopes)
+{
+    return envelopes > RECEIVERTHRESHOLD * IQFULLSCALE * IQREADS;
+}
+
+
+/* restart after a full buffer, the same way batch_decoder.c does */
+static int stepAmplitude(timeDecoder* decoder, int input, time_t* time)
+{
+    if (updateDecoder(decoder, input) != 3)
+        return 0;
+
+    int dst;
+    int err = updateTimeAndDate(decoder, time, &dst);
+
+    if (err)
+        initDecoder(decoder);
+    else
+        keepLastMarker(decoder);
+
+    return !err;
+}
+
+
+static int stepPhase(phaseDecoder* decoder, iqSample sample, time_t* time)
+{
+    int dst;
+
+    if (updatePhaseDecoder(decoder, sample) != 3)
+        return 0;
+
+    return !decodePhaseFrame(decoder, time, &dst);
+}
+
+
+static void runTrial(double snr, benchResult* result, int trial, int seed)
+{
+    time_t minute = PHASEEPOCH + (time_t) (rand() % 1000000) * 60;
+    double offset = 60.0 * rand() / RAND_MAX;
+    double frequency = MAXOFFSET * (2.0 * rand() / RAND_MAX - 1);
+
+    phaseSource source;
+    initPhaseSource(&source, minute, offset, snr, frequency, seed);
+
+    timeDecoder amplitude;
+    phaseDecoder phase;
+    initDecoder(&amplitude);
+    initPhaseDecoder(&phase);
+
+    int amplitudeTime = NEVER, phaseTime = NEVER;
+    double envelopes = 0;
+
+    for (long i = 0; i < MAXSECONDS * IQSAMPLES; i++) {
+        iqSample sample = phaseSourceSample(&source);
+        time_t truth = phaseSourceTime(&source);
+        time_t time;
+
+        /* a receiver sample is over every IQREADS I/Q samples */
+        envelopes += envelope(sample);
+
+        if ((i + 1) % IQREADS == 0) {
+            int input = receiverOutput(envelopes);
+            envelopes = 0;
+
+            if (amplitudeTime == NEVER &&
+                stepAmplitude(&amplitude, input, &time)) {
+                if (labs((long) (time - truth)) <= 1)
+                    amplitudeTime = i / IQSAMPLES;
+                else
+                    result->amplitudeWrong++;
+            }
+        }
+
+        if (phaseTime == NEVER && stepPhase(&phase, sample, &time)) {
+            if (labs((long) (time - truth)) <= 1)
+                phaseTime = i / IQSAMPLES;
+            else
+                result->phaseWrong++;
+        }
+
+        if (amplitudeTime != NEVER && phaseTime != NEVER)
+            break;
+    }
+
+    result->amplitude[trial] = amplitudeTime;
+    result->phase[trial]     = phaseTime;
+}
+
+
+/* returns the number of trials that synced */
+static int printTimes(const char* name, int* times, int trials, int wrong)
+{
+    qsort(times, trials, sizeof(int), compareInts);
+
+    int synced = 0;
+    for (int i = 0; i < trials; i++)
+        synced += times[i] != NEVER;
+
+    int median = times[trials / 2];
+    int p99    = times[(99 * trials) / 100];
+
+    printf("  %-9s %4d/%-4d", name, synced, trials);
+
+    if (median == NEVER)
+        printf("  %8s", "never");
+    else
+        printf("  %7ds", median);
+
+    if (p99 == NEVER)
+        printf("  %8s", "never");
+    else
+        printf("  %7ds", p99);
+
+    printf("  %5d\n", wrong);
+
+    return synced;
+}
+
+
+/* samples per second of both decoders on an hour of a clean signal */
+static void timeDecoders()
+{
+    long count = BENCHMINUTES * 60L * IQSAMPLES;
+    long inputs = count / IQREADS;
+    iqSample* samples = malloc(count * sizeof(iqSample));
+    double* envelopes = calloc(inputs, sizeof(double));
+    char* levels = malloc(inputs);
+
+    phaseSource source;
+    initPhaseSource(&source, PHASEEPOCH, 0, INFINITY, 0, 1);
+
+    for (long i = 0; i < count; i++) {
+        samples[i] = phaseSourceSample(&source);
+        envelopes[i / IQREADS] += envelope(samples[i]);
+    }
+
+    for (long i = 0; i < inputs; i++)
+        levels[i] = receiverOutput(envelopes[i]);
+
+    double elapsed = 0, start = now();
+    long passes = 0, syncs = 0;
+    time_t time;
+
+    for (; elapsed < MINTIME; passes++, elapsed = now() - start) {
+        timeDecoder decoder;
+        initDecoder(&decoder);
+
+        for (long i = 0; i < inputs; i++)
+            syncs += stepAmplitude(&decoder, levels[i], &time);
+    }
+
+    printf("  %-9s %8.3g samples/s  %6.0fx real time\n", "amplitude",
+           passes * inputs / elapsed, passes * inputs / NSAMPLES / elapsed);
+
+    elapsed = 0;
+    start = now();
+    long amplitudeSyncs = syncs / passes;
+    passes = syncs = 0;
+
+    for (; elapsed < MINTIME; passes++, elapsed = now() - start) {
+        phaseDecoder decoder;
+        initPhaseDecoder(&decoder);
+
+        for (long i = 0; i < count; i++)
+            syncs += stepPhase(&decoder, samples[i], &time);
+    }
+
+    printf("  %-9s %8.3g samples/s  %6.0fx real time\n", "phase",
+           passes * count / elapsed, passes * count / IQSAMPLES / elapsed);
+    printf("  syncs per hour: amplitude %ld, phase %ld\n", amplitudeSyncs,
+           syncs / passes);
+
+    free(samples);
+    free(envelopes);
+    free(levels);
+}
+
+
+int main(int argc, char** argv)
+{
+    static const double snrs[] = {INFINITY, 12, 6, 0, -6, -12, -18, -24};
+    int trials = argc > 1 ? atoi(argv[1]) : 200;
+
+    if (trials < 1) {
+        fprintf(stderr, "usage: %s [trials]\n", argv[0]);
+        return 2;
+    }
+
+    benchResult result;
+    result.amplitude = malloc(trials * sizeof(int));
+    result.phase     = malloc(trials * sizeof(int));
+
+    int failed = 0;
+    srand(1);
+
+    printf("snr dB  decoder   synced     median       p99  wrong\n");
+
+    for (size_t n = 0; n < sizeof(snrs) / sizeof(snrs[0]); n++) {
+        result.amplitudeWrong = 0;
+        result.phaseWrong = 0;
+
+        for (int t = 0; t < trials; t++)
+            runTrial(snrs[n], &result, t, (int) n * trials + t + 1);
+
+        printf("%.0f\n", snrs[n]);
+        int amplitude = printTimes("amplitude", result.amplitude, trials,
+                                   result.amplitudeWrong);
+        int phase = printTimes("phase", result.phase, trials,
+                               result.phaseWrong);
+
+        /* on a clean signal both decoders must always get the right time */
+        if (isinf(snrs[n]))
+            failed = amplitude < trials || phase < trials ||
+                     result.amplitudeWrong || result.phaseWrong;
+    }
+
+    printf("throughput\n");
+    timeDecoders();
+
+    free(result.amplitude);
+    free(result.phase);
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
@@ -0,0 +1,178 @@
+/*
+ * Checks the phase code and the phaseDecoder.
+ *
+ * Every minute code must come back with one wrong bit and not with two,
+ * and frames must decode to the minute and DST status they were encoded
+ * with. On clean baseband samples of random carrier phase, frequency offset
+ * and sample timing the decoder must lock within two whole frames and then
+ * decode every frame right, and on noise alone it must never sync.
+ *
+ * Build: gcc -std=c99 -O2 frame_layout.c civil_time.c wwvb_signal.c \
+ *            phase_decoder.c phase_signal.c test_support.c \
+ *            phase_decoder_test.c -lm
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "phase_signal.h"
+#include "test_support.h"
+
+#define NTRIALS 50
+#define NCODES 2000
+#define TRIALMINUTES 10
+#define NOISEHOURS 6
+
+
+/* random minute of the century */
+static time_t randomMinute()
+{
+    return PHASEEPOCH + (time_t) (rand() % (long) PHASEMINUTES) * 60;
+}
+
+
+static void checkMinuteCode()
+{
+    int corrected = 1, wrong = 1;
+
+    for (int n = 0; n < NCODES; n++) {
+        uint32_t minutes = rand() % PHASEMINUTES;
+        uint32_t code = encodeMinuteCode(minutes);
+        uint32_t value;
+
+        corrected &= !decodeMinuteCode(code, &value) && value == minutes;
+
+        for (int a = 1; a <= CODELENGTH; a++) {
+            uint32_t one = code ^ (uint32_t) 1 << a;
+            corrected &= decodeMinuteCode(one, &value) == a &&
+                         value == minutes;
+
+            int b = 1 + (a + rand() % (CODELENGTH - 1)) % CODELENGTH;
+            decodeMinuteCode(one ^ (uint32_t) 1 << b, &value);
+            wrong &= value != minutes;
+        }
+    }
+
+    expect(corrected, "one wrong bit corrected");
+    expect(wrong, "two wrong bits never give the minute back");
+}
+
+
+static void checkFrames()
+{
+    int ok = 1;
+
+    for (int n = 0; n < NCODES; n++) {
+        time_t minute = randomMinute(), decoded;
+        int dst = rand() % 4, decodedDst;
+        uint64_t frame = encodePhaseFrame(minute, dst);
+
+        ok &= (frame & SYNCMASK) == SYNCBITS &&
+              !decodePhaseBits(frame, &decoded, &decodedDst) &&
+              decoded == minute && decodedDst == dst;
+    }
+
+    expect(ok, "frames decode to their minute");
+}
+
+
+/* seconds to the first sync, and syncs and wrong syncs after it */
+static void runSource(phaseSource* source, long samples, long* lock,
+                      int* syncs, int* wrong)
+{
+    phaseDecoder decoder;
+    initPhaseDecoder(&decoder);
+
+    *lock  = -1;
+    *syncs = 0;
+    *wrong = 0;
+
+    for (long i = 0; i < samples; i++) {
+        iqSample sample = phaseSourceSample(source);
+        time_t time;
+        int dst;
+
+        if (updatePhaseDecoder(&decoder, sample) != 3 ||
+            decodePhaseFrame(&decoder, &time, &dst))
+            continue;
+
+        /* the frame ends at the sample after the last one of the minute */
+        if (labs((long) (time - phaseSourceTime(source))) > 1 ||
+            dst != DSTOFF) {
+            (*wrong)++;
+            continue;
+        }
+
+        if (*lock < 0)
+            *lock = i / IQSAMPLES;
+
+        (*syncs)++;
+    }
+}
+
+
+static void checkLock()
+{
+    long worst = 0;
+    int  missed = 0, wrong = 0;
+
+    for (int t = 0; t < NTRIALS; t++) {
+        phaseSource source;
+        double offset = 60.0 * rand() / RAND_MAX;
+        double frequency = 0.004 * rand() / RAND_MAX - 0.002;
+
+        initPhaseSource(&source, randomMinute(), offset, INFINITY, frequency,
+                        t + 1);
+
+        long lock;
+        int syncs, bad;
+        runSource(&source, TRIALMINUTES * 60L * IQSAMPLES, &lock, &syncs,
+                  &bad);
+
+        /* every frame after the first two whole ones */
+        missed += lock < 0 || syncs < TRIALMINUTES - 3;
+        wrong  += bad;
+
+        if (lock > worst)
+            worst = lock;
+    }
+
+    printf("clean signal: lock within %ld s\n", worst);
+
+    expect(!missed, "every frame of a clean signal decoded");
+    expect(!wrong, "no wrong times on a clean signal");
+    expect(worst <= 3 * FRAMESIZE + 5, "lock within two whole frames");
+}
+
+
+static void checkNoise()
+{
+    phaseSource source;
+    initPhaseSource(&source, randomMinute(), 0, -40, 0, 7);
+
+    long lock;
+    int syncs, wrong;
+    runSource(&source, NOISEHOURS * 3600L * IQSAMPLES, &lock, &syncs, &wrong);
+
+    expect(!syncs && !wrong, "no syncs on noise");
+}
+
+
+int main()
+{
+    srand(1);
+
+    checkMinuteCode();
+    checkFrames();
+    checkLock();
+    checkNoise();
+
+    if (failures) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
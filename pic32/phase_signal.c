@@ -0,0 +1,98 @@
+#include <math.h>
+
+#include "channel_model.h"
+#include "phase_signal.h"
+#include "test_support.h"
+
+#define NOISESTREAM   0x9E3779B97F4A7C15ULL
+#define CARRIERSTREAM 0xBB67AE8584CAA73BULL
+#define TWOPI 6.283185307179586
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* random number in [0, 1) fixed by the seed, the stream and the index */
+static double uniform(uint64_t seed, uint64_t stream, long index)
+{
+    uint64_t random = mix(seed ^ stream ^ mix((uint64_t) index));
+
+    return (random >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+static int16_t toSample(double value)
+{
+    double scaled = value * IQFULLSCALE;
+
+    return scaled > 32767 ? 32767 : scaled < -32768 ? -32768
+                                                    : (int16_t) lrint(scaled);
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initPhaseSource(phaseSource* source, time_t start, double offset,
+                     double snr, double frequency, uint64_t seed)
+{
+    source->start     = start;
+    source->offset    = offset;
+    source->carrier   = TWOPI * uniform(seed, CARRIERSTREAM, 0);
+    source->frequency = frequency;
+    source->sigma     = sqrt(0.5 * pow(10, -snr / 10));
+    source->seed      = seed;
+
+    source->sample = 0;
+    source->second = 0;
+    source->minute = -1;
+}
+
+
+iqSample phaseSourceSample(phaseSource* source)
+{
+    double elapsed = (double) source->sample / IQSAMPLES;
+    double t = source->offset + elapsed;
+    long second = (long) t;
+    long minute = second / 60;
+
+    if (minute != source->minute) {
+        encodeFrame(source->start + minute * 60, DSTOFF, source->frame);
+        source->phaseFrame = encodePhaseFrame(source->start + minute * 60,
+                                              DSTOFF);
+        source->minute = minute;
+    }
+
+    /* the pulse of the amplitude code and the sign of the phase code */
+    int bit = second % 60;
+    double into = t - second;
+    double amplitude = into * NSAMPLES < pulseLows(source->frame[bit])
+                     ? LOWCARRIER : 1;
+
+    if (source->phaseFrame >> bit & 1)
+        amplitude = -amplitude;
+
+    double angle = source->carrier + TWOPI * source->frequency * elapsed;
+
+    /* Box-Muller, a Gaussian pair for I and Q */
+    double u1 = uniform(source->seed, NOISESTREAM, 2 * source->sample);
+    double u2 = uniform(source->seed, NOISESTREAM, 2 * source->sample + 1);
+    double r  = source->sigma * sqrt(-2 * log(1 - u1));
+
+    iqSample sample;
+    sample.i = toSample(amplitude * cos(angle) + r * cos(TWOPI * u2));
+    sample.q = toSample(amplitude * sin(angle) + r * sin(TWOPI * u2));
+
+    source->second = second;
+    source->sample++;
+
+    return sample;
+}
+
+
+time_t phaseSourceTime(const phaseSource* source)
+{
+    return source->start + source->second;
+}
@@ -0,0 +1,73 @@
+#ifndef PHASE_SIGNAL_H_
+#define PHASE_SIGNAL_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "phase_decoder.h"
+
+#define IQFULLSCALE 8192     /* I/Q amplitude of the full carrier */
+
+
+/*
+ * The baseband carrier of a transmitter sending the amplitude code and the
+ * phase code at the same time, from a UTC minute on. The amplitude drops
+ * to LOWCARRIER for the pulse of every second, the phase reverses for the
+ * seconds of the phase code that are 1, and the receiver adds Gaussian
+ * noise and is left with an unknown carrier phase and a small frequency
+ * offset after downconversion. The noise is a function of the seed and the
+ * sample, so a source replays the same way from the same seed.
+ */
+typedef struct {
+    time_t   start;        /* UTC of the minute the transmitter starts in */
+    double   offset;       /* seconds into that minute of the first sample */
+    double   carrier;      /* carrier phase at the first sample, radians */
+    double   frequency;    /* carrier offset after downconversion, Hz */
+    double   sigma;        /* noise of I and of Q, full carrier is 1 */
+    uint64_t seed;
+
+    long     sample;       /* index of the next sample */
+    long     second;       /* seconds since start of the last sample */
+    long     minute;       /* minute of the frames below */
+    char     frame[FRAMESIZE];     /* amplitude code of the minute */
+    uint64_t phaseFrame;           /* phase code of the minute */
+} phaseSource;
+
+
+/*
+ * \brief Start a phaseSource.
+ *
+ * Frames are encoded without DST, and the carrier phase is random.
+ *
+ * \param source Pointer to phaseSource to initialize.
+ * \param start UTC time of the minute the transmitter starts in.
+ * \param offset Seconds into that minute of the first sample, 0 to 60.
+ * \param snr Full carrier to noise power of a sample, dB, or INFINITY.
+ * \param frequency Carrier offset left after downconversion, Hz.
+ * \param seed Seed of the noise and the carrier phase.
+ */
+void initPhaseSource(phaseSource* source, time_t start, double offset,
+                     double snr, double frequency, uint64_t seed);
+
+
+/*
+ * \brief Take the next baseband sample.
+ *
+ * \param source Pointer to phaseSource to sample.
+ *
+ * \returns I/Q sample, IQFULLSCALE for the full carrier.
+ */
+iqSample phaseSourceSample(phaseSource* source);
+
+
+/*
+ * \brief UTC second the transmitter was in at the last sample.
+ *
+ * \param source Pointer to phaseSource sampled at least once.
+ *
+ * \returns UTC time in whole seconds.
+ */
+time_t phaseSourceTime(const phaseSource* source);
+
+
+#endif /* PHASE_SIGNAL_H_ */
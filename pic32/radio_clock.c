@@ -1,134 +1,266 @@
+#include "bit_ring.h"
+#include "capture_recorder.h"
+#include "hal.h"
+#include "radio_clock.h"
+#include "spi_protocol.h"
 #include "time_keeping.h"
 #include "time_decoder.h"
 
-/* offset for pacific time zone */
-#define TIMEZONE -28800
+/* the decoder takes the sample of each tick */
+#if NSAMPLES != NTICKS
+#error "the radio clock samples the receiver at NTICKS per second, build with NSAMPLES 10"
+#endif
 
-void initSPI()
+
+/* shared with the sampling interrupt */
+static HALLOCAL receiverSampler sampler;
+
+
+HALSAMPLINGISR(samplingInterrupt)
 {
-    // SPI setup
-    long readdata;
+    sampleReceiver(&sampler);
+    halAckSamplingInterrupt();
+}
 
-    /* turn off SPI */
-    SPI2CON = 0x0;//0xFFFF7FFF & SPI2CON;
 
-    /* read BUF to clear it */
-    readdata = SPI2BUF;
+void sendCurrentTime(timePacket* packet)
+{
+    uint32_t words[PACKETWORDS];
+    encodePacket(packet, words);
 
-    /* set baud rate to 1.25MHz for a 20MHz peripheral clk */
-    SPI2BRG = 0x0007;
+    for (int i = 0; i < PACKETWORDS; i++)
+        halWriteSPI(words[i]);
+}
 
-    /* set to Master mode (bit 5), SDO centered on rising clk edge (bit 8),
-     * 32 bit mode (bit 11 - 10) */
-    SPI2CON = SPI2CON | 0x00000920;
 
-    /* turn SPI back on */
-    SPI2CON = SPI2CON | 0x00008000;
+static void sendCapture(const void* data, uint32_t size, void* context)
+{
+    (void) context;
+    halWriteCapture(data, size);
 }
 
 
-void sendCurrentTime(int packet)
+void createPacket(time_keeper* timeKeeper, int packetType,
+                  timePacket* packet)
 {
-    SPI2BUF = packet;
+    struct tm timeToSend;
+    getLocalTime(timeKeeper, &timeToSend);
+
+    packet->header      = packetType;
+    packet->year        = timeToSend.tm_year + 1900;
+    packet->month       = timeToSend.tm_mon + 1;
+    packet->day         = timeToSend.tm_mday;
+    packet->hour        = timeToSend.tm_hour;
+    packet->minute      = timeToSend.tm_min;
+    packet->second      = timeToSend.tm_sec;
+    packet->millisecond = getMilliseconds(timeKeeper);
+    packet->dst         = timeKeeper->dst;
+    packet->locked      = timeKeeper->locked;
+    packet->synced      = timeKeeper->synced;
+
+    /* 1/16 ppm per unit */
+    packet->drift       = getDrift(timeKeeper) * 2 / 125;
+    packet->sinceSync   = timeKeeper->synced
+                        ? timeKeeper->currentTime - timeKeeper->lastSync
+                        : 65535;
 }
 
 
-int createPacket(struct tm* timeToSend, int packetType)
+/* what the main loop keeps from one sample to the next */
+typedef struct {
+    time_keeper     timeKeeper;
+    timeDecoder     decoder;
+    bitRing         ring;
+    captureRecorder recorder;
+    long            sinceBit;        /* samples since the last bit went in */
+    int             lostSeconds;     /* the ring may not line up any more */
+    int             packetHeader;    /* 0 for the first packet after a sync */
+} clockState;
+
+
+/* push the bit of the pulse that just ended, and sync to decoded frames */
+static void pushPulse(clockState* clock)
 {
-    int year = timeToSend->tm_year + 1900 - 2014;
-    int month = timeToSend->tm_mon + 1;
-    int day = timeToSend->tm_mday;
-    int hour = timeToSend->tm_hour;
-    int minute = timeToSend->tm_min;
-    int second = timeToSend->tm_sec;
-
-    int header = packetType << 31;
-
-    year   = year << 26;
-    month  = month << 22;
-    day    = day << 17;
-    hour   = hour << 12;
-    minute = minute << 6;
-
-    return header | year | month | day | hour | minute | second;
+    if (clock->lostSeconds)
+        bridgeGap(&clock->ring, clock->sinceBit);
+
+    pushBit(&clock->ring, clock->decoder.lastPulse);
+    clock->sinceBit = 0;
+    clock->lostSeconds = 0;
+
+    /* two frames are enough on their own, one frame while in sync,
+     * and a vote over the ring until then */
+    time_keeper* timeKeeper = &clock->timeKeeper;
+    time_t currentUnixTime;
+    int dst;
+    int err = decodeRingFrames(&clock->ring, &currentUnixTime, &dst);
+
+    if (err && timeKeeper->synced)
+        err = trackRingFrame(&clock->ring, timeKeeper->currentTime,
+                             &currentUnixTime, &dst);
+    else if (err)
+        err = voteRingFrames(&clock->ring, &currentUnixTime, &dst);
+
+    if (err)
+        return;
+
+    /* only syncs, most pushes aren't aligned to a frame yet */
+    countFramePair(&clock->decoder, pairDecoded);
+
+    /* keep what led up to a sync that moved the clock */
+    long jump = (long) (currentUnixTime - timeKeeper->currentTime);
+
+    if (timeKeeper->synced &&
+        (jump > TRACKTOLERANCE || jump < -TRACKTOLERANCE))
+        holdRecorder(&clock->recorder, CAPTUREHOLD);
+
+    /* update time keeper, which works out DST on a change day */
+    syncTime(timeKeeper, currentUnixTime, dst);
+    recordSync(&clock->recorder, currentUnixTime, timeKeeper->dst);
+
+    /* next data packet will indicate sync has happened */
+    clock->packetHeader = 0;
 }
 
 
-int main()
+/* decode a run of filtered samples, returns 1 if a pulse ended in it */
+static int decodeRun(clockState* clock, sampleRun run)
+{
+    int pulseEnded = 0;
+
+    while (run.length > 0) {
+        /* stops early where a sample needs more than counting */
+        int status;
+        int done = updateDecoderRun(&clock->decoder, run.level, run.length,
+                                    &status);
+
+        for (int i = 0; i < done; i++)
+            recordSample(&clock->recorder, (char) run.level);
+
+        run.length -= done;
+        clock->sinceBit += done;
+
+        /* the bit buffer only has to find the pulses, keep it going */
+        if (status == 3)
+            keepLastMarker(&clock->decoder);
+
+        if (status == 1) {
+            /* lost the seconds, the next pulse tells if the ring lines up */
+            clock->lostSeconds = 1;
+
+        } else if (clock->decoder.lastPulse != NOPULSE) {
+            pushPulse(clock);
+            pulseEnded = 1;
+        }
+    }
+
+    return pulseEnded;
+}
+
+
+void runRadioClock()
 {
     /* initialize receiver board */
     initReceiver();
 
     /* initialize SPI module */
-    initSPI();
-
-    /* initialize timers */
-    resetTimeKeepingTimer();
-    resetSamplingTimer();
+    halInitSPI();
 
     /* initialize current time to 00:00:00, Januray 2, 2014 UTC */
-    time_keeper timeKeeper;
-    setTime(&timeKeeper, 1388620800, 0);
+    clockState clock;
+    time_keeper* timeKeeper = &clock.timeKeeper;
+    initTimeKeeper(timeKeeper, TIMEZONE, 1388620800);
+
+    /* set up time signal decoder, frames are decoded from the bit ring */
+    initDecoder(&clock.decoder);
+    clearDecoderTelemetry(&clock.decoder);
+    initBitRing(&clock.ring);
+
+    clock.sinceBit = 0;
+    clock.lostSeconds = 0;
 
-    /* set up time signal decoder */
-    timeDecoder decoder;
-    initDecoder(&decoder);
+    /* the samples before a bad sync, sent out once */
+    initRecorder(&clock.recorder);
+    int captureSent = 0;
 
-    /* start timer */
+    /* a packet per tick, 0 for the first after a sync */
+    int packetDue = 0;
+    clock.packetHeader = 1;
+    uint32_t nextSequence = 0;
+
+    /* start timers, the interrupt samples the receiver from here on */
     startTimeKeepingTimer();
-    startSamplingTimer();
+    startSampler(&sampler, samplingInterrupt);
+
+    while (halKeepRunning()) {
+        receiverSample sample;
+
+        if (popSample(&sampler.queue, &sample)) {
+            /* send current local time to FPGA via SPI, once it is current */
+            if (packetDue && secondStarted(timeKeeper)) {
+                timePacket packet;
+                createPacket(timeKeeper, clock.packetHeader, &packet);
+                sendCurrentTime(&packet);
+                packetDue = 0;
+                clock.packetHeader = 1;
+            }
 
-    while (1) {
-        /* update time */
-        tick(&timeKeeper);
+            halWaitForInterrupt();
+            continue;
+        }
 
-        /* get output from receiver */
-        char x = getReceiverOutput();
+        /* the ticks of samples dropped on a full queue still passed */
+        if (sample.sequence != nextSequence) {
+            long dropped = (long) (sample.sequence - nextSequence);
 
-        int packetHeader = 1;
+            for (long i = 0; i < dropped; i++) {
+                tick(timeKeeper);
+                tickPeriod(timeKeeper);
+            }
 
-        /* update decoder and get its status */
-        int decoderStatus = updateDecoder(&decoder, x);
-        PORTD = decoder.bitCount;
+            /* the pulse the decoder was in is lost too, with its runs */
+            initDecoder(&clock.decoder);
+            clock.lostSeconds = 1;
+            clock.sinceBit += dropped;
+        }
 
-        /* if decoder has two full transmission frames */
-        if (decoderStatus == 3) {
-            /* decode the two frames to get current time */
-            time_t currentUnixTime;
-            int dst;
-            int err = updateTimeAndDate(&decoder, &currentUnixTime, &dst);
+        nextSequence = sample.sequence + 1;
 
-            /* reset decoder */
-            initDecoder(&decoder);
+        /* the filtered level only comes in runs, at its edges */
+        int pulseStarted = 0;
 
-            if (!err) {
-                /* update time keeper */
-                setTime(&timeKeeper, currentUnixTime, dst);
+        for (int i = 0; i < sample.runs; i++)
+            pulseStarted |= decodeRun(&clock, sample.run[i]);
 
-                /* next data packet will indicate sync has happened */
-                packetHeader = 0;
+        /* keep the seconds on the on-time edges */
+        trackPhase(timeKeeper, sample.level, pulseStarted);
 
-                /* if good sync, keep first marker and keep going */
-                decoder.currentState = countLow;
-                decoder.bitCount = 1;
-                updateInputBuffer(&decoder, x);
-            }
-        }
+        /* the tick of the sample is over, trim the one being sampled */
+        tick(timeKeeper);
+        setSamplerPeriod(&sampler, tickPeriod(timeKeeper));
+        setTickLength(timeKeeper, sample.period);
 
-        /* offset utc time to local time */
-        int dstOffset           = timeKeeper.dst * 3600;
-        time_t currentLocalTime = timeKeeper.currentTime + TIMEZONE + dstOffset;
+        halWriteLeds(clock.ring.count);
 
-        /* send current local time to FPGA via SPI */
-        struct tm* timeToSend = localtime(&currentLocalTime);
-        int        timePacket = createPacket(timeToSend, packetHeader);
-        sendCurrentTime(timePacket);
+        if (recorderStopped(&clock.recorder) && !captureSent) {
+            exportCapture(&clock.recorder, sendCapture, NULL);
+            captureSent = 1;
+        }
 
-        /* pause loop until 100 ms has ellapsed */
-        holdTimeKeepingTimer();
-        resetTimeKeepingTimer();
+        /* sent once the loop has caught up with the interrupt */
+        packetDue = 1;
     }
+}
+
+
+#ifndef RADIO_CLOCK_NO_MAIN
+
+int main()
+{
+    runRadioClock();
 
     return 0;
 }
 
+#endif
+
@@ -0,0 +1,49 @@
+#ifndef RADIO_CLOCK_H_
+#define RADIO_CLOCK_H_
+
+#include <time.h>
+
+#include "spi_protocol.h"
+#include "time_decoder.h"
+#include "time_keeping.h"
+
+/* offset for pacific time zone */
+#define TIMEZONE -28800
+
+/* samples still recorded after a sync that moved the clock, 1 minute */
+#define CAPTUREHOLD (60 * NSAMPLES)
+
+
+/*
+ * \brief Fill in the time packet sent to the FPGA.
+ *
+ * \param timeKeeper Pointer to time_keeper with the current time.
+ * \param packetType 0 right after a sync, 1 otherwise.
+ * \param packet Stores the local time, year 2014 to 2045, and the state of
+ *     the time keeper.
+ */
+void createPacket(time_keeper* timeKeeper, int packetType,
+                  timePacket* packet);
+
+
+/*
+ * \brief Run the radio clock main loop while halKeepRunning().
+ *
+ * The receiver is sampled by the sampling interrupt, which queues a sample
+ * per tick, and the loop decodes them and keeps the time, so a slow step
+ * never moves the sampling. The decoder gets the edge filtered level of
+ * the ticks in runs, through updateDecoderRun(), and the phase-locked loop
+ * the averaged level of each tick. Ticks whose samples were dropped on a full
+ * queue are still counted, and the decoder starts over after them. A
+ * packet is sent once per tick when the loop has caught up.
+ *
+ * Builds with RADIO_CLOCK_NO_MAIN to run the loop from another program,
+ * such as the simulator in clock_sim.c. The samples fed to the decoder are
+ * recorded, and the first sync that moves a synced clock by more than
+ * TRACKTOLERANCE seconds stops the recording CAPTUREHOLD samples later and
+ * sends it out with halWriteCapture().
+ */
+void runRadioClock();
+
+
+#endif /* RADIO_CLOCK_H_ */
@@ -0,0 +1,98 @@
+#include "sample_queue.h"
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+#ifdef __PIC32MX__
+
+/*
+ * One core, and the interrupt runs on it between two instructions of the
+ * main loop, so program order is all either side can see. The compiler
+ * only has to be kept from moving the sample accesses across the index.
+ */
+static inline uint32_t loadIndex(const uint32_t* index)
+{
+    uint32_t value = *(const volatile uint32_t*) index;
+    __asm__ __volatile__ ("" ::: "memory");
+
+    return value;
+}
+
+
+static inline void storeIndex(uint32_t* index, uint32_t value)
+{
+    __asm__ __volatile__ ("" ::: "memory");
+    *(volatile uint32_t*) index = value;
+}
+
+#else
+
+/* on a desktop the two sides are threads, maybe on different cores */
+static inline uint32_t loadIndex(const uint32_t* index)
+{
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+
+static inline void storeIndex(uint32_t* index, uint32_t value)
+{
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+#endif
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initSampleQueue(sampleQueue* queue)
+{
+    queue->head      = 0;
+    queue->tail      = 0;
+    queue->overruns  = 0;
+    queue->highWater = 0;
+}
+
+
+int pushSample(sampleQueue* queue, const receiverSample* sample)
+{
+    /* only the producer writes head, its own copy is current */
+    uint32_t head    = queue->head;
+    uint32_t waiting = head - loadIndex(&queue->tail);
+
+    if (waiting >= QUEUESIZE) {
+        queue->overruns++;
+        return 1;
+    }
+
+    queue->samples[head & (QUEUESIZE - 1)] = *sample;
+    storeIndex(&queue->head, head + 1);
+
+    if (waiting + 1 > queue->highWater)
+        queue->highWater = waiting + 1;
+
+    return 0;
+}
+
+
+int popSample(sampleQueue* queue, receiverSample* sample)
+{
+    uint32_t tail = queue->tail;
+
+    if (loadIndex(&queue->head) == tail)
+        return 1;
+
+    *sample = queue->samples[tail & (QUEUESIZE - 1)];
+    storeIndex(&queue->tail, tail + 1);
+
+    return 0;
+}
+
+
+int samplesWaiting(sampleQueue* queue)
+{
+    return (int) (loadIndex(&queue->head) - queue->tail);
+}
@@ -0,0 +1,86 @@
+#ifndef SAMPLE_QUEUE_H_
+#define SAMPLE_QUEUE_H_
+
+#include <stdint.h>
+
+#define QUEUESIZE 16      /* samples waiting at most, a power of 2, 1.6 s */
+#define MAXTICKRUNS 2     /* runs of decoder samples a tick ends at most */
+
+
+/* Decoder samples in a row at the same level */
+typedef struct {
+    int level;
+    int length;
+} sampleRun;
+
+
+/* A 100 ms sample of the receiver, taken by the sampling interrupt */
+typedef struct {
+    int       level;       /* reads of the carrier at full amplitude */
+    unsigned  period;      /* timer ticks of the tick it was taken in */
+    uint32_t  sequence;    /* ticks since sampling started, dropped ones too */
+    int       runs;        /* runs of filtered levels that ended in the tick */
+    sampleRun run[MAXTICKRUNS];
+} receiverSample;
+
+
+/*
+ * Lock-free queue of samples from one producer, the sampling interrupt, to
+ * one consumer, the main loop. Each side only writes its own index, and a
+ * sample is written before the head that publishes it and read before the
+ * tail that frees it, so neither side ever waits on the other. The indices
+ * count every sample pushed and popped and wrap at 2^32, so head - tail is
+ * the number waiting even across the wrap. A sample pushed on a full queue
+ * is dropped and counted.
+ */
+typedef struct {
+    receiverSample samples[QUEUESIZE];
+    uint32_t head;         /* samples pushed, written by the producer */
+    uint32_t tail;         /* samples popped, written by the consumer */
+    uint32_t overruns;     /* samples dropped on a full queue, producer */
+    uint32_t highWater;    /* most samples ever waiting, producer */
+} sampleQueue;
+
+
+/*
+ * \brief Initialize an empty sampleQueue.
+ *
+ * \param queue Pointer to sampleQueue to initialize, before either side
+ *     uses it.
+ */
+void initSampleQueue(sampleQueue* queue);
+
+
+/*
+ * \brief Push a sample, from the producer only.
+ *
+ * \param queue Pointer to the sampleQueue.
+ * \param sample Sample to push.
+ *
+ * \returns 0 if pushed, 1 if the queue was full and the sample dropped.
+ */
+int pushSample(sampleQueue* queue, const receiverSample* sample);
+
+
+/*
+ * \brief Pop the oldest sample, from the consumer only.
+ *
+ * \param queue Pointer to the sampleQueue.
+ * \param sample Stores the sample.
+ *
+ * \returns 0 if a sample was popped, 1 if the queue was empty.
+ */
+int popSample(sampleQueue* queue, receiverSample* sample);
+
+
+/*
+ * \brief Number of samples waiting, from the consumer only.
+ *
+ * \param queue Pointer to the sampleQueue.
+ *
+ * \returns 0 to QUEUESIZE, more may be pushed in the meantime.
+ */
+int samplesWaiting(sampleQueue* queue);
+
+
+#endif /* SAMPLE_QUEUE_H_ */
@@ -0,0 +1,424 @@
+/*
+ * Checks the sample queue between the sampling interrupt and the main loop,
+ * with the interrupt as a real thread, and measures the jitter of the
+ * sampling with and without it.
+ *
+ * On one thread the queue must hand out samples in order, drop and count
+ * them when full and keep its count across the wrap of its indices. Then a
+ * thread pushes as fast as it can against a main loop that pops as fast as
+ * it can, retrying a full queue: every sample must arrive once, whole and
+ * in order, and every retry must be counted as an overrun. Then samples
+ * are taken every SAMPLEUS by a thread woken by the clock, the way the
+ * interrupt takes them, at real-time priority where the system allows it,
+ * while the main loop stalls for SLOWUS every STALLEVERY samples the way
+ * the civil time conversions after a full buffer used to. None may be
+ * dropped, and a stall longer than the queue holds must be counted
+ * exactly. How late the samples were taken is printed next to a loop that
+ * samples and does the same work itself, the way radio_clock.c used to,
+ * holding for a period after each start.
+ *
+ * Build: gcc -std=c99 -O2 -pthread sample_queue.c test_support.c \
+ *            sample_queue_test.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sample_queue.h"
+#include "test_support.h"
+
+#define NSTRESS 2000000     /* samples pushed flat out */
+#define SAMPLEUS 10000      /* sampling period, a tenth of the firmware's */
+#define NTIMED 100          /* samples taken on the clock */
+#define STALLEVERY 20       /* samples between two slow steps */
+#define SLOWUS 40000        /* length of a slow step */
+#define OVERRUNAT 10        /* sample the long stall comes after */
+#define OVERRUNUS 250000    /* stall longer than the queue holds */
+
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static void sleepUntil(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec  = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+
+/* the main loop busy with something slow */
+static void busyFor(uint64_t us)
+{
+    uint64_t end = nowNs() + us * 1000;
+
+    while (nowNs() < end);
+}
+
+
+/* a sample whose fields can only come together, to catch torn reads */
+static receiverSample makeSample(uint32_t sequence)
+{
+    receiverSample sample;
+    sample.level    = (int) (sequence * 2654435761u >> 22);
+    sample.period   = sequence ^ 0x5A5A5A5Au;
+    sample.sequence = sequence;
+    sample.runs     = (int) (sequence % (MAXTICKRUNS + 1));
+
+    for (int i = 0; i < MAXTICKRUNS; i++) {
+        sample.run[i].level  = (int) (sequence >> i & 1);
+        sample.run[i].length = (int) (sequence * 40503u >> (8 + i) & 0xFF);
+    }
+
+    return sample;
+}
+
+
+static int wholeSample(const receiverSample* sample)
+{
+    receiverSample expected = makeSample(sample->sequence);
+    int same = sample->level == expected.level &&
+               sample->period == expected.period &&
+               sample->runs == expected.runs;
+
+    for (int i = 0; i < expected.runs; i++)
+        same &= sample->run[i].level == expected.run[i].level &&
+                sample->run[i].length == expected.run[i].length;
+
+    return same;
+}
+
+
+/******************************************************************************/
+/******************************** One thread **********************************/
+/******************************************************************************/
+
+static void checkOneThread()
+{
+    sampleQueue    queue;
+    receiverSample sample;
+    initSampleQueue(&queue);
+
+    expect(popSample(&queue, &sample) == 1, "an empty queue pops nothing");
+
+    int pushed = 1;
+
+    for (uint32_t i = 0; i < QUEUESIZE; i++) {
+        sample = makeSample(i);
+        pushed &= !pushSample(&queue, &sample);
+    }
+
+    sample = makeSample(QUEUESIZE);
+
+    expect(pushed, "a queue with room takes every sample");
+    expect(pushSample(&queue, &sample) == 1 && queue.overruns == 1,
+           "a full queue drops the sample and counts it");
+    expect(samplesWaiting(&queue) == QUEUESIZE &&
+           queue.highWater == QUEUESIZE, "a full queue counts as full");
+
+    int inOrder = 1;
+
+    for (uint32_t i = 0; i < QUEUESIZE; i++)
+        inOrder &= !popSample(&queue, &sample) && sample.sequence == i &&
+                   wholeSample(&sample);
+
+    expect(inOrder, "samples come out in the order they went in");
+    expect(popSample(&queue, &sample) == 1 && !samplesWaiting(&queue),
+           "the queue is empty after all were popped");
+
+    /* the indices wrap at 2^32 while samples are waiting */
+    initSampleQueue(&queue);
+    queue.head = queue.tail = UINT32_MAX - 5;
+
+    uint32_t next = 0;
+    inOrder = 1;
+
+    for (uint32_t i = 0; i < 3 * QUEUESIZE; i++) {
+        sample = makeSample(i);
+        inOrder &= !pushSample(&queue, &sample);
+
+        if (samplesWaiting(&queue) < QUEUESIZE / 2)
+            continue;
+
+        inOrder &= !popSample(&queue, &sample) && sample.sequence == next++;
+    }
+
+    while (!popSample(&queue, &sample))
+        inOrder &= sample.sequence == next++;
+
+    expect(inOrder && next == 3 * QUEUESIZE && !queue.overruns,
+           "samples stay in order across the wrap of the indices");
+}
+
+
+/******************************************************************************/
+/********************************* Flat out ***********************************/
+/******************************************************************************/
+
+typedef struct {
+    sampleQueue queue;
+    uint32_t    count;      /* samples to push */
+    uint32_t    retries;    /* pushes to a full queue */
+    int         done;       /* all were pushed, set by the producer */
+} flatOut;
+
+
+static void* pushFlatOut(void* arg)
+{
+    flatOut* run = arg;
+
+    for (uint32_t i = 0; i < run->count; i++) {
+        receiverSample sample = makeSample(i);
+
+        while (pushSample(&run->queue, &sample)) {
+            run->retries++;
+            sched_yield();
+        }
+    }
+
+    __atomic_store_n(&run->done, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+
+static void checkFlatOut()
+{
+    static flatOut run;
+    initSampleQueue(&run.queue);
+    run.count   = NSTRESS;
+    run.retries = 0;
+    run.done    = 0;
+
+    pthread_t producer;
+
+    if (pthread_create(&producer, NULL, pushFlatOut, &run)) {
+        expect(0, "the producer thread starts");
+        return;
+    }
+
+    uint32_t next = 0, broken = 0;
+
+    while (1) {
+        receiverSample sample;
+
+        /* whatever was pushed before done is in the queue */
+        int done = __atomic_load_n(&run.done, __ATOMIC_ACQUIRE);
+
+        if (popSample(&run.queue, &sample)) {
+            if (done)
+                break;
+
+            sched_yield();
+            continue;
+        }
+
+        broken += sample.sequence != next++ || !wholeSample(&sample);
+    }
+
+    pthread_join(producer, NULL);
+
+    expect(!broken && next == NSTRESS,
+           "every sample arrives once, whole and in order");
+    expect(run.queue.overruns == run.retries,
+           "every push to a full queue is counted as an overrun");
+
+    printf("flat out: %u samples, %u pushes to a full queue, %u waiting at "
+           "most\n", (unsigned) NSTRESS, (unsigned) run.retries,
+           (unsigned) run.queue.highWater);
+}
+
+
+/******************************************************************************/
+/********************************* On a clock ********************************/
+/******************************************************************************/
+
+typedef struct {
+    sampleQueue queue;
+    int         count;            /* samples to take */
+    uint64_t    start;            /* clock time of the first, ns */
+    uint64_t    late[NTIMED];     /* ns each was taken late by */
+    int         realTime;         /* the thread got real-time priority */
+    int         done;
+} clockedRun;
+
+
+/* the interrupt, taking samples on a fixed grid */
+static void* sampleOnClock(void* arg)
+{
+    clockedRun* run = arg;
+
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    run->realTime = !pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    for (int i = 0; i < run->count; i++) {
+        uint64_t due = run->start + (uint64_t) i * SAMPLEUS * 1000;
+        sleepUntil(due);
+        run->late[i] = nowNs() - due;
+
+        receiverSample sample = makeSample(i);
+        pushSample(&run->queue, &sample);
+    }
+
+    __atomic_store_n(&run->done, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+
+/* pop like the main loop, stalled for stallUs after each sample in stallAt */
+static int runClocked(clockedRun* run, int count, int stallEvery,
+                      int stallAt, uint64_t stallUs, uint32_t* gaps)
+{
+    initSampleQueue(&run->queue);
+    run->count = count;
+    run->start = nowNs() + SAMPLEUS * 1000;
+    run->done  = 0;
+
+    pthread_t sampler;
+
+    if (pthread_create(&sampler, NULL, sampleOnClock, run))
+        return -1;
+
+    uint32_t next = 0;
+    int popped = 0, broken = 0;
+    *gaps = 0;
+
+    while (1) {
+        receiverSample sample;
+        int done = __atomic_load_n(&run->done, __ATOMIC_ACQUIRE);
+
+        if (popSample(&run->queue, &sample)) {
+            if (done)
+                break;
+
+            /* nothing to do until the next sample */
+            sleepUntil(nowNs() + SAMPLEUS * 100);
+            continue;
+        }
+
+        if (sample.sequence < next || !wholeSample(&sample))
+            broken++;
+
+        *gaps += sample.sequence - next;
+        next   = sample.sequence + 1;
+        popped++;
+
+        int i = (int) sample.sequence;
+
+        if ((stallEvery && i % stallEvery == stallEvery - 1) || i == stallAt)
+            busyFor(stallUs);
+    }
+
+    pthread_join(sampler, NULL);
+    *gaps += count - next;
+
+    return broken ? -1 : popped;
+}
+
+
+/* the loop before, sampling and working in turn */
+static void runInline(uint64_t* late, int count)
+{
+    uint64_t start = nowNs() + SAMPLEUS * 1000;
+    uint64_t due   = start;
+
+    for (int i = 0; i < count; i++) {
+        sleepUntil(due);
+
+        /* the timer is reset at every start, so a late start stays late */
+        uint64_t taken = nowNs();
+        late[i] = taken - (start + (uint64_t) i * SAMPLEUS * 1000);
+        due = taken + SAMPLEUS * 1000;
+
+        if (i % STALLEVERY == STALLEVERY - 1)
+            busyFor(SLOWUS);
+    }
+}
+
+
+static int compareLate(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+
+static void printLate(const char* name, const uint64_t* late, int count)
+{
+    uint64_t sorted[NTIMED];
+    memcpy(sorted, late, count * sizeof(sorted[0]));
+    qsort(sorted, count, sizeof(sorted[0]), compareLate);
+
+    printf("%-22s %9.1f %9.1f %9.1f\n", name, sorted[count / 2] / 1e3,
+           sorted[count * 99 / 100] / 1e3, sorted[count - 1] / 1e3);
+}
+
+
+static void checkOnClock()
+{
+    static clockedRun run;
+    uint64_t inlineLate[NTIMED];
+    uint32_t gaps;
+
+    /* slow steps the queue absorbs */
+    int popped = runClocked(&run, NTIMED, STALLEVERY, -1, SLOWUS, &gaps);
+
+    expect(popped == NTIMED && !gaps && !run.queue.overruns,
+           "no sample is lost to slow steps shorter than the queue");
+
+    printf("sampling every %d us, %d us slow step every %d samples, "
+           "%u waiting at most\n", SAMPLEUS, SLOWUS, STALLEVERY,
+           (unsigned) run.queue.highWater);
+    printf("%-22s %9s %9s %9s\n", "late by (us)", "p50", "p99", "max");
+    printLate(run.realTime ? "interrupt, real-time" : "interrupt", run.late,
+              NTIMED);
+
+    runInline(inlineLate, NTIMED);
+    printLate("in the loop", inlineLate, NTIMED);
+
+    /* a stall the queue can't absorb */
+    int count = 2 * OVERRUNAT + OVERRUNUS / SAMPLEUS;
+    popped = runClocked(&run, count, 0, OVERRUNAT, OVERRUNUS, &gaps);
+
+    expect(popped > 0 && run.queue.overruns > 0 &&
+           popped + run.queue.overruns == (uint32_t) count &&
+           gaps == run.queue.overruns,
+           "samples lost to a long stall are all counted");
+
+    printf("%d us stall: %d of %d samples popped, %u dropped\n", OVERRUNUS,
+           popped, count, (unsigned) run.queue.overruns);
+}
+
+
+int main()
+{
+    checkOneThread();
+    checkFlatOut();
+    checkOnClock();
+
+    if (failures) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * Runs updateDecoder() over a grid of signal to noise ratios through the
+ * channel model.
+ *
+ * Usage: snr_sweep [-j threads] [-n trials] [-m minutes] [-s seed]
+ *                  [-g low:high:step] [-J jitter ms] [-k skew ppm]
+ *                  [-f fades per hour] [-l fade seconds] [-d fade dB]
+ *
+ * Every trial starts the transmitter at a random minute, entered part way
+ * through, and runs it for the same minutes at every SNR of the grid, with
+ * the same random numbers behind the noise, the edge jitter and the fades.
+ * The decoder restarts after a full buffer the same way radio_clock.c does.
+ * A clean channel, without any impairment, gives the frames each trial can
+ * deliver at best. Per SNR it prints the time to the first correct sync
+ * (median, 90th and 99th percentile), the frame error rate, the share of
+ * the clean channel's frames that no correct sync covered, and the false
+ * syncs, decoded times more than a second off. Trials are spread over a
+ * pool of threads and give the same results for any number of them. Fails
+ * if the clean channel misses a sync or decodes a wrong time.
+ *
+ * Build: gcc -std=c99 -O2 -pthread time_decoder.c frame_layout.c \
+ *            civil_time.c wwvb_signal.c channel_model.c test_support.c \
+ *            snr_sweep.c -lm
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channel_model.h"
+#include "test_support.h"
+
+#define MAXSNRS 256
+#define NEVER INT32_MAX    /* no correct sync in the trial */
+
+
+/* one trial through one channel */
+typedef struct {
+    int32_t firstSync;     /* seconds to the first correct sync, or NEVER */
+    int32_t correct;       /* decoded times within a second of the truth */
+    int32_t wrong;         /* false syncs */
+    int32_t frames;        /* frames of the clean channel delivered */
+    int32_t lost;          /* of those, frames not delivered here */
+} trialResult;
+
+
+/* work shared by the threads */
+typedef struct {
+    channelConfig   impaired;
+    channelConfig   clean;
+    const double*   snrs;
+    int             nsnrs;
+    int             trials;
+    int             minutes;
+    uint64_t        seed;
+    trialResult*    results;   /* [snr][trial], the clean channel last */
+    pthread_mutex_t lock;
+    int             next;
+} sweepJob;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* restart after a full buffer, the same way radio_clock.c does */
+static int stepHard(timeDecoder* decoder, int input, time_t* time)
+{
+    if (updateDecoder(decoder, input) != 3)
+        return 0;
+
+    int dst;
+    int err = updateTimeAndDate(decoder, time, &dst);
+
+    if (err) {
+        initDecoder(decoder);
+        return 0;
+    }
+
+    keepLastMarker(decoder);
+
+    return 1;
+}
+
+
+/*
+ * Decode one trial through a channel, marking the frames of every correct
+ * sync in delivered, one entry per minute of the transmitter.
+ */
+static void runChannel(const sweepJob* job, const channelConfig* config,
+                       int trial, char* delivered, trialResult* result)
+{
+    uint64_t seed  = mix(job->seed ^ mix((uint64_t) trial));
+    time_t   start = 1420070400 + (time_t) (seed % 13000000) * 60;
+    double   phase = (mix(seed) % 60000) / 1000.0;
+
+    channel ch;
+    timeDecoder decoder;
+    initChannel(&ch, config, start, phase, seed);
+    initDecoder(&decoder);
+
+    memset(result, 0, sizeof(*result));
+    result->firstSync = NEVER;
+    memset(delivered, 0, job->minutes + 2);
+
+    long samples = job->minutes * 60L * NSAMPLES;
+
+    for (long i = 0; i < samples; i++) {
+        time_t time;
+
+        if (!stepHard(&decoder, channelSample(&ch), &time))
+            continue;
+
+        if (labs((long) (time - channelTime(&ch))) > 1) {
+            result->wrong++;
+            continue;
+        }
+
+        if (result->firstSync == NEVER)
+            result->firstSync = i / NSAMPLES;
+
+        result->correct++;
+
+        /* the time is the end of the second of the two frames */
+        long minute = (long) (time - start + 30) / 60;
+
+        for (long m = minute - 2; m < minute; m++)
+            if (m >= 0 && m < job->minutes + 2)
+                delivered[m] = 1;
+    }
+}
+
+
+static void* sweepWorker(void* arg)
+{
+    sweepJob* job = arg;
+    int n = job->minutes + 2;
+    char clean[n], impaired[n];
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        int trial = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (trial >= job->trials)
+            return NULL;
+
+        trialResult* reference = &job->results[job->nsnrs * job->trials
+                                               + trial];
+        runChannel(job, &job->clean, trial, clean, reference);
+
+        for (int m = 0; m < n; m++)
+            reference->frames += clean[m];
+
+        for (int s = 0; s < job->nsnrs; s++) {
+            channelConfig config = job->impaired;
+            config.snr = job->snrs[s];
+
+            trialResult* result = &job->results[s * job->trials + trial];
+            runChannel(job, &config, trial, impaired, result);
+
+            for (int m = 0; m < n; m++) {
+                result->frames += clean[m];
+                result->lost   += clean[m] && !impaired[m];
+            }
+        }
+    }
+}
+
+
+static void runAll(sweepJob* job, int threads)
+{
+    pthread_t workers[threads > 1 ? threads - 1 : 1];
+    int started = 0;
+
+    while (started < threads - 1 &&
+           !pthread_create(&workers[started], NULL, sweepWorker, job))
+        started++;
+
+    /* the calling thread is one of the workers */
+    sweepWorker(job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+}
+
+
+static void printTime(int32_t seconds)
+{
+    if (seconds == NEVER)
+        printf("  %6s", "never");
+    else
+        printf("  %5ds", seconds);
+}
+
+
+/* one row of the table, returns the number of trials that synced */
+static int report(const char* snr, double flip, trialResult* results,
+                  int trials)
+{
+    int  times[trials];
+    long correct = 0, wrong = 0, frames = 0, lost = 0;
+    int synced = 0;
+
+    for (int t = 0; t < trials; t++) {
+        times[t] = results[t].firstSync;
+        synced  += times[t] != NEVER;
+        correct += results[t].correct;
+        wrong   += results[t].wrong;
+        frames  += results[t].frames;
+        lost    += results[t].lost;
+    }
+
+    qsort(times, trials, sizeof(int), compareInts);
+
+    printf("%6s  %7.1e  %5d/%-5d", snr, flip, synced, trials);
+    printTime(times[trials / 2]);
+    printTime(times[(90 * trials) / 100]);
+    printTime(times[(99 * trials) / 100]);
+    printf("  %6.2f%%  %6ld/%-6ld %6.2f%%\n",
+           frames ? 100.0 * lost / frames : 0.0, wrong, correct + wrong,
+           correct + wrong ? 100.0 * wrong / (correct + wrong) : 0.0);
+
+    return synced;
+}
+
+
+/******************************************************************************/
+/*********************************** Main *************************************/
+/******************************************************************************/
+
+int main(int argc, char** argv)
+{
+    channelConfig impaired = {0, 0.010, 30, 2, 15, 20};
+    channelConfig clean    = {INFINITY, 0, 0, 0, 0, 0};
+    double low = 12, high = 24, step = 1;
+    int threads = 4, trials = 200, minutes = 30;
+    uint64_t seed = 1;
+    int usage = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-j"))
+            threads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-n"))
+            trials = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-m"))
+            minutes = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-s"))
+            seed = strtoull(argv[i + 1], NULL, 0);
+        else if (!strcmp(argv[i], "-g"))
+            usage |= sscanf(argv[i + 1], "%lf:%lf:%lf", &low, &high,
+                            &step) != 3;
+        else if (!strcmp(argv[i], "-J"))
+            impaired.jitter = atof(argv[i + 1]) / 1000;
+        else if (!strcmp(argv[i], "-k"))
+            impaired.skew = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            impaired.fadesPerHour = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-l"))
+            impaired.fadeLength = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-d"))
+            impaired.fadeDepth = atof(argv[i + 1]);
+        else
+            usage = 1;
+    }
+
+    double snrs[MAXSNRS];
+    int nsnrs = 0;
+
+    for (double snr = high; step > 0 && snr >= low - step / 2 &&
+         nsnrs < MAXSNRS; snr -= step)
+        snrs[nsnrs++] = snr;
+
+    if (usage || argc % 2 == 0 || threads < 1 || trials < 1 ||
+        minutes < 1 || !nsnrs) {
+        fprintf(stderr, "usage: %s [-j threads] [-n trials] [-m minutes] "
+                "[-s seed] [-g low:high:step] [-J jitter ms] [-k skew ppm] "
+                "[-f fades per hour] [-l fade seconds] [-d fade dB]\n",
+                argv[0]);
+        return 2;
+    }
+
+    sweepJob job = {impaired, clean, snrs, nsnrs, trials, minutes, seed,
+                    calloc((size_t) (nsnrs + 1) * trials,
+                           sizeof(trialResult)),
+                    PTHREAD_MUTEX_INITIALIZER, 0};
+
+    if (!job.results) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    runAll(&job, threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - begin.tv_sec)
+                   + (end.tv_nsec - begin.tv_nsec) * 1e-9;
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    printf("%d trials of %d minutes, edge jitter %.1f ms, skew %.1f ppm, "
+           "%.1f fades per hour of %.1f s at %.1f dB\n\n", trials, minutes,
+           impaired.jitter * 1000, impaired.skew, impaired.fadesPerHour,
+           impaired.fadeLength, impaired.fadeDepth);
+    printf("snr dB     flip       synced   first sync (med, p90, p99)"
+           "     FER    false syncs\n");
+
+    trialResult* reference = job.results + (size_t) nsnrs * trials;
+    int synced = report("clean", 0, reference, trials);
+
+    for (int s = 0; s < nsnrs; s++) {
+        char snr[16];
+        snprintf(snr, sizeof(snr), "%.1f", snrs[s]);
+        report(snr, flipProbability(snrs[s]),
+               job.results + (size_t) s * trials, trials);
+    }
+
+    long frames = (long) trials * minutes * (nsnrs + 1);
+    fprintf(stderr, "frames: %ld on %d threads in %.2f s (%.0f/s)\n",
+            frames, threads, elapsed, frames / elapsed);
+
+    /* a clean channel must always get the right time */
+    int failed = synced < trials;
+
+    for (int t = 0; t < trials; t++)
+        failed |= reference[t].wrong != 0;
+
+    free(job.results);
+    pthread_mutex_destroy(&job.lock);
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
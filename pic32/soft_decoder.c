@@ -0,0 +1,294 @@
+#include "civil_time.h"
+#include "frame_layout.h"
+#include "soft_decoder.h"
+#include "wwvb_signal.h"
+
+/* a second of samples is a window of bits in an unsigned */
+#if NSAMPLES > 31
+#error "the soft decoder only takes up to 31 samples per second"
+#endif
+
+#define WINDOWMASK ((1u << NSAMPLES) - 1)
+
+
+/* a way to read one frame, with the total confidence of the flipped bits */
+typedef struct {
+    time_t time;
+    int    dst;
+    int    cost;
+} softCandidate;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* one second of samples starting at the falling edge, oldest sample highest */
+static unsigned pulseTemplate(char bit)
+{
+    return (1u << (NSAMPLES - pulseLows(bit))) - 1;
+}
+
+
+/* correlate the window against the templates of a 0, a 1 and a marker */
+static int scoreWindow(unsigned window, softBit* bit)
+{
+    static const char symbols[3] = {0, 1, 'm'};
+    int best = 0;
+
+    for (int i = 0; i < 3; i++) {
+        unsigned differ = (window ^ pulseTemplate(symbols[i])) & WINDOWMASK;
+        int agree = NSAMPLES - __builtin_popcount(differ);
+
+        bit->score[i] = agree;
+        if (agree > best)
+            best = agree;
+    }
+
+    return best;
+}
+
+
+/* move the second boundary to the best phase, 1 if it moved */
+static int updatePhase(softDecoder* decoder)
+{
+    int best = decoder->phase;
+
+    for (int p = 0; p < NSAMPLES; p++)
+        if (decoder->phaseScore[p] > decoder->phaseScore[best])
+            best = p;
+
+    if (best == decoder->phase ||
+        decoder->phaseScore[best] < decoder->phaseScore[decoder->phase] +
+                                    SOFTHYSTERESIS)
+        return 0;
+
+    /* bits received so far belong to the old second boundary */
+    decoder->phase    = best;
+    decoder->bitHead  = 0;
+    decoder->bitCount = 0;
+
+    return 1;
+}
+
+
+static const softBit* bitAt(const softDecoder* decoder, int index)
+{
+    int oldest = decoder->bitHead - decoder->bitCount + BUFFERSIZE;
+
+    return &decoder->bits[(oldest + index) % BUFFERSIZE];
+}
+
+
+/* every plausible reading of the frame starting at bit first, 0 if none */
+static int frameCandidates(const softDecoder* decoder, int first,
+                           softCandidate* candidates)
+{
+    uint64_t data = 0;
+    int markers   = 0;
+
+    int flips[SOFTFLIPS];
+    int margins[SOFTFLIPS];
+    int nflips = 0;
+
+    for (int i = 0; i < FRAMESIZE; i++) {
+        const softBit* bit = bitAt(decoder, first + i);
+        int zero   = bit->score[0];
+        int one    = bit->score[1];
+        int marker = bit->score[2];
+
+        /* markers where they belong count for the alignment, others against */
+        int isMarker = marker >= zero && marker >= one;
+
+        if (MARKERMASK >> i & 1) {
+            markers += isMarker;
+            continue;
+        }
+
+        markers -= isMarker;
+
+        /* predefined 0's and unused bits stay 0 */
+        if (!(FIELDMASK >> i & 1))
+            continue;
+
+        data |= (uint64_t) (one > zero) << i;
+
+        /* keep the least confident field bits, sorted by confidence */
+        int margin = one > zero ? one - zero : zero - one;
+        int k = nflips < SOFTFLIPS ? nflips++ : SOFTFLIPS;
+
+        while (k > 0 && margins[k - 1] > margin) {
+            if (k < SOFTFLIPS) {
+                flips[k]   = flips[k - 1];
+                margins[k] = margins[k - 1];
+            }
+            k--;
+        }
+
+        if (k < SOFTFLIPS) {
+            flips[k]   = i;
+            margins[k] = margin;
+        }
+    }
+
+    /* the frame is not aligned with the received bits */
+    if (markers < SOFTMARKERS)
+        return 0;
+
+    int count = 0;
+
+    for (int mask = 0; mask < 1 << nflips; mask++) {
+        uint64_t flipped = data;
+        int cost = 0;
+
+        for (int k = 0; k < nflips; k++) {
+            if (mask >> k & 1) {
+                flipped ^= (uint64_t) 1 << flips[k];
+                cost    += margins[k];
+            }
+        }
+
+        struct tm frameTime;
+
+        if (cost > SOFTMAXCOST ||
+            decodePackedFrame(flipped, MARKERMASK, &frameTime))
+            continue;
+
+        candidates[count].time = timeFromCivil(&frameTime);
+        candidates[count].dst  = frameTime.tm_isdst;
+        candidates[count].cost = cost;
+        count++;
+    }
+
+    return count;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initSoftDecoder(softDecoder* decoder)
+{
+    decoder->window      = 0;
+    decoder->sampleCount = 0;
+    decoder->phase       = 0;
+    decoder->bitHead     = 0;
+    decoder->bitCount    = 0;
+
+    for (int p = 0; p < NSAMPLES; p++)
+        decoder->phaseScore[p] = 0;
+}
+
+
+int updateSoftDecoder(softDecoder* decoder, int input)
+{
+    decoder->window = (decoder->window << 1 | (input != 0)) & WINDOWMASK;
+    decoder->sampleCount++;
+
+    if (decoder->sampleCount < NSAMPLES)
+        return 0;
+
+    /* phase of the second that would have started at the oldest sample */
+    int phase = (decoder->sampleCount - NSAMPLES) % NSAMPLES;
+
+    softBit bit;
+    int best = scoreWindow(decoder->window, &bit);
+
+    /* decaying average, about the last SOFTHISTORY seconds count */
+    int* score = &decoder->phaseScore[phase];
+    *score += best * SOFTSCALE - *score / SOFTHISTORY;
+
+    if (phase != decoder->phase)
+        return 0;
+
+    /* wait for a few seconds of history before trusting the phase */
+    if (decoder->sampleCount < SOFTHISTORY * NSAMPLES)
+        return 0;
+
+    if (updatePhase(decoder))
+        return 2;
+
+    decoder->bits[decoder->bitHead] = bit;
+    decoder->bitHead = (decoder->bitHead + 1) % BUFFERSIZE;
+
+    if (decoder->bitCount < BUFFERSIZE)
+        decoder->bitCount++;
+
+    return decoder->bitCount == BUFFERSIZE ? 3 : 1;
+}
+
+
+int getSoftBit(const softDecoder* decoder, int index, int* confidence)
+{
+    static const char symbols[3] = {0, 1, 'm'};
+    const softBit* bit = bitAt(decoder, index);
+
+    int best = 0, second = -1;
+
+    for (int i = 1; i < 3; i++) {
+        if (bit->score[i] > bit->score[best]) {
+            second = best;
+            best   = i;
+        } else if (second < 0 || bit->score[i] > bit->score[second]) {
+            second = i;
+        }
+    }
+
+    *confidence = bit->score[best] - bit->score[second];
+
+    return symbols[best];
+}
+
+
+int decodeSoftFrames(const softDecoder* decoder, time_t* currentTime, int* dst)
+{
+    softCandidate frame1[1 << SOFTFLIPS], frame2[1 << SOFTFLIPS];
+
+    if (decoder->bitCount < BUFFERSIZE)
+        return 1;
+
+    int count1 = frameCandidates(decoder, 0, frame1);
+    int count2 = count1 ? frameCandidates(decoder, FRAMESIZE, frame2) : 0;
+
+    int    bestCost  = SOFTMAXCOST + 1;
+    time_t bestTime  = 0;
+    int    bestDst   = DSTOFF;
+    int    ambiguous = 0;
+
+    /* cheapest pair of readings that are one minute apart */
+    for (int i = 0; i < count1; i++) {
+        for (int j = 0; j < count2; j++) {
+            int cost = frame1[i].cost + frame2[j].cost;
+
+            /* only a pair within SOFTMAXCOST ties with the best so far */
+            if (frame2[j].time - frame1[i].time != 60 ||
+                frame1[i].dst != frame2[j].dst ||
+                cost > SOFTMAXCOST || cost > bestCost)
+                continue;
+
+            /* 60 seconds has passed since the second frame */
+            time_t time = frame2[j].time + 60;
+
+            if (cost == bestCost) {
+                ambiguous |= time != bestTime;
+                continue;
+            }
+
+            bestCost  = cost;
+            bestTime  = time;
+            bestDst   = frame2[j].dst;
+            ambiguous = 0;
+        }
+    }
+
+    /* nothing fits, or two different times fit equally well */
+    if (bestCost > SOFTMAXCOST || ambiguous)
+        return 1;
+
+    *currentTime = bestTime;
+    *dst = bestDst;
+
+    /* follow convention of returning 0 for success */
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef SOFT_DECODER_H_
+#define SOFT_DECODER_H_
+
+#include <time.h>
+
+#include "time_decoder.h"
+
+#define SOFTHISTORY 4      /* Seconds of template agreement kept per phase */
+#define SOFTSCALE 16       /* Fixed point scale of the phase scores */
+#define SOFTHYSTERESIS 32  /* Phase score lead needed to move the phase */
+#define SOFTMARKERS 6      /* Markers in place less stray markers per frame */
+#define SOFTFLIPS 4        /* Least confident field bits tried both ways */
+#define SOFTMAXCOST 1      /* Largest total confidence of the flipped bits */
+
+
+/* How well one second of samples matches each pulse template */
+typedef struct {
+    /* number of samples agreeing with a 0, a 1 and a marker, 0 to NSAMPLES */
+    unsigned char score[3];
+} softBit;
+
+
+/*
+ * Soft-decision decoder. Instead of counting the 0 samples of a pulse
+ * between two edges and resetting on the first bad pulse, every second of
+ * samples is correlated against the 0, 1 and marker templates. The second
+ * boundary is the phase whose windows have matched the templates best over
+ * the last few seconds, so single glitches move neither the edge nor the
+ * frame, and every received bit keeps how sure the match was.
+ */
+typedef struct {
+    unsigned window;                  /* last NSAMPLES samples, newest in bit 0 */
+    long     sampleCount;             /* samples seen since initialization */
+
+    int      phaseScore[NSAMPLES];    /* decaying best agreement per phase */
+    int      phase;                   /* sample of the second's falling edge */
+
+    softBit  bits[BUFFERSIZE];        /* ring of the last BUFFERSIZE bits */
+    int      bitHead;                 /* slot for the next bit */
+    int      bitCount;                /* number of bits in the ring */
+
+} softDecoder;
+
+
+/*
+ * \brief Initialize a softDecoder.
+ *
+ * \param decoder Pointer to softDecoder to initialize.
+ */
+void initSoftDecoder(softDecoder* decoder);
+
+
+/*
+ * \brief Update the softDecoder with one raw sample.
+ *
+ * \param decoder Pointer to softDecoder to update.
+ * \param input Raw input sample from receiver board.
+ *
+ * \returns
+ *     0: No new bit.
+ *     1: A new bit was received.
+ *     2: The second boundary moved and the received bits were dropped.
+ *     3: A new bit was received and the ring holds BUFFERSIZE bits,
+ *        ready for decodeSoftFrames().
+ */
+int updateSoftDecoder(softDecoder* decoder, int input);
+
+
+/*
+ * \brief Most likely value of a received bit and how sure it is.
+ *
+ * \param decoder Pointer to softDecoder.
+ * \param index Index of the bit, 0 is the oldest in the ring.
+ * \param confidence Stores how many more samples agree with the returned
+ *        value than with the next best one, 0 to NSAMPLES.
+ *
+ * \returns 0, 1 or 'm'.
+ */
+int getSoftBit(const softDecoder* decoder, int index, int* confidence);
+
+
+/*
+ * \brief Decode the last two frames of received bits.
+ *
+ * Marker and predefined 0 bits only need to be recognized well enough to
+ * fix the frame alignment. The least confident field bits of each frame are
+ * tried both ways, and the most likely pair of frames 60 seconds apart wins.
+ *
+ * \param decoder Pointer to softDecoder.
+ * \param currentTime Stores the time at the falling edge after the last bit.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Error(s) in time signal.
+ */
+int decodeSoftFrames(const softDecoder* decoder, time_t* currentTime, int* dst);
+
+
+#endif /* SOFT_DECODER_H_ */
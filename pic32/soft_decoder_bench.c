@@ -0,0 +1,195 @@
+/*
+ * Compares the time to the first sync of updateDecoder() and the
+ * soft-decision decoder on noisy captures.
+ *
+ * Usage: soft_decoder_bench [trials]
+ *
+ * Every trial starts at a random minute and a random sample within it, and
+ * flips every raw sample with a fixed probability. Both decoders see the
+ * same samples until each reports a time within a second of the truth, or
+ * MAXSECONDS have passed. Median and 99th percentile times to the first
+ * correct sync are printed per noise level, along with the number of
+ * decoded times that were wrong. Fails if either decoder misses a sync on
+ * the clean signal.
+ *
+ * Build: gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c \
+ *            wwvb_signal.c soft_decoder.c test_support.c \
+ *            soft_decoder_bench.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soft_decoder.h"
+#include "test_support.h"
+#include "wwvb_signal.h"
+
+#define MAXSECONDS 1800    /* give up on a trial after half an hour */
+#define NEVER (MAXSECONDS + 1)
+
+
+/* seconds to the first correct sync of each decoder, and wrong syncs */
+typedef struct {
+    int* hard;
+    int* soft;
+    int  hardWrong;
+    int  softWrong;
+} benchResult;
+
+
+/* restart after a full buffer, the same way radio_clock.c does */
+static int stepHard(timeDecoder* decoder, int input, time_t* time)
+{
+    if (updateDecoder(decoder, input) != 3)
+        return 0;
+
+    int dst;
+    int err = updateTimeAndDate(decoder, time, &dst);
+
+    if (err) {
+        initDecoder(decoder);
+        return 0;
+    }
+
+    keepLastMarker(decoder);
+
+    return 1;
+}
+
+
+static int stepSoft(softDecoder* decoder, int input, time_t* time)
+{
+    int dst;
+
+    if (updateSoftDecoder(decoder, input) != 3)
+        return 0;
+
+    return !decodeSoftFrames(decoder, time, &dst);
+}
+
+
+static void runTrial(double noise, benchResult* result, int trial)
+{
+    static char samples[FRAMESAMPLES];
+    char frame[FRAMESIZE];
+
+    time_t minute = (time_t) (rand() % 1000000) * 60 + 946684800;
+    long offset   = rand() % FRAMESAMPLES;
+    int threshold = noise * RAND_MAX;
+
+    timeDecoder hard;
+    softDecoder soft;
+    initDecoder(&hard);
+    initSoftDecoder(&soft);
+
+    int hardTime = NEVER, softTime = NEVER;
+
+    for (long i = 0; i < MAXSECONDS * NSAMPLES; i++) {
+        long sample = offset + i;
+
+        if (i == 0 || sample % FRAMESAMPLES == 0) {
+            encodeFrame(minute + sample / FRAMESAMPLES * 60, 0, frame);
+            frameToSamples(frame, samples);
+        }
+
+        int input = samples[sample % FRAMESAMPLES] ^ (rand() < threshold);
+
+        /* true time at this sample, in whole seconds */
+        time_t truth = minute + sample / NSAMPLES;
+        time_t time;
+
+        if (hardTime == NEVER && stepHard(&hard, input, &time)) {
+            if (labs((long) (time - truth)) <= 1)
+                hardTime = i / NSAMPLES;
+            else
+                result->hardWrong++;
+        }
+
+        if (softTime == NEVER && stepSoft(&soft, input, &time)) {
+            if (labs((long) (time - truth)) <= 1)
+                softTime = i / NSAMPLES;
+            else
+                result->softWrong++;
+        }
+
+        if (hardTime != NEVER && softTime != NEVER)
+            break;
+    }
+
+    result->hard[trial] = hardTime;
+    result->soft[trial] = softTime;
+}
+
+
+/* returns the number of trials that synced */
+static int printTimes(const char* name, int* times, int trials, int wrong)
+{
+    qsort(times, trials, sizeof(int), compareInts);
+
+    int synced = 0;
+    for (int i = 0; i < trials; i++)
+        synced += times[i] != NEVER;
+
+    int median = times[trials / 2];
+    int p99    = times[(99 * trials) / 100];
+
+    printf("  %-5s %4d/%-4d", name, synced, trials);
+
+    if (median == NEVER)
+        printf("  %8s", "never");
+    else
+        printf("  %7ds", median);
+
+    if (p99 == NEVER)
+        printf("  %8s", "never");
+    else
+        printf("  %7ds", p99);
+
+    printf("  %5d\n", wrong);
+
+    return synced;
+}
+
+
+int main(int argc, char** argv)
+{
+    static const double noises[] = {0.0, 0.005, 0.01, 0.02, 0.03, 0.05};
+    int trials = argc > 1 ? atoi(argv[1]) : 200;
+
+    if (trials < 1) {
+        fprintf(stderr, "usage: %s [trials]\n", argv[0]);
+        return 2;
+    }
+
+    benchResult result;
+    result.hard = malloc(trials * sizeof(int));
+    result.soft = malloc(trials * sizeof(int));
+
+    int failed = 0;
+    srand(1);
+
+    printf("noise  decoder  synced     median       p99  wrong\n");
+
+    for (size_t n = 0; n < sizeof(noises) / sizeof(noises[0]); n++) {
+        result.hardWrong = 0;
+        result.softWrong = 0;
+
+        for (int t = 0; t < trials; t++)
+            runTrial(noises[n], &result, t);
+
+        printf("%.3f\n", noises[n]);
+        int hard = printTimes("hard", result.hard, trials, result.hardWrong);
+        int soft = printTimes("soft", result.soft, trials, result.softWrong);
+
+        /* on a clean signal both decoders must always get the right time */
+        if (noises[n] == 0.0)
+            failed = hard < trials || soft < trials ||
+                     result.hardWrong || result.softWrong;
+    }
+
+    free(result.hard);
+    free(result.soft);
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
@@ -0,0 +1,82 @@
+#include "spi_protocol.h"
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+static uint32_t clampField(int value, int low, int high)
+{
+    return value < low ? low : value > high ? high : value;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+unsigned packetCrc(const uint32_t* words)
+{
+    unsigned crc = CRCINIT;
+
+    for (int i = 0; i < CRCBITS; i++)
+        crc = updateCrc(crc, words[i / 32] >> (31 - i % 32) & 1);
+
+    return crc;
+}
+
+
+void encodePacket(const timePacket* packet, uint32_t* words)
+{
+    words[0] = (uint32_t) PACKETSYNC << 16 | PROTOCOLVERSION << 12
+             | PACKETWORDS << 8;
+
+    words[1] = (uint32_t) (packet->header != 0) << 31
+             | clampField(packet->year - PACKETYEAR, 0, 31) << 26
+             | clampField(packet->month, 0, 15) << 22
+             | clampField(packet->day, 0, 31) << 17
+             | clampField(packet->hour, 0, 31) << 12
+             | clampField(packet->minute, 0, 63) << 6
+             | clampField(packet->second, 0, 63);
+
+    words[2] = clampField(packet->millisecond, 0, 999) << 22
+             | (uint32_t) (packet->dst != 0) << 21
+             | (uint32_t) (packet->locked != 0) << 20
+             | (uint32_t) (packet->synced != 0) << 19
+             | (clampField(packet->drift, -32768, 32767) & 0xFFFF);
+
+    words[3] = clampField(packet->sinceSync, 0, 65535) << 16;
+    words[3] |= packetCrc(words);
+}
+
+
+void unpackPacket(const uint32_t* words, timePacket* packet)
+{
+    packet->header      = words[1] >> 31;
+    packet->year        = (words[1] >> 26 & 0x1F) + PACKETYEAR;
+    packet->month       = words[1] >> 22 & 0xF;
+    packet->day         = words[1] >> 17 & 0x1F;
+    packet->hour        = words[1] >> 12 & 0x1F;
+    packet->minute      = words[1] >> 6 & 0x3F;
+    packet->second      = words[1] & 0x3F;
+    packet->millisecond = words[2] >> 22;
+    packet->dst         = words[2] >> 21 & 1;
+    packet->locked      = words[2] >> 20 & 1;
+    packet->synced      = words[2] >> 19 & 1;
+    packet->drift       = (int16_t) (words[2] & 0xFFFF);
+    packet->sinceSync   = words[3] >> 16;
+}
+
+
+int decodePacket(const uint32_t* words, timePacket* packet)
+{
+    if (words[0] >> 16 != PACKETSYNC || (words[0] >> 12 & 0xF) !=
+            PROTOCOLVERSION || (words[0] >> 8 & 0xF) != PACKETWORDS)
+        return 1;
+
+    if ((words[3] & 0xFFFF) != packetCrc(words))
+        return 2;
+
+    unpackPacket(words, packet);
+
+    return 0;
+}
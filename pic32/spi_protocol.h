@@ -0,0 +1,111 @@
+#ifndef SPI_PROTOCOL_H_
+#define SPI_PROTOCOL_H_
+
+#include <stdint.h>
+
+/*
+ * Version 2 of the time packets sent from the PIC32 to the FPGA. A packet
+ * is PACKETWORDS 32 bit words, sent most significant bit first:
+ *
+ *     word 0: [31:16] PACKETSYNC, [15:12] version, [11:8] number of words
+ *     word 1: [31] header, [30:26] year - 2014, [25:22] month, [21:17] day,
+ *             [16:12] hour, [11:6] minute, [5:0] second, same as version 1
+ *     word 2: [31:22] millisecond, [21] DST, [20] seconds locked to the
+ *             time signal, [19] synced, [15:0] oscillator drift in 1/16 ppm
+ *     word 3: [31:16] seconds since the last sync, [15:0] CRC
+ *
+ * The receiver finds a packet by its sync word, and the CRC-16/CCITT of
+ * everything before it (polynomial 0x1021, starting from 0xFFFF) rejects
+ * packets that were not a packet or were damaged, so no idle time between
+ * packets or chip select is needed.
+ */
+
+#define PROTOCOLVERSION 2
+#define PACKETWORDS 4
+#define PACKETBITS (32 * PACKETWORDS)
+#define PACKETSYNC 0xEB90         /* sync word, also a telemetry standard */
+#define CRCBITS (PACKETBITS - 16) /* bits covered by the CRC */
+#define CRCPOLY 0x1021
+#define CRCINIT 0xFFFF
+#define PACKETYEAR 2014           /* year 0 of the year field */
+
+
+/* contents of a time packet */
+typedef struct {
+    int header;         /* 0 if the time was set from a frame, 1 otherwise */
+    int year;           /* full year, PACKETYEAR to PACKETYEAR + 31 */
+    int month;          /* 1 to 12 */
+    int day;            /* 1 to 31 */
+    int hour;           /* 0 to 23 */
+    int minute;         /* 0 to 59 */
+    int second;         /* 0 to 59 */
+    int millisecond;    /* 0 to 999 */
+    int dst;            /* daylight saving time in effect */
+    int locked;         /* seconds locked to the on-time edges */
+    int synced;         /* time was set from the time signal */
+    int drift;          /* oscillator drift in 1/16 ppm, positive for fast */
+    int sinceSync;      /* seconds since the last sync, 0 to 65535 */
+} timePacket;
+
+
+/*
+ * \brief Advance a CRC by one bit.
+ *
+ * \param crc CRC so far.
+ * \param bit Next bit, 0 or 1.
+ *
+ * \returns Updated CRC.
+ */
+static inline unsigned updateCrc(unsigned crc, int bit)
+{
+    unsigned feedback = (crc >> 15 ^ (unsigned) bit) & 1;
+
+    return (crc << 1 ^ (feedback ? CRCPOLY : 0)) & 0xFFFF;
+}
+
+
+/*
+ * \brief CRC of the first CRCBITS bits of a packet.
+ *
+ * \param words Packet words, the CRC field is ignored.
+ *
+ * \returns 16 bit CRC.
+ */
+unsigned packetCrc(const uint32_t* words);
+
+
+/*
+ * \brief Pack a time packet into words, adding the sync word and CRC.
+ *
+ * Fields out of range are clamped or cut to their width.
+ *
+ * \param packet Packet to pack.
+ * \param words Stores PACKETWORDS words to send.
+ */
+void encodePacket(const timePacket* packet, uint32_t* words);
+
+
+/*
+ * \brief Unpack the fields of a time packet without checking it.
+ *
+ * \param words PACKETWORDS words, the sync word and CRC are ignored.
+ * \param packet Stores the contents of the packet.
+ */
+void unpackPacket(const uint32_t* words, timePacket* packet);
+
+
+/*
+ * \brief Unpack and check a time packet.
+ *
+ * \param words PACKETWORDS received words.
+ * \param packet Stores the contents of the packet.
+ *
+ * \returns
+ *     0: Valid packet.
+ *     1: Wrong sync word, version or length.
+ *     2: CRC mismatch.
+ */
+int decodePacket(const uint32_t* words, timePacket* packet);
+
+
+#endif /* SPI_PROTOCOL_H_ */
@@ -0,0 +1,96 @@
+#include <string.h>
+
+#include "spi_receiver_model.h"
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initSpiReceiver(spiReceiverModel* receiver)
+{
+    memset(receiver, 0, sizeof(spiReceiverModel));
+}
+
+
+int clockSpiReceiver(spiReceiverModel* receiver, int sclk, int sdi)
+{
+    spiReceiverModel next = *receiver;
+
+    /* combinational signals from the current registers */
+    unsigned rise  = (receiver->sclkSync >> 1 & 1) & ~(receiver->sclkSync >> 2) & 1;
+    unsigned bitIn = receiver->sdiSync >> 1 & 1;
+
+    /* packet = {shift[126:0], bitin} */
+    uint32_t packet[4];
+    for (int i = 0; i < 4; i++)
+        packet[i] = receiver->shift[i] << 1
+                  | (i < 3 ? receiver->shift[i + 1] >> 31 : bitIn);
+
+    next.sclkSync = (receiver->sclkSync << 1 | (sclk != 0)) & 0x7;
+    next.sdiSync  = (receiver->sdiSync << 1 | (sdi != 0)) & 0x3;
+    next.good     = 0;
+
+    if (rise) {
+        next.idle = 0;
+        memcpy(next.shift, packet, sizeof(packet));
+
+        if (!receiver->inFrame) {
+            /* hunt for the sync word one bit at a time */
+            if ((packet[3] & 0xFFFF) == PACKETSYNC) {
+                next.inFrame = 1;
+                next.count   = 16;
+                next.crc     = CRCAFTERSYNC;
+            }
+
+        } else {
+            next.count = (receiver->count + 1) & 0xFF;
+
+            if (receiver->count < CRCBITS)
+                next.crc = updateCrc(receiver->crc, bitIn);
+
+            /* last bit, keep the packet if the version and CRC match */
+            if (receiver->count == PACKETBITS - 1) {
+                next.inFrame = 0;
+
+                unsigned version = packet[0] & 0xFFFF;
+                unsigned header  = PROTOCOLVERSION << 12 | PACKETWORDS << 8;
+
+                if (version == header && (packet[3] & 0xFFFF) == receiver->crc) {
+                    /* timedata <= packet[95:16] */
+                    next.timeData[0] = packet[1] >> 16;
+                    next.timeData[1] = packet[1] << 16 | packet[2] >> 16;
+                    next.timeData[2] = packet[2] << 16 | packet[3] >> 16;
+                    next.good = 1;
+
+                } else {
+                    next.errors = (receiver->errors + 1) & 0xFF;
+                }
+            }
+        }
+
+    } else if (receiver->idle < IDLECYCLES) {
+        next.idle = receiver->idle + 1;
+
+    } else {
+        /* sclk stopped in the middle of a packet */
+        next.inFrame = 0;
+    }
+
+    *receiver = next;
+
+    return receiver->good;
+}
+
+
+void getReceiverOutputs(spiReceiverModel* receiver, timePacket* packet)
+{
+    /* the words of the packet back from timedata */
+    uint32_t words[PACKETWORDS];
+
+    words[0] = (uint32_t) PACKETSYNC << 16;
+    words[1] = receiver->timeData[0] << 16 | receiver->timeData[1] >> 16;
+    words[2] = receiver->timeData[1] << 16 | receiver->timeData[2] >> 16;
+    words[3] = receiver->timeData[2] << 16;
+
+    unpackPacket(words, packet);
+}
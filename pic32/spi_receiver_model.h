@@ -0,0 +1,62 @@
+#ifndef SPI_RECEIVER_MODEL_H_
+#define SPI_RECEIVER_MODEL_H_
+
+#include <stdint.h>
+
+#include "spi_protocol.h"
+
+#define IDLECYCLES 8000       /* IDLECYCLES parameter of spi_receiver.sv */
+#define CRCAFTERSYNC 0x52FE   /* CRC after the sync word, CRCSYNC */
+
+
+/*
+ * Cycle accurate model of vga/spi_receiver.sv, one field per register with
+ * the same width. clockSpiReceiver() is one rising edge of clk: every next
+ * value is computed from the current ones, as the nonblocking assignments
+ * of the always_ff block do.
+ */
+typedef struct {
+    unsigned sclkSync;       /* [2:0] */
+    unsigned sdiSync;        /* [1:0] */
+    unsigned idle;           /* [13:0] */
+    uint32_t shift[4];       /* [127:0], shift[0] holds bits 127 to 96 */
+    unsigned inFrame;
+    unsigned count;          /* [7:0] */
+    unsigned crc;            /* [15:0] */
+    uint32_t timeData[3];    /* [79:0], timeData[0] holds bits 79 to 64 */
+    unsigned good;           /* valid */
+    unsigned errors;         /* [7:0], crcerrors */
+} spiReceiverModel;
+
+
+/*
+ * \brief Put every register in its initial state.
+ *
+ * \param receiver Pointer to spiReceiverModel to initialize.
+ */
+void initSpiReceiver(spiReceiverModel* receiver);
+
+
+/*
+ * \brief Advance the receiver by one clk cycle.
+ *
+ * \param receiver Pointer to spiReceiverModel to clock.
+ * \param sclk Level of sclk before the edge.
+ * \param sdi Level of sdi before the edge.
+ *
+ * \returns The valid output after the edge.
+ */
+int clockSpiReceiver(spiReceiverModel* receiver, int sclk, int sdi);
+
+
+/*
+ * \brief Read the outputs of the receiver, from the last good packet.
+ *
+ * \param receiver Pointer to spiReceiverModel to read.
+ * \param packet Stores the output fields, year and drift converted the
+ *     same way as decodePacket().
+ */
+void getReceiverOutputs(spiReceiverModel* receiver, timePacket* packet);
+
+
+#endif /* SPI_RECEIVER_MODEL_H_ */
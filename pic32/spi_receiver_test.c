@@ -0,0 +1,316 @@
+/*
+ * Checks the version 2 SPI protocol against the model of spi_receiver.sv.
+ *
+ * Random packets are packed with encodePacket(), turned into sclk and sdi
+ * levels per 40MHz FPGA clock cycle the way the PIC32 SPI module drives
+ * them, and clocked through the cycle accurate receiver model at several
+ * link rates, back to back and with idle time between them. Every packet
+ * has to come out of the receiver unchanged, packets with a flipped bit
+ * must be rejected, and random bits with false sync words in them must not
+ * stop the next packets from being found. Then the model speed and the
+ * packet rate of each link rate are reported.
+ *
+ * Build: gcc -std=c99 -O2 spi_protocol.c spi_receiver_model.c \
+ *            spi_receiver_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "spi_receiver_model.h"
+
+#define NPACKETS 300
+#define MAXWAVE (1 << 24)         /* clk cycles in a test stream */
+#define IDLEGAP (IDLECYCLES + 100)
+#define BENCHPACKETS 20000
+#define CLKRATE 40000000          /* FPGA clock */
+#define PBCLKRATE 20000000        /* PIC32 peripheral clock */
+
+
+/* sclk in bit 0 and sdi in bit 1 of each clk cycle */
+typedef struct {
+    unsigned char* levels;
+    size_t count;
+} spiWave;
+
+
+int samePacket(const timePacket* a, const timePacket* b)
+{
+    return !memcmp(a, b, sizeof(timePacket));
+}
+
+
+void randomPacket(timePacket* packet)
+{
+    packet->header      = rand() % 2;
+    packet->year        = PACKETYEAR + rand() % 32;
+    packet->month       = 1 + rand() % 12;
+    packet->day         = 1 + rand() % 31;
+    packet->hour        = rand() % 24;
+    packet->minute      = rand() % 60;
+    packet->second      = rand() % 60;
+    packet->millisecond = rand() % 1000;
+    packet->dst         = rand() % 2;
+    packet->locked      = rand() % 2;
+    packet->synced      = rand() % 2;
+    packet->drift       = rand() % 65536 - 32768;
+    packet->sinceSync   = rand() % 65536;
+}
+
+
+/* bits go out MSB first, changing as sclk falls, read as it rises */
+void addBits(spiWave* wave, uint32_t bits, int count, int halfPeriod)
+{
+    for (int i = count - 1; i >= 0; i--) {
+        int sdi = bits >> i & 1;
+
+        for (int c = 0; c < 2 * halfPeriod && wave->count < MAXWAVE; c++)
+            wave->levels[wave->count++] = (c >= halfPeriod) | sdi << 1;
+    }
+}
+
+
+void addIdle(spiWave* wave, int cycles)
+{
+    for (int c = 0; c < cycles && wave->count < MAXWAVE; c++)
+        wave->levels[wave->count++] = 0;
+}
+
+
+/* clock a stream through the receiver, storing every packet it puts out */
+int receiveWave(spiWave* wave, timePacket* received, int maxPackets,
+                unsigned* errors)
+{
+    spiReceiverModel receiver;
+    initSpiReceiver(&receiver);
+
+    int count = 0;
+
+    for (size_t t = 0; t < wave->count; t++) {
+        int level = wave->levels[t];
+
+        if (clockSpiReceiver(&receiver, level & 1, level >> 1) &&
+                count < maxPackets)
+            getReceiverOutputs(&receiver, &received[count++]);
+    }
+
+    /* a few more cycles for the last bit to get through the flops */
+    for (int t = 0; t < 8; t++)
+        if (clockSpiReceiver(&receiver, 0, 0) && count < maxPackets)
+            getReceiverOutputs(&receiver, &received[count++]);
+
+    *errors = receiver.errors;
+    return count;
+}
+
+
+int checkCrc()
+{
+    uint32_t words[PACKETWORDS];
+    timePacket packet, decoded;
+    unsigned crc = CRCINIT;
+
+    for (int i = 15; i >= 0; i--)
+        crc = updateCrc(crc, PACKETSYNC >> i & 1);
+
+    /* the constant in spi_receiver.sv */
+    if (crc != CRCAFTERSYNC) {
+        printf("CRC after the sync word is %04X\n", crc);
+        return 1;
+    }
+
+    randomPacket(&packet);
+    encodePacket(&packet, words);
+
+    if (decodePacket(words, &decoded) || !samePacket(&packet, &decoded)) {
+        printf("packet does not survive encodePacket() and decodePacket()\n");
+        return 1;
+    }
+
+    /* every single bit error is caught */
+    for (int i = 0; i < PACKETBITS; i++) {
+        words[i / 32] ^= 1u << (31 - i % 32);
+        int err = decodePacket(words, &decoded);
+        words[i / 32] ^= 1u << (31 - i % 32);
+
+        if (!err) {
+            printf("bit %d flipped and the packet still decoded\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* random packets through the receiver at a link rate */
+int checkLink(spiWave* wave, int brg, int gap)
+{
+    static timePacket sent[NPACKETS], received[NPACKETS];
+    int halfPeriod = 2 * (brg + 1) * CLKRATE / PBCLKRATE / 2;
+    unsigned errors;
+
+    wave->count = 0;
+
+    for (int i = 0; i < NPACKETS; i++) {
+        uint32_t words[PACKETWORDS];
+        randomPacket(&sent[i]);
+        encodePacket(&sent[i], words);
+
+        for (int w = 0; w < PACKETWORDS; w++)
+            addBits(wave, words[w], 32, halfPeriod);
+
+        addIdle(wave, gap);
+    }
+
+    int count = receiveWave(wave, received, NPACKETS, &errors);
+
+    if (count != NPACKETS || errors) {
+        printf("BRG %d, gap %d: %d of %d packets, %u errors\n", brg, gap,
+               count, NPACKETS, errors);
+        return 1;
+    }
+
+    for (int i = 0; i < NPACKETS; i++) {
+        if (!samePacket(&sent[i], &received[i])) {
+            printf("BRG %d, gap %d: packet %d differs\n", brg, gap, i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* packets after random bits, and packets with a flipped bit */
+int checkDamage(spiWave* wave)
+{
+    static timePacket sent[NPACKETS], received[NPACKETS];
+    int halfPeriod = 4, expected = 0, flipped = 0;
+    unsigned errors;
+
+    wave->count = 0;
+
+    for (int i = 0; i < NPACKETS; i++) {
+        uint32_t words[PACKETWORDS];
+
+        /* random bits, some with a false sync word, then the line idles */
+        if (i % 3 == 0) {
+            for (int j = 0; j < 1 + rand() % 8; j++)
+                addBits(wave, rand() % 2 ? (uint32_t) rand() :
+                              (uint32_t) PACKETSYNC << (rand() % 16),
+                        32, halfPeriod);
+            addIdle(wave, IDLEGAP);
+        }
+
+        randomPacket(&sent[expected]);
+        encodePacket(&sent[expected], words);
+
+        /* flip a bit after the sync word of every fifth packet */
+        int damaged = i % 5 == 0;
+        if (damaged) {
+            int bit = 16 + rand() % (PACKETBITS - 16);
+            words[bit / 32] ^= 1u << (31 - bit % 32);
+            flipped++;
+        }
+
+        for (int w = 0; w < PACKETWORDS; w++)
+            addBits(wave, words[w], 32, halfPeriod);
+
+        addIdle(wave, IDLEGAP);
+        expected += !damaged;
+    }
+
+    int count = receiveWave(wave, received, NPACKETS, &errors);
+
+    /* random bits can fail the CRC too, but no damaged packet may pass */
+    if (count != expected || (int) errors < flipped) {
+        printf("damaged link: %d of %d packets, %u errors for %d flips\n",
+               count, expected, errors, flipped);
+        return 1;
+    }
+
+    for (int i = 0; i < expected; i++) {
+        if (!samePacket(&sent[i], &received[i])) {
+            printf("damaged link: packet %d differs\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void benchmark(spiWave* wave)
+{
+    timePacket packet;
+    uint32_t words[PACKETWORDS];
+    unsigned errors;
+
+    randomPacket(&packet);
+    encodePacket(&packet, words);
+
+    /* back to back packets at 5MHz */
+    wave->count = 0;
+    for (int i = 0; i < BENCHPACKETS && wave->count < MAXWAVE - 4096; i++)
+        for (int w = 0; w < PACKETWORDS; w++)
+            addBits(wave, words[w], 32, 4);
+
+    static timePacket received[BENCHPACKETS];
+    clock_t start = clock();
+    int count = receiveWave(wave, received, BENCHPACKETS, &errors);
+    double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    printf("model: %.3g clk cycles/s, %.3g packets/s\n",
+           wave->count / elapsed, count / elapsed);
+
+    /* the link itself, SPI2BRG 7 was the version 1 rate */
+    for (int brg = 7; brg >= 0; brg /= 2) {
+        double sclk = PBCLKRATE / (2.0 * (brg + 1));
+
+        printf("SPI2BRG %d: %5.2f MHz sclk, %5.1f us per packet, "
+               "%6.0f packets/s\n", brg, sclk / 1e6, PACKETBITS / sclk * 1e6,
+               sclk / PACKETBITS);
+
+        if (!brg)
+            break;
+    }
+}
+
+
+int main()
+{
+    spiWave wave = {malloc(MAXWAVE), 0};
+
+    srand(1);
+
+    int failed = checkCrc();
+
+    /* from the version 1 rate up to a quarter of clk */
+    for (int brg = 7; brg >= 0 && !failed; brg /= 2) {
+        failed = checkLink(&wave, brg, 0) || checkLink(&wave, brg, 37)
+              || checkLink(&wave, brg, IDLEGAP);
+
+        if (!brg)
+            break;
+    }
+
+    failed = failed || checkDamage(&wave);
+
+    if (failed) {
+        printf("FAIL\n");
+        free(wave.levels);
+        return 1;
+    }
+
+    benchmark(&wave);
+    free(wave.levels);
+
+    printf("PASS\n");
+    return 0;
+}
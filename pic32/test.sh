@@ -1,8 +1,110 @@
-# generate test signal and expected output with python
-pypy generate_tests.py
+# generate the test signal and expected output for the tools that replay it
+gcc -std=c99 -O2 -pthread frame_layout.c civil_time.c wwvb_signal.c wwvb_synthesizer.c test_support.c wwvb_synthesize.c -o wwvb_synthesize
+./wwvb_synthesize signals.txt time.txt
 
-# run test and log output
-./a.out < signals.txt > out.txt
+# decode every case in memory on all cores and check it against its time
+gcc -std=c99 -O2 -pthread time_decoder.c frame_layout.c civil_time.c wwvb_signal.c wwvb_synthesizer.c test_support.c decoder_regress.c -o decoder_regress
+./decoder_regress -j "$(nproc)"
 
-# compare output with expected
-diff out.txt time.txt
+# check the decoder telemetry counters and their dump
+gcc -std=c99 -O2 -DDECODER_TELEMETRY time_decoder.c frame_layout.c civil_time.c wwvb_signal.c decoder_telemetry.c test_support.c decoder_telemetry_test.c -o decoder_telemetry_test
+./decoder_telemetry_test
+
+# check the bit-packed decoder against updateDecoder()
+gcc -std=c99 -O2 -march=native time_decoder.c frame_layout.c civil_time.c packed_samples.c packed_samples_test.c -o packed_test
+./packed_test signals.txt
+gcc -std=c99 -O2 -march=native -DDECODER_TELEMETRY time_decoder.c frame_layout.c civil_time.c packed_samples.c packed_samples_test.c -o packed_test_telemetry
+./packed_test_telemetry
+
+# check the capture recorder and replay binary captures of two synthesized hours against their truth
+gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c packed_samples.c batch_decoder.c capture_recorder.c capture_file.c test_support.c capture_test.c -o capture_test
+./capture_test
+gcc -std=c99 -O2 -march=native time_decoder.c frame_layout.c civil_time.c packed_samples.c capture_file.c test_support.c capture_replay.c -o capture_replay
+./wwvb_synthesize -r "2014-05-13 16:10" 120 hours.txt
+./capture_replay -c -t "2014-05-13 16:10" hours.txt hours.cap
+./capture_replay hours.cap
+
+# check the native synthesizer against frameToSamples() and the decoder
+gcc -std=c99 -O2 -pthread time_decoder.c frame_layout.c civil_time.c wwvb_signal.c wwvb_synthesizer.c test_support.c wwvb_synthesizer_test.c -o wwvb_synthesizer_test
+./wwvb_synthesizer_test
+
+# check the civil time conversions against the C library
+gcc -std=c99 -O2 civil_time.c civil_time_test.c -o civil_time_test
+./civil_time_test
+
+# check the local time carried forward by the time keeper and time its ticks
+gcc -std=c99 -O2 civil_time.c time_keeping.c sample_queue.c edge_filter.c hal_linux.c time_keeping_test.c -o time_keeping_test
+./time_keeping_test
+
+# check the multi-channel decoder against updateDecoder()
+gcc -std=c99 -O3 -march=native -pthread time_decoder.c frame_layout.c civil_time.c wwvb_signal.c multi_decoder.c multi_decoder_test.c -o multi_test
+./multi_test
+
+# compare time to first sync of the soft-decision decoder and updateDecoder()
+gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c soft_decoder.c test_support.c soft_decoder_bench.c -o soft_bench
+./soft_bench 50
+
+# check the phase code decoder on baseband I/Q and compare its time to lock with the amplitude code
+gcc -std=c99 -O2 frame_layout.c civil_time.c wwvb_signal.c phase_decoder.c phase_signal.c test_support.c phase_decoder_test.c -lm -o phase_decoder_test
+./phase_decoder_test
+gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c phase_decoder.c phase_signal.c test_support.c phase_decoder_bench.c -lm -o phase_bench
+./phase_bench 10
+
+# check the channel model and sweep updateDecoder() over SNRs with jitter, skew and fades
+gcc -std=c99 -O2 frame_layout.c civil_time.c wwvb_signal.c channel_model.c channel_model_test.c -lm -o channel_model_test
+./channel_model_test
+gcc -std=c99 -O2 -pthread time_decoder.c frame_layout.c civil_time.c wwvb_signal.c channel_model.c test_support.c snr_sweep.c -lm -o snr_sweep
+./snr_sweep -n 50
+
+# build the decoder for 100 and 1000 samples per second, check the packed decoder against it and sweep the channel
+for rate in 100 1000; do
+    gcc -std=c99 -O2 -march=native -DNSAMPLES=$rate time_decoder.c frame_layout.c civil_time.c packed_samples.c packed_samples_test.c -o packed_test_$rate
+    ./packed_test_$rate
+    gcc -std=c99 -O2 -pthread -DNSAMPLES=$rate time_decoder.c frame_layout.c civil_time.c wwvb_signal.c channel_model.c test_support.c snr_sweep.c -lm -o snr_sweep_$rate
+    ./snr_sweep_$rate -n 20 -m 15 -g 20:24:4
+done
+
+# check resync after dropouts with the sliding bit ring, with and without tracking
+gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c bit_ring.c frame_voter.c bit_ring_test.c -o bit_ring_test
+./bit_ring_test
+
+# check the frame voter, and time to sync on a weak signal with bridged gaps and votes
+gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c channel_model.c bit_ring.c frame_voter.c test_support.c frame_voter_test.c -lm -o frame_voter_test
+./frame_voter_test
+
+# check the edge filters and decoding from their edges against averaged samples
+gcc -std=c99 -O2 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c edge_filter.c test_support.c edge_filter_test.c -lm -o edge_filter_test
+./edge_filter_test
+
+# the same checks of the bit ring, frame voter, multi-channel decoder and edge filters at 100 samples per second
+gcc -std=c99 -O2 -DNSAMPLES=100 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c bit_ring.c frame_voter.c bit_ring_test.c -o bit_ring_test_100
+./bit_ring_test_100
+gcc -std=c99 -O2 -DNSAMPLES=100 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c channel_model.c bit_ring.c frame_voter.c test_support.c frame_voter_test.c -lm -o frame_voter_test_100
+./frame_voter_test_100
+gcc -std=c99 -O3 -march=native -pthread -DNSAMPLES=100 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c multi_decoder.c multi_decoder_test.c -o multi_test_100
+./multi_test_100
+gcc -std=c99 -O2 -DNSAMPLES=100 time_decoder.c frame_layout.c civil_time.c wwvb_signal.c edge_filter.c test_support.c edge_filter_test.c -lm -o edge_filter_test_100
+./edge_filter_test_100
+
+# stress the sample queue with the sampling interrupt as a thread, and compare the jitter of sampling from it and from the loop
+gcc -std=c99 -O2 -pthread sample_queue.c test_support.c sample_queue_test.c -o sample_queue_test
+./sample_queue_test
+
+# check the SPI packets against the model of the FPGA receiver
+gcc -std=c99 -O2 spi_protocol.c spi_receiver_model.c spi_receiver_test.c -o spi_receiver_test
+./spi_receiver_test
+
+# check the fast VGA frame renderer against the pixel by pixel model of radclk_vga.sv
+gcc -std=c99 -O3 -march=native -pthread vga_model.c test_support.c vga_model_test.c -o vga_model_test
+./vga_model_test
+
+# build the microbenchmarks, bench.sh times them against a baseline
+gcc -std=c99 -O2 -DRADIO_CLOCK_NO_MAIN time_decoder.c frame_layout.c civil_time.c wwvb_signal.c time_keeping.c sample_queue.c bit_ring.c frame_voter.c capture_recorder.c hal_linux.c spi_protocol.c radio_clock.c edge_filter.c micro_bench.c micro_bench_run.c -o micro_bench
+
+# build the firmware main loop against the Linux HAL and replay the test signal
+gcc -std=c99 -O2 radio_clock.c time_keeping.c sample_queue.c bit_ring.c frame_voter.c capture_recorder.c time_decoder.c frame_layout.c civil_time.c edge_filter.c hal_linux.c spi_protocol.c -o radio_clock_host
+HAL_SAMPLES=signals.txt HAL_SECONDS=600 ./radio_clock_host > /dev/null
+
+# simulate the whole clock on a virtual clock, with noise, drift and dropouts
+gcc -std=c99 -O2 -pthread -DRADIO_CLOCK_NO_MAIN radio_clock.c time_keeping.c sample_queue.c bit_ring.c frame_voter.c capture_recorder.c time_decoder.c frame_layout.c civil_time.c wwvb_signal.c edge_filter.c hal_linux.c spi_protocol.c clock_sim.c -lm -o clock_sim
+./clock_sim -h 1 -n 2
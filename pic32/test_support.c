@@ -0,0 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <time.h>
+
+#include "test_support.h"
+
+int failures = 0;
+
+
+void expect(int ok, const char* what)
+{
+    if (!ok) {
+        printf("failed: %s\n", what);
+        failures++;
+    }
+}
+
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+int compareInts(const void* a, const void* b)
+{
+    int x = *(const int*) a, y = *(const int*) b;
+
+    return (x > y) - (x < y);
+}
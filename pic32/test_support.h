@@ -0,0 +1,59 @@
+#ifndef TEST_SUPPORT_H_
+#define TEST_SUPPORT_H_
+
+#include <stdint.h>
+
+/*
+ * Helpers shared by the host tests, benchmarks, tools and signal models,
+ * none of which are built into the firmware.
+ */
+
+
+/* checks that failed so far, counted by expect() */
+extern int failures;
+
+
+/*
+ * \brief Hash a 64 bit value with the splitmix64 finalizer.
+ *
+ * Random numbers are taken from a hash of the seed and their index, so any
+ * thread can produce any part of a stream and get the same numbers.
+ *
+ * \param x Value to hash.
+ *
+ * \returns The hashed value.
+ */
+static inline uint64_t mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+
+/*
+ * \brief Count and print a check that failed.
+ *
+ * \param ok Nonzero if the check passed.
+ * \param what What was checked, printed if it failed.
+ */
+void expect(int ok, const char* what);
+
+
+/*
+ * \brief Time from a monotonic clock, to time a run with.
+ *
+ * \returns Seconds from an arbitrary start.
+ */
+double now();
+
+
+/*
+ * \brief Order two ints for qsort().
+ *
+ * \returns Negative, 0 or positive as the first is less, equal or greater.
+ */
+int compareInts(const void* a, const void* b);
+
+
+#endif /* TEST_SUPPORT_H_ */
@@ -1,5 +1,89 @@
+#include "civil_time.h"
+#include "frame_layout.h"
 #include "time_decoder.h"
 
+/* statements only compiled in with DECODER_TELEMETRY */
+#ifdef DECODER_TELEMETRY
+#define TELEMETRY(statements) statements
+#else
+#define TELEMETRY(statements)
+#endif
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+#ifdef DECODER_TELEMETRY
+
+/* count a sample handled in the given state, and the pulse it ended */
+static void countSample(timeDecoder* decoder, enum STATE state)
+{
+    decoderTelemetry* telemetry = &decoder->telemetry;
+
+    telemetry->samples++;
+    telemetry->dwell[state]++;
+
+    /* the state can also be changed between calls, after a full buffer */
+    if (state != telemetry->runState) {
+        uint32_t length = telemetry->runLength;
+
+        /* counters that were never cleared are wrong, but stay in bounds */
+        if (length && telemetry->runState <= bufferFull)
+            telemetry->dwellRuns[telemetry->runState]
+                                [length < DWELLBINS ? length - 1
+                                                    : DWELLBINS - 1]++;
+
+        telemetry->runState  = state;
+        telemetry->runLength = 0;
+    }
+
+    telemetry->runLength++;
+
+    int pulse = decoder->lastPulse;
+
+    if (pulse != NOPULSE)
+        telemetry->symbols[pulse == 'm'     ? symbolMarker
+                         : pulse == ERASURE ? symbolErasure
+                         : pulse]++;
+}
+
+#endif
+
+
+/* samples of a run that only count into the pulse, or don't change a thing */
+static int quietSamples(const timeDecoder* decoder, int input, int count)
+{
+    int quiet = 0;
+
+    switch (decoder->currentState) {
+
+        case waitForHigh:
+            quiet = input ? 0 : count;
+            break;
+
+        case waitForEdge:
+            quiet = input ? count : 0;
+            break;
+
+        case countLow:
+            quiet = input ? 0 : NSAMPLES - decoder->inputCount;
+            break;
+
+        case countHigh:
+            quiet = input ? NSAMPLES + NSPADDING - decoder->inputCount : 0;
+            break;
+
+        default:
+            break;
+    }
+
+    if (quiet < 0)
+        return 0;
+
+    return quiet < count ? quiet : count;
+}
+
+
 /******************************************************************************/
 /************* Functions to execute at each state of the decoder **************/
 /******************************************************************************/
@@ -19,7 +103,10 @@ int funcWaitForEdge(timeDecoder* decoder, int input)
     /* detected falling edge */
     if (!input) {
         decoder->currentState = countLow;
-        updateInputBuffer(decoder, input);
+
+        /* first sample of the first pulse, nothing was counted before it */
+        decoder->inputCount = 1;
+        decoder->zeroCount  = 1;
     }
 
     return 0;
@@ -30,11 +117,12 @@ int funcCountLow(timeDecoder* decoder, int input)
 {
     /* reset decoder if there are too many 0 samples */
     if (decoder->inputCount >= NSAMPLES) {
+        TELEMETRY(decoder->telemetry.resets[resetLongLow]++;)
         initDecoder(decoder);
         return 1;
     }
 
-    /* update input buffer */
+    /* count the sample into the pulse */
     updateInputBuffer(decoder, input);
 
     /* if input is 1, go to countHigh state */
@@ -51,47 +139,30 @@ int funcCountHigh(timeDecoder* decoder, int input)
     int over  = decoder->inputCount >= NSAMPLES + NSPADDING &&  input;
     int under = decoder->inputCount <  NSAMPLES - NSPADDING && !input;
 
+    /* one early 0 is a glitch, count it as a 1 and erase the pulse */
+    if (under && !decoder->glitched) {
+        decoder->glitched = 1;
+        TELEMETRY(decoder->telemetry.glitches++;)
+        updateInputBuffer(decoder, 1);
+        return 0;
+    }
+
     /* reset decoder if there are too many or not enough 1 samples */
     if (over || under) {
+        TELEMETRY(decoder->telemetry.resets[over ? resetLongHigh
+                                                 : resetShortHigh]++;)
         initDecoder(decoder);
         return 1;
     }
 
-    /* if input is 1, update inputCount and inputBuffer */
+    /* if input is 1, count it into the pulse */
     if (input) {
         updateInputBuffer(decoder, input);
         return 0;
     }
 
-    /* if input is 0, decode bit from inputBuffer and update bitBuffer */
-    int err = updateBitBuffer(decoder);
-
-    /* check for error conditions */
-    switch (err) {
-
-        case 1:    /* inputBuffer does not encode a valid bit */
-            initDecoder(decoder);
-            return err;
-
-        case 2:    /* valid bit, but haven't found start of frame */
-            initDecoder(decoder);
-            updateInputBuffer(decoder, input);
-            decoder->currentState = countLow;
-            return err;
-    }
-
-    /* go to bufferFull state if bitBuffer is now full */
-    if (decoder->bitCount >= BUFFERSIZE) {
-        decoder->currentState = bufferFull;
-        return 3;
-    }
-
-    /* start counting 0's again */
-    decoder->inputCount = 0;
-    decoder->currentState = countLow;
-    updateInputBuffer(decoder, input);
-
-    return 0;
+    /* if input is 0, decode bit from the pulse and update bitBuffer */
+    return finishPulse(decoder, updateBitBuffer(decoder));
 }
 
 
@@ -103,9 +174,11 @@ void initDecoder(timeDecoder* decoder)
 {
     /* reset everything to starting state */
     decoder->inputCount   = 0;
+    decoder->zeroCount    = 0;
     decoder->bitCount     = 0;
     decoder->currentState = waitForHigh;
     decoder->foundStart   = 0;
+    decoder->glitched     = 0;
 }
 
 
@@ -113,6 +186,11 @@ int updateDecoder(timeDecoder* decoder, int input)
 {
     int rVal;
 
+    TELEMETRY(enum STATE state = decoder->currentState;)
+
+    /* set again by appendPulse() if a pulse ends at this sample */
+    decoder->lastPulse = NOPULSE;
+
     switch(decoder->currentState) {
         case waitForHigh:
             rVal = funcWaitForHigh(decoder, input);
@@ -135,96 +213,185 @@ int updateDecoder(timeDecoder* decoder, int input)
             break;
     }
 
+    TELEMETRY(countSample(decoder, state);)
+
     return rVal;
 }
 
 
+int updateDecoderRun(timeDecoder* decoder, int input, int count, int* status)
+{
+    int done = 0;
+    *status = 0;
+
+    while (done < count) {
+        int quiet = quietSamples(decoder, input, count - done);
+
+        /* telemetry counts every sample in the state it was handled in */
+        TELEMETRY(quiet = 0;)
+
+        if (quiet) {
+            if (decoder->currentState == countLow ||
+                decoder->currentState == countHigh) {
+                decoder->inputCount += quiet;
+
+                if (!input)
+                    decoder->zeroCount += quiet;
+            }
+
+            decoder->lastPulse = NOPULSE;
+            done += quiet;
+            continue;
+        }
+
+        /* the sample that changes the state */
+        *status = updateDecoder(decoder, input);
+        done++;
+
+        if (*status || decoder->lastPulse != NOPULSE)
+            break;
+    }
+
+    return done;
+}
+
+
 int updateTimeAndDate(timeDecoder* decoder, time_t* currentTime, int* dst)
 {
-    char* frame1 = decoder->bitBuffer;
-    char* frame2 = decoder->bitBuffer + 60;
+    enum FRAMEPAIR outcome = decodeFramePair(decoder->bitBuffer, currentTime,
+                                             dst);
+    countFramePair(decoder, outcome);
+
+    return outcome != pairDecoded;
+}
+
+
+int decodeFrames(char* frames, time_t* currentTime, int* dst)
+{
+    return decodeFramePair(frames, currentTime, dst) != pairDecoded;
+}
 
-    struct tm frame1Time, frame2Time;
+
+enum FRAMEPAIR decodeFramePair(char* frames, time_t* currentTime, int* dst)
+{
+    time_t times1[1 << MAXERASURES], times2[1 << MAXERASURES];
+    int    dsts1[1 << MAXERASURES],  dsts2[1 << MAXERASURES];
 
     /* decode the 2 frames and check for errors */
-    if (decodeFrame(frame1, &frame1Time) || decodeFrame(frame2, &frame2Time))
-        return 1;
+    int count1 = decodeErasedFrame(frames, times1, dsts1);
 
-    /* daylight saving times don't match */
-    if (frame1Time.tm_isdst != frame2Time.tm_isdst)
-        return 1;
+    if (!count1)
+        return pairBadFirst;
 
-    /* remove and store dst flag */
-    int dstFlag = frame2Time.tm_isdst;
-    frame1Time.tm_isdst = frame2Time.tm_isdst = -1;
+    int count2 = decodeErasedFrame(frames + 60, times2, dsts2);
 
-    /* convert to unix time */
-    time_t unixTime1 = mktime(&frame1Time);
-    time_t unixTime2 = mktime(&frame2Time);
+    if (!count2)
+        return pairBadSecond;
 
-    /* check for time conversion errors */
-    if (unixTime1 == -1 || unixTime2 == -1)
-        return 1;
+    int    found = 0;
+    time_t unixTime = 0;
+    int    dstFlag = 0;
 
-    /* check that the two frames differ by 60 seconds */
-    if (unixTime2 - unixTime1 != 60)
-        return 1;
+    for (int i = 0; i < count1; i++) {
+        for (int j = 0; j < count2; j++) {
+            /* the two frames differ by 60 seconds, with matching DST */
+            if (times2[j] - times1[i] != 60 || dsts1[i] != dsts2[j])
+                continue;
+
+            /* erasures leave two different times possible */
+            if (found && times2[j] != unixTime)
+                return pairAmbiguous;
+
+            found    = 1;
+            unixTime = times2[j];
+            dstFlag  = dsts2[j];
+        }
+    }
+
+    if (!found)
+        return pairMismatch;
 
     /* 60 seconds has passed since the second frame */
-    *currentTime = unixTime2 + 60;
+    *currentTime = unixTime + 60;
     *dst = dstFlag;
 
-    return 0;
+    return pairDecoded;
+}
+
+
+void keepLastMarker(timeDecoder* decoder)
+{
+    initDecoder(decoder);
+
+    /* the falling edge that ended the marker starts the next pulse */
+    decoder->currentState = countLow;
+    decoder->bitCount = 1;
+    updateInputBuffer(decoder, 0);
 }
 
 
 void updateInputBuffer(timeDecoder* decoder, int input)
 {
-    /* update inputCount and inputBuffer */
-    (decoder->inputBuffer)[decoder->inputCount++] = input;
+    /* running counts, the samples themselves are not needed */
+    decoder->inputCount++;
+
+    if (!input)
+        decoder->zeroCount++;
 }
 
 
 int updateBitBuffer(timeDecoder* decoder)
 {
-    int zeroCounts = 0;
+    return appendPulse(decoder, decoder->zeroCount);
+}
+
+
+int appendPulse(timeDecoder* decoder, int zeroCounts)
+{
+    int bit = classifyPulse(zeroCounts);
 
-    char* inputBuffer = decoder->inputBuffer;
+    /* keep the second, only its bit is lost */
+    if (bit < 0 || decoder->glitched)
+        bit = ERASURE;
+
+    decoder->lastPulse = bit;
+
+    return appendBit(decoder->bitBuffer, &decoder->bitCount,
+                     &decoder->foundStart, bit);
+}
 
-    /* Count number of zeroes */
-    for (int i = 0; i < decoder->inputCount; i++)
-        if (!inputBuffer[i]) zeroCounts++;
 
+int classifyPulse(int zeroCounts)
+{
     /* number or zero samples encode the bit */
     int marker = 4 * NSAMPLES / 5;
     int zero   =     NSAMPLES / 5;
     int one    =     NSAMPLES / 2;
 
     int padding = NSPADDING / 2;
-    char bit;
 
     if (zeroCounts >= marker - padding && zeroCounts <= marker + padding)
-        bit = 'm';
+        return 'm';
     else if (zeroCounts >= zero - padding && zeroCounts <= zero + padding)
-        bit = 0;
+        return 0;
     else if (zeroCounts >= one - padding && zeroCounts <= one + padding)
-        bit = 1;
-    else
         return 1;
 
+    return -1;
+}
 
-    int   bitCount  = decoder->bitCount;
-    char* bitBuffer = decoder->bitBuffer;
 
+int appendBit(char* bitBuffer, int* bitCount, int* foundStart, char bit)
+{
     /* if empty bitBuffer and marker, or frame star found, append bit */
-    if ((bitCount == 0 && bit == 'm') || decoder->foundStart) {
-        bitBuffer[decoder->bitCount++] = bit;
+    if ((*bitCount == 0 && bit == 'm') || *foundStart) {
+        bitBuffer[(*bitCount)++] = bit;
         return 0;
     }
 
     /* two consecutive marker bits, start of frame has been found */
-    if (bitCount == 1 && bitBuffer[0] == 'm' && bit == 'm') {
-        decoder->foundStart = 1;
+    if (*bitCount == 1 && bitBuffer[0] == 'm' && bit == 'm') {
+        *foundStart = 1;
         return 0;
     }
 
@@ -232,36 +399,167 @@ int updateBitBuffer(timeDecoder* decoder)
 }
 
 
+int finishPulse(timeDecoder* decoder, int err)
+{
+    /* the glitch, if any, only erased the pulse that just ended */
+    decoder->glitched = 0;
+
+    /* check for error conditions */
+    switch (err) {
+
+        case 2:    /* valid bit, but haven't found start of frame */
+            TELEMETRY(decoder->telemetry.resets[resetNoStart]++;)
+            initDecoder(decoder);
+            updateInputBuffer(decoder, 0);
+            decoder->currentState = countLow;
+            return err;
+    }
+
+    /* go to bufferFull state if bitBuffer is now full */
+    if (decoder->bitCount >= BUFFERSIZE) {
+        decoder->currentState = bufferFull;
+        return 3;
+    }
+
+    /* start counting 0's again */
+    decoder->inputCount = 0;
+    decoder->zeroCount = 0;
+    decoder->currentState = countLow;
+    updateInputBuffer(decoder, 0);
+
+    return 0;
+}
+
+
 int decodeFrame(char* frame, struct tm* frameTime)
+{
+    uint64_t data, markers;
+    packFrame(frame, &data, &markers);
+
+    uint64_t erasures = packErasures(frame);
+
+    /* an erased field bit could be either, one frame can't tell which */
+    if (erasures & FIELDMASK || __builtin_popcountll(erasures) > MAXERASURES)
+        return 1;
+
+    return decodePackedFrame(data, markers | (erasures & MARKERMASK),
+                             frameTime);
+}
+
+
+int decodeErasedFrame(char* frame, time_t* times, int* dsts)
+{
+    uint64_t data, markers;
+    packFrame(frame, &data, &markers);
+
+    uint64_t erasures = packErasures(frame);
+    uint64_t unknown  = erasures & FIELDMASK;
+
+    if (__builtin_popcountll(erasures) > MAXERASURES)
+        return 0;
+
+    /* erased markers are taken as received, erased 0's already are */
+    markers |= erasures & MARKERMASK;
+
+    int count = 0;
+    uint64_t fill = 0;
+
+    /* every combination of values for the erased field bits */
+    do {
+        struct tm frameTime;
+
+        if (!decodePackedFrame(data | fill, markers, &frameTime)) {
+            times[count] = timeFromCivil(&frameTime);
+            dsts[count]  = frameTime.tm_isdst;
+            count++;
+        }
+
+        fill = (fill - unknown) & unknown;
+    } while (fill);
+
+    return count;
+}
+
+
+int decodeTime(char* frame, struct tm* frameTime)
+{
+    uint64_t data, markers;
+    packFrame(frame, &data, &markers);
+
+    return decodePackedTime(data, frameTime);
+}
+
+
+int decodeDate(char* frame, struct tm* frameTime)
+{
+    uint64_t data, markers;
+    packFrame(frame, &data, &markers);
+
+    return decodePackedDate(data, frameTime);
+}
+
+
+int checkFrame(char* frame)
+{
+    uint64_t data, markers;
+    packFrame(frame, &data, &markers);
+
+    return checkPackedFrame(data, markers);
+}
+
+
+void packFrame(char* frame, uint64_t* data, uint64_t* markers)
+{
+    uint64_t dataBits   = 0;
+    uint64_t markerBits = 0;
+
+    /* frame bit i goes to bit i of the packed words */
+    for (int i = FRAMESIZE - 1; i >= 0; i--) {
+        dataBits   = dataBits   << 1 | (frame[i] == 1);
+        markerBits = markerBits << 1 | (frame[i] == 'm');
+    }
+
+    *data    = dataBits;
+    *markers = markerBits;
+}
+
+
+uint64_t packErasures(char* frame)
+{
+    uint64_t erasures = 0;
+
+    for (int i = FRAMESIZE - 1; i >= 0; i--)
+        erasures = erasures << 1 | (frame[i] == ERASURE);
+
+    return erasures;
+}
+
+
+int decodePackedFrame(uint64_t data, uint64_t markers, struct tm* frameTime)
 {
     /* check position of marker and predefined 0 bits */
-    if (checkFrame(frame))
+    if (checkPackedFrame(data, markers))
         return 1;
 
 
     /* decode time and check for errors */
-    if (decodeTime(frame, frameTime))
+    if (decodePackedTime(data, frameTime))
         return 1;
 
 
     /* decode date and check for errors */
-    if (decodeDate(frame, frameTime))
+    if (decodePackedDate(data, frameTime))
         return 1;
 
     return 0;
 }
 
 
-int decodeTime(char* frame, struct tm* frameTime)
+int decodePackedTime(uint64_t data, struct tm* frameTime)
 {
     /* calculate hour and minute */
-    int minute = frame[1] * 40 + frame[2] * 20
-               + frame[3] * 10 + frame[5] * 8
-               + frame[6] * 4  + frame[7] * 2  + frame[8];
-
-    int hour   = frame[12] * 20 + frame[13] * 10
-               + frame[15] *  8 + frame[16] * 4
-               + frame[17] *  2 + frame[18];
+    int minute = decodeField(data, minuteField);
+    int hour   = decodeField(data, hourField);
 
     /* check that encoded hour and minutes are valid */
     if (minute > 59 || hour > 23)
@@ -275,67 +573,44 @@ int decodeTime(char* frame, struct tm* frameTime)
 }
 
 
-int decodeDate(char* frame, struct tm* frameTime)
+int decodePackedDate(uint64_t data, struct tm* frameTime)
 {
     /* calculate day of year and current year */
-    int day  = frame[22] * 200 + frame[23] * 100
-             + frame[25] * 80  + frame[26] * 40
-             + frame[27] * 20  + frame[28] * 10
-             + frame[30] * 8   + frame[31] * 4
-             + frame[32] * 2   + frame[33];
-
-    int year = frame[45] * 80 + frame[46] * 40
-             + frame[47] * 20 + frame[48] * 10
-             + frame[50] * 8  + frame[51] * 4
-             + frame[52] * 2  + frame[53] + 2000;
-
-    int dst  = frame[57] && frame[58];
-
-    /* check if it's a leap year */
-    int leapYear = 0;
-    if (year % 400 == 0 || (year % 4 == 0 && year % 100 != 0))
-        leapYear = 1;
-
-    /* check that the encoded day is valid and leap year matches up */
-    if (day > 365 + leapYear || leapYear != frame[55])
-        return 1;
+    int day  = decodeField(data, dayField);
+    int year = decodeField(data, yearField) + 2000;
 
+    int dst  = (int) (data >> DSTATENDBIT & 1) * DSTBEGINS
+             | (int) (data >> DSTATSTARTBIT & 1) * DSTENDS;
 
-    int daysInMonth[12] = {31, 28 + leapYear, 31, 30, 31, 30,
-                           31, 31,            30, 31, 30, 31};
+    int leapYear = isLeapYear(year);
 
-    /* 0 to 11 inclusive for month, convention of tm struct */
-    int month    = 0;
-    int daysUsed = 0;
+    /* check that the leap year flag matches up */
+    if (leapYear != (int) (data >> LEAPYEARBIT & 1))
+        return 1;
 
-    /* calculate current month */
-    while (day > daysUsed)
-        daysUsed += daysInMonth[month++];
+    /* 0 to 11 inclusive for month, convention of tm struct */
+    int month, dayOfMonth;
 
-    /* calculate day of the month */
-    int dayOfMonth = daysInMonth[--month] - (daysUsed - day);
+    /* check that the encoded day is valid, get month and day of the month */
+    if (monthFromDayOfYear(day, leapYear, &month, &dayOfMonth))
+        return 1;
 
     /* update current date */
     frameTime->tm_year  = year - 1900;    /* convention of tm struct */
     frameTime->tm_mon   = month;
     frameTime->tm_mday  = dayOfMonth;
+    frameTime->tm_yday  = day - 1;
     frameTime->tm_isdst = dst;
 
     return 0;
 }
 
 
-int checkFrame(char* frame)
+int checkPackedFrame(uint64_t data, uint64_t markers)
 {
-    int valid =
-        frame[0]  == 'm' && frame[4]  ==  0  && frame[9]  == 'm' &&
-        frame[10] ==  0  && frame[11] ==  0  && frame[14] ==  0  &&
-        frame[19] == 'm' && frame[20] ==  0  && frame[21] ==  0  &&
-        frame[24] ==  0  && frame[29] == 'm' && frame[34] ==  0  &&
-        frame[35] ==  0  && frame[39] == 'm' && frame[44] ==  0  &&
-        frame[49] == 'm' && frame[54] ==  0  && frame[59] == 'm';
+    /* markers exactly where expected, and no 1 in a predefined 0 bit */
+    int valid = markers == MARKERMASK && !(data & ZEROMASK);
 
     /* follow convention of returning 0 for success */
     return !valid;
 }
-
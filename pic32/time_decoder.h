@@ -1,11 +1,37 @@
 #ifndef DECODER_H_
 #define DECODER_H_
 
+#include <stdint.h>
 #include <time.h>
 
-#define NSAMPLES 10       /* Number of samples per second */
-#define NSPADDING 2       /* Padding for error tolerance */
+/*
+ * The sample rate, and the tolerances that scale with it, can be set with
+ * -D for a build of the decoder at another rate. Pulses are counted, not
+ * stored, so the decoder is the same size at any rate.
+ */
+#ifndef NSAMPLES
+#define NSAMPLES 10                 /* Number of samples per second */
+#endif
+
+#ifndef NSPADDING
+#define NSPADDING (NSAMPLES / 5)    /* Padding for error tolerance */
+#endif
+
+#if NSAMPLES % 10 || NSAMPLES < 10
+#error "NSAMPLES must be a multiple of 10, for whole tenths of a second"
+#endif
+
 #define BUFFERSIZE 120    /* Number of transmitted bits to store */
+#define NOPULSE -2        /* No pulse ended at the last sample */
+#define ERASURE 'x'       /* Bit of a pulse that is not a valid encoding */
+#define MAXERASURES 4     /* Erased bits a frame may have and still decode */
+#define DWELLBINS 16      /* Stays in a state by length, the last bin for longer */
+
+/* DST status of a frame, from its DSTATENDBIT and DSTATSTARTBIT */
+#define DSTOFF 0          /* Standard time all day, neither bit set */
+#define DSTBEGINS 1       /* DST begins today, DSTATENDBIT set */
+#define DSTENDS 2         /* DST ends today, DSTATSTARTBIT set */
+#define DSTON 3           /* DST all day, both bits set */
 
 enum STATE {
     waitForHigh,
@@ -15,12 +41,65 @@ enum STATE {
     bufferFull
 };
 
+/* why the state machine was reset */
+enum RESETCAUSE {
+    resetLongLow,     /* too many 0 samples in funcCountLow() */
+    resetLongHigh,    /* too many 1 samples in funcCountHigh() */
+    resetShortHigh,   /* too few 1 samples in funcCountHigh() */
+    resetNoStart,     /* valid bit before the start of frame */
+    NRESETCAUSES
+};
 
-/* Stores received signals from receiver board */
+/* how a frame pair decoded */
+enum FRAMEPAIR {
+    pairDecoded,
+    pairBadFirst,     /* first frame has no valid reading */
+    pairBadSecond,    /* second frame has no valid reading */
+    pairMismatch,     /* no readings 60 seconds apart with the same DST */
+    pairAmbiguous,    /* erasures leave two different times possible */
+    NFRAMEPAIRS
+};
+
+enum SYMBOL {
+    symbolZero,
+    symbolOne,
+    symbolMarker,
+    symbolErasure,
+    NSYMBOLS
+};
+
+
+#ifdef DECODER_TELEMETRY
+#include <string.h>
+
+/*
+ * Counters kept by updateDecoder() and updateTimeAndDate() when built with
+ * DECODER_TELEMETRY. Samples are 100 ms each, so the counters last for
+ * years. initDecoder() leaves them alone, so they have to be set up with
+ * clearDecoderTelemetry() before the first sample.
+ */
 typedef struct {
-    /* stores raw input from receiver board */
-    char inputBuffer[NSAMPLES + NSPADDING];
+    uint32_t samples;                   /* calls to updateDecoder() */
+    uint32_t resets[NRESETCAUSES];
+    uint32_t symbols[NSYMBOLS];         /* pulses by the bit they encode */
+    uint32_t glitches;                  /* pulses erased by an early 0 */
+    uint32_t dwell[bufferFull + 1];     /* samples spent in each state */
+
+    /* stays in each state by length in samples, 1 to DWELLBINS or more */
+    uint32_t dwellRuns[bufferFull + 1][DWELLBINS];
 
+    enum STATE runState;                /* state of the stay so far */
+    uint32_t   runLength;
+
+    uint32_t pairs[NFRAMEPAIRS];        /* frame pairs by how they decoded */
+    uint32_t firstSync;                 /* samples to the first decoded pair */
+    uint32_t lastSync;                  /* samples to the last one */
+} decoderTelemetry;
+
+#endif
+
+/* Stores received signals from receiver board */
+typedef struct {
     /* stores bits encoded in the transmission */
     char bitBuffer[BUFFERSIZE];
 
@@ -29,11 +108,66 @@ typedef struct {
 
     int foundStart;   /* have seen two consecutive marker bits */
     int bitCount;     /* number of encoded bits stored in bitBuffer */
-    int inputCount;   /* number of raw input samples in inputBuffer */
+    int inputCount;   /* number of raw input samples in the current pulse */
+    int zeroCount;    /* number of them that were 0 */
+    int glitched;     /* current pulse had a 0 sample too early, erase it */
+
+    /* pulse that ended at the last sample, 0, 1, 'm', ERASURE if invalid,
+     * or NOPULSE, set by every call to updateDecoder() */
+    int lastPulse;
+
+#ifdef DECODER_TELEMETRY
+    decoderTelemetry telemetry;
+#endif
 
 } timeDecoder;
 
 
+/*
+ * \brief Reset the telemetry counters of a timeDecoder.
+ *
+ * Does nothing unless built with DECODER_TELEMETRY.
+ *
+ * \param decoder Pointer to the timeDecoder.
+ */
+static inline void clearDecoderTelemetry(timeDecoder* decoder)
+{
+#ifdef DECODER_TELEMETRY
+    memset(&decoder->telemetry, 0, sizeof(decoder->telemetry));
+#else
+    (void) decoder;
+#endif
+}
+
+
+/*
+ * \brief Count a frame pair decoded outside of updateTimeAndDate().
+ *
+ * Does nothing unless built with DECODER_TELEMETRY.
+ *
+ * \param decoder Pointer to the timeDecoder that found the pulses.
+ * \param outcome How the pair decoded, pairDecoded for a sync.
+ */
+static inline void countFramePair(timeDecoder* decoder, enum FRAMEPAIR outcome)
+{
+#ifdef DECODER_TELEMETRY
+    decoderTelemetry* telemetry = &decoder->telemetry;
+
+    if (outcome == pairDecoded) {
+        if (!telemetry->pairs[pairDecoded])
+            telemetry->firstSync = telemetry->samples;
+
+        telemetry->lastSync = telemetry->samples;
+    }
+
+    telemetry->pairs[outcome]++;
+#else
+    (void) decoder;
+    (void) outcome;
+#endif
+}
+
+
 /*
  * \brief Initialize a timeDecoder state machine.
  *
@@ -50,20 +184,42 @@ void initDecoder(timeDecoder* decoder);
  *
  * \returns
  *     0: No errors detected yet in signal.
- *     1: Error detected in time signal and timeDecoder state machine
- *        has been reset.
+ *     1: Pulse too long or too short to keep track of the seconds, and
+ *        timeDecoder state machine has been reset. A pulse of the right
+ *        length that is not a valid encoding is kept as an ERASURE bit.
  *     2: Signal valid so far, but have not found start of frame.
  *     3: Buffer storing encoded bits is full, ready for decoding.
  */
 int updateDecoder(timeDecoder* decoder, int input);
 
 
+/*
+ * \brief Update the timeDecoder state machine with a run of equal samples.
+ *
+ * Equivalent to calling updateDecoder() on every sample of the run, for
+ * input that comes as edges rather than one sample at a time. The samples
+ * of a pulse are counted in one step, except in builds with
+ * DECODER_TELEMETRY, which keep counting every sample. Stops after the
+ * first sample for which updateDecoder() would not have returned 0, or
+ * that ended a pulse, so the status and lastPulse are those of the last
+ * sample consumed.
+ *
+ * \param decoder Pointer to timeDecoder to update.
+ * \param input Level of every sample of the run.
+ * \param count Number of samples in the run, at least 1.
+ * \param status Stores what updateDecoder() returned for the last sample.
+ *
+ * \returns Number of samples consumed, 1 to count.
+ */
+int updateDecoderRun(timeDecoder* decoder, int input, int count, int* status);
+
+
 /*
  * \brief Decode received transmission frames and get the current time and date.
  *
  * \param decoder Pointer to timeDecoder.
  * \param currentTime Stores the current time and date if decoding is successful.
- * \param dst Indicates if DST is in effect.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
  *
  * \returns
  *     0: Time signal is successfully decoded
@@ -73,7 +229,40 @@ int updateTimeAndDate(timeDecoder* decoder, time_t* currentTime, int* dst);
 
 
 /*
- * \brief Update the input buffer of the timeDecoder.
+ * \brief Decode two consecutive frames and get the current time and date.
+ *
+ * \param frames Pointer to array storing two full frames, 60 seconds apart.
+ * \param currentTime Stores the time at the end of the second frame.
+ * \param dst Stores the DST status of the frames, DSTOFF to DSTON.
+ *
+ * \returns
+ *     0: Time signal is successfully decoded
+ *     1: Error(s) in time signal.
+ */
+int decodeFrames(char* frames, time_t* currentTime, int* dst);
+
+
+/*
+ * \brief Same as decodeFrames(), but tells why a frame pair did not decode.
+ *
+ * \returns pairDecoded, or the first reason the pair was rejected for.
+ */
+enum FRAMEPAIR decodeFramePair(char* frames, time_t* currentTime, int* dst);
+
+
+/*
+ * \brief Restart a full timeDecoder from the marker that ended its buffer.
+ *
+ * The marker stays as the first bit, so the next frame pair is ready after
+ * another BUFFERSIZE - 1 bits.
+ *
+ * \param decoder Pointer to the timeDecoder to restart.
+ */
+void keepLastMarker(timeDecoder* decoder);
+
+
+/*
+ * \brief Count a raw input sample into the current pulse.
  *
  * \param decoder Pointer to the timeDecoder to update.
  * \param input Raw input sample from receiver board.
@@ -83,21 +272,72 @@ void updateInputBuffer(timeDecoder* decoder, int input);
 
 /*
  * \brief Update the bit buffer of the timeDecoder by decoding
- *        the samples from inputBuffer.
+ *        the samples counted into the current pulse.
  *
  * \param decoder Pointer to the timeDecoder to update.
  *
  * \returns
- *     0: Input buffer decoded successfully.
- *     1: Input buffer is not a valid encoding.
- *     2: Input buffer is valid but can be discarded.
+ *     0: Input buffer decoded successfully, or kept as an ERASURE bit.
+ *     2: Input buffer can be discarded.
  */
 int updateBitBuffer(timeDecoder* decoder);
 
 
+/*
+ * \brief Classify one pulse and append the encoded bit to the bit buffer.
+ *
+ * \param decoder Pointer to the timeDecoder to update.
+ * \param zeroCounts Number of 0 samples in the pulse.
+ *
+ * \returns
+ *     0: Pulse decoded successfully, or kept as an ERASURE bit.
+ *     2: Pulse can be discarded.
+ */
+int appendPulse(timeDecoder* decoder, int zeroCounts);
+
+
+/*
+ * \brief Classify a pulse by the number of 0 samples in it.
+ *
+ * \param zeroCounts Number of 0 samples in the pulse.
+ *
+ * \returns 0 or 1 for a data bit, 'm' for a marker, -1 if not a valid pulse.
+ */
+int classifyPulse(int zeroCounts);
+
+
+/*
+ * \brief Append a decoded bit to a bit buffer, waiting for the frame start.
+ *
+ * \param bitBuffer Bit buffer to append to.
+ * \param bitCount Number of bits in bitBuffer, updated.
+ * \param foundStart Flag for having seen two consecutive markers, updated.
+ * \param bit Bit to append, 0, 1, 'm' or ERASURE.
+ *
+ * \returns
+ *     0: Bit appended, or start of frame found.
+ *     2: Bit is valid but can be discarded.
+ */
+int appendBit(char* bitBuffer, int* bitCount, int* foundStart, char bit);
+
+
+/*
+ * \brief Update the state machine at the falling edge that ends a pulse.
+ *
+ * \param decoder Pointer to the timeDecoder to update.
+ * \param err Return value of updateBitBuffer() or appendPulse() for the pulse.
+ *
+ * \returns Same as updateDecoder() for the sample holding the falling edge.
+ */
+int finishPulse(timeDecoder* decoder, int err);
+
+
 /*
  * \brief Decode the time and date from one complete frame of transmission.
  *
+ * Erased markers and predefined 0 bits are taken as received, an erased
+ * field bit fails the frame.
+ *
  * \param frame Pointer to array storing one full frame.
  * \param frameTime Stores the frame time and date.
  *
@@ -108,6 +348,24 @@ int updateBitBuffer(timeDecoder* decoder);
 int decodeFrame(char* frame, struct tm* frameTime);
 
 
+/*
+ * \brief Decode every time a frame with erased bits could encode.
+ *
+ * Erased markers and predefined 0 bits are taken as received, and every
+ * combination of erased field bits is tried. A frame without erasures has
+ * at most one reading.
+ *
+ * \param frame Pointer to array storing one full frame.
+ * \param times Stores the start of the minute of each reading, room for
+ *        1 << MAXERASURES.
+ * \param dsts Stores the DST status of each reading.
+ *
+ * \returns Number of readings, 0 if the frame can't be decoded or has more
+ *          than MAXERASURES erased bits.
+ */
+int decodeErasedFrame(char* frame, time_t* times, int* dsts);
+
+
 /*
  * \brief Decode only the time from one complete frame of transmission.
  *
@@ -146,5 +404,49 @@ int decodeDate(char* frame, struct tm* frameTime);
 int checkFrame(char* frame);
 
 
+/*
+ * \brief Pack one frame into 64-bit words, frame bit i goes to bit i.
+ *
+ * \param frame Pointer to array storing one full frame.
+ * \param data Stores a word with the 1 bits of the frame set.
+ * \param markers Stores a word with the marker bits of the frame set.
+ */
+void packFrame(char* frame, uint64_t* data, uint64_t* markers);
+
+
+/*
+ * \brief Pack the erased bits of one frame, frame bit i goes to bit i.
+ *
+ * \param frame Pointer to array storing one full frame.
+ *
+ * \returns A word with the ERASURE bits of the frame set.
+ */
+uint64_t packErasures(char* frame);
+
+
+/*
+ * \brief Same as decodeFrame(), for a frame packed with packFrame().
+ */
+int decodePackedFrame(uint64_t data, uint64_t markers, struct tm* frameTime);
+
+
+/*
+ * \brief Same as decodeTime(), for the data word of a packed frame.
+ */
+int decodePackedTime(uint64_t data, struct tm* frameTime);
+
+
+/*
+ * \brief Same as decodeDate(), for the data word of a packed frame.
+ */
+int decodePackedDate(uint64_t data, struct tm* frameTime);
+
+
+/*
+ * \brief Same as checkFrame(), for a frame packed with packFrame().
+ */
+int checkPackedFrame(uint64_t data, uint64_t markers);
+
+
 #endif /* DECODER_H_ */
 
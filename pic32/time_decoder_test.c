@@ -1,5 +1,6 @@
 #include <stdio.h>
 
+#include "civil_time.h"
 #include "time_decoder.h"
 
 void printState(timeDecoder* decoder)
@@ -46,7 +47,7 @@ int testFullTransmission(timeDecoder* decoder)
         c = getchar();
     }
 
-    struct tm* currentTime;
+    struct tm currentTime;
     time_t unixTime;
     int dst;
 
@@ -63,13 +64,13 @@ int testFullTransmission(timeDecoder* decoder)
     decoder->bitCount = 1;
     updateInputBuffer(decoder, 0);
 
-    currentTime = localtime(&unixTime);
+    civilFromTime(unixTime, &currentTime);
 
-    int year = 1900 + currentTime->tm_year;
-    int month = currentTime->tm_mon + 1;
-    int day = currentTime->tm_mday;
-    int hour = currentTime->tm_hour;
-    int minute = currentTime->tm_min;
+    int year = 1900 + currentTime.tm_year;
+    int month = currentTime.tm_mon + 1;
+    int day = currentTime.tm_mday;
+    int hour = currentTime.tm_hour;
+    int minute = currentTime.tm_min;
 
     printf("%d-%02d-%02d %02d:%02d\n", year, month, day, hour, minute);
 
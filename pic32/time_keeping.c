@@ -1,11 +1,379 @@
+#include <stdlib.h>
+
+#include "civil_time.h"
+#include "time_decoder.h"
 #include "time_keeping.h"
 
-void tick(time_keeper* timeKeeper)
+/* the pulses are found by the decoder in the sample of each tick */
+#if NSAMPLES != NTICKS
+#error "the time keeper ticks at NTICKS per second, build with NSAMPLES 10"
+#endif
+
+/* most phase trim a tick can take on top of MAXTRIM, within MAXPERIOD */
+#define MAXSLEW ((MAXPERIOD - MS100) * (long) TRIMSCALE - MAXTRIM - TRIMSCALE)
+
+/******************************************************************************/
+/******************************** Local time **********************************/
+/******************************************************************************/
+
+/* UTC time of the DST change of a year, away from the DST state given */
+static time_t dstChangeTime(int year, int dst, long utcOffset)
+{
+    /* ends on the first Sunday of November, starts on the second of March */
+    long first = daysFromCivil(year, dst ? 11 : 3, 1);
+
+    /* 1970-01-01 was a Thursday */
+    int  wday   = (first % 7 + 11) % 7;
+    long sunday = first + (7 - wday) % 7 + (dst ? 0 : 7);
+
+    /* DSTHOUR in the local time before the change */
+    return (time_t) sunday * SECONDSPERDAY + DSTHOUR * 3600L
+         - utcOffset - dst * 3600L;
+}
+
+
+/*
+ * DST at a decoded time from the DST status of the frames, and the UTC time
+ * of the change if there is one that day, 0 otherwise. The time is the end
+ * of the last frame, so the frame is on the UTC day of the minute before.
+ */
+static int dstFromStatus(time_t time, int status, long utcOffset,
+                         time_t* change)
+{
+    *change = 0;
+
+    if (status == DSTOFF || status == DSTON)
+        return status == DSTON;
+
+    /* DSTHOUR in the local time before the change */
+    int    before   = status == DSTENDS;
+    time_t dayStart = (time - 60) / SECONDSPERDAY * SECONDSPERDAY;
+
+    *change = dayStart + DSTHOUR * 3600L - utcOffset - before * 3600L;
+
+    return time >= *change ? !before : before;
+}
+
+
+/* full conversion of the current time to local time, only after a reset */
+static void convertLocalTime(time_keeper* timeKeeper)
+{
+    long   dstOffset = timeKeeper->dst * 3600L;
+    time_t localUnix = timeKeeper->currentTime + timeKeeper->utcOffset
+                     + dstOffset;
+
+    civilFromTime(localUnix, &timeKeeper->localTime);
+    timeKeeper->localTime.tm_isdst = timeKeeper->dst;
+
+    /* the change this year, or next year's if it has passed */
+    int year = timeKeeper->localTime.tm_year + 1900;
+    timeKeeper->dstChange = dstChangeTime(year, timeKeeper->dst,
+                                          timeKeeper->utcOffset);
+
+    if (timeKeeper->dstChange <= timeKeeper->currentTime)
+        timeKeeper->dstChange = dstChangeTime(year + 1, timeKeeper->dst,
+                                              timeKeeper->utcOffset);
+}
+
+
+/* carry the local time forward by one day */
+static void nextDay(struct tm* localTime)
+{
+    localTime->tm_wday = (localTime->tm_wday + 1) % 7;
+    localTime->tm_yday++;
+
+    if (++localTime->tm_mday <= daysInMonth(localTime->tm_year + 1900,
+                                            localTime->tm_mon))
+        return;
+
+    localTime->tm_mday = 1;
+
+    if (++localTime->tm_mon < 12)
+        return;
+
+    localTime->tm_mon  = 0;
+    localTime->tm_yday = 0;
+    localTime->tm_year++;
+}
+
+
+/* carry the local time forward by one second */
+static void nextSecond(struct tm* localTime)
+{
+    if (++localTime->tm_sec < 60)
+        return;
+
+    localTime->tm_sec = 0;
+
+    if (++localTime->tm_min < 60)
+        return;
+
+    localTime->tm_min = 0;
+
+    if (++localTime->tm_hour < 24)
+        return;
+
+    localTime->tm_hour = 0;
+    nextDay(localTime);
+}
+
+
+/* switch DST on the schedule, both changes stay within the same day */
+static void changeDst(time_keeper* timeKeeper)
+{
+    int dst = !timeKeeper->dst;
+
+    timeKeeper->dst = dst;
+    timeKeeper->localTime.tm_isdst = dst;
+    timeKeeper->localTime.tm_hour += dst ? 1 : -1;
+
+    timeKeeper->dstChange = dstChangeTime(timeKeeper->localTime.tm_year + 1900
+                                          + !dst, dst, timeKeeper->utcOffset);
+}
+
+
+/******************************************************************************/
+/***************************** Phase discipline *******************************/
+/******************************************************************************/
+
+/*
+ * Where the falling edge at the start of a pulse is, in timer ticks from the
+ * start of the current tick. Reads at or after the edge are low, so a level
+ * in between counts the reads before it. A sample that is all low follows
+ * either a partly low sample that still rounded to 1, or an edge in the gap
+ * between sampling windows.
+ */
+static long edgeOffset(int level, int lastLevel, unsigned lastPeriod)
+{
+    long interval = READTICKS;
+
+    if (level > 0)
+        return level * interval - interval / 2;
+
+    if (lastLevel < NOVERSAMPLES)
+        return lastLevel * interval - interval / 2 - (long) lastPeriod;
+
+    return (NOVERSAMPLES * interval - (long) lastPeriod) / 2;
+}
+
+
+/*
+ * Move the seconds onto an edge, over the next second, or over as many
+ * ticks as it takes to keep each of them within MAXPERIOD.
+ */
+static void stepPhase(time_keeper* timeKeeper, long error)
+{
+    /* whole ticks out, move the tick count instead, within the second */
+    while (error < -MS100 / 2 && timeKeeper->subSecondCount < NTICKS - 1) {
+        timeKeeper->subSecondCount++;
+        error += MS100;
+    }
+
+    while (error > MS100 / 2 && timeKeeper->subSecondCount > 0) {
+        timeKeeper->subSecondCount--;
+        error -= MS100;
+    }
+
+    long trim  = error * TRIMSCALE;
+    long ticks = (labs(trim) + MAXSLEW - 1) / MAXSLEW;
+
+    if (ticks < NTICKS)
+        ticks = NTICKS;
+
+    timeKeeper->phaseTrim = trim / ticks;
+    timeKeeper->slewTicks = (int) ticks;
+    timeKeeper->locked    = 1;
+    timeKeeper->outliers  = 0;
+}
+
+
+/* proportional and integral steps of the phase-locked loop */
+static void steerPhase(time_keeper* timeKeeper, long error)
+{
+    long freqTrim = timeKeeper->freqTrim
+                  + error * TRIMSCALE / (NTICKS << FREQSHIFT);
+
+    if (freqTrim > MAXTRIM)
+        freqTrim = MAXTRIM;
+    if (freqTrim < -MAXTRIM)
+        freqTrim = -MAXTRIM;
+
+    timeKeeper->freqTrim  = freqTrim;
+    timeKeeper->phaseTrim = error * TRIMSCALE / (NTICKS << PHASESHIFT);
+    timeKeeper->slewTicks = NTICKS;
+    timeKeeper->outliers  = 0;
+}
+
+
+/******************************************************************************/
+/******************************** Edge filter *********************************/
+/******************************************************************************/
+
+/* vote on EDGEGROUP reads, and filter the votes into edges for the decoder */
+static void filterReceiverRead(receiverSampler* sampler, int read)
+{
+    sampler->groupLevel += read;
+
+    if (++sampler->groupReads < EDGEGROUP)
+        return;
+
+    int vote = 2 * sampler->groupLevel > EDGEGROUP;
+    sampler->groupReads = 0;
+    sampler->groupLevel = 0;
+
+    /* into the tick, an edge dated back into the last one is before 0 */
+    pinEdge edge;
+
+    if (filterRead(&sampler->filter, vote, halReadTickTimer(), &edge) &&
+        (int32_t) edge.time < (int32_t) (sampler->period / 2))
+        sampler->tickLevel = edge.level;
+}
+
+
+static void addRun(receiverSample* sample, int level, int length)
+{
+    sample->run[sample->runs].level  = level;
+    sample->run[sample->runs].length = length;
+    sample->runs++;
+}
+
+
+/* the runs of decoder samples the tick ends */
+static void endTickRuns(receiverSampler* sampler, receiverSample* sample)
 {
-    if (++(timeKeeper->subSecondCount) >= NTICKS) {
-        timeKeeper->subSecondCount = 0;
-        timeKeeper->currentTime++;
+    int level = sampler->tickLevel;
+    sample->runs = 0;
+
+    if (level != sampler->runLevel) {
+        if (sampler->runLength)
+            addRun(sample, sampler->runLevel, sampler->runLength);
+
+        addRun(sample, level, 1);
+        sampler->runLevel  = level;
+        sampler->runLength = 0;
+
+    } else if (++sampler->runLength >= NSAMPLES) {
+        addRun(sample, level, sampler->runLength);
+        sampler->runLength = 0;
     }
+
+    /* the level the next tick starts at */
+    sampler->tickLevel = sampler->filter.level;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void initTimeKeeper(time_keeper* timeKeeper, long utcOffset, time_t startTime)
+{
+    timeKeeper->utcOffset      = utcOffset;
+    timeKeeper->freqTrim       = 0;
+    timeKeeper->periodFraction = 0;
+    timeKeeper->lastPeriod     = MS100;
+    timeKeeper->lastLevel      = NOVERSAMPLES;
+
+    setTime(timeKeeper, startTime, 0);
+}
+
+
+unsigned tickPeriod(time_keeper* timeKeeper)
+{
+    long period = MS100 * (long) TRIMSCALE + timeKeeper->freqTrim
+                + timeKeeper->periodFraction;
+
+    if (timeKeeper->slewTicks > 0) {
+        period += timeKeeper->phaseTrim;
+        timeKeeper->slewTicks--;
+    }
+
+    /*
+     * Dither whole timer ticks so the average length is exact. Past
+     * MAXPERIOD, the rest is carried over to the next ticks too.
+     */
+    long whole = period / TRIMSCALE;
+
+    if (whole > MAXPERIOD)
+        whole = MAXPERIOD;
+
+    timeKeeper->periodFraction = period - whole * TRIMSCALE;
+    timeKeeper->lastPeriod     = (unsigned) whole;
+
+    return timeKeeper->lastPeriod;
+}
+
+
+void setTickLength(time_keeper* timeKeeper, unsigned period)
+{
+    timeKeeper->lastPeriod = period;
+}
+
+
+void trackPhase(time_keeper* timeKeeper, int level, int pulseStarted)
+{
+    int lastLevel = timeKeeper->lastLevel;
+    timeKeeper->lastLevel = level;
+
+    if (!pulseStarted || !timeKeeper->synced)
+        return;
+
+    /* edge against the nearest start of a second of the clock */
+    long error = edgeOffset(level, lastLevel, timeKeeper->lastPeriod)
+               - EDGEOFFSET + timeKeeper->subSecondCount * (long) MS100;
+
+    if (timeKeeper->subSecondCount >= NTICKS / 2)
+        error -= NTICKS * (long) MS100;
+
+    timeKeeper->phaseError = error;
+
+    /* anything far off is noise, unless a frame was decoded at this edge */
+    if (!timeKeeper->locked)
+        stepPhase(timeKeeper, error);
+    else if (error >= -LOCKRANGE && error <= LOCKRANGE)
+        steerPhase(timeKeeper, error);
+    else
+        timeKeeper->outliers++;
+}
+
+
+int getMilliseconds(time_keeper* timeKeeper)
+{
+    long ticks = timeKeeper->subSecondCount * (long) MS100
+               + (long) halReadTickTimer() - EDGEOFFSET;
+
+    /* the first tick starts a little before the second */
+    if (ticks < 0)
+        return 0;
+
+    return ticks < HALTICKRATE ? ticks / (HALTICKRATE / 1000) : 999;
+}
+
+
+int secondStarted(time_keeper* timeKeeper)
+{
+    return timeKeeper->subSecondCount > 0 || halReadTickTimer() >= EDGEOFFSET;
+}
+
+
+long getDrift(time_keeper* timeKeeper)
+{
+    /* 1e9 / (TRIMSCALE * MS100) ppb per unit of trim */
+    return timeKeeper->freqTrim * 125 / 2;
+}
+
+
+void tick(time_keeper* timeKeeper)
+{
+    if (++(timeKeeper->subSecondCount) < NTICKS)
+        return;
+
+    timeKeeper->subSecondCount = 0;
+    timeKeeper->currentTime++;
+    nextSecond(&timeKeeper->localTime);
+
+    if (timeKeeper->currentTime == timeKeeper->dstChange)
+        changeDst(timeKeeper);
 }
 
 
@@ -14,39 +382,108 @@ void setTime(time_keeper* timeKeeper, time_t newTime, int dst)
     timeKeeper->currentTime = newTime;
     timeKeeper->subSecondCount = 0;
     timeKeeper->dst = dst;
+    timeKeeper->synced = 0;
+    timeKeeper->locked = 0;
+    timeKeeper->slewTicks = 0;
+
+    convertLocalTime(timeKeeper);
+}
+
+
+void syncTime(time_keeper* timeKeeper, time_t newTime, int status)
+{
+    time_t change;
+    int    dst = dstFromStatus(newTime, status, timeKeeper->utcOffset, &change);
+
+    /* the second that starts at the nearest tick */
+    time_t clockTime = timeKeeper->currentTime
+                     + (timeKeeper->subSecondCount >= NTICKS / 2);
+
+    if (timeKeeper->locked && newTime == clockTime) {
+        /* the edge of this frame is real, step to it if the last were not */
+        timeKeeper->locked = !timeKeeper->outliers;
+
+        if (dst != timeKeeper->dst) {
+            timeKeeper->dst = dst;
+            convertLocalTime(timeKeeper);
+        }
+
+    } else {
+        setTime(timeKeeper, newTime, dst);
+    }
+
+    /* the change the frames announce for later today */
+    if (change > newTime)
+        timeKeeper->dstChange = change;
+
+    timeKeeper->synced   = 1;
+    timeKeeper->lastSync = newTime;
 }
 
 
+void getLocalTime(time_keeper* timeKeeper, struct tm* localTime)
+{
+    *localTime = timeKeeper->localTime;
+}
+
+
+/******************************************************************************/
+/********************************* Receiver ***********************************/
+/******************************************************************************/
+
 void initReceiver()
 {
-    /* set up LEDs to display received signal */
-    TRISD = 0xFF00;
+    halInitReceiverPins();
+}
+
+
+void startSampler(receiverSampler* sampler, halInterruptHandler handler)
+{
+    initSampleQueue(&sampler->queue);
+    sampler->period   = MS100;
+    sampler->reads    = 0;
+    sampler->level    = 0;
+    sampler->sequence = 0;
+
+    /* the decoder starts out waiting for the carrier */
+    initEdgeFilter(&sampler->filter, EDGEWINDOW, EDGEWINDOW / 4,
+                   3 * EDGEWINDOW / 4, EDGEGROUP * READTICKS);
+    sampler->groupReads = 0;
+    sampler->groupLevel = 0;
+    sampler->tickLevel  = 1;
+    sampler->runLevel   = 1;
+    sampler->runLength  = 0;
 
-    /* set up input for receiver board */
-    TRISF = 0xFFFF;
+    halResetTickTimer();
+    halStartSamplingInterrupt(READTICKS, handler);
 }
 
 
-char getReceiverOutput()
+void sampleReceiver(receiverSampler* sampler)
 {
-    /* get input from RF0, output from board is negated */
-    char accum = ~PORTF & 0x1;
-    resetSamplingTimer();
+    unsigned period = sampler->period;
 
-    /* get 1000 samples in sampling period */
-    int intervalCount = MS90 / 1000;
-    int count = 1;
+    if (halTickTimerPassed(period)) {
+        receiverSample sample;
+        sample.level    = sampler->level;
+        sample.period   = period;
+        sample.sequence = sampler->sequence++;
+        endTickRuns(sampler, &sample);
 
-    while (TMR2 < MS90) {
-        if (TMR2 % intervalCount == 0) {
-            accum += ~PORTF & 0x1;
-            count++;
-        }
+        /* on a full queue the sample is dropped, the main loop sees the gap */
+        pushSample(&sampler->queue, &sample);
+        halRewindTickTimer(period);
+
+        sampler->reads = 0;
+        sampler->level = 0;
     }
 
+    int read = halReadReceiverPin();
 
-    /* write to led for debugging */
-    char avg = accum / count;
+    if (sampler->reads < NOVERSAMPLES) {
+        sampler->level += read;
+        sampler->reads++;
+    }
 
-    return avg;
+    filterReceiverRead(sampler, read);
 }
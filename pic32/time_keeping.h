@@ -1,78 +1,202 @@
 #ifndef TIME_KEEPING_H_
 #define TIME_KEEPING_H_
 
-#include <P32xxxx.h>
 #include <time.h>
 
+#include "edge_filter.h"
+#include "hal.h"
+#include "sample_queue.h"
+
 #define MS100 62500
 #define MS90 56250
 #define NTICKS 10
+#define NOVERSAMPLES 1000    /* receiver samples averaged per sample */
+#define READTICKS (MS90 / NOVERSAMPLES)    /* timer ticks between two of them */
+#define DSTHOUR 2            /* local hour DST starts and ends at */
 
-static inline void startSamplingTimer()
-{
-    /*
-     * Assumes peripheral clock at 20MHz, use Timer2 for sampling timer
-     *     bit 15  : ON    = 1  : timer on
-     *     bit 14  : FRZ   = 0  : keep running in exception mode
-     *     bit 13  : SIDL  = 0  : keep running in idle mode
-     *     bit 12-8: unused
-     *     bit 7   : TGATE = 0  : disable gated accumulation
-     *     bit 6-4 : TCKPS = 101: 1:32 prescaler
-     *     bit 3   : T32   = 0  : 16 bit timer
-     *     bit 2   : unused
-     *     bit 1   : TCS   = 0  : use internal peripheral clock
-     *     bit 0   : unused
-     */
-    T2CON = 0x8050;
-}
-
-static inline void resetSamplingTimer()
-{
-    /* reset timer counter to 0 */
-    TMR2 = 0;
-}
+#define TRIMSCALE 256        /* tick period trims in 1/256 timer ticks */
+#define EDGEOFFSET (MS90 / 4)    /* on-time edge into the first tick of a second */
+#define PHASESHIFT 3         /* 1/8 of the phase error is slewed per second */
+#define FREQSHIFT 8          /* and 1/256 of it goes into the frequency trim */
+#define LOCKRANGE 6250       /* edges further than 10 ms from the second are outliers */
+#define MAXTRIM 8000         /* frequency trim limit, 500 ppm */
+#define MAXPERIOD (HALTIMERMAX - 2 * READTICKS)    /* longest tick, seen to end before Timer4 wraps */
+#define EDGEGROUP 11         /* reads voted into one read of the edge filter, 1 ms */
+#define EDGEWINDOW 24        /* voted reads the edge filter sums */
 
 static inline void startTimeKeepingTimer()
 {
-    /*
-     * Assumes peripheral clock at 20MHz, use Timer2 for sampling timer
-     *     bit 15  : ON    = 1  : timer on
-     *     bit 14  : FRZ   = 0  : keep running in exception mode
-     *     bit 13  : SIDL  = 0  : keep running in idle mode
-     *     bit 12-8: unused
-     *     bit 7   : TGATE = 0  : disable gated accumulation
-     *     bit 6-4 : TCKPS = 101: 1:32 prescaler
-     *     bit 3   : T32   = 0  : 16 bit timer
-     *     bit 2   : unused
-     *     bit 1   : TCS   = 0  : use internal peripheral clock
-     *     bit 0   : unused
-     */
-    T4CON = 0x8050;
+    halStartTickTimer();
 }
 
 static inline void resetTimeKeepingTimer()
 {
-    /* reset timer counter to 0 */
-    TMR4 = 0;
+    halResetTickTimer();
 }
 
 
-static inline void holdTimeKeepingTimer()
-{
-    while (TMR4 < MS100);
-}
+/*
+ * Keeps the current time, both as UTC unix time and as local broken-down
+ * time. The local time is carried forward a second at a time, so it only
+ * has to be converted in full when the time is set. DST starts and ends on
+ * the US schedule, at DSTHOUR on the second Sunday of March and the first
+ * Sunday of November, until the next time signal says otherwise.
+ *
+ * Once synced, the on-time edge of every second is located to a fraction of
+ * a sample from the oversampled receiver level, and a phase-locked loop
+ * trims the length of the 100 ms ticks so the edges fall EDGEOFFSET into the
+ * first tick of each second, where a quarter of the sample is low and the
+ * edge is measured well. The second starts at the edge, so the first tick
+ * starts EDGEOFFSET early. The frequency part of the trim is an estimate of
+ * the drift of the local oscillator and is kept through losses of signal.
+ */
+typedef struct {
+    time_t    currentTime;       /* current time */
+    int       subSecondCount;    /* ticks of 100 ms since the second started */
+    int       dst;               /* flag indicating if it's daylight saving time */
+    int       synced;            /* time was last set from the time signal */
+    time_t    lastSync;          /* time of the last sync */
+    long      utcOffset;         /* offset of local standard time from UTC */
+    struct tm localTime;         /* current local time, DST applied */
+    time_t    dstChange;         /* UTC time of the next scheduled DST change */
+
+    /* phase and frequency discipline, periods in 1/TRIMSCALE timer ticks */
+    int       locked;            /* seconds are following the on-time edges */
+    int       outliers;          /* edges outside LOCKRANGE since the last in it */
+    long      phaseError;        /* last edge minus the second, timer ticks */
+    long      freqTrim;          /* period trim for the oscillator drift */
+    long      phaseTrim;         /* period trim slewing out the phase error */
+    int       slewTicks;         /* ticks phaseTrim still applies to */
+    long      periodFraction;    /* fraction of a timer tick carried over */
+    unsigned  lastPeriod;        /* length of the last tick in timer ticks */
+    int       lastLevel;         /* receiver level of the last sample */
+} time_keeper;
 
 
-/* keeps the current time */
+/*
+ * Samples the receiver from the sampling interrupt, which reads the pin
+ * every READTICKS. The first NOVERSAMPLES reads of each tick, spread over
+ * MS90, are summed into its level, and a level in between 0 and
+ * NOVERSAMPLES locates a falling edge inside the sample. Once the time
+ * keeping timer passes the length of the tick, the sample is pushed to the
+ * main loop and the timer is rewound by that length, so the time the
+ * interrupt came late carries over into the next tick. A tick is at most
+ * MAXPERIOD long, so a read sees it end before the 16 bit timer wraps. The
+ * reads of a tick start up to a read into it, which puts the edges half a
+ * read late on average.
+ *
+ * Every read also goes to the decoder through an edge filter. The reads
+ * are voted on EDGEGROUP at a time, and the votes are filtered with
+ * hysteresis over EDGEWINDOW of them, which drops glitches and chatter
+ * around the edges. The decoder sample of a tick is the filtered level at
+ * its middle, and ticks at the same level are passed on as one run, so
+ * the decoder only has work at the edges. A run ends at the first tick of
+ * the next level, which is passed on in a run of its own right away, so a
+ * pulse ends in the tick of its edge, and a long run is passed on once a
+ * second.
+ */
 typedef struct {
-    time_t currentTime;       /* current time */
-    int    subSecondCount;    /* number of 25ms ticks since last second */
-    int    dst;               /* flag indicating if it's daylight saving time */
-} time_keeper;
+    sampleQueue       queue;       /* samples for the main loop */
+    volatile unsigned period;      /* length of the current tick, main loop */
+    int               reads;       /* reads so far in the current tick */
+    int               level;       /* of them at full amplitude */
+    uint32_t          sequence;    /* ticks sampled so far */
+    edgeFilter        filter;      /* of the votes, for the decoder */
+    int               groupReads;  /* reads in the current vote */
+    int               groupLevel;  /* of them at full amplitude */
+    int               tickLevel;   /* filtered level of the current tick */
+    int               runLevel;    /* level of the ticks not passed on yet */
+    int               runLength;   /* number of them */
+} receiverSampler;
+
+
+/*
+ * \brief Initialize a time_keeper for a time zone.
+ *
+ * \param timeKeeper Pointer to time_keeper to initialize.
+ * \param utcOffset Offset of local standard time from UTC in seconds.
+ * \param startTime Time to start from, DST not in effect.
+ */
+void initTimeKeeper(time_keeper* timeKeeper, long utcOffset, time_t startTime);
 
 
 /*
- * \brief Increment tick by 25 ms.
+ * \brief Get the length of the next tick, trimmed by the phase-locked loop.
+ *
+ * Call once per tick and end the tick after the length returned.
+ *
+ * \param timeKeeper Pointer to time_keeper to get the tick length from.
+ *
+ * \returns Length of the tick in timer ticks, MS100 when not trimmed.
+ */
+unsigned tickPeriod(time_keeper* timeKeeper);
+
+
+/*
+ * \brief Set how long the last tick actually was.
+ *
+ * The sampling interrupt is a tick ahead of the main loop, so the length
+ * last returned by tickPeriod() is for the tick after the last sample.
+ * Call after tickPeriod() with the length the interrupt timed instead.
+ *
+ * \param timeKeeper Pointer to time_keeper to correct.
+ * \param period Length of the tick of the last sample in timer ticks.
+ */
+void setTickLength(time_keeper* timeKeeper, unsigned period);
+
+
+/*
+ * \brief Locate the on-time edge of a second and steer the seconds toward it.
+ *
+ * Call once per sample, after the time signal decoder, so a time decoded at
+ * this sample has already been set. Edges are only tracked once synced.
+ *
+ * \param timeKeeper Pointer to time_keeper to steer.
+ * \param level Receiver level of the sample, from a receiverSample.
+ * \param pulseStarted 1 if the decoder found the start of a pulse, the
+ *     on-time edge of a second, at this sample.
+ */
+void trackPhase(time_keeper* timeKeeper, int level, int pulseStarted);
+
+
+/*
+ * \brief Milliseconds into the current second.
+ *
+ * Counts from the start of the second, EDGEOFFSET into its first tick, with
+ * the time keeping timer giving the time into the current tick.
+ *
+ * \param timeKeeper Pointer to time_keeper to read.
+ *
+ * \returns 0 to 999.
+ */
+int getMilliseconds(time_keeper* timeKeeper);
+
+
+/*
+ * \brief Check if the current second has started yet.
+ *
+ * The first tick of a second starts EDGEOFFSET before it, and until then
+ * the time is still in the second before.
+ *
+ * \param timeKeeper Pointer to time_keeper to read.
+ *
+ * \returns 1 once the second has started, 0 before.
+ */
+int secondStarted(time_keeper* timeKeeper);
+
+
+/*
+ * \brief Estimated drift of the local oscillator.
+ *
+ * \param timeKeeper Pointer to time_keeper to read.
+ *
+ * \returns Drift in parts per billion, positive for a fast oscillator.
+ */
+long getDrift(time_keeper* timeKeeper);
+
+
+/*
+ * \brief Advance the time by one 100 ms tick.
  *
  * \param timeKeeper Pointer to time_keeper to increment.
  */
@@ -89,6 +213,31 @@ void tick(time_keeper* timeKeeper);
 void setTime(time_keeper* timeKeeper, time_t newTime, int dst);
 
 
+/*
+ * \brief Set the time from a decoded time signal, marking it as trusted.
+ *
+ * If the seconds are locked to the on-time edges and the time agrees with
+ * the clock, only DST is taken so the phase is kept. On the day of a DST
+ * change the frames only say that it happens today, so DST is taken from
+ * the time of the change at DSTHOUR, which is then scheduled if still
+ * ahead.
+ *
+ * \param timeKeeper Pointer to time_keeper to reset.
+ * \param newTime Decoded time, at the start of the current second.
+ * \param status DST status of the decoded frames, DSTOFF to DSTON.
+ */
+void syncTime(time_keeper* timeKeeper, time_t newTime, int status);
+
+
+/*
+ * \brief Get the local date and time without depending on the TZ setting.
+ *
+ * \param timeKeeper Pointer to time_keeper holding the current time.
+ * \param localTime Stores the local date and time, DST applied if in effect.
+ */
+void getLocalTime(time_keeper* timeKeeper, struct tm* localTime);
+
+
 /*
  * \brief Initialize IO to get receiver board output.
  */
@@ -96,10 +245,38 @@ void initReceiver();
 
 
 /*
- * \brief Get output from receiver board.
- * \returns 0 or 1 depending on amplitude of carrier wave received.
+ * \brief Start sampling the receiver from the sampling interrupt.
+ *
+ * Starts the time keeping timer over, with the first tick MS100 long.
+ *
+ * \param sampler Pointer to receiverSampler to initialize, shared with the
+ *     interrupt.
+ * \param handler Handler of the interrupt, calling sampleReceiver() on
+ *     sampler.
+ */
+void startSampler(receiverSampler* sampler, halInterruptHandler handler);
+
+
+/*
+ * \brief Read the receiver once, from the sampling interrupt.
+ *
+ * Pushes the sample of the tick first if the tick is over.
+ *
+ * \param sampler Pointer to the receiverSampler.
  */
-char getReceiverOutput();
+void sampleReceiver(receiverSampler* sampler);
+
+
+/*
+ * \brief Set the length of the tick the interrupt is sampling.
+ *
+ * \param sampler Pointer to the receiverSampler.
+ * \param period Length of the tick in timer ticks, from tickPeriod().
+ */
+static inline void setSamplerPeriod(receiverSampler* sampler, unsigned period)
+{
+    sampler->period = period;
+}
 
 
 #endif /* TIME_KEEPING_H_ */
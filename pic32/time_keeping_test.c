@@ -0,0 +1,393 @@
+/*
+ * Checks the local time carried forward by the time_keeper.
+ *
+ * The time_keeper is ticked through every second of more than a year,
+ * covering a leap day, a year end and both DST changes, and through a few
+ * days from random start times, and its local time is compared with
+ * localtime_r() in the US Pacific time zone every second, also after syncs
+ * on the days DST begins and ends, whose frames only say that it changes
+ * that day. The phase-locked loop is run against the on-time edges of
+ * oscillators with different drifts and has to find the drift and put the
+ * edges on EDGEOFFSET. The seconds are stepped onto edges anywhere in a
+ * second, at either end of the frequency trim, and no tick of the step may
+ * be longer than MAXPERIOD, whose end the sampling interrupt sees before
+ * Timer4 wraps, while the ticks together have to make up the step. The
+ * sampling interrupt is run on the virtual clock with ticks of MAXPERIOD and
+ * has to end every one of them on time, passing the carrier on to the
+ * decoder in whole runs. Then the cycles per 100 ms tick of the main loop
+ * are compared with converting the whole time every tick, the way
+ * radio_clock.c used to.
+ *
+ * Build: gcc -std=c99 -O2 civil_time.c time_keeping.c sample_queue.c \
+ *            edge_filter.c hal_linux.c time_keeping_test.c
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "civil_time.h"
+#include "time_decoder.h"
+#include "time_keeping.h"
+
+#define UTCOFFSET -28800          /* same as TIMEZONE in radio_clock.h */
+#define BENCHTICKS 10000000
+#define LOCKSECONDS 900           /* time the loop gets to settle */
+#define PULSELOW 0.2              /* seconds of low carrier after an edge */
+#define SAMPLERTICKS 50           /* ticks the sampling interrupt is run for */
+
+
+static receiverSampler sampler;
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static unsigned long long cycles()
+{
+    return __rdtsc();
+}
+
+#else
+
+/* nanoseconds where there is no cycle counter */
+static unsigned long long cycles()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif
+
+
+int sameLocalTime(struct tm* a, struct tm* b)
+{
+    return a->tm_year == b->tm_year && a->tm_mon  == b->tm_mon  &&
+           a->tm_mday == b->tm_mday && a->tm_hour == b->tm_hour &&
+           a->tm_min  == b->tm_min  && a->tm_sec  == b->tm_sec  &&
+           a->tm_wday == b->tm_wday && a->tm_yday == b->tm_yday &&
+           a->tm_isdst == b->tm_isdst;
+}
+
+
+/* tick through a number of seconds, comparing with the C library */
+int compareRun(time_keeper* timeKeeper, time_t start, long seconds)
+{
+    struct tm expected, actual;
+
+    for (long s = 0; s <= seconds; s++) {
+        time_t now = start + s;
+        localtime_r(&now, &expected);
+        getLocalTime(timeKeeper, &actual);
+
+        if (!sameLocalTime(&expected, &actual)) {
+            printf("local time differs at %ld: %02d:%02d:%02d, expected "
+                   "%02d:%02d:%02d\n", (long) now, actual.tm_hour,
+                   actual.tm_min, actual.tm_sec, expected.tm_hour,
+                   expected.tm_min, expected.tm_sec);
+            return 1;
+        }
+
+        for (int t = 0; t < NTICKS; t++)
+            tick(timeKeeper);
+    }
+
+    return 0;
+}
+
+
+/* a run with the time set the way the C library has it */
+int checkRun(time_t start, long seconds)
+{
+    struct tm expected;
+    localtime_r(&start, &expected);
+
+    time_keeper timeKeeper;
+    initTimeKeeper(&timeKeeper, UTCOFFSET, start);
+    setTime(&timeKeeper, start, expected.tm_isdst);
+
+    return compareRun(&timeKeeper, start, seconds);
+}
+
+
+/* syncs on the day of a DST change, before and after it, from its frames */
+int checkDstChange(time_t change, int status)
+{
+    static const long offsets[] = {-32340, -3600, -5, 0, 5, 3600, 36000};
+
+    for (int i = 0; i < (int) (sizeof(offsets) / sizeof(offsets[0])); i++) {
+        time_t start = change + offsets[i];
+
+        time_keeper timeKeeper;
+        initTimeKeeper(&timeKeeper, UTCOFFSET, start);
+        syncTime(&timeKeeper, start, status);
+
+        if (compareRun(&timeKeeper, start, 7200)) {
+            printf("synced %ld s from the DST change at %ld\n", offsets[i],
+                   (long) change);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* run the main loop against edges from an oscillator off by ppm */
+int checkDiscipline(double ppm)
+{
+    time_keeper timeKeeper;
+    initTimeKeeper(&timeKeeper, UTCOFFSET, 0);
+
+    /* a second of the time signal in local timer ticks, first edge at 0.37 s */
+    double second = HALTICKRATE * (1 + ppm * 1e-6);
+    double edge   = 0.37 * HALTICKRATE;
+    double now    = 0;
+    int    last   = 1;
+
+    long   interval = MS90 / NOVERSAMPLES;
+    time_t edgeTime = 1420070400;
+
+    while (now < LOCKSECONDS * second) {
+        tick(&timeKeeper);
+
+        /* the carrier is low for PULSELOW after every edge */
+        int level = 0;
+
+        for (int i = 0; i < NOVERSAMPLES; i++) {
+            double t = now + i * interval - edge;
+            double intoSecond = t - second * (long) (t / second);
+
+            level += t < 0 || intoSecond >= PULSELOW * second;
+        }
+
+        int x = 2 * level >= NOVERSAMPLES;
+        int started = last && !x;
+        last = x;
+
+        /* every edge decodes, as if from the bit ring */
+        if (started)
+            syncTime(&timeKeeper, edgeTime + (time_t) ((now - edge) / second
+                                                       + 0.5), 0);
+
+        trackPhase(&timeKeeper, level, started);
+        now += tickPeriod(&timeKeeper);
+    }
+
+    long expected = (long) (ppm * 1000);
+    long error    = timeKeeper.phaseError;
+
+    if (labs(getDrift(&timeKeeper) - expected) > 250 || labs(error) > 100) {
+        printf("%.0f ppm: drift %ld ppb, phase error %ld ticks\n", ppm,
+               getDrift(&timeKeeper), error);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* step onto an edge in every tick of a second, returns the longest tick */
+int checkLargeSteps(unsigned* longest)
+{
+    static const int levels[] = {0, 1, NOVERSAMPLES / 2, NOVERSAMPLES - 1};
+    static const long trims[] = {-MAXTRIM, 0, MAXTRIM};
+
+    *longest = 0;
+
+    /* every tick, edge level, level before and frequency trim */
+    for (int c = 0; c < NTICKS * 4 * 2 * 3; c++) {
+        int  sub       = c % NTICKS;
+        int  level     = levels[c / NTICKS % 4];
+        int  lastLevel = c / (NTICKS * 4) % 2 ? NOVERSAMPLES : 0;
+        long trim      = trims[c / (NTICKS * 8)];
+
+        time_keeper timeKeeper;
+        initTimeKeeper(&timeKeeper, UTCOFFSET, 1420070400);
+        syncTime(&timeKeeper, 1420070400, 0);
+
+        timeKeeper.freqTrim       = trim;
+        timeKeeper.subSecondCount = sub;
+        trackPhase(&timeKeeper, lastLevel, 0);
+        trackPhase(&timeKeeper, level, 1);
+
+        /* what is left after moving the tick count has to be slewed */
+        long error = timeKeeper.phaseError
+                   + (timeKeeper.subSecondCount - sub) * (long) MS100;
+        long long slewed = 0;
+
+        for (int i = 0; i < 20 * NTICKS; i++) {
+            unsigned period = tickPeriod(&timeKeeper);
+
+            if (period > *longest)
+                *longest = period;
+
+            slewed += (long long) period * TRIMSCALE
+                    - (MS100 * (long long) TRIMSCALE + trim);
+        }
+
+        if (*longest > MAXPERIOD || timeKeeper.slewTicks > 0 ||
+            llabs(slewed - (long long) error * TRIMSCALE) > TRIMSCALE) {
+            printf("step of %ld ticks from tick %d: longest tick %u, "
+                   "%lld/%d slewed\n", error, sub, *longest, slewed,
+                   TRIMSCALE);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+HALSAMPLINGISR(samplingInterrupt)
+{
+    sampleReceiver(&sampler);
+    halAckSamplingInterrupt();
+}
+
+
+static int fullCarrier(uint64_t tick, void* context)
+{
+    (void) tick;
+    (void) context;
+
+    return 1;
+}
+
+
+/* run the sampling interrupt with every tick period long */
+int checkSampler(unsigned period)
+{
+    halReset();
+    halSetReceiverSource(fullCarrier, NULL);
+    startSampler(&sampler, samplingInterrupt);
+    setSamplerPeriod(&sampler, period);
+
+    int count = 0, broken = 0, decoded = 0;
+
+    /* a tick the interrupt never ends leaves the loop on time */
+    while (count < SAMPLERTICKS &&
+           halTicks() < 2 * (uint64_t) SAMPLERTICKS * period) {
+        receiverSample sample;
+
+        if (popSample(&sampler.queue, &sample)) {
+            halWaitForInterrupt();
+            continue;
+        }
+
+        broken += sample.sequence != (uint32_t) count ||
+                  sample.period != period || sample.level != NOVERSAMPLES;
+
+        /* the decoder sees one steady run of carrier, a second at a time */
+        for (int i = 0; i < sample.runs; i++) {
+            broken += sample.run[i].level != 1;
+            decoded += sample.run[i].length;
+        }
+
+        count++;
+    }
+
+    /* each tick ends at the first read at or after its end */
+    uint64_t late = halTicks() - (uint64_t) SAMPLERTICKS * period;
+
+    if (count < SAMPLERTICKS || broken || late > READTICKS ||
+        decoded != count - count % NSAMPLES) {
+        printf("ticks of %u: %d of %d sampled, %d wrong, %d decoded, "
+               "last %lu late\n", period, count, SAMPLERTICKS, broken,
+               decoded, (unsigned long) late);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+void benchmarkTicks()
+{
+    time_keeper timeKeeper;
+    initTimeKeeper(&timeKeeper, UTCOFFSET, 1420070400);
+
+    struct tm timeToSend;
+    long checksum = 0;
+
+    /* the main loop before: UTC kept, whole conversion every tick */
+    unsigned long long start = cycles();
+
+    for (long i = 0; i < BENCHTICKS; i++) {
+        if (++timeKeeper.subSecondCount >= NTICKS) {
+            timeKeeper.subSecondCount = 0;
+            timeKeeper.currentTime++;
+        }
+
+        time_t localUnix = timeKeeper.currentTime + UTCOFFSET
+                         + timeKeeper.dst * 3600L;
+        civilFromTime(localUnix, &timeToSend);
+        checksum += timeToSend.tm_sec;
+    }
+
+    double full = (double) (cycles() - start) / BENCHTICKS;
+
+    /* local time carried forward */
+    start = cycles();
+
+    for (long i = 0; i < BENCHTICKS; i++) {
+        tick(&timeKeeper);
+        getLocalTime(&timeKeeper, &timeToSend);
+        checksum += timeToSend.tm_sec;
+    }
+
+    double incremental = (double) (cycles() - start) / BENCHTICKS;
+
+    /* print the checksum so the loops are not optimized away */
+    printf("cycles per tick: %.1f full conversion, %.1f incremental "
+           "(checksum %ld)\n", full, incremental, checksum);
+}
+
+
+int main()
+{
+    setenv("TZ", "PST8PDT,M3.2.0,M11.1.0", 1);
+    tzset();
+
+    /* 2015-12-01 to 2017-01-05 UTC */
+    int failed = checkRun(1448928000, 402 * SECONDSPERDAY);
+
+    srand(1);
+
+    /* a few days from random times from 2000 to 2100 */
+    for (int i = 0; i < 20 && !failed; i++) {
+        time_t start = 946684800 + (time_t) (rand() % 36500) * SECONDSPERDAY
+                     + rand() % SECONDSPERDAY;
+        failed = checkRun(start, 3 * SECONDSPERDAY);
+    }
+
+    /* a run starting right before a DST change in either direction */
+    failed = failed || checkRun(1457863200 - 5, 10)
+                    || checkRun(1478422800 - 5, 10);
+
+    /* synced from frames that only say DST begins or ends that day */
+    failed = failed || checkDstChange(1457863200, DSTBEGINS)
+                    || checkDstChange(1478422800, DSTENDS);
+
+    /* a slow and a fast oscillator, both within MAXTRIM */
+    failed = failed || checkDiscipline(0) || checkDiscipline(-80)
+                    || checkDiscipline(230.5);
+
+    unsigned longest;
+    failed = failed || checkLargeSteps(&longest) || checkSampler(MS100)
+                    || checkSampler(MAXPERIOD);
+
+    if (failed) {
+        printf("FAIL\n");
+        return 1;
+    }
+
+    printf("longest tick of a step: %u timer ticks\n", longest);
+    benchmarkTicks();
+    printf("PASS\n");
+    return 0;
+}
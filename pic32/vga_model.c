@@ -0,0 +1,650 @@
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vga_model.h"
+
+#define XCENTER 320      /* center of the clock face and the hands */
+#define YCENTER 240
+#define RADIUS 200
+#define HANDMARGIN 2     /* pixels of rounding around the hands */
+#define DIGESTLANES 4    /* words of a frame hashed side by side */
+#define FNVBASIS 14695981039346656037ULL
+#define FNVPRIME 1099511628211ULL
+
+/* colors of videoGen, in order of priority */
+#define COLORNONE 0
+#define COLORDARK 1      /* minute and hour hands and the ticks, 0x010101 */
+#define COLORWHITE 2     /* clock face and text */
+#define COLORRED 3       /* second hand */
+
+
+static const unsigned char palette[4][3] = {
+    {0x00, 0x00, 0x00}, {0x01, 0x01, 0x01}, {0xff, 0xff, 0xff},
+    {0xff, 0x00, 0x00}
+};
+
+
+/* coslookup and sinlookup, cos and sin of 90 - 6 * tick degrees * 2^16 */
+static const int32_t cosines[64] = {
+         0,   6850,  13626,  20252,  26656,  32768,  38521,  43852,
+     48702,  53020,  56756,  59870,  62329,  64104,  65177,  65536,
+     65177,  64104,  62329,  59870,  56756,  53020,  48702,  43852,
+     38521,  32768,  26656,  20252,  13626,   6850,      0,  -6850,
+    -13626, -20252, -26656, -32768, -38521, -43852, -48702, -53020,
+    -56756, -59870, -62329, -64104, -65177, -65536, -65177, -64104,
+    -62329, -59870, -56756, -53020, -48702, -43852, -38521, -32768,
+    -26656, -20252, -13626,  -6850,      0,      0,      0,      0
+};
+
+static const int32_t sines[64] = {
+     65536,  65177,  64104,  62329,  59870,  56756,  53020,  48702,
+     43852,  38521,  32768,  26656,  20252,  13626,   6850,      0,
+     -6850, -13626, -20252, -26656, -32768, -38521, -43852, -48702,
+    -53020, -56756, -59870, -62329, -64104, -65177, -65536, -65177,
+    -64104, -62329, -59870, -56756, -53020, -48702, -43852, -38521,
+    -32768, -26656, -20252, -13626,  -6850,      0,   6850,  13626,
+     20252,  26656,  32768,  38521,  43852,  48702,  53020,  56756,
+     59870,  62329,  64104,  65177,  65536,  65536,  65536,  65536
+};
+
+
+/* one rotrectangle instance, unrotated rectangle and rotation */
+typedef struct {
+    uint32_t left;
+    uint32_t top;
+    uint32_t width;
+    uint32_t height;
+    uint32_t cosine;
+    uint32_t sine;
+
+    /* pixels that can be part of the hand, only used by renderFrame() */
+    int      xmin;
+    int      xmax;
+    int      ymin;
+    int      ymax;
+} vgaHand;
+
+
+/******************************************************************************/
+/********************************* HDL modules ********************************/
+/******************************************************************************/
+
+static int romBit(const vgaRom* rom, unsigned address, unsigned bit)
+{
+    if (address >= (unsigned) rom->depth || bit >= (unsigned) rom->width)
+        return 0;
+
+    return rom->bits[(size_t) address * rom->width + bit];
+}
+
+
+/* chargenrom, 6 bit lines zero extended to 8 and read from bit 7 down */
+static int charPixel(const vgaRoms* roms, unsigned xstart, unsigned ystart,
+                     unsigned x, unsigned y, unsigned ch)
+{
+    unsigned xdiff = (x - xstart) & 0x3ff;
+    unsigned ydiff = (y - ystart) & 0x3ff;
+
+    if (ydiff >= 8 || xdiff > 8)
+        return 0;
+
+    return romBit(&roms->chars, (ydiff & 7) + ((ch & 0xff) << 3),
+                  (7 - xdiff) & 7);
+}
+
+
+/* mongenrom, 24 bit lines read from bit 24 down */
+static int monthPixel(const vgaRoms* roms, unsigned xstart, unsigned ystart,
+                      unsigned x, unsigned y, unsigned month)
+{
+    unsigned xdiff = (x - xstart) & 0x3ff;
+    unsigned ydiff = (y - ystart) & 0x3ff;
+
+    if (ydiff >= 8 || xdiff > 24)
+        return 0;
+
+    return romBit(&roms->months, ((ydiff & 7) + ((month & 0xf) << 3)) & 0x7f,
+                  (24 - xdiff) & 0x1f);
+}
+
+
+/* clkgenrom at x - 377, y - 40, where 8'd399 is truncated to 143 */
+static int tickPixel(const vgaRoms* roms, unsigned x, unsigned y)
+{
+    unsigned xrom = (x - 377) & 0x3ff;
+    unsigned yrom = (y - 40) & 0x3ff;
+
+    return romBit(&roms->ticks, yrom, (143 - xrom) & 0x3ff);
+}
+
+
+/* circle, distances squared in 20 bits */
+static int circlePixel(unsigned x, unsigned y)
+{
+    uint64_t xdist = (x - XCENTER) & 0xfffff;
+    uint64_t ydist = (y - YCENTER) & 0xfffff;
+
+    return (((xdist * xdist & 0xfffff) + (ydist * ydist & 0xfffff)) & 0xfffff)
+           < RADIUS * RADIUS;
+}
+
+
+/* rotrectangle, the pixel unrotated in 32 bit unsigned arithmetic */
+static int handPixel(const vgaHand* hand, uint32_t dx, uint32_t dy)
+{
+    uint32_t x0 = (((dx * hand->cosine - dy * hand->sine) >> 16) + XCENTER)
+                & 0x3ff;
+    uint32_t y0 = (((dy * hand->cosine + dx * hand->sine) >> 16) + YCENTER)
+                & 0x3ff;
+
+    return (x0 - hand->left <= hand->width) & (y0 - hand->top <= hand->height);
+}
+
+
+/* rotate the corners of the rectangle back to find the pixels of a hand */
+static void boundHand(vgaHand* hand)
+{
+    int64_t cosine = (int32_t) hand->cosine;
+    int64_t sine   = (int32_t) hand->sine;
+
+    hand->xmin = hand->ymin = INT_MAX;
+    hand->xmax = hand->ymax = INT_MIN;
+
+    for (int corner = 0; corner < 4; corner++) {
+        int64_t rx = (int64_t) hand->left - XCENTER + (corner & 1) * hand->width;
+        int64_t ry = (int64_t) hand->top - YCENTER + (corner >> 1) * hand->height;
+
+        /* the transpose undoes the rotation to within rounding */
+        int x = XCENTER + (int) ((cosine * rx + sine * ry) / 65536);
+        int y = YCENTER + (int) ((cosine * ry - sine * rx) / 65536);
+
+        hand->xmin = x < hand->xmin ? x : hand->xmin;
+        hand->xmax = x > hand->xmax ? x : hand->xmax;
+        hand->ymin = y < hand->ymin ? y : hand->ymin;
+        hand->ymax = y > hand->ymax ? y : hand->ymax;
+    }
+
+    hand->xmin = hand->xmin - HANDMARGIN < 0 ? 0 : hand->xmin - HANDMARGIN;
+    hand->ymin = hand->ymin - HANDMARGIN < 0 ? 0 : hand->ymin - HANDMARGIN;
+    hand->xmax = hand->xmax + HANDMARGIN >= VGAWIDTH ? VGAWIDTH - 1
+                                                     : hand->xmax + HANDMARGIN;
+    hand->ymax = hand->ymax + HANDMARGIN >= VGAHEIGHT ? VGAHEIGHT - 1
+                                                      : hand->ymax + HANDMARGIN;
+}
+
+
+/* second, minute and hour hands of videoGen */
+static void setHands(const vgaTime* time, vgaHand* hands)
+{
+    /* xshape, yshape, width and height of the rotrectangle instances */
+    static const uint32_t shapes[3][4] = {
+        {270, 238, 200, 4}, {280, 237, 200, 6}, {280, 236, 150, 8}
+    };
+
+    unsigned ticks[3] = {
+        time->second & 0x3f, time->minute & 0x3f,
+        ((time->hour & 0x1f) % 12 * 5 + (time->minute & 0x3f) / 12) & 0x3f
+    };
+
+    for (int i = 0; i < 3; i++) {
+        hands[i].left   = shapes[i][0];
+        hands[i].top    = shapes[i][1];
+        hands[i].width  = shapes[i][2];
+        hands[i].height = shapes[i][3];
+        hands[i].cosine = (uint32_t) cosines[ticks[i]];
+        hands[i].sine   = (uint32_t) sines[ticks[i]];
+        boundHand(&hands[i]);
+    }
+}
+
+
+static void setGlyph(vgaGlyph* glyph, int column, int y, int code, int month)
+{
+    glyph->x     = 30 + 8 * column;    /* xoffset + charwidth * column */
+    glyph->y     = y;
+    glyph->code  = code & 0xff;
+    glyph->month = month;
+}
+
+
+/* date and time of one side of datetimedisp, from a column of the text */
+static vgaGlyph* layoutTime(const vgaTime* time, int column, vgaGlyph* glyph)
+{
+    int digits[3] = {time->hour & 0x1f, time->minute & 0x3f,
+                     time->second & 0x3f};
+    int day  = time->day & 0x1f;
+    int year = (time->year + 14) & 0xff;
+
+    /* month, day and 20 followed by the year, then HH:MM:SS */
+    setGlyph(glyph++, column + 1, 52, time->month & 0xf, 1);
+    setGlyph(glyph++, column + 5, 52, '0' + day / 10, 0);
+    setGlyph(glyph++, column + 6, 52, '0' + day % 10, 0);
+    setGlyph(glyph++, column + 8, 52, '2', 0);
+    setGlyph(glyph++, column + 9, 52, '0', 0);
+    setGlyph(glyph++, column + 10, 52, '0' + year / 10, 0);
+    setGlyph(glyph++, column + 11, 52, '0' + year % 10, 0);
+
+    for (int i = 0; i < 3; i++) {
+        if (i > 0)
+            setGlyph(glyph++, column + 3 * i + 1, 64, ':', 0);
+
+        setGlyph(glyph++, column + 3 * i + 2, 64, '0' + digits[i] / 10, 0);
+        setGlyph(glyph++, column + 3 * i + 3, 64, '0' + digits[i] % 10, 0);
+    }
+
+    return glyph;
+}
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* read the next word of a $readmemb file, 0 at the end of the file */
+static int readWord(FILE* in, char* word, size_t size)
+{
+    int c;
+    size_t length = 0;
+
+    while ((c = fgetc(in)) != EOF) {
+        /* comments separate words like white space */
+        if (c == '/') {
+            int next = fgetc(in);
+
+            if (next == '/') {
+                while ((c = fgetc(in)) != EOF && c != '\n')
+                    ;
+            } else if (next == '*') {
+                int last = 0;
+                while ((c = fgetc(in)) != EOF && !(last == '*' && c == '/'))
+                    last = c;
+            }
+
+            c = ' ';
+        }
+
+        if (isspace(c)) {
+            if (length)
+                break;
+            continue;
+        }
+
+        if (length + 1 < size && c != '_')
+            word[length++] = (char) c;
+    }
+
+    word[length] = '\0';
+    return length > 0;
+}
+
+
+/* pixels of one character from its top left corner, row by row */
+static void maskGlyphs(vgaFace* face, const vgaRoms* roms)
+{
+    for (int code = 0; code < 256; code++) {
+        for (int row = 0; row < 8; row++) {
+            face->charMasks[code][row] = 0;
+
+            for (int column = 0; column <= 8; column++)
+                face->charMasks[code][row] |=
+                    charPixel(roms, 0, 0, column, row, code) << column;
+        }
+    }
+
+    for (int month = 0; month < 16; month++) {
+        for (int row = 0; row < 8; row++) {
+            face->monthMasks[month][row] = 0;
+
+            for (int column = 0; column <= 24; column++)
+                face->monthMasks[month][row] |=
+                    (uint32_t) monthPixel(roms, 0, 0, column, row, month)
+                    << column;
+        }
+    }
+}
+
+
+static void drawGlyphs(const vgaFace* face, const vgaGlyph* glyphs, int y,
+                       unsigned char* row)
+{
+    for (int i = 0; i < NGLYPHS; i++) {
+        int line = y - glyphs[i].y;
+
+        if (line < 0 || line >= 8)
+            continue;
+
+        uint32_t mask = glyphs[i].month
+                      ? face->monthMasks[glyphs[i].code][line]
+                      : face->charMasks[glyphs[i].code][line];
+
+        /* text is drawn last, only where nothing else is */
+        for (int x = glyphs[i].x; mask; x++, mask >>= 1)
+            if ((mask & 1) && x < VGAWIDTH && row[x] == COLORNONE)
+                row[x] = COLORWHITE;
+    }
+}
+
+
+/* one hand across a row, handPixel() in a vectorizable loop */
+static void drawHand(const vgaHand* hand, int y, unsigned char color,
+                     unsigned char* row)
+{
+    uint32_t cosine = hand->cosine, sine = hand->sine;
+    uint32_t left = hand->left, top = hand->top;
+    uint32_t width = hand->width, height = hand->height;
+    uint32_t dy = (uint32_t) (y - YCENTER);
+    uint32_t xbase = 0 - dy * sine, ybase = dy * cosine;
+
+    for (int x = hand->xmin; x <= hand->xmax; x++) {
+        uint32_t dx = (uint32_t) (x - XCENTER);
+        uint32_t x0 = (((dx * cosine + xbase) >> 16) + XCENTER) & 0x3ff;
+        uint32_t y0 = (((dx * sine + ybase) >> 16) + YCENTER) & 0x3ff;
+        int hit = (x0 - left <= width) & (y0 - top <= height);
+
+        row[x] = hit ? color : row[x];
+    }
+}
+
+
+/* work shared by the threads of renderFrames() */
+typedef struct {
+    const vgaFace*  face;
+    const vgaState* states;
+    size_t          count;
+    frameCallback   onFrame;
+    void*           context;
+
+    pthread_mutex_t lock;
+    size_t          nextFrame;    /* next state to render */
+} renderJob;
+
+
+static void* renderWorker(void* arg)
+{
+    renderJob* job = arg;
+    unsigned char* rgb = malloc(FRAMEBYTES);
+
+    while (rgb) {
+        pthread_mutex_lock(&job->lock);
+        size_t frame = job->nextFrame++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (frame >= job->count)
+            break;
+
+        renderFrame(job->face, &job->states[frame], rgb);
+        job->onFrame(frame, rgb, job->context);
+    }
+
+    free(rgb);
+    return NULL;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+int initVgaRom(vgaRom* rom, int width, int depth)
+{
+    rom->width = width;
+    rom->depth = depth;
+    rom->bits  = calloc((size_t) width * depth, 1);
+
+    return rom->bits == NULL;
+}
+
+
+int loadVgaRom(vgaRom* rom, const char* path)
+{
+    FILE* in = fopen(path, "r");
+    char word[1024];
+    unsigned long address = 0;
+
+    if (!in)
+        return 1;
+
+    while (readWord(in, word, sizeof(word))) {
+        if (word[0] == '@') {
+            address = strtoul(word + 1, NULL, 16);
+            continue;
+        }
+
+        if (address < (unsigned long) rom->depth) {
+            unsigned char* bits = rom->bits + address * rom->width;
+            int length = (int) strlen(word);
+
+            /* the last digit is bit 0, missing high bits are 0 */
+            for (int bit = 0; bit < rom->width; bit++)
+                bits[bit] = bit < length && word[length - 1 - bit] == '1';
+        }
+
+        address++;
+    }
+
+    fclose(in);
+    return 0;
+}
+
+
+int loadVgaRoms(vgaRoms* roms, const char* dir)
+{
+    static const char* names[3] = {"charrom.txt", "monthrom.txt",
+                                   "clkface1.txt"};
+    vgaRom* list[3] = {&roms->chars, &roms->months, &roms->ticks};
+    char path[4096];
+
+    /* declared sizes of charrom, monthrom and clocktick */
+    if (initVgaRom(&roms->chars, 6, 744) | initVgaRom(&roms->months, 24, 111)
+            | initVgaRom(&roms->ticks, 400, 400)) {
+        freeVgaRoms(roms);
+        return 1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+
+        if (loadVgaRom(list[i], path)) {
+            perror(path);
+            freeVgaRoms(roms);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void freeVgaRoms(vgaRoms* roms)
+{
+    free(roms->chars.bits);
+    free(roms->months.bits);
+    free(roms->ticks.bits);
+
+    roms->chars.bits = roms->months.bits = roms->ticks.bits = NULL;
+}
+
+
+void layoutGlyphs(const vgaState* state, vgaGlyph* glyphs)
+{
+    static const char* labels[2] = {"CURRENT TIME", "LAST SYNC"};
+    vgaGlyph* glyph = glyphs;
+
+    /* the static text, without the spaces */
+    for (int side = 0; side < 2; side++)
+        for (int i = 0; labels[side][i]; i++)
+            if (labels[side][i] != ' ')
+                setGlyph(glyph++, side * 61 + i, 40, labels[side][i], 0);
+
+    glyph = layoutTime(&state->current, 0, glyph);
+    layoutTime(&state->sync, 59, glyph);
+}
+
+
+uint32_t vgaPixel(const vgaRoms* roms, const vgaState* state, int x, int y)
+{
+    vgaHand  hands[3];
+    vgaGlyph glyphs[NGLYPHS];
+    uint32_t dx = (uint32_t) (x - XCENTER);
+    uint32_t dy = (uint32_t) (y - YCENTER);
+
+    setHands(&state->current, hands);
+    layoutGlyphs(state, glyphs);
+
+    int inRange = x >= 120 && x <= 520 && y >= 40 && y <= 440;
+
+    int text = 0;
+    for (int i = 0; i < NGLYPHS; i++)
+        text |= glyphs[i].month
+              ? monthPixel(roms, glyphs[i].x, glyphs[i].y, x, y, glyphs[i].code)
+              : charPixel(roms, glyphs[i].x, glyphs[i].y, x, y, glyphs[i].code);
+
+    /* the always_comb block of videoGen, first color that is not black */
+    if (handPixel(&hands[0], dx, dy))
+        return 0xff0000;
+    if (handPixel(&hands[1], dx, dy) || handPixel(&hands[2], dx, dy))
+        return 0x010101;
+    if (inRange && tickPixel(roms, x, y))
+        return 0x010101;
+    if (circlePixel(x, y) || text)
+        return 0xffffff;
+
+    return 0;
+}
+
+
+void initVgaFace(vgaFace* face, const vgaRoms* roms)
+{
+    for (int y = 0; y < VGAHEIGHT; y++) {
+        for (int x = 0; x < VGAWIDTH; x++) {
+            int inRange = x >= 120 && x <= 520 && y >= 40 && y <= 440;
+
+            if (inRange && tickPixel(roms, x, y))
+                face->background[y][x] = COLORDARK;
+            else if (circlePixel(x, y))
+                face->background[y][x] = COLORWHITE;
+            else
+                face->background[y][x] = COLORNONE;
+
+            memcpy(face->rgb + 3 * (y * VGAWIDTH + x),
+                   palette[face->background[y][x]], 3);
+        }
+    }
+
+    maskGlyphs(face, roms);
+}
+
+
+void renderFrame(const vgaFace* face, const vgaState* state,
+                 unsigned char* rgb)
+{
+    vgaHand  hands[3];
+    vgaGlyph glyphs[NGLYPHS];
+    unsigned char row[VGAWIDTH];
+
+    setHands(&state->current, hands);
+    layoutGlyphs(state, glyphs);
+    memcpy(rgb, face->rgb, FRAMEBYTES);
+
+    for (int y = 0; y < VGAHEIGHT; y++) {
+        int first = VGAWIDTH, last = -1;
+
+        /* columns that differ from the background can only be in these */
+        for (int i = 0; i < NGLYPHS; i++) {
+            if (y >= glyphs[i].y && y < glyphs[i].y + 8) {
+                first = 0;
+                last  = VGAWIDTH - 1;
+            }
+        }
+
+        for (int i = 0; i < 3; i++) {
+            if (y >= hands[i].ymin && y <= hands[i].ymax) {
+                first = hands[i].xmin < first ? hands[i].xmin : first;
+                last  = hands[i].xmax > last ? hands[i].xmax : last;
+            }
+        }
+
+        if (first > last)
+            continue;
+
+        /* lowest priority first, the second hand over everything */
+        memcpy(row, face->background[y], VGAWIDTH);
+        drawGlyphs(face, glyphs, y, row);
+
+        for (int i = 2; i >= 0; i--)
+            if (y >= hands[i].ymin && y <= hands[i].ymax)
+                drawHand(&hands[i], y, i ? COLORDARK : COLORRED, row);
+
+        unsigned char* out = rgb + 3 * VGAWIDTH * y;
+
+        for (int x = first; x <= last; x++)
+            memcpy(out + 3 * x, palette[row[x]], 3);
+    }
+}
+
+
+int renderFrames(const vgaFace* face, const vgaState* states, size_t count,
+                 int threads, frameCallback onFrame, void* context)
+{
+    renderJob job = {face, states, count, onFrame, context,
+                     PTHREAD_MUTEX_INITIALIZER, 0};
+
+    /* the calling thread is one of the workers */
+    pthread_t workers[threads > 1 ? threads - 1 : 1];
+    int started = 0;
+
+    while (started < threads - 1 &&
+           !pthread_create(&workers[started], NULL, renderWorker, &job))
+        started++;
+
+    renderWorker(&job);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_mutex_destroy(&job.lock);
+
+    /* a worker out of memory leaves states behind */
+    return job.nextFrame >= count ? started + 1 : 0;
+}
+
+
+uint64_t frameDigest(const unsigned char* rgb)
+{
+    uint64_t lanes[DIGESTLANES], hash = FNVBASIS;
+
+    for (int lane = 0; lane < DIGESTLANES; lane++)
+        lanes[lane] = FNVBASIS;
+
+    /* independent lanes so the multiplies overlap */
+    for (size_t i = 0; i < FRAMEBYTES; i += 8 * DIGESTLANES) {
+        for (int lane = 0; lane < DIGESTLANES; lane++) {
+            uint64_t word;
+            memcpy(&word, rgb + i + 8 * lane, 8);
+            lanes[lane] = (lanes[lane] ^ word) * FNVPRIME;
+        }
+    }
+
+    for (int lane = 0; lane < DIGESTLANES; lane++)
+        hash = (hash ^ lanes[lane]) * FNVPRIME;
+
+    return hash;
+}
+
+
+int writePpm(const char* path, const unsigned char* rgb)
+{
+    FILE* out = fopen(path, "wb");
+
+    if (!out)
+        return 1;
+
+    fprintf(out, "P6\n%d %d\n255\n", VGAWIDTH, VGAHEIGHT);
+    size_t written = fwrite(rgb, 1, FRAMEBYTES, out);
+
+    return (fclose(out) != 0) | (written != FRAMEBYTES);
+}
@@ -0,0 +1,218 @@
+#ifndef VGA_MODEL_H_
+#define VGA_MODEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VGAWIDTH 640
+#define VGAHEIGHT 480
+#define FRAMEBYTES (VGAWIDTH * VGAHEIGHT * 3)    /* RGB, 8 bits each */
+#define NGLYPHS 49                                /* chargenrom and mongenrom */
+
+
+/*
+ * Contents of a $readmemb ROM of radclk_vga.sv, one byte per bit. Bit b of
+ * word a is bits[a * width + b], with bit 0 the last digit of the word.
+ */
+typedef struct {
+    int            width;
+    int            depth;
+    unsigned char* bits;
+} vgaRom;
+
+
+typedef struct {
+    vgaRom chars;     /* charrom.txt, 6 bit lines, 8 per character code */
+    vgaRom months;    /* monthrom.txt, 24 bit lines, 8 per month */
+    vgaRom ticks;     /* clkface1.txt, 400 x 400 clock face ticks */
+} vgaRoms;
+
+
+/* time fields as they come out of spi_receiver, at their port widths */
+typedef struct {
+    int hour;      /* 0 to 23 */
+    int minute;
+    int second;
+    int month;     /* 1 to 12 */
+    int day;
+    int year;      /* years since 2014 */
+} vgaTime;
+
+
+typedef struct {
+    vgaTime current;
+    vgaTime sync;       /* time datetimedisp latched at the last sync */
+} vgaState;
+
+
+/* one chargenrom or mongenrom instance of datetimedisp */
+typedef struct {
+    int x;
+    int y;
+    int code;     /* character code, or the month */
+    int month;    /* 1 for mongenrom */
+} vgaGlyph;
+
+
+/*
+ * Everything of a frame that does not depend on the time: the clock face
+ * and its ticks, and every character of the ROMs as bit masks of the pixels
+ * chargenrom and mongenrom light from their top left corner.
+ */
+typedef struct {
+    unsigned char background[VGAHEIGHT][VGAWIDTH];    /* colors, see .c */
+    unsigned char rgb[FRAMEBYTES];                     /* and as a frame */
+    uint16_t      charMasks[256][8];
+    uint32_t      monthMasks[16][8];
+} vgaFace;
+
+
+/*
+ * \brief Called for every frame rendered by renderFrames().
+ *
+ * Called from the worker threads, so it must be thread-safe.
+ *
+ * \param index Index of the state the frame was rendered from.
+ * \param rgb The frame, FRAMEBYTES of RGB rows from the top left.
+ * \param context Pointer passed through from renderFrames().
+ */
+typedef void (*frameCallback)(size_t index, const unsigned char* rgb,
+                              void* context);
+
+
+/*
+ * \brief Allocate a ROM with every bit 0.
+ *
+ * \param rom Pointer to vgaRom to initialize.
+ * \param width Bits per word.
+ * \param depth Number of words.
+ *
+ * \returns 0 on success, 1 if out of memory.
+ */
+int initVgaRom(vgaRom* rom, int width, int depth);
+
+
+/*
+ * \brief Load a ROM the way $readmemb does.
+ *
+ * Words are binary digits separated by white space, with _ ignored, x and z
+ * read as 0 and comments allowed. @ followed by a hex address moves to that
+ * word. Words longer than the ROM keep their low bits.
+ *
+ * \param rom Pointer to vgaRom set up with initVgaRom().
+ * \param path Text file to read.
+ *
+ * \returns 0 on success, 1 if the file cannot be read.
+ */
+int loadVgaRom(vgaRom* rom, const char* path);
+
+
+/*
+ * \brief Allocate and load every ROM of radclk_vga.sv from a directory.
+ *
+ * \param roms Pointer to vgaRoms to load.
+ * \param dir Directory with charrom.txt, monthrom.txt and clkface1.txt.
+ *
+ * \returns 0 on success, 1 if a file is missing.
+ */
+int loadVgaRoms(vgaRoms* roms, const char* dir);
+
+
+/*
+ * \brief Free the ROMs of initVgaRom() and loadVgaRoms().
+ *
+ * \param roms Pointer to vgaRoms to free.
+ */
+void freeVgaRoms(vgaRoms* roms);
+
+
+/*
+ * \brief List the characters datetimedisp draws for a state.
+ *
+ * \param state Pointer to the time and last sync to display.
+ * \param glyphs Stores NGLYPHS characters, in pixelarray order.
+ */
+void layoutGlyphs(const vgaState* state, vgaGlyph* glyphs);
+
+
+/*
+ * \brief Color of one pixel, following videoGen and its modules literally.
+ *
+ * Arithmetic wraps at the widths of the HDL signals. Reads outside a ROM and
+ * the undriven bits of pixelarray are taken as 0, as synthesis makes them.
+ *
+ * \param roms Pointer to the ROMs.
+ * \param state Pointer to the time and last sync to display.
+ * \param x Column from 0 to VGAWIDTH - 1.
+ * \param y Row from 0 to VGAHEIGHT - 1.
+ *
+ * \returns Color as 0xRRGGBB.
+ */
+uint32_t vgaPixel(const vgaRoms* roms, const vgaState* state, int x, int y);
+
+
+/*
+ * \brief Work out the parts of every frame that do not depend on the time.
+ *
+ * \param face Pointer to vgaFace to fill.
+ * \param roms Pointer to the ROMs.
+ */
+void initVgaFace(vgaFace* face, const vgaRoms* roms);
+
+
+/*
+ * \brief Render a frame, bit-identical to vgaPixel() for every pixel.
+ *
+ * \param face Pointer to vgaFace from initVgaFace().
+ * \param state Pointer to the time and last sync to display.
+ * \param rgb Stores FRAMEBYTES of RGB rows from the top left.
+ */
+void renderFrame(const vgaFace* face, const vgaState* state,
+                 unsigned char* rgb);
+
+
+/*
+ * \brief Render many frames in parallel.
+ *
+ * A pool of threads takes states until all are rendered, each into its own
+ * frame buffer.
+ *
+ * \param face Pointer to vgaFace from initVgaFace().
+ * \param states States to render.
+ * \param count Number of states.
+ * \param threads Number of worker threads.
+ * \param onFrame Callback for every frame.
+ * \param context Pointer passed through to onFrame.
+ *
+ * \returns Number of threads used, including the calling thread, or 0 if out
+ *     of memory.
+ */
+int renderFrames(const vgaFace* face, const vgaState* states, size_t count,
+                 int threads, frameCallback onFrame, void* context);
+
+
+/*
+ * \brief 64 bit FNV-1a digest of a frame.
+ *
+ * The frame is read as 64 bit words in host byte order, word i going into
+ * lane i % 4, and the four lane hashes are hashed together at the end.
+ *
+ * \param rgb Frame of FRAMEBYTES.
+ *
+ * \returns Digest of the frame.
+ */
+uint64_t frameDigest(const unsigned char* rgb);
+
+
+/*
+ * \brief Write a frame as a binary PPM image.
+ *
+ * \param path File to write.
+ * \param rgb Frame of FRAMEBYTES.
+ *
+ * \returns 0 on success, 1 if the file cannot be written.
+ */
+int writePpm(const char* path, const unsigned char* rgb);
+
+
+#endif /* VGA_MODEL_H_ */
@@ -0,0 +1,203 @@
+/*
+ * Checks the fast frame renderer of vga_model.c against vgaPixel().
+ *
+ * The ROMs are filled with random bits, so every character, month and tick
+ * pixel is exercised without the ROM files of the Quartus project. Random
+ * states, including field values the PIC32 never sends, are rendered both
+ * ways and compared pixel by pixel. Then $readmemb parsing is checked on a
+ * small file, the thread pool is checked against single frames, and the
+ * time to render all 43200 positions of the hands is estimated.
+ *
+ * Build: gcc -std=c99 -O3 -march=native -pthread vga_model.c \
+ *            test_support.c vga_model_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test_support.h"
+#include "vga_model.h"
+
+#define NSTATES 16
+#define NTHREADED 200
+#define BENCHFRAMES 2000
+#define ROMTEST "vga_model_test_rom.txt"
+
+
+static void randomRom(vgaRom* rom, int width, int depth)
+{
+    initVgaRom(rom, width, depth);
+
+    for (int i = 0; i < width * depth; i++)
+        rom->bits[i] = rand() % 2;
+}
+
+
+/* any value that fits the ports, or a valid time most of the time */
+static void randomTime(vgaTime* time, int valid)
+{
+    time->hour   = valid ? rand() % 24 : rand() % 32;
+    time->minute = valid ? rand() % 60 : rand() % 64;
+    time->second = valid ? rand() % 60 : rand() % 64;
+    time->month  = valid ? 1 + rand() % 12 : rand() % 16;
+    time->day    = valid ? 1 + rand() % 31 : rand() % 32;
+    time->year   = rand() % 64;
+}
+
+
+int checkFrames(const vgaRoms* roms, const vgaFace* face)
+{
+    static unsigned char rgb[FRAMEBYTES];
+
+    /* every angle of every hand, then random states */
+    for (int i = 0; i < 64 + NSTATES; i++) {
+        vgaState state;
+        randomTime(&state.current, i % 3);
+        randomTime(&state.sync, i % 3);
+
+        if (i < 64) {
+            state.current.second = state.current.minute = i;
+            state.current.hour   = i % 13 + (i & 16);
+        }
+
+        renderFrame(face, &state, rgb);
+
+        for (int y = 0; y < VGAHEIGHT; y++) {
+            for (int x = 0; x < VGAWIDTH; x++) {
+                const unsigned char* p = rgb + 3 * (y * VGAWIDTH + x);
+                uint32_t color = (uint32_t) p[0] << 16 | p[1] << 8 | p[2];
+                uint32_t expected = vgaPixel(roms, &state, x, y);
+
+                if (color != expected) {
+                    printf("%02d:%02d:%02d pixel %d, %d is %06lx, not %06lx\n",
+                           state.current.hour, state.current.minute,
+                           state.current.second, x, y, (unsigned long) color,
+                           (unsigned long) expected);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+int checkRomFile()
+{
+    vgaRom rom;
+    FILE* out = fopen(ROMTEST, "w");
+
+    if (!out) {
+        perror(ROMTEST);
+        return 1;
+    }
+
+    /* comments, an address jump, underscores, x and a long word */
+    fprintf(out, "// test\n101100 000_011\n/* skip\n 111111 */ 0x1\n"
+                 "@5 1111011\n");
+    fclose(out);
+
+    initVgaRom(&rom, 6, 8);
+    int err = loadVgaRom(&rom, ROMTEST);
+    remove(ROMTEST);
+
+    static const unsigned expected[8] = {054, 03, 01, 0, 0, 073, 0, 0};
+
+    for (int a = 0; a < 8 && !err; a++) {
+        unsigned word = 0;
+
+        for (int b = 0; b < 6; b++)
+            word |= (unsigned) rom.bits[a * 6 + b] << b;
+
+        if (word != expected[a]) {
+            printf("ROM word %d is %o, not %o\n", a, word, expected[a]);
+            err = 1;
+        }
+    }
+
+    free(rom.bits);
+    return err;
+}
+
+
+void storeDigest(size_t index, const unsigned char* rgb, void* context)
+{
+    ((uint64_t*) context)[index] = frameDigest(rgb);
+}
+
+
+int checkThreaded(const vgaFace* face)
+{
+    static vgaState states[NTHREADED];
+    static uint64_t digests[NTHREADED];
+    static unsigned char rgb[FRAMEBYTES];
+
+    for (int i = 0; i < NTHREADED; i++) {
+        randomTime(&states[i].current, 1);
+        states[i].sync = states[i].current;
+    }
+
+    if (!renderFrames(face, states, NTHREADED, 4, storeDigest, digests))
+        return 1;
+
+    for (int i = 0; i < NTHREADED; i++) {
+        renderFrame(face, &states[i], rgb);
+
+        if (frameDigest(rgb) != digests[i]) {
+            printf("threaded frame %d differs\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void benchmark(const vgaFace* face)
+{
+    static vgaState states[BENCHFRAMES];
+    static uint64_t digests[BENCHFRAMES];
+
+    for (int i = 0; i < BENCHFRAMES; i++) {
+        vgaTime time = {i / 3600 % 12, i / 60 % 60, i % 60, 12, 6, 0};
+        states[i].current = states[i].sync = time;
+    }
+
+    double start = now();
+    renderFrames(face, states, BENCHFRAMES, 1, storeDigest, digests);
+    double elapsed = now() - start;
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    printf("%.0f frames/s per thread, %.1f s for all 43200 hand positions\n",
+           BENCHFRAMES / elapsed, 43200 * elapsed / BENCHFRAMES);
+}
+
+
+int main()
+{
+    static vgaFace face;
+    vgaRoms roms;
+
+    srand(1);
+
+    randomRom(&roms.chars, 6, 744);
+    randomRom(&roms.months, 24, 111);
+    randomRom(&roms.ticks, 400, 400);
+    initVgaFace(&face, &roms);
+
+    int failed = checkFrames(&roms, &face) || checkRomFile()
+              || checkThreaded(&face);
+
+    if (!failed)
+        benchmark(&face);
+
+    freeVgaRoms(&roms);
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
@@ -0,0 +1,175 @@
+/*
+ * Renders the frames radclk_vga.sv draws, one per second from a start time.
+ *
+ * Usage: vga_render [-j threads] [-r romdir] [-n frames] [-o dir]
+ *                   [-s "last sync"] ["start time"]
+ *
+ * Times are given as "YYYY-MM-DD HH:MM:SS" in the local time the PIC32 sends.
+ * The start time defaults to 2014-01-01 00:00:00, and the 43200 frames of
+ * the default run go through every position of the hands once. The last
+ * sync shown defaults to the start time. The ROM files read by $readmemb are
+ * loaded from romdir, ../vga by default.
+ *
+ * Every frame is printed with its time and frameDigest() for diffing against
+ * a simulation of the HDL. With -o every frame is also written to
+ * dir/frameNNNNN.ppm.
+ *
+ * Build: gcc -std=c99 -O3 -march=native -pthread civil_time.c vga_model.c \
+ *            test_support.c vga_render.c -o vga_render
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civil_time.h"
+#include "test_support.h"
+#include "vga_model.h"
+
+#define FIRSTYEAR 2014    /* year 0 of the year field */
+
+
+/* where the frames go, written by the thread that rendered each */
+typedef struct {
+    const char* dir;
+    uint64_t*   digests;
+    int         failed;
+} frameOutput;
+
+
+/* seconds since 1970 of a local time, 0 on success */
+int parseTime(const char* text, time_t* time)
+{
+    int year, month, day, hour, minute, second;
+
+    if (sscanf(text, "%d-%d-%d%*c%d:%d:%d", &year, &month, &day, &hour,
+               &minute, &second) != 6)
+        return 1;
+
+    *time = (time_t) daysFromCivil(year, month, day) * SECONDSPERDAY
+          + hour * 3600L + minute * 60 + second;
+    return 0;
+}
+
+
+void toVgaTime(time_t time, vgaTime* fields)
+{
+    struct tm local;
+    civilFromTime(time, &local);
+
+    fields->hour   = local.tm_hour;
+    fields->minute = local.tm_min;
+    fields->second = local.tm_sec;
+    fields->month  = local.tm_mon + 1;
+    fields->day    = local.tm_mday;
+    fields->year   = local.tm_year + 1900 - FIRSTYEAR;
+}
+
+
+void outputFrame(size_t index, const unsigned char* rgb, void* context)
+{
+    frameOutput* output = context;
+    output->digests[index] = frameDigest(rgb);
+
+    if (output->dir) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/frame%05zu.ppm", output->dir, index);
+
+        if (writePpm(path, rgb)) {
+            perror(path);
+            output->failed = 1;
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    static vgaFace face;
+    vgaRoms roms;
+
+    int threads = 4;
+    size_t count = 43200;
+    const char* romDir = "../vga";
+    const char* syncText = NULL;
+    const char* startText = "2014-01-01 00:00:00";
+    frameOutput output = {NULL, NULL, 0};
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-j") == 0)
+            threads = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-r") == 0)
+            romDir = argv[arg + 1];
+        else if (strcmp(argv[arg], "-n") == 0)
+            count = strtoul(argv[arg + 1], NULL, 10);
+        else if (strcmp(argv[arg], "-o") == 0)
+            output.dir = argv[arg + 1];
+        else if (strcmp(argv[arg], "-s") == 0)
+            syncText = argv[arg + 1];
+        else
+            break;
+    }
+
+    if (arg < argc)
+        startText = argv[arg++];
+
+    time_t start, sync;
+
+    if (arg < argc || threads < 1 || count < 1 || parseTime(startText, &start)
+            || parseTime(syncText ? syncText : startText, &sync)) {
+        fprintf(stderr, "usage: %s [-j threads] [-r romdir] [-n frames] "
+                "[-o dir] [-s \"last sync\"] [\"YYYY-MM-DD HH:MM:SS\"]\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (loadVgaRoms(&roms, romDir))
+        return 1;
+
+    initVgaFace(&face, &roms);
+    freeVgaRoms(&roms);
+
+    vgaState* states = malloc(count * sizeof(vgaState));
+    output.digests = malloc(count * sizeof(uint64_t));
+
+    if (!states || !output.digests) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        toVgaTime(start + (time_t) i, &states[i].current);
+        toVgaTime(sync, &states[i].sync);
+    }
+
+    double begin = now();
+    int used = renderFrames(&face, states, count, threads, outputFrame,
+                            &output);
+    double elapsed = now() - begin;
+
+    if (!used) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        vgaTime* t = &states[i].current;
+        printf("%d-%02d-%02d %02d:%02d:%02d %016llx\n", FIRSTYEAR + t->year,
+               t->month, t->day, t->hour, t->minute, t->second,
+               (unsigned long long) output.digests[i]);
+    }
+
+    /* guard against a zero interval on tiny runs */
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "frames: %zu on %d threads (%.0f frames/s)\n", count, used,
+            count / elapsed);
+
+    free(states);
+    free(output.digests);
+
+    return output.failed;
+}
@@ -0,0 +1,43 @@
+# WWVB amplitude time code frame layout.
+#
+# This is the only description of the frame layout. generate_signal.py uses it
+# to build test signals, and generate_layout_header.py turns it into the masks
+# and lookup tables that time_decoder.c decodes frames with. Run
+# generate_layout_header.py again after changing anything here.
+
+FRAME_SIZE = 60
+
+# bits that are always a marker
+MARKERS = [0, 9, 19, 29, 39, 49, 59]
+
+# bits that are always 0
+ZEROS = [4, 10, 11, 14, 20, 21, 24, 34, 35, 44, 54]
+
+# BCD fields as (name, [(bit index, weight), ...]), most significant bit first
+FIELDS = [
+    ('minute', [(1, 40), (2, 20), (3, 10), (5, 8), (6, 4), (7, 2), (8, 1)]),
+    ('hour',   [(12, 20), (13, 10), (15, 8), (16, 4), (17, 2), (18, 1)]),
+    ('day',    [(22, 200), (23, 100), (25, 80), (26, 40), (27, 20),
+                (28, 10),  (30, 8),   (31, 4),  (32, 2),  (33, 1)]),
+    ('year',   [(45, 80), (46, 40), (47, 20), (48, 10),
+                (50, 8),  (51, 4),  (52, 2),  (53, 1)]),
+]
+
+# set in leap years
+LEAP_YEAR_BIT = 55
+
+# set while daylight saving time is in effect at the end of the UTC day of
+# the frame, so on the day it begins but not on the day it ends
+DST_AT_END_BIT = 57
+
+# set while daylight saving time is in effect at the start of the UTC day of
+# the frame, so on the day it ends but not on the day it begins
+DST_AT_START_BIT = 58
+
+
+def field(name):
+    for (fieldName, indAndWeight) in FIELDS:
+        if fieldName == name:
+            return indAndWeight
+
+    raise KeyError(name)
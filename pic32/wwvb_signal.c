@@ -0,0 +1,68 @@
+#include "civil_time.h"
+#include "wwvb_signal.h"
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+/* set the bits of a BCD field, inverse of decodeField() */
+static void encodeField(int value, enum FIELD field, char* frame)
+{
+    /* weights decrease from the first bit of the field to the last */
+    for (int i = 0; i < MAXSLICES; i++) {
+        const fieldSlice* slice = &frameFields[field][i];
+
+        for (int k = 0; k < slice->width; k++) {
+            int weight = slice->table[1 << k];
+
+            if (weight && value >= weight) {
+                frame[slice->shift + k] = 1;
+                value -= weight;
+            }
+        }
+    }
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void encodeFrame(time_t minute, int dst, char* frame)
+{
+    struct tm utc;
+    civilFromTime(minute, &utc);
+
+    for (int i = 0; i < FRAMESIZE; i++)
+        frame[i] = MARKERMASK >> i & 1 ? 'm' : 0;
+
+    encodeField(utc.tm_min, minuteField, frame);
+    encodeField(utc.tm_hour, hourField, frame);
+    encodeField(utc.tm_yday + 1, dayField, frame);
+    encodeField(utc.tm_year % 100, yearField, frame);
+
+    frame[LEAPYEARBIT] = isLeapYear(utc.tm_year + 1900);
+
+    frame[DSTATENDBIT]   = (dst & DSTBEGINS) != 0;
+    frame[DSTATSTARTBIT] = (dst & DSTENDS) != 0;
+}
+
+
+int pulseLows(char bit)
+{
+    if (bit == 'm')
+        return 4 * NSAMPLES / 5;
+
+    return bit ? NSAMPLES / 2 : NSAMPLES / 5;
+}
+
+
+void frameToSamples(const char* frame, char* samples)
+{
+    for (int i = 0; i < FRAMESIZE; i++) {
+        int lows = pulseLows(frame[i]);
+
+        for (int j = 0; j < NSAMPLES; j++)
+            *samples++ = j >= lows;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef WWVB_SIGNAL_H_
+#define WWVB_SIGNAL_H_
+
+#include <time.h>
+
+#include "frame_layout.h"
+#include "time_decoder.h"
+
+#define FRAMESAMPLES (FRAMESIZE * NSAMPLES)    /* Raw samples in one frame */
+
+
+/*
+ * \brief Encode the frame transmitted during one minute.
+ *
+ * The same bits generate_signal.py produces, with the field weights taken
+ * from the generated frame layout tables.
+ *
+ * \param minute UTC time of the start of the minute.
+ * \param dst DST status of the UTC day, DSTOFF, DSTBEGINS, DSTENDS or DSTON.
+ * \param frame Stores the FRAMESIZE encoded bits, 0, 1 or 'm'.
+ */
+void encodeFrame(time_t minute, int dst, char* frame);
+
+
+/*
+ * \brief Number of 0 samples that start the pulse of an encoded bit.
+ *
+ * \param bit Encoded bit, 0, 1 or 'm'.
+ *
+ * \returns Number of 0 samples, the inverse of classifyPulse().
+ */
+int pulseLows(char bit);
+
+
+/*
+ * \brief Raw samples of a frame as seen by the receiver board.
+ *
+ * \param frame FRAMESIZE encoded bits, 0, 1 or 'm'.
+ * \param samples Stores FRAMESAMPLES raw samples, 0 or 1.
+ */
+void frameToSamples(const char* frame, char* samples);
+
+
+#endif /* WWVB_SIGNAL_H_ */
@@ -0,0 +1,134 @@
+/*
+ * Writes WWVB sample files, natively and in parallel.
+ *
+ * Usage: wwvb_synthesize [-j threads] [-s seed] [-n cases]
+ *                        [signals.txt time.txt]
+ *        wwvb_synthesize [-j threads] [-d dst] -r "YYYY-MM-DD HH:MM" minutes
+ *                        [out.txt]
+ *
+ * The first form writes the test corpus of generate_tests.py, 150000 cases
+ * by default, to signals.txt and time.txt. The same seed gives the same
+ * corpus whatever the number of threads. The second form writes the frames
+ * of every minute from a UTC time, to stdout without a file name. A report
+ * of frames/s goes to stderr.
+ *
+ * Build: gcc -std=c99 -O2 -pthread frame_layout.c civil_time.c wwvb_signal.c \
+ *            wwvb_synthesizer.c test_support.c wwvb_synthesize.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civil_time.h"
+#include "test_support.h"
+#include "wwvb_synthesizer.h"
+
+
+/* UTC time of a "YYYY-MM-DD HH:MM" string, 0 on success */
+int parseMinute(const char* text, time_t* time)
+{
+    int year, month, day, hour, minute;
+
+    if (sscanf(text, "%d-%d-%d%*c%d:%d", &year, &month, &day, &hour,
+               &minute) != 5)
+        return 1;
+
+    *time = (time_t) daysFromCivil(year, month, day) * SECONDSPERDAY
+          + hour * 3600L + minute * 60L;
+    return 0;
+}
+
+
+FILE* openOutput(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+
+    if (!file)
+        perror(path);
+
+    return file;
+}
+
+
+int main(int argc, char** argv)
+{
+    int threads = 4, dst = 0;
+    long count = CORPUSCASES;
+    uint64_t seed = 1;
+    const char* range = NULL;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-j") == 0)
+            threads = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-s") == 0)
+            seed = strtoull(argv[arg + 1], NULL, 10);
+        else if (strcmp(argv[arg], "-n") == 0)
+            count = atol(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-d") == 0)
+            dst = atoi(argv[arg + 1]) != 0;
+        else if (strcmp(argv[arg], "-r") == 0)
+            range = argv[arg + 1];
+        else
+            break;
+    }
+
+    time_t start = 0;
+    int files = argc - arg;
+
+    /* a range takes the number of minutes first */
+    if (range && files > 0)
+        count = atol(argv[arg++]), files--;
+
+    if (threads < 1 || count < 1 || (range && parseMinute(range, &start))
+            || files > (range ? 1 : 2) || (!range && files == 1)) {
+        fprintf(stderr, "usage: %s [-j threads] [-s seed] [-n cases] "
+                "[signals.txt time.txt]\n"
+                "       %s [-j threads] [-d dst] -r \"YYYY-MM-DD HH:MM\" "
+                "minutes [out.txt]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    double begin = now();
+    long frames = range ? count : 2 * count;
+    int err;
+
+    if (range) {
+        FILE* out = files ? openOutput(argv[arg]) : stdout;
+
+        if (!out)
+            return 1;
+
+        err = synthRange(out, start, count, dst, threads);
+        err |= out != stdout && fclose(out) != 0;
+
+    } else {
+        FILE* signals = openOutput(files ? argv[arg] : "signals.txt");
+        FILE* truth   = openOutput(files ? argv[arg + 1] : "time.txt");
+
+        if (!signals || !truth)
+            return 1;
+
+        err = synthCorpus(signals, truth, count, seed, threads);
+        err |= fclose(signals) != 0;
+        err |= fclose(truth) != 0;
+    }
+
+    double elapsed = now() - begin;
+
+    if (err) {
+        fprintf(stderr, "%s: write failed\n", argv[0]);
+        return 1;
+    }
+
+    /* guard against a zero interval on tiny runs */
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    fprintf(stderr, "frames: %ld on %d threads (%.3g frames/s)\n", frames,
+            threads, frames / elapsed);
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "civil_time.h"
+#include "test_support.h"
+#include "wwvb_synthesizer.h"
+
+#define NOISESTART "1111111111111111111111"    /* before the first marker */
+
+
+/* samples of a 0, a 1 and a marker as text */
+static char pulseText[3][NSAMPLES];
+static pthread_once_t pulseTextOnce = PTHREAD_ONCE_INIT;
+
+
+/* one block of a corpus or a range, generated by one thread */
+typedef struct {
+    uint64_t seed;
+    time_t   start;      /* range only */
+    int      dst;        /* range only */
+    int      corpus;     /* 1 for corpus cases, 0 for frames of a range */
+    long     first;      /* index of the first case or frame */
+    long     count;
+    char*    text;
+    char*    truth;      /* corpus only */
+} synthBlock;
+
+
+/******************************************************************************/
+/********************************* Helpers ************************************/
+/******************************************************************************/
+
+static void initPulseText(void)
+{
+    static const char bits[3] = {0, 1, 'm'};
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < NSAMPLES; j++)
+            pulseText[i][j] = j < pulseLows(bits[i]) ? '0' : '1';
+}
+
+
+static void putDigits(char* text, int value, int digits)
+{
+    for (int i = digits - 1; i >= 0; i--, value /= 10)
+        text[i] = (char) ('0' + value % 10);
+}
+
+
+static void* fillBlock(void* arg)
+{
+    synthBlock* block = arg;
+
+    if (!block->corpus) {
+        rangeToText(block->start + block->first * 60, block->count, block->dst,
+                    block->text);
+        return NULL;
+    }
+
+    for (long i = 0; i < block->count; i++)
+        caseToText(block->seed, block->first + i,
+                   block->text + i * CASESAMPLES, block->truth + i * TRUTHSIZE);
+
+    return NULL;
+}
+
+
+/* generate blocks on every thread, then write them in order */
+static int runBlocks(synthBlock* job, long total, int threads, FILE* out,
+                     FILE* truth)
+{
+    size_t textSize = (size_t) SYNTHBLOCK
+                    * (job->corpus ? CASESAMPLES : FRAMESAMPLES);
+
+    synthBlock* blocks = calloc(threads, sizeof(synthBlock));
+    pthread_t workers[threads > 1 ? threads - 1 : 1];
+    int err = blocks == NULL;
+
+    for (int i = 0; i < threads && !err; i++) {
+        blocks[i] = *job;
+        blocks[i].text  = malloc(textSize);
+        blocks[i].truth = malloc((size_t) SYNTHBLOCK * TRUTHSIZE);
+        err = !blocks[i].text || !blocks[i].truth;
+    }
+
+    for (long first = 0; first < total && !err; first += (long) threads
+                                                         * SYNTHBLOCK) {
+        int used = 0, started = 0;
+
+        for (; used < threads && first + used * SYNTHBLOCK < total; used++) {
+            long left = total - first - used * SYNTHBLOCK;
+
+            blocks[used].first = first + used * SYNTHBLOCK;
+            blocks[used].count = left < SYNTHBLOCK ? left : SYNTHBLOCK;
+        }
+
+        /* the calling thread fills the first block */
+        while (started < used - 1 && !pthread_create(&workers[started], NULL,
+                                                     fillBlock,
+                                                     &blocks[started + 1]))
+            started++;
+
+        for (int i = started + 1; i < used; i++)
+            fillBlock(&blocks[i]);
+
+        fillBlock(&blocks[0]);
+
+        for (int i = 0; i < started; i++)
+            pthread_join(workers[i], NULL);
+
+        for (int i = 0; i < used && !err; i++) {
+            size_t samples = (size_t) blocks[i].count
+                           * (job->corpus ? CASESAMPLES : FRAMESAMPLES);
+
+            err = fwrite(blocks[i].text, 1, samples, out) != samples;
+
+            if (job->corpus && !err)
+                err = fwrite(blocks[i].truth, TRUTHSIZE, blocks[i].count, truth)
+                      != (size_t) blocks[i].count;
+        }
+    }
+
+    for (int i = 0; blocks && i < threads; i++) {
+        free(blocks[i].text);
+        free(blocks[i].truth);
+    }
+
+    free(blocks);
+    return err;
+}
+
+
+/******************************************************************************/
+/************************ Header file implementation **************************/
+/******************************************************************************/
+
+void frameToText(const char* frame, char* text)
+{
+    pthread_once(&pulseTextOnce, initPulseText);
+
+    for (int i = 0; i < FRAMESIZE; i++, text += NSAMPLES)
+        memcpy(text, pulseText[frame[i] == 'm' ? 2 : frame[i] != 0], NSAMPLES);
+}
+
+
+void rangeToText(time_t minute, long count, int dst, char* text)
+{
+    char frame[FRAMESIZE];
+
+    for (long i = 0; i < count; i++, minute += 60, text += FRAMESAMPLES) {
+        encodeFrame(minute, dst ? DSTON : DSTOFF, frame);
+        frameToText(frame, text);
+    }
+}
+
+
+time_t caseTime(uint64_t seed, long index)
+{
+    uint64_t random = mix(seed ^ mix((uint64_t) index));
+
+    /* random.randint(0, CORPUSSPAN) seconds */
+    return CORPUSEPOCH + (time_t) (random % (CORPUSSPAN + 1));
+}
+
+
+void caseToText(uint64_t seed, long index, char* text, char* truth)
+{
+    time_t start = caseTime(seed, index);
+    struct tm done;
+
+    rangeToText(start, 2, 0, text);
+
+    /* the decoder has the time once the second frame is over */
+    civilFromTime(start + 120, &done);
+    memcpy(truth, "YYYY-MM-DD HH:MM\n", TRUTHSIZE);
+    putDigits(truth, done.tm_year + 1900, 4);
+    putDigits(truth + 5, done.tm_mon + 1, 2);
+    putDigits(truth + 8, done.tm_mday, 2);
+    putDigits(truth + 11, done.tm_hour, 2);
+    putDigits(truth + 14, done.tm_min, 2);
+}
+
+
+int synthCorpus(FILE* signals, FILE* truth, long cases, uint64_t seed,
+                int threads)
+{
+    synthBlock job = {seed, 0, 0, 1, 0, 0, NULL, NULL};
+
+    pthread_once(&pulseTextOnce, initPulseText);
+
+    /* noise and a marker first, and a 0 to finish the last pulse */
+    int err = fputs(NOISESTART, signals) == EOF
+           || fwrite(pulseText[2], 1, NSAMPLES, signals) != NSAMPLES;
+
+    err = err || runBlocks(&job, cases, threads, signals, truth);
+
+    return err || fputc('0', signals) == EOF;
+}
+
+
+int synthRange(FILE* out, time_t start, long minutes, int dst, int threads)
+{
+    synthBlock job = {0, start, dst, 0, 0, 0, NULL, NULL};
+
+    return runBlocks(&job, minutes, threads, out, NULL);
+}
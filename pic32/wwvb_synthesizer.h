@@ -0,0 +1,102 @@
+#ifndef WWVB_SYNTHESIZER_H_
+#define WWVB_SYNTHESIZER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "wwvb_signal.h"
+
+#define CORPUSCASES 150000               /* cases of generate_tests.py */
+#define CORPUSEPOCH 946684800            /* 2000-01-01, start of the cases */
+#define CORPUSSPAN (32 * 31536000L)      /* case times are up to this after */
+#define CASESAMPLES (2 * FRAMESAMPLES)   /* two frames per case */
+#define TRUTHSIZE 17                     /* "YYYY-MM-DD HH:MM\n" */
+#define SYNTHBLOCK 1024                  /* cases or frames per block */
+
+
+/*
+ * \brief Samples of a frame as text, one '0' or '1' per sample.
+ *
+ * The same as frameToSamples(), but copies a precomputed pattern per bit.
+ *
+ * \param frame FRAMESIZE encoded bits, 0, 1 or 'm'.
+ * \param text Stores FRAMESAMPLES characters, not terminated.
+ */
+void frameToText(const char* frame, char* text);
+
+
+/*
+ * \brief Samples of consecutive frames as text.
+ *
+ * \param minute UTC time of the start of the first frame.
+ * \param count Number of frames.
+ * \param dst 1 if DST is in effect, 0 otherwise.
+ * \param text Stores count * FRAMESAMPLES characters, not terminated.
+ */
+void rangeToText(time_t minute, long count, int dst, char* text);
+
+
+/*
+ * \brief Start time of a case of the test corpus.
+ *
+ * Depends only on the seed and the index, so a corpus is the same however
+ * it is split between threads.
+ *
+ * \param seed Seed of the corpus.
+ * \param index Index of the case.
+ *
+ * \returns Time from CORPUSEPOCH to CORPUSEPOCH + CORPUSSPAN.
+ */
+time_t caseTime(uint64_t seed, long index);
+
+
+/*
+ * \brief One case of the test corpus, in the format of generate_tests.py.
+ *
+ * Two frames from the case time, without DST, and the time the second frame
+ * finishes.
+ *
+ * \param seed Seed of the corpus.
+ * \param index Index of the case.
+ * \param text Stores CASESAMPLES characters, not terminated.
+ * \param truth Stores TRUTHSIZE characters, the line of time.txt.
+ */
+void caseToText(uint64_t seed, long index, char* text, char* truth);
+
+
+/*
+ * \brief Write a test corpus the way generate_tests.py does.
+ *
+ * Blocks of SYNTHBLOCK cases are generated by a pool of threads and written
+ * in order as they finish, so only a few blocks are in memory at a time.
+ *
+ * \param signals File for the samples, signals.txt.
+ * \param truth File for the time each case decodes to, time.txt.
+ * \param cases Number of cases.
+ * \param seed Seed of the corpus.
+ * \param threads Number of threads generating blocks.
+ *
+ * \returns 0 on success, 1 if out of memory or a write failed.
+ */
+int synthCorpus(FILE* signals, FILE* truth, long cases, uint64_t seed,
+                int threads);
+
+
+/*
+ * \brief Write the samples of every minute of a time range.
+ *
+ * Generated in blocks of SYNTHBLOCK frames like synthCorpus().
+ *
+ * \param out File for the samples.
+ * \param start UTC time of the start of the first frame.
+ * \param minutes Number of frames.
+ * \param dst 1 if DST is in effect, 0 otherwise.
+ * \param threads Number of threads generating blocks.
+ *
+ * \returns 0 on success, 1 if out of memory or a write failed.
+ */
+int synthRange(FILE* out, time_t start, long minutes, int dst, int threads);
+
+
+#endif /* WWVB_SYNTHESIZER_H_ */
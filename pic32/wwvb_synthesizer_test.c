@@ -0,0 +1,192 @@
+/*
+ * Checks the native synthesizer against frameToSamples().
+ *
+ * Random frames are turned into text both ways, ranges are compared with
+ * frames encoded one by one, and corpora written with different numbers of
+ * threads, with a partial last block, have to be identical. Every case of
+ * a corpus has to decode to its line of time.txt. Then the corpus rate is
+ * measured.
+ *
+ * Build: gcc -std=c99 -O2 -pthread time_decoder.c frame_layout.c \
+ *            civil_time.c wwvb_signal.c wwvb_synthesizer.c \
+ *            test_support.c wwvb_synthesizer_test.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "civil_time.h"
+#include "test_support.h"
+#include "wwvb_synthesizer.h"
+
+#define NFRAMES 2000
+#define NCASES (2 * SYNTHBLOCK + 77)    /* a partial block at the end */
+#define BENCHCASES 500000
+
+
+/* whole contents of a temporary file */
+char* readAll(FILE* file, long* size)
+{
+    *size = ftell(file);
+    rewind(file);
+
+    char* data = malloc(*size + 1);
+    if (fread(data, 1, *size, file) != (size_t) *size)
+        *size = -1;
+
+    return data;
+}
+
+
+int checkFrames()
+{
+    char frame[FRAMESIZE], samples[FRAMESAMPLES], text[FRAMESAMPLES];
+    static char range[NFRAMES * FRAMESAMPLES];
+    time_t start = CORPUSEPOCH + (time_t) (rand() % 100000) * 60;
+
+    rangeToText(start, NFRAMES, 1, range);
+
+    for (int i = 0; i < NFRAMES; i++) {
+        encodeFrame(start + 60 * i, DSTON, frame);
+        frameToSamples(frame, samples);
+        frameToText(frame, text);
+
+        for (int j = 0; j < FRAMESAMPLES; j++) {
+            if (text[j] != '0' + samples[j] ||
+                    range[i * FRAMESAMPLES + j] != text[j]) {
+                printf("frame %d differs at sample %d\n", i, j);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/* decode a corpus the way time_decoder_test.c does */
+int checkDecoded(const char* signals, long size, const char* truth)
+{
+    timeDecoder decoder;
+    initDecoder(&decoder);
+
+    int cases = 0;
+
+    for (long i = 0; i < size; i++) {
+        if (updateDecoder(&decoder, signals[i] - '0') != 3)
+            continue;
+
+        time_t unixTime = 0;
+        int dst = 0;
+        int err = updateTimeAndDate(&decoder, &unixTime, &dst);
+
+        /* the last marker of the pair starts the next case */
+        keepLastMarker(&decoder);
+
+        /* decoded as the time the second frame finishes */
+        struct tm t;
+        char line[64];
+        civilFromTime(unixTime, &t);
+        snprintf(line, sizeof(line), "%04d-%02d-%02d %02d:%02d\n",
+                 t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour,
+                 t.tm_min);
+
+        if (err || memcmp(line, truth + cases * TRUTHSIZE, TRUTHSIZE)) {
+            printf("case %d decoded to %.16s\n", cases, line);
+            return 1;
+        }
+
+        cases++;
+    }
+
+    if (cases != NCASES) {
+        printf("%d of %d cases decoded\n", cases, NCASES);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int checkCorpus()
+{
+    char* signals[2];
+    char* truth[2];
+    long signalSize[2], truthSize[2];
+    int threads[2] = {1, 3};
+
+    for (int i = 0; i < 2; i++) {
+        FILE* signalFile = tmpfile();
+        FILE* truthFile  = tmpfile();
+
+        if (!signalFile || !truthFile ||
+                synthCorpus(signalFile, truthFile, NCASES, 7, threads[i])) {
+            printf("corpus not written\n");
+            return 1;
+        }
+
+        signals[i] = readAll(signalFile, &signalSize[i]);
+        truth[i]   = readAll(truthFile, &truthSize[i]);
+        fclose(signalFile);
+        fclose(truthFile);
+    }
+
+    int failed = signalSize[0] != 32 + (long) NCASES * CASESAMPLES + 1
+              || truthSize[0] != (long) NCASES * TRUTHSIZE;
+
+    if (failed)
+        printf("corpus sizes %ld and %ld\n", signalSize[0], truthSize[0]);
+
+    if (!failed && (signalSize[0] != signalSize[1] || truthSize[0] != truthSize[1]
+            || memcmp(signals[0], signals[1], signalSize[0])
+            || memcmp(truth[0], truth[1], truthSize[0]))) {
+        printf("corpus depends on the number of threads\n");
+        failed = 1;
+    }
+
+    failed = failed || checkDecoded(signals[0], signalSize[0], truth[0]);
+
+    for (int i = 0; i < 2; i++) {
+        free(signals[i]);
+        free(truth[i]);
+    }
+
+    return failed;
+}
+
+
+void benchmark()
+{
+    FILE* sink = fopen("/dev/null", "wb");
+
+    if (!sink)
+        return;
+
+    double start = now();
+    synthCorpus(sink, sink, BENCHCASES, 1, 4);
+    double elapsed = now() - start;
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+
+    printf("%.3g frames/s, %.2f s per million frames\n",
+           2 * BENCHCASES / elapsed, elapsed * 1e6 / (2 * BENCHCASES));
+
+    fclose(sink);
+}
+
+
+int main()
+{
+    srand(1);
+
+    int failed = checkFrames() || checkCorpus();
+
+    if (!failed)
+        benchmark();
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed;
+}
@@ -100,6 +100,11 @@ module videoGen(input logic clk,
   logic [3:0] month_in;
   logic [4:0] day_in;
   logic [5:0] year_in;
+  logic [9:0] millisecond_in;
+  logic dst_in, locked_in, synced_in;
+  logic [15:0] drift_in, sincesync_in;
+  logic packetvalid;
+  logic [7:0] crcerrors;
   logic synccounter;
   logic clkgenrange;
   logic stargenrange;
@@ -108,8 +113,10 @@ module videoGen(input logic clk,
   // Instantiate modules
   
   // read in time from PIC over SPI 
-  spi_receiver spirec(clk, sclk, sdi, s, header, hour_in, minute_in, 
-                      second_in, month_in, day_in, year_in);
+  spi_receiver spirec(clk, sclk, sdi, header, hour_in, minute_in, 
+                      second_in, month_in, day_in, year_in, millisecond_in,
+                      dst_in, locked_in, synced_in, drift_in, sincesync_in,
+                      packetvalid, crcerrors);
   
   // generate digital time display for current time & time of last sync
   datetimedisp dateandtime(x, y, header, second_in, minute_in, hour_in, 
@@ -1,75 +1,132 @@
 // spi_receiver.sv
 // Lasted edited 12/06/2014 by Mengyi Tao & Yukun Lin
 // SPI receiver module for radio clock project
+//
+// Receives version 2 time packets, see pic32/spi_protocol.h: four 32 bit
+// words starting with the sync word 16'hEB90 and ending with a CRC-16/CCITT
+// of everything before it. sclk and sdi are sampled on clk, so frames are
+// found by their sync word instead of by the clock domain of sclk, and sclk
+// can run at up to a quarter of clk. pic32/spi_receiver_model.c is a cycle
+// accurate C model of this module.
 
-module spi_receiver (input  logic clk, sclk,     //clk @ 40MHz (0.025us period)
-                                                 //sclk @ 1.25MHz (0.8us period)
+module spi_receiver #(parameter IDLECYCLES = 14'd8000)   // ~0.2 ms
+                    (input  logic clk, sclk,     //clk @ 40MHz (0.025us period)
+                                                 //sclk @ 5MHz (0.2us period)
                      input  logic sdi,           // spi input from master (PIC)
-                     output logic header,        // denotes if current time = time 
-                                                 // of last sync (if so, header = 1)
+                     output logic header,        // 0 if the time was just set
+                                                 // from the time signal
                      output logic [4:0] hour,    // 0-23 hours
                      output logic [5:0] minute,  // 0-60
                      output logic [5:0] second,  // 0-60
                      output logic [3:0] month,   // 0-12
                      output logic [4:0] day,     // 0-31
-                     output logic [4:0] year     // 2014-2078; 2014 is the reference year (i.e. year = 0 -> 2014)
+                     output logic [4:0] year,    // 2014-2045; 2014 is the reference year (i.e. year = 0 -> 2014)
+                     output logic [9:0] millisecond,  // 0-999
+                     output logic dst,           // daylight saving time
+                     output logic locked,        // seconds locked to the time signal
+                     output logic synced,        // time set from the time signal
+                     output logic [15:0] drift,  // PIC oscillator drift, 1/16 ppm
+                     output logic [15:0] sincesync,  // seconds since last sync
+                     output logic valid,         // high for one clk per good packet
+                     output logic [7:0] crcerrors    // packets that failed the CRC
 );
-                            
-
-  logic [31:0] spizerocount = 0;
-  logic lastZero = 1;
-  logic [31:0] timeout = 0;         // 32 bit number containing time information from PIC
-  logic [4:0] cnt = 0;              // for tracking the bit that's being updated
-  logic reset;                      // reset SPI buffer
-  logic [31:0] q;
-
-  
-  // track number of consecutive lows in sclk
-  always_ff @(posedge clk) 
+
+  localparam SYNC      = 16'hEB90;    // first half of word 0
+  localparam VERSION   = 16'h2400;    // version 2, 4 words
+  localparam CRCSYNC   = 16'h52FE;    // CRC after the sync word from 16'hFFFF
+  localparam CRCBITS   = 8'd112;      // bits before the CRC
+  localparam LASTBIT   = 8'd127;
+
+  logic [2:0] sclksync = 0;           // sclk through two flops, and one more
+  logic [1:0] sdisync = 0;            // for the edge
+  logic [13:0] idle = 0;              // clk cycles since the last sclk edge
+  logic [127:0] shift = 0;            // last 128 bits received
+  logic inframe = 0;                  // sync word found
+  logic [7:0] count = 0;              // bits of the packet received
+  logic [15:0] crc = 0;
+  logic [79:0] timedata = 0;          // words 1 to 3 of the last good packet
+  logic good = 0;                     // drives valid
+  logic [7:0] errors = 0;             // drives crcerrors
+
+  logic rise, bitin;
+  logic [127:0] packet;
+
+
+  function automatic logic [15:0] crcnext(input logic [15:0] c,
+                                          input logic b);
+    crcnext = {c[14:0], 1'b0} ^ ((c[15] ^ b) ? 16'h1021 : 16'h0);
+  endfunction
+
+
+  // synchronize sclk and sdi to clk, data is stable at the rising edge
+  assign rise   = sclksync[1] & ~sclksync[2];
+  assign bitin  = sdisync[1];
+  assign packet = {shift[126:0], bitin};
+
+  always_ff @(posedge clk)
     begin
-    if (!sclk)                               // sclk is low this cycle
+    sclksync <= {sclksync[1:0], sclk};
+    sdisync  <= {sdisync[0], sdi};
+    good     <= 0;
+
+    if (rise)
       begin
-      if (lastZero)                          // sclk was low on the previous cycle
-        spizerocount <= spizerocount + 1;    // increment counter
+      idle  <= 0;
+      shift <= packet;
+
+      if (!inframe)
+        begin
+        // hunt for the sync word one bit at a time
+        if (packet[15:0] == SYNC)
+          begin
+          inframe <= 1;
+          count   <= 8'd16;
+          crc     <= CRCSYNC;
+          end
+        end
       else
-        lastZero = 1; 
-      end
-    else 
-      begin
-      lastZero <= 0;
-      spizerocount <= 0;
+        begin
+        count <= count + 8'd1;
+
+        if (count < CRCBITS)
+          crc <= crcnext(crc, bitin);
+
+        // last bit, keep the packet if the version and CRC match
+        if (count == LASTBIT)
+          begin
+          inframe <= 0;
+
+          if (packet[111:96] == VERSION && packet[15:0] == crc)
+            begin
+            timedata <= packet[95:16];
+            good     <= 1;
+            end
+          else
+            errors <= errors + 8'd1;
+          end
+        end
       end
-    end
- 
-  // reset SPI buffer if sclk went low for ~0.2 ms = 8,000 clk cycles. 
-  assign reset = spizerocount > 8000;   
-  
-  
-  // 5-bit counter tracks when full 32 bit is transmitted from the PIC
-  always_ff @(negedge sclk, posedge reset) 
-    begin
-    if (reset)
-      cnt <= 0;
+    else if (idle < IDLECYCLES)
+      idle <= idle + 14'd1;
     else
-      cnt <= cnt + 5'b1;
+      inframe <= 0;                   // sclk stopped in the middle of a packet
     end
 
-    
-  // loadable shift register; once q is full, load it into output buffer (timeout)
-  always_ff @(posedge sclk) 
-    begin
-      timeout <=  (cnt == 0) ? q : timeout;
-      q       <=  {q[30:0], sdi};
-    end
-  
-  
-  // parse time information from output buffer
-  assign header = timeout[31];
-  assign year = timeout[30:26];
-  assign month = timeout[25:22];
-  assign day = timeout[21:17];
-  assign hour = timeout[16:12];
-  assign minute = timeout[11:6];
-  assign second= timeout[5:0];
+  // parse time information from the last good packet
+  assign header      = timedata[79];
+  assign year        = timedata[78:74];
+  assign month       = timedata[73:70];
+  assign day         = timedata[69:65];
+  assign hour        = timedata[64:60];
+  assign minute      = timedata[59:54];
+  assign second      = timedata[53:48];
+  assign millisecond = timedata[47:38];
+  assign dst         = timedata[37];
+  assign locked      = timedata[36];
+  assign synced      = timedata[35];
+  assign drift       = timedata[31:16];
+  assign sincesync   = timedata[15:0];
+  assign valid       = good;
+  assign crcerrors   = errors;
 
 endmodule
\ No newline at end of file
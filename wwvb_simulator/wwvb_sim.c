@@ -1,5 +1,4 @@
-#include <P32xxxx.h>
-#include <time.h>
+#include "../pic32/hal.h"
 #include "signal_out.h"
 
 #define MS100 62500
@@ -8,22 +7,22 @@
 int main()
 {
     /* initialize output */
-    TRISF = 0x0000;
+    halInitSignalPin();
 
 
     /* initialize timers */
-    T4CON = 0x8050;
+    halStartTickTimer();
 
     /* start timer */
-    TMR4 = 0;
+    halResetTickTimer();
 
-    while (1) {
+    while (halKeepRunning()) {
         /* update time */
         int current = signal_out();
-        while (TMR4 < MS100)
-            PORTF = current;
+        halWriteSignalPin(current);
+        halWaitTickTimer(MS100);
 
-        TMR4 = 0;
+        halResetTickTimer();
     }
 
     return 0;